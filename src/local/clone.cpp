@@ -40,6 +40,7 @@
 #include "Args.h"
 #include "restApi.h"
 #include "project/Project.h"
+#include "project/Object.h"
 #include "localClient.h"
 
 #define LOG_CLI(...) { printf(__VA_ARGS__); fflush(stdout);}
@@ -127,8 +128,7 @@ int pullObjects(const PullContext &ctx, const Project &p)
         trim(objectId);
         if (objectId.empty()) continue; // should not happen though
 
-        std::string destLocal = p.getObjectsDir() + "/" + Object::getSubpath(objectId);
-        if (fileExists(destLocal)) continue; // already in local repo
+        if (Object::exists(p.getObjectsDir(), objectId)) continue; // already in local repo
 
         // download
 
@@ -136,11 +136,19 @@ int pullObjects(const PullContext &ctx, const Project &p)
         LOG_CLI("\r%s: pulling files: %d", p.getName().c_str(), count);
 
         std::string url = urlFiles + "/" + objectId;
-        int r = HttpRequest::downloadFile(ctx.httpCtx, url, destLocal);
-        if (r != 0) {
+        std::string data;
+        int r = HttpRequest::downloadInMemory(ctx.httpCtx, url, data);
+        if (r < 0) {
             LOG_ERROR("Could not download %s: r=%d", url.c_str(), r);
             return -1;
         }
+
+        // store through the object layer (compression, escaping of the headers)
+        r = Object::writeToId(p.getObjectsDir(), data.data(), data.size(), objectId);
+        if (r < 0) {
+            LOG_ERROR("Could not store object %s: r=%d", objectId.c_str(), r);
+            return -1;
+        }
     }
 
     if (count > 0) LOG_CLI("\n");
@@ -278,7 +286,7 @@ Entry *mergeEntry(const Entry *localEntry, Issue &remoteIssue, const Issue &remo
     // - ignored
     // - kept
     // - interactively merged
-    std::map<std::string, std::list<std::string> >::const_iterator localProperty;
+    PropertiesCIt localProperty;
     FOREACH(localProperty, localEntry->properties) {
         std::string propertyName = localProperty->first;
         std::list<std::string> localValue = localProperty->second;
@@ -290,7 +298,7 @@ Entry *mergeEntry(const Entry *localEntry, Issue &remoteIssue, const Issue &remo
             continue;
         }
 
-        std::map<std::string, std::list<std::string> >::const_iterator remoteProperty;
+        PropertiesCIt remoteProperty;
 
         // look if the value in the local entry is the same as in the remote issue
         remoteProperty = remoteIssue.properties.find(propertyName);
@@ -349,12 +357,14 @@ Entry *mergeEntry(const Entry *localEntry, Issue &remoteIssue, const Issue &remo
     }
 
     // keep the message (ask for confirmation?)
-    if (localEntry->getMessage().size() > 0) {
+    std::string holder;
+    const std::string &localMessage = localEntry->getMessage(holder);
+    if (localMessage.size() > 0) {
         // if a conflict was detected before, then ask the user to keep the message of not
         if (isConflicting && ms == MERGE_INTERACTIVE) {
             LOG_CLI("Local message:\n");
             LOG_CLI("--------------------------------------------------\n");
-            LOG_CLI("%s\n", localEntry->getMessage().c_str());
+            LOG_CLI("%s\n", localMessage.c_str());
             LOG_CLI("--------------------------------------------------\n");
             std::string response;
             while (response != "k" && response != "K" && response != "d" && response != "D") {
@@ -363,14 +373,14 @@ Entry *mergeEntry(const Entry *localEntry, Issue &remoteIssue, const Issue &remo
             }
             if (response == "k" || response == "K") {
                 // keep the message
-                newProperties[K_MESSAGE].push_back(localEntry->getMessage());
+                newProperties[K_MESSAGE].push_back(localMessage);
             }
         } else if (isConflicting && ms == MERGE_DROP_LOCAL) {
             // drop the message
             LOG_DEBUG("Local message dropped.");
         } else {
             // no conflict on the properties. keep the message unchanged
-            newProperties[K_MESSAGE].push_back(localEntry->getMessage());
+            newProperties[K_MESSAGE].push_back(localMessage);
         }
     }
 
@@ -717,9 +727,8 @@ int pullProjectConfig(const PullContext &ctx, Project &p)
     LOG_CLI("  new project config: %s\n", id.c_str());
 
     // Check that the project config is valid.
-    std::string configPath = p.getObjectsDir() + "/" + Object::getSubpath(id);
     ProjectConfig dlConfig;
-    r = ProjectConfig::load(configPath, dlConfig, id);
+    r = ProjectConfig::load(p.getObjectsDir(), dlConfig, id);
     if (r != 0) return -1;
     if (dlConfig.properties.empty()) {
         LOG_ERROR("Invalid remote project config: no properties");
@@ -1285,11 +1294,19 @@ int getHead(const PullContext &pushCtx, const std::string &url)
     }
 }
 
-int pushFile(const PullContext &pushCtx, const std::string &localFile, const std::string &url,
-             int &httpStatusCode, std::string &response)
+/** Push an object (packed or loose) of the local repository
+  */
+int pushObject(const PullContext &pushCtx, const Project &p, const std::string &id, const std::string &url,
+               int &httpStatusCode, std::string &response)
 {
+    std::string data;
+    int r = Object::load(p.getObjectsDir(), id, data);
+    if (r != 0) {
+        LOG_ERROR("Cannot load local object '%s': %s", id.c_str(), strerror(errno));
+        return -1;
+    }
     HttpRequest hr(pushCtx.httpCtx);
-    int r = hr.postFile(localFile, url);
+    r = hr.postData(data, url);
     if (r == 0 && hr.lines.size()) response = hr.lines.front();
     httpStatusCode = hr.httpStatusCode;
     return r;
@@ -1313,11 +1330,10 @@ int pushEntry(const PullContext &pushCtx, const Project &p, std::string &issue,
     LOG_CLI("Pushing entry: %s / %s / %s\n", p.getName().c_str(), issue.c_str(), entry.c_str());
     // post the entry (which must be the first entry of an issue)
     // the result of the POST indicates the issue number that has been allocated
-    std::string localFile = p.getObjectsDir() + '/' + Object::getSubpath(entry);
     std::string url = pushCtx.rooturl + '/' + p.getUrlName() + "/" RESOURCE_ISSUES "/" + issue + '/' + entry;
     std::string response;
     int httpStatusCode = 0;
-    int r = pushFile(pushCtx, localFile, url, httpStatusCode, response);
+    int r = pushObject(pushCtx, p, entry, url, httpStatusCode, response);
     if (httpStatusCode == 409) {
         // conflict
         LOG_ERROR("Conflict for pushing entry of project %s: %s/%s",
@@ -1350,10 +1366,10 @@ void pushAttachedFiles(const PullContext &pushCtx, const Project &p, const Entry
     LOG_FUNC();
     LOG_DEBUG("Pushing files attached to entry %s", e.id.c_str());
 
-    PropertiesIt files = e.properties.find(K_FILE);
+    PropertiesCIt files = e.properties.find(K_FILE);
     if (files != e.properties.end()) {
         LOG_DEBUG("Entry %s has files: %s", e.id.c_str(), toString(files->second).c_str());
-        std::list<std::string>::const_iterator f;
+        PropertyValuesIt f;
         FOREACH(f, files->second) {
             // file is like: <object-id>/<basename>
             std::string fid = *f;
@@ -1371,11 +1387,10 @@ void pushAttachedFiles(const PullContext &pushCtx, const Project &p, const Entry
                 }
 
                 LOG_CLI("Pushing file %s...\n", f->c_str());
-                std::string localPath = p.getObjectsDir() + "/" + Object::getSubpath(id);
                 std::string url = pushCtx.rooturl + '/' + p.getUrlName() + "/" RESOURCE_FILES "/" + id;
                 std::string response;
                 int httpStatusCode = 0;
-                int r = pushFile(pushCtx, localPath, url, httpStatusCode, response);
+                int r = pushObject(pushCtx, p, id, url, httpStatusCode, response);
 
                 if (r != 0) {
                     LOG_ERROR("Cannot push file: %s (HTTP %d)", url.c_str(), httpStatusCode);
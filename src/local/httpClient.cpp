@@ -197,7 +197,6 @@ int HttpRequest::head(const std::string &url)
 
 int HttpRequest::postFile(const std::string &srcFile, const std::string &destUrl)
 {
-    CURLcode res;
     struct stat file_info;
     FILE *fd;
 
@@ -236,11 +235,42 @@ int HttpRequest::postFile(const std::string &srcFile, const std::string &destUrl
     curl_easy_setopt(curlHandle, CURLOPT_WRITEDATA, (void *)this);
     curl_easy_setopt(curlHandle, CURLOPT_WRITEFUNCTION, receiveLinesCallback);
 
+    int r = performUpload();
+    fclose(fd);
+
+    return r;
+}
+
+/** Post data from memory
+  */
+int HttpRequest::postData(const std::string &data, const std::string &destUrl)
+{
+    LOG_DEBUG("post data: size %ldo", L(data.size()));
+
+    curl_easy_setopt(curlHandle, CURLOPT_URL, destUrl.c_str());
+    curl_easy_setopt(curlHandle, CURLOPT_CUSTOMREQUEST, "POST");
+    headerList = curl_slist_append(headerList, "Content-type: application/octet-stream");
+    curl_easy_setopt(curlHandle, CURLOPT_HTTPHEADER, headerList);
+
+    curl_easy_setopt(curlHandle, CURLOPT_POSTFIELDS, data.data());
+    curl_easy_setopt(curlHandle, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)data.size());
+
+    curl_easy_setopt(curlHandle, CURLOPT_WRITEDATA, (void *)this);
+    curl_easy_setopt(curlHandle, CURLOPT_WRITEFUNCTION, receiveLinesCallback);
+
+    return performUpload();
+}
+
+/** Perform an upload prepared by postFile() or postData()
+  */
+int HttpRequest::performUpload()
+{
+    CURLcode res;
+
     /* enable verbose for easier tracing */
     if (getLoggingLevel() > LL_INFO) curl_easy_setopt(curlHandle, CURLOPT_VERBOSE, 1L);
 
     res = curl_easy_perform(curlHandle);
-    fclose(fd);
 
     /* Check for errors */
     if (res != CURLE_OK) {
@@ -37,6 +37,7 @@ public:
     void getRequestRaw();
     void post(const std::string &params);
     int postFile(const std::string &srcFile, const std::string &destUrl);
+    int postData(const std::string &data, const std::string &destUrl);
     int head(const std::string &url);
 
     std::map<std::string, Cookie> cookies;
@@ -78,6 +79,7 @@ public:
 
 private:
     void performRequest();
+    int performUpload();
     std::string url;
     std::string response;
     std::string sessionId;
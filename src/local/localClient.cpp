@@ -89,7 +89,7 @@ void printHeader(const char *header)
 
 void printProperties(const IssueCopy &i)
 {
-    PropertiesIt p;
+    PropertiesCIt p;
     printHeader("Properties");
     FOREACH(p, i.properties) {
         if (p->first == K_SUMMARY) continue;
@@ -102,7 +102,8 @@ void printMessages(const IssueCopy &i, int printMode)
     const Entry *e = i.first;
     while (e) {
         bool doPrint = false; // used to know ifn the header must be printed
-        std::string msg = e->getMessage();
+        std::string holder;
+        const std::string &msg = e->getMessage(holder);
 
         if (e->isAmending()) doPrint = false;
         else if (msg.size() || (printMode & PRINT_FULL_HISTORY) ) doPrint = true;
@@ -137,7 +138,7 @@ void printMessages(const IssueCopy &i, int printMode)
             if (printMode & PRINT_FULL_HISTORY) {
                 // print the properties changes
                 // process summary first as it is not part of orderedFields
-                PropertiesIt p;
+                PropertiesCIt p;
                 FOREACH(p, e->properties) {
                     if (p->first == K_MESSAGE) continue;
                     if (noModifiedPropertiesSoFar) {
@@ -173,7 +174,7 @@ void printAllIssues(const Project &p)
     const std::map<std::string, std::list<std::string> > filterOut;
 
     std::vector<IssueCopy> issueList;
-    p.search("", filterIn, filterOut, "id", issueList);
+    p.search("", filterIn, filterOut, "id", issueList, 0, -1, 0, false);
     std::vector<IssueCopy>::const_iterator i;
     FOREACH(i, issueList) {
         printIssue(*i, PRINT_SUMMARY);
@@ -37,6 +37,10 @@
 #include "utils/identifiers.h"
 #include "utils/filesystem.h"
 #include "repository/db.h"
+#include "repository/scrubber.h"
+#include "repository/refWatcher.h"
+#include "project/Object.h"
+#include "project/MessageCache.h"
 #include "user/session.h"
 #include "global.h"
 #include "local/localClient.h"
@@ -54,6 +58,7 @@ void usage()
 #ifdef CURL_ENABLED
            "  clone       Clone a smit repository\n"
 #endif
+           "  fsck        Verify the integrity of the objects of the projects\n"
            "  init        Initialise a smit repository\n"
            "  issue       Print or modify an issue in a local project\n"
            "  project     List, create, or update a smit project\n"
@@ -61,6 +66,7 @@ void usage()
            "  pull        Fetch from and merge with a remote repository\n"
            "  push        Push local changes to a remote repository\n"
 #endif
+           "  repack      Move the loose objects of projects into packs\n"
            "  serve       Start a smit web server\n"
            "  user        List, create, or update a smit user\n"
            "  ui          Browse a local smit repository (read-only)\n"
@@ -526,6 +532,190 @@ int cmdUser(int argc, char **argv)
     return 0;
 }
 
+int helpRepack()
+{
+    printf("Usage: smit repack [<repository>] [options]\n"
+           "\n"
+           "  Move the loose objects of all projects of a repository into packs.\n"
+           "  A server must not be running on the repository.\n"
+           "\n"
+           "  <repository>      select a repository (by default . is used)\n"
+           "\n"
+           "Options:\n"
+           "  -v    be verbose (debug)\n"
+           );
+    return 1;
+}
+
+/** Repack recursively the projects under the given path
+  *
+  * @return
+  *    0 success
+  *   -1 error
+  */
+static int repackProjects(const std::string &path)
+{
+    int result = 0;
+    std::list<std::string> paths;
+    Database::findProjects(path, true, paths);
+
+    std::list<std::string>::const_iterator p;
+    FOREACH(p, paths) {
+        std::string objectsDir = *p + "/" PATH_OBJECTS;
+        int n = Object::repack(objectsDir);
+        if (n < 0) {
+            printf("%s: repack failed\n", p->c_str());
+            result = -1;
+        } else {
+            printf("%s: %d object(s) packed\n", p->c_str(), n);
+        }
+    }
+    return result;
+}
+
+int cmdRepack(int argc, char **argv)
+{
+    const char *repo = ".";
+
+    int c;
+    int optionIndex = 0;
+    struct option longOptions[] = { {NULL, 0, NULL, 0} };
+    while ((c = getopt_long(argc, argv, "v", longOptions, &optionIndex)) != -1) {
+        switch (c) {
+        case 'v':
+            setLoggingLevel(LL_DIAG);
+            break;
+        case '?': // incorrect syntax, a message is printed by getopt_long
+            return helpRepack();
+            break;
+        default:
+            printf("?? getopt returned character code 0x%x ??\n", c);
+            return helpRepack();
+        }
+    }
+    // manage non-option ARGV elements
+    if (optind < argc) {
+        repo = argv[optind];
+        optind++;
+    }
+    if (optind < argc) {
+        printf("Too many arguments.\n\n");
+        return helpRepack();
+    }
+
+    setLoggingOption(LO_CLI);
+
+    // prevent a server from running concurrently
+    std::string dotLock = repo;
+    dotLock += "/.lock";
+    int lockFd = lockFile(dotLock);
+    if (lockFd < 0) {
+        LOG_ERROR("Cannot lock repository: %s", dotLock.c_str());
+        return 1;
+    }
+
+    int r = repackProjects(repo);
+    if (r < 0) return 1;
+    return 0; // the lock is released on exit
+}
+
+int helpFsck()
+{
+    printf("Usage: smit fsck [<repository>] [options]\n"
+           "\n"
+           "  Verify that the contents of the objects of all projects of a repository\n"
+           "  match their sha1, and print the corrupted ones.\n"
+           "\n"
+           "  <repository>      select a repository (by default . is used)\n"
+           "\n"
+           "Options:\n"
+           "  -j <n>    number of threads (default is the number of processors)\n"
+           "  -v        be verbose (debug)\n"
+           );
+    return 1;
+}
+
+/** Verify the objects of the projects under the given path
+  *
+  * @return
+  *    number of corrupted objects
+  */
+static size_t fsckProjects(const std::string &path, int nWorkers)
+{
+    std::list<std::string> paths;
+    Database::findProjects(path, true, paths);
+
+    std::list<ObjectBatch*> batches;
+    std::list<std::string>::const_iterator p;
+    FOREACH(p, paths) {
+        Scrubber::makeBatches(*p, *p + "/" PATH_OBJECTS, batches);
+    }
+
+    ThreadPool pool(nWorkers);
+    std::list<ObjectBatch*>::iterator batch;
+    FOREACH(batch, batches) pool.submit(Scrubber::verifyBatch, *batch);
+    pool.waitAll();
+
+    size_t nVerified = 0;
+    size_t nCorrupted = 0;
+    FOREACH(batch, batches) {
+        nVerified += (*batch)->ids.size();
+        std::list<std::string>::const_iterator id;
+        FOREACH(id, (*batch)->corrupted) {
+            printf("%s: corrupted object %s\n", (*batch)->project.c_str(), id->c_str());
+            nCorrupted++;
+        }
+        delete *batch;
+    }
+    printf("%lu object(s) verified, %lu corrupted\n", L(nVerified), L(nCorrupted));
+    return nCorrupted;
+}
+
+int cmdFsck(int argc, char **argv)
+{
+    const char *repo = ".";
+    int nWorkers = ThreadPool::getNumCpus();
+
+    int c;
+    int optionIndex = 0;
+    struct option longOptions[] = { {NULL, 0, NULL, 0} };
+    while ((c = getopt_long(argc, argv, "j:v", longOptions, &optionIndex)) != -1) {
+        switch (c) {
+        case 'j':
+            nWorkers = atoi(optarg);
+            if (nWorkers < 1) {
+                printf("Invalid number of threads: %s\n\n", optarg);
+                return helpFsck();
+            }
+            break;
+        case 'v':
+            setLoggingLevel(LL_DIAG);
+            break;
+        case '?': // incorrect syntax, a message is printed by getopt_long
+            return helpFsck();
+            break;
+        default:
+            printf("?? getopt returned character code 0x%x ??\n", c);
+            return helpFsck();
+        }
+    }
+    // manage non-option ARGV elements
+    if (optind < argc) {
+        repo = argv[optind];
+        optind++;
+    }
+    if (optind < argc) {
+        printf("Too many arguments.\n\n");
+        return helpFsck();
+    }
+
+    setLoggingOption(LO_CLI);
+
+    size_t n = fsckProjects(repo, nWorkers);
+    if (n > 0) return 1;
+    return 0;
+}
+
 int helpServe()
 {
     printf("Usage: smit serve [<repository>] [options]\n"
@@ -542,10 +732,60 @@ int helpServe()
            "                         including public and private key.\n"
            "  --url-rewrite-root\n"
            "                         set URL-rewriting root, for usage behind a reverse proxy.\n"
+           "  --load-workers <n>\n"
+           "                         set the number of threads loading the projects at\n"
+           "                         startup (default is the number of processors).\n"
+           "  --message-cache <MB>\n"
+           "                         do not keep the messages of the entries in memory,\n"
+           "                         but read them when needed, through a cache of the\n"
+           "                         given size (default is 0: all messages are kept).\n"
+           "  --cache-interval <seconds>\n"
+           "                         set the period of storing the cache of the projects\n"
+           "                         (default is 600). 0 means storing only when stopping.\n"
+           "  --scrub-period <seconds>\n"
+           "                         set the period of the verification of the objects\n"
+           "                         in the background (default is 86400). 0 disables it.\n"
            );
     return 1;
 }
 
+static volatile sig_atomic_t StopSignal = 0;
+static int CacheInterval = 600; // seconds between 2 periodic stores of the caches of the projects
+
+static void onStopSignal(int sig)
+{
+    StopSignal = sig;
+}
+
+/** Block until SIGINT or SIGTERM
+  *
+  * Meanwhile, store periodically the caches of the projects.
+  * On reception of the signal, store the entries pending in the journals,
+  * store the caches a last time, and terminate.
+  */
+static void waitUntilStopped()
+{
+    signal(SIGINT, onStopSignal);
+    signal(SIGTERM, onStopSignal);
+
+    time_t lastStore = time(0);
+    while (!StopSignal) {
+        usleep(100*1000); // the signal may be delivered to another thread
+        if (CacheInterval > 0 && time(0) - lastStore >= CacheInterval) {
+            Database::storeCaches();
+            lastStore = time(0);
+        }
+    }
+
+    LOG_INFO("Storing the caches of the projects before stopping...");
+    Database::flushJournals();
+    Database::storeCaches();
+
+    // terminate as if the signal had not been caught
+    signal(StopSignal, SIG_DFL);
+    raise(StopSignal);
+}
+
 int serveRepository(int argc, char **argv)
 {
     LOG_INFO("Starting Smit v" VERSION);
@@ -554,6 +794,7 @@ int serveRepository(int argc, char **argv)
     const char *repo = 0;
     const char *certificatePemFile = 0;
     const char *urlRewritingRoot = 0;
+    int scrubPeriod = 86400;
 
     int c;
     int optionIndex = 0;
@@ -561,6 +802,10 @@ int serveRepository(int argc, char **argv)
         {"listen-port", 1, 0, 0},
         {"ssl-cert", 1, 0, 0},
         {"url-rewrite-root", 1, 0, 0},
+        {"load-workers", 1, 0, 0},
+        {"cache-interval", 1, 0, 0},
+        {"message-cache", 1, 0, 0},
+        {"scrub-period", 1, 0, 0},
         {NULL, 0, NULL, 0}
     };
     optind = 1; // reset this in case cmdUi has already parsed with getopt_long
@@ -571,6 +816,33 @@ int serveRepository(int argc, char **argv)
             if (0 == strcmp(longOptions[optionIndex].name, "listen-port")) listenPort = optarg;
             else if (0 == strcmp(longOptions[optionIndex].name, "ssl-cert")) certificatePemFile = optarg;
             else if (0 == strcmp(longOptions[optionIndex].name, "url-rewrite-root")) urlRewritingRoot = optarg;
+            else if (0 == strcmp(longOptions[optionIndex].name, "load-workers")) {
+                int n = atoi(optarg);
+                if (n < 1) {
+                    printf("Invalid number of workers: %s\n\n", optarg);
+                    return helpServe();
+                }
+                Database::setLoadWorkers(n);
+            } else if (0 == strcmp(longOptions[optionIndex].name, "message-cache")) {
+                int mb = atoi(optarg);
+                if (mb < 0) {
+                    printf("Invalid size of message cache: %s\n\n", optarg);
+                    return helpServe();
+                }
+                MessageCache::setCapacity((size_t)mb*1024*1024);
+            } else if (0 == strcmp(longOptions[optionIndex].name, "cache-interval")) {
+                CacheInterval = atoi(optarg);
+                if (CacheInterval < 0) {
+                    printf("Invalid cache interval: %s\n\n", optarg);
+                    return helpServe();
+                }
+            } else if (0 == strcmp(longOptions[optionIndex].name, "scrub-period")) {
+                scrubPeriod = atoi(optarg);
+                if (scrubPeriod < 0) {
+                    printf("Invalid scrub period: %s\n\n", optarg);
+                    return helpServe();
+                }
+            }
             break;
         case 'd':
             loglevel++;
@@ -623,6 +895,9 @@ int serveRepository(int argc, char **argv)
 
     initHttpStats();
 
+    if (scrubPeriod > 0) Scrubber::start(scrubPeriod);
+    RefWatcher::start();
+
     MongooseServerContext *mc = new MongooseServerContext();
     mc->setRequestHandler(begin_request_handler);
     mc->setListeningPort(listenPort);
@@ -657,7 +932,7 @@ int serveRepository(int argc, char **argv)
     }
 
     if (!UserBase::isLocalUserInterface()) {
-        while (1) sleep(1); // block until ctrl-C
+        waitUntilStopped();
     }
     // else, we return, and the cmdUi() will launch the web browser
 
@@ -830,7 +1105,7 @@ int cmdUi(int argc, char **argv)
     }
     printf("Hit Ctrl-C to stop the local server\n");
 
-    while (1) sleep(1); // block until ctrl-C
+    waitUntilStopped();
 
 #else // _WIN32
     // start local server
@@ -916,6 +1191,12 @@ int main(int argc, char **argv)
         } else if (0 == strcmp(command, "ui")) {
             return cmdUi(argc-1, argv+1);
 
+        } else if (0 == strcmp(command, "repack")) {
+            return cmdRepack(argc-1, argv+1);
+
+        } else if (0 == strcmp(command, "fsck")) {
+            return cmdFsck(argc-1, argv+1);
+
         } else if (0 == strcmp(command, "help")) {
             if (i < argc) {
                 const char *help = argv[i];
@@ -925,6 +1206,8 @@ int main(int argc, char **argv)
                 else if (0 == strcmp(help, "user")) return helpUser();
                 else if (0 == strcmp(help, "serve")) return helpServe();
                 else if (0 == strcmp(help, "ui")) return helpUi();
+                else if (0 == strcmp(help, "repack")) return helpRepack();
+                else if (0 == strcmp(help, "fsck")) return helpFsck();
 #ifdef CURL_ENABLED
                 else if (0 == strcmp(help, "clone")) return helpClone(0);
                 else if (0 == strcmp(help, "pull")) return helpPull(0);
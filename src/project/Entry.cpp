@@ -30,6 +30,9 @@
 #include <unistd.h>
 
 #include "Entry.h"
+#include "Issue.h"
+#include "MessageCache.h"
+#include "ObjectPack.h"
 #include "utils/parseConfig.h"
 #include "utils/filesystem.h"
 #include "utils/logging.h"
@@ -38,67 +41,84 @@
 #include "global.h"
 #include "mg_win32.h"
 
-const std::string Entry::EMPTY_MESSAGE("");
 
 
-/** Load an entry from a file
+/** Load an entry from the objects database (packed or loose)
+  *
+  * A packed entry is parsed directly in the mapped pack, without copy,
+  * unless it is compressed.
   *
   * @param id
   *     id of the new Entry instance to be created
   */
-Entry *Entry::loadEntry(const std::string &path, const std::string &id)
+Entry *Entry::loadEntry(const std::string &objectsDir, const std::string &id)
 {
+    size_t size;
+    const char *packed = ObjectPack::lookup(objectsDir, id, size);
+    if (packed && Object::getCodec(packed, size) == OBJECT_CODEC_NONE) {
+        return loadEntryFromBuffer(packed, size, id);
+    }
+
     // load a given entry
     std::string buf;
-    int n = loadFile(path.c_str(), buf);
+    int n = Object::load(objectsDir, id, buf);
 
     if (n < 0) {
-        // error loading the file
-        LOG_ERROR("Cannot load entry '%s': %s", path.c_str(), strerror(errno));
+        // error loading the object
+        LOG_ERROR("Cannot load entry '%s': %s", id.c_str(), strerror(errno));
         return 0;
     }
     return loadEntryFromBuffer(buf, id);
 }
 
+Entry *Entry::loadEntryFromBuffer(const std::string &data, const std::string &id)
+{
+    return loadEntryFromBuffer(data.data(), data.size(), id);
+}
+
 /** Load an entry from a buffer
+  *
+  * The buffer is tokenized in place (see TokenViews), and only the
+  * values kept in the entry are copied.
+  *
+  * The sha1 of the buffer is not verified here (see Scrubber).
   *
   * @param id
   *     id of the new Entry instance to be created
   */
-Entry *Entry::loadEntryFromBuffer(const std::string &data, const std::string &id)
+Entry *Entry::loadEntryFromBuffer(const char *data, size_t size, const std::string &id)
 {
-    // log if sha1 does not match
-    std::string hash = getSha1(data);
-    if (0 != hash.compare(id)) {
-        LOG_ERROR("Hash does not match: entry=%s, sha1=%s", id.c_str(), hash.c_str());
-    }
-
     Entry *e = new Entry;
     e->id = id;
 
-    std::list<std::list<std::string> > lines = parseConfigTokens(data.c_str(), data.size());
+    TokenViews views;
+    views.parse(data, size);
 
-    std::list<std::list<std::string> >::iterator line;
-    int lineNum = 0;
+    size_t line;
     std::string smitVersion = "1.0"; // default value if version is not present
-    for (line=lines.begin(); line != lines.end(); line++) {
-        lineNum++;
+    for (line=0; line < views.getNumLines(); line++) {
         // each line should be a key / value pair
-        if (line->empty()) continue; // ignore this line
+        size_t begin = views.lineBegin(line);
+        size_t end = views.lineEnd(line);
+        if (begin == end) continue; // ignore this line
 
-        std::string key = line->front();
-        line->pop_front(); // remove key from tokens
-        std::string firstValue;
+        const TokenView &key = views.tokens[begin];
         // it is allowed for multiselects and associations to have no value
-        if (line->size() >= 1) firstValue = line->front();
-
-        if (0 == key.compare(K_CTIME)) {
-            e->ctime = atoi((char*)firstValue.c_str());
-        } else if (0 == key.compare(K_PARENT)) e->parent = firstValue;
-        else if (0 == key.compare(K_AUTHOR)) e->author = firstValue;
-        else if (key == K_SMIT_VERSION) smitVersion = firstValue;
-        else {
-            e->properties[key] = *line;
+        size_t firstValue = begin + 1;
+
+        if (views.equals(key, K_CTIME)) {
+            if (firstValue < end) e->ctime = atoi(views.str(views.tokens[firstValue]).c_str());
+        } else if (views.equals(key, K_PARENT)) {
+            if (firstValue < end) e->parent = views.str(views.tokens[firstValue]);
+        } else if (views.equals(key, K_AUTHOR)) {
+            if (firstValue < end) e->author = views.str(views.tokens[firstValue]);
+        } else if (views.equals(key, K_SMIT_VERSION)) {
+            if (firstValue < end) smitVersion = views.str(views.tokens[firstValue]);
+        } else {
+            PropertyValues &values = e->properties[views.str(key)];
+            values.clear();
+            size_t tok;
+            for (tok=firstValue; tok<end; tok++) values.push_back(views.str(views.tokens[tok]));
         }
     }
 
@@ -127,16 +147,89 @@ void Entry::setId()
 
 void Entry::updateMessage()
 {
-    // update pointer to message
-    std::map<std::string, std::list<std::string> >::const_iterator t = properties.find(K_MESSAGE);
-    const std::string *m;
-    if (t != properties.end() && (t->second.size()>0) ) m = &(t->second.front());
-    else m = &EMPTY_MESSAGE;
+    if (messageInObject || properties.count(K_MESSAGE)) setMessageOwner(this);
+    else setMessageOwner(0);
+}
 
-    setMessage(m);
+static const std::string NoMessage;
+
+/** Get the message of the entry, possibly amended by a later entry
+  *
+  * @param holder
+  *     receives the message if it is not resident (see getOwnMessage)
+  */
+const std::string &Entry::getMessage(std::string &holder) const
+{
+    const Entry *owner = getMessageOwner();
+    if (!owner) return NoMessage;
+    return owner->getOwnMessage(holder);
+}
+
+/** Get the message carried by this entry itself (not amended)
+  *
+  * A resident message is returned by reference, without copy. Otherwise,
+  * it is fetched through the MessageCache into the holder, and the
+  * reference to the holder is returned.
+  */
+const std::string &Entry::getOwnMessage(std::string &holder) const
+{
+    if (messageInObject) {
+        if (!issue) {
+            LOG_ERROR("Cannot get message of entry %s: no issue", id.c_str());
+            return NoMessage;
+        }
+        holder = MessageCache::get(issue->project, id);
+        return holder;
+    }
+
+    PropertiesCIt m = properties.find(K_MESSAGE);
+    if (m == properties.end() || m->second.empty()) return NoMessage;
+    return m->second.front();
+}
+
+/** Remove the message from the properties
+  *
+  * The message remains available via getMessage() and getOwnMessage().
+  */
+void Entry::dropMessage()
+{
+    if (!properties.count(K_MESSAGE)) return;
+
+    properties.erase(K_MESSAGE);
+    messageInObject = true;
+}
+
+/** Estimate the memory used by the entry (heap overhead not included)
+  */
+size_t Entry::getResidentSize() const
+{
+    size_t n = sizeof(Entry) + id.size() + parent.size() + author.size();
+    PropertiesCIt p;
+    FOREACH(p, properties) {
+        // the interned strings are shared, and not counted here
+        n += sizeof(Properties::Property);
+        PropertyValuesIt v;
+        FOREACH(v, p->second) {
+            n += sizeof(IString);
+            if (!v->isInterned()) n += sizeof(std::string) + v->size();
+        }
+    }
+    return n;
 }
 
 Entry *Entry::createNewEntry(const PropertiesMap &props, const std::string &author, const Entry *eParent)
+{
+    std::string data;
+    return createNewEntry(props, author, eParent ? eParent->id : K_PARENT_NULL, data);
+}
+
+/** Create a new entry, and give its serialized data
+  *
+  * @param      parentId  K_PARENT_NULL for the first entry of an issue
+  * @param[out] data      the data to be stored as the object of the entry
+  */
+Entry *Entry::createNewEntry(const PropertiesMap &props, const std::string &author,
+                             const std::string &parentId, std::string &data)
 {
     Entry *e = new Entry();
     e->properties = props;
@@ -145,10 +238,10 @@ Entry *Entry::createNewEntry(const PropertiesMap &props, const std::string &auth
 
     e->updateMessage();
 
-    if (eParent) e->parent = eParent->id;
-    else e->parent = K_PARENT_NULL;
+    e->parent = parentId;
 
-    e->setId();
+    data = e->serialize();
+    e->id = getSha1(data);
 
     return e;
 }
@@ -171,7 +264,7 @@ std::string Entry::serialize() const
     s << serializeProperty(K_AUTHOR, author);
     s << K_CTIME << " " << ctime << "\n";
 
-    std::map<std::string, std::list<std::string> >::const_iterator p;
+    PropertiesCIt p;
     for (p = properties.begin(); p != properties.end(); p++) {
         std::string key = p->first;
         std::list<std::string> value = p->second;
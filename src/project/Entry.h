@@ -10,6 +10,7 @@
 
 #include "utils/ustring.h"
 #include "utils/stringTools.h"
+#include "utils/properties.h"
 #include "Object.h"
 
 #define K_MESSAGE     "+message" // keyword used for the message
@@ -74,22 +75,29 @@ public:
     std::string id; // unique id of this entry
     long ctime; // creation time
     std::string author;
-    PropertiesMap properties;
+    Properties properties;
     Issue *issue;
 
 
     // methods
-    Entry() : ctime(0), issue(0), next(0), prev(0), message(&EMPTY_MESSAGE) {}
-    static Entry *loadEntry(const std::string &path, const std::string &id);
+    Entry() : ctime(0), issue(0), next(0), prev(0), messageOwner(0), messageInObject(false) {}
+    static Entry *loadEntry(const std::string &objectsDir, const std::string &id);
     static Entry *loadEntryFromBuffer(const std::string &data, const std::string &id);
+    static Entry *loadEntryFromBuffer(const char *data, size_t size, const std::string &id);
 
     void setId();
     void updateMessage();
     std::string serialize() const;
     int getCtime() const;
 
-    inline const std::string &getMessage() const { return *((const std::string*)atomicGet(message)); }
-    inline void setMessage(const std::string *msg) { atomicSet((const void**)&message, msg); }
+    const std::string &getMessage(std::string &holder) const;
+    const std::string &getOwnMessage(std::string &holder) const;
+    inline const Entry *getMessageOwner() const { return (const Entry *)atomicGet(messageOwner); }
+    inline void setMessageOwner(const Entry *owner) { atomicSet((const void**)&messageOwner, owner); }
+    void dropMessage();
+    inline bool isMessageInObject() const { return messageInObject; }
+    inline void setMessageInObject() { messageInObject = true; }
+    size_t getResidentSize() const;
 
     inline Entry *getNext() const { return (Entry *)atomicGet(next); }
     inline void setNext(Entry *nextEntry) { atomicSet((const void**)&next, nextEntry); }
@@ -102,6 +110,8 @@ public:
     inline std::string getSubpath() const { return Object::getSubpath(id); }
     static inline std::string getSubpath(const std::string identifier) { return Object::getSubpath(identifier); }
     static Entry *createNewEntry(const PropertiesMap &props, const std::string &author, const Entry *eParent);
+    static Entry *createNewEntry(const PropertiesMap &props, const std::string &author,
+                                 const std::string &parentId, std::string &data);
 
     // methods managing the linked list
     void append(Entry *e);
@@ -115,14 +125,17 @@ private:
     struct Entry *next; // child
     struct Entry *prev; // parent
 
-    /** The member "message" points to :
+    /** The member "messageOwner" points to the entry that holds the message:
       * - either null if no message
-      * - or this->properties[K_MESSAGE]
-      * - or to the message of the latest amending entry
+      * - or this
+      * - or the latest amending entry
       */
-    const std::string *message;
+    const Entry *messageOwner;
 
-    static const std::string EMPTY_MESSAGE;
+    /** The message was dropped from the properties (see MessageCache)
+      * and must be read from the object of the entry
+      */
+    bool messageInObject;
 
 };
 
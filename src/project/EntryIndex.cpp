@@ -0,0 +1,122 @@
+/*   Small Issue Tracker
+ *   Copyright (C) 2013 Frederic Hoerni
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License v2 as published by
+ *   the Free Software Foundation.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ */
+#include "config.h"
+
+#include <algorithm>
+
+#include "EntryIndex.h"
+#include "Entry.h"
+#include "utils/dateTools.h"
+#include "utils/logging.h"
+#include "global.h"
+
+EntryIndex::EntryIndex() : built(false)
+{
+}
+
+bool EntryIndex::lessCtime(const Entry *a, const Entry *b)
+{
+    if (a->ctime != b->ctime) return a->ctime < b->ctime;
+    return a->id < b->id;
+}
+
+/** Index a new entry
+  *
+  * Does nothing if the index is not built yet.
+  */
+void EntryIndex::addEntry(const Entry *e)
+{
+    ScopeLocker scopeLocker(locker, LOCK_READ_WRITE);
+    if (built) {
+        if (order.empty() || lessCtime(order.back(), e)) order.push_back(e);
+        else order.insert(std::upper_bound(order.begin(), order.end(), e, lessCtime), e);
+    }
+}
+
+/** Remove an entry from the index, before it is deleted
+  */
+void EntryIndex::removeEntry(const Entry *e)
+{
+    ScopeLocker scopeLocker(locker, LOCK_READ_WRITE);
+    if (built) {
+        std::vector<const Entry*>::iterator it = std::lower_bound(order.begin(), order.end(), e, lessCtime);
+        if (it != order.end() && *it == e) order.erase(it);
+    }
+}
+
+void EntryIndex::build(const std::map<std::string, Entry*> &entries)
+{
+    double t0 = getSeconds();
+
+    order.clear();
+    order.reserve(entries.size());
+    std::map<std::string, Entry*>::const_iterator e;
+    FOREACH(e, entries) order.push_back(e->second);
+    std::sort(order.begin(), order.end(), lessCtime);
+    built = true;
+
+    LOG_INFO("Entry index built: %ld entries (%.3fs)", L(order.size()), getSeconds() - t0);
+}
+
+/** Build the index, if not built yet (see BuildLocker)
+  */
+void EntryIndex::buildIfNeeded(const std::map<std::string, Entry*> &entries)
+{
+    BuildLocker buildLocker(locker);
+    if (built) return;
+
+    buildLocker.lockForBuilding();
+    if (!built) build(entries); // else built by a concurrent request meanwhile
+}
+
+/** Get a page of the entries, in the order of their ctime
+  *
+  * @param ascending
+  *     false for the latest entries first
+  *
+  * @param cursor
+  *     if not null, the page starts after this entry (in the given order)
+  *
+  * @param limit
+  *     maximum number of entries (-1 for no limit)
+  */
+void EntryIndex::getEntries(const std::map<std::string, Entry*> &entries, bool ascending, const Entry *cursor,
+                            int limit, std::vector<const Entry*> &result)
+{
+    buildIfNeeded(entries);
+
+    ScopeLocker scopeLocker(locker, LOCK_READ_ONLY);
+    // the page is [first, end) in ascending order, [end, first) in descending order
+    size_t first = ascending ? 0 : order.size();
+    if (cursor) {
+        if (ascending) first = std::upper_bound(order.begin(), order.end(), cursor, lessCtime) - order.begin();
+        else first = std::lower_bound(order.begin(), order.end(), cursor, lessCtime) - order.begin();
+    }
+
+    size_t n = ascending ? order.size() - first : first;
+    if (limit >= 0 && (size_t)limit < n) n = limit;
+
+    result.reserve(result.size() + n);
+    for (size_t k = 0; k < n; k++) {
+        if (ascending) result.push_back(order[first + k]);
+        else result.push_back(order[first - 1 - k]);
+    }
+}
+
+/** Exchange the contents of 2 indexes (see BuildLocker)
+  */
+void EntryIndex::swap(EntryIndex &other)
+{
+    std::swap(built, other.built);
+    order.swap(other.order);
+}
@@ -0,0 +1,42 @@
+#ifndef _EntryIndex_h
+#define _EntryIndex_h
+
+#include <string>
+#include <map>
+#include <vector>
+
+#include "utils/mutexTools.h"
+
+class Entry;
+
+/** Index of the entries of a project, in the order of their ctime
+  *
+  * The entries are sorted by ctime, and then by id for the entries of
+  * the same ctime. The latest (or oldest) entries are thus read at the end
+  * (or beginning) of the index, without sorting all the entries. A cursor
+  * (an entry) gives the position where a page starts.
+  *
+  * The index is built on the first use, and then kept up to date by the
+  * modifications of the 'entries' table of the project (see BuildLocker).
+  * The new entries are usually the latest, and are appended.
+  */
+class EntryIndex {
+public:
+    EntryIndex();
+    void addEntry(const Entry *e);
+    void removeEntry(const Entry *e);
+    void getEntries(const std::map<std::string, Entry*> &entries, bool ascending, const Entry *cursor,
+                    int limit, std::vector<const Entry*> &result);
+    void swap(EntryIndex &other);
+
+private:
+    void build(const std::map<std::string, Entry*> &entries);
+    void buildIfNeeded(const std::map<std::string, Entry*> &entries);
+    static bool lessCtime(const Entry *a, const Entry *b);
+
+    bool built;
+    std::vector<const Entry*> order; // sorted by ctime, then by id
+    Locker locker;
+};
+
+#endif
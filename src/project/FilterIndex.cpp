@@ -0,0 +1,321 @@
+/*   Small Issue Tracker
+ *   Copyright (C) 2013 Frederic Hoerni
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License v2 as published by
+ *   the Free Software Foundation.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ */
+#include "config.h"
+
+#include "FilterIndex.h"
+#include "Issue.h"
+#include "utils/dateTools.h"
+#include "utils/logging.h"
+#include "global.h"
+
+void Bitmap::intersect(const Bitmap &other)
+{
+    if (words.size() > other.words.size()) words.resize(other.words.size());
+    for (size_t i = 0; i < words.size(); i++) words[i] &= other.words[i];
+}
+
+void Bitmap::unite(const Bitmap &other)
+{
+    if (words.size() < other.words.size()) words.resize(other.words.size(), 0);
+    for (size_t i = 0; i < other.words.size(); i++) words[i] |= other.words[i];
+}
+
+void Bitmap::subtract(const Bitmap &other)
+{
+    size_t n = words.size() < other.words.size() ? words.size() : other.words.size();
+    for (size_t i = 0; i < n; i++) words[i] &= ~other.words[i];
+}
+
+/** Get the members of the set, in increasing order
+  */
+void Bitmap::getMembers(std::vector<uint32_t> &members) const
+{
+    for (size_t i = 0; i < words.size(); i++) {
+        uint64_t w = words[i];
+        while (w) {
+            int bit = __builtin_ctzll(w);
+            members.push_back(i * 64 + bit);
+            w &= w - 1;
+        }
+    }
+}
+
+/** Get the number of members of the intersection of 2 sets
+  */
+size_t Bitmap::countIntersection(const Bitmap &other) const
+{
+    size_t n = words.size() < other.words.size() ? words.size() : other.words.size();
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) count += __builtin_popcountll(words[i] & other.words[i]);
+    return count;
+}
+
+FilterIndex::FilterIndex() : built(false)
+{
+}
+
+/** Get the ordinal of an issue, allocating it if needed
+  */
+uint32_t FilterIndex::getOrdinal(const Issue *issue)
+{
+    std::map<const Issue*, uint32_t>::const_iterator o = ordinalOfIssue.find(issue);
+    if (o != ordinalOfIssue.end()) return o->second;
+
+    uint32_t ordinal = ordinals.size();
+    ordinals.push_back(issue);
+    ordinalOfIssue[issue] = ordinal;
+    return ordinal;
+}
+
+void FilterIndex::updateUnlocked(const Issue *issue)
+{
+    uint32_t ordinal = getOrdinal(issue);
+    alive.set(ordinal);
+
+    std::map<std::string, ValueBitmaps>::iterator property;
+    FOREACH(property, properties) {
+        // remove the former values
+        ValueBitmaps::iterator value;
+        FOREACH(value, property->second) value->second.clear(ordinal);
+
+        // If the issue has no such property, or if the property of this issue has no value,
+        // then consider that the property has an empty value (as Issue::isInFilter).
+        PropertiesCIt p = issue->properties.find(property->first);
+        if (p == issue->properties.end() || p->second.empty()) {
+            property->second[""].set(ordinal);
+        } else {
+            PropertyValuesIt v;
+            FOREACH(v, p->second) property->second[*v].set(ordinal);
+        }
+    }
+}
+
+/** Index the current values of the properties of an issue (new or modified)
+  *
+  * Does nothing if the index is not built yet.
+  */
+void FilterIndex::update(const Issue *issue)
+{
+    ScopeLocker scopeLocker(locker, LOCK_READ_WRITE);
+    if (built) updateUnlocked(issue);
+}
+
+/** Remove an issue from the index, before it is deleted
+  */
+void FilterIndex::removeIssue(const Issue *issue)
+{
+    ScopeLocker scopeLocker(locker, LOCK_READ_WRITE);
+    std::map<const Issue*, uint32_t>::iterator o = ordinalOfIssue.find(issue);
+    if (o != ordinalOfIssue.end()) {
+        uint32_t ordinal = o->second;
+        alive.clear(ordinal);
+        std::map<std::string, ValueBitmaps>::iterator property;
+        FOREACH(property, properties) {
+            ValueBitmaps::iterator value;
+            FOREACH(value, property->second) value->second.clear(ordinal);
+        }
+        ordinals[ordinal] = 0;
+        ordinalOfIssue.erase(o);
+    }
+}
+
+void FilterIndex::build(const std::map<std::string, Issue*> &issues, const std::set<std::string> &selectProperties)
+{
+    double t0 = getSeconds();
+
+    properties.clear();
+    alive = Bitmap();
+    ordinals.clear();
+    ordinalOfIssue.clear();
+
+    std::set<std::string>::const_iterator name;
+    FOREACH(name, selectProperties) properties[*name];
+
+    std::map<std::string, Issue*>::const_iterator i;
+    FOREACH(i, issues) updateUnlocked(i->second);
+    built = true;
+
+    LOG_INFO("Filter index built: %ld issues, %ld properties (%.3fs)", L(issues.size()),
+             L(properties.size()), getSeconds() - t0);
+}
+
+/** Tell if the index is built on the given select properties
+  */
+bool FilterIndex::isBuilt(const std::set<std::string> &selectProperties) const
+{
+    if (!built || properties.size() != selectProperties.size()) return false;
+    std::map<std::string, ValueBitmaps>::const_iterator p;
+    FOREACH(p, properties) {
+        if (!selectProperties.count(p->first)) return false;
+    }
+    return true;
+}
+
+/** Build the index, if not built yet or if the select properties have changed
+  * (see BuildLocker)
+  */
+void FilterIndex::buildIfNeeded(const std::map<std::string, Issue*> &issues,
+                                const std::set<std::string> &selectProperties)
+{
+    BuildLocker buildLocker(locker);
+    if (isBuilt(selectProperties)) return;
+
+    buildLocker.lockForBuilding();
+    if (isBuilt(selectProperties)) return; // built by a concurrent search meanwhile
+    build(issues, selectProperties);
+}
+
+/** Get the issues that match any of the filtered values of a select property
+  *
+  * @return
+  *     false if the property is not indexed
+  */
+bool FilterIndex::getMatchingIssues(const std::string &property, const std::list<std::string> &filteredValues,
+                                    Bitmap &result) const
+{
+    std::map<std::string, ValueBitmaps>::const_iterator p = properties.find(property);
+    if (p == properties.end()) return false;
+
+    ValueBitmaps::const_iterator value;
+    FOREACH(value, p->second) {
+        if (isPropertyInFilter(value->first, filteredValues)) result.unite(value->second);
+    }
+    return true;
+}
+
+/** Select the issues through the filters on select properties
+  *
+  * The filters on the other properties (eg: text properties, id) are
+  * returned, to be evaluated by Issue::isInFilter on the selected issues.
+  *
+  * @param selectProperties
+  *     names of the properties of type select, multiselect or selectUser
+  *
+  * @param[out] selected
+  *     The issues that pass the filters on select properties, in the order
+  *     of their ordinals.
+  *
+  * @return
+  *     false if no filter is on a select property: all the issues are selected
+  */
+bool FilterIndex::select(const std::map<std::string, Issue*> &issues, const std::set<std::string> &selectProperties,
+                         const std::map<std::string, std::list<std::string> > &filterIn,
+                         const std::map<std::string, std::list<std::string> > &filterOut,
+                         std::vector<const Issue*> &selected,
+                         std::map<std::string, std::list<std::string> > &otherFilterIn,
+                         std::map<std::string, std::list<std::string> > &otherFilterOut)
+{
+    bool indexed = false;
+    std::map<std::string, std::list<std::string> >::const_iterator f;
+    FOREACH(f, filterIn) {
+        if (selectProperties.count(f->first)) indexed = true;
+        else otherFilterIn.insert(*f);
+    }
+    FOREACH(f, filterOut) {
+        if (selectProperties.count(f->first)) indexed = true;
+        else otherFilterOut.insert(*f);
+    }
+    if (!indexed) return false;
+
+    buildIfNeeded(issues, selectProperties);
+
+    ScopeLocker scopeLocker(locker, LOCK_READ_ONLY);
+    Bitmap result;
+    getSelection(filterIn, filterOut, result);
+
+    std::vector<uint32_t> members;
+    result.getMembers(members);
+    std::vector<uint32_t>::const_iterator ordinal;
+    FOREACH(ordinal, members) selected.push_back(ordinals[*ordinal]);
+    return true;
+}
+
+/** Get the issues that pass the filters on the indexed properties
+  */
+void FilterIndex::getSelection(const std::map<std::string, std::list<std::string> > &filterIn,
+                               const std::map<std::string, std::list<std::string> > &filterOut,
+                               Bitmap &result) const
+{
+    std::map<std::string, std::list<std::string> >::const_iterator f;
+
+    // filterin: AND between properties, OR between the values of a property
+    result = alive;
+    FOREACH(f, filterIn) {
+        Bitmap matching;
+        if (getMatchingIssues(f->first, f->second, matching)) result.intersect(matching);
+    }
+
+    // filterout: OR between all the values
+    FOREACH(f, filterOut) {
+        Bitmap matching;
+        if (getMatchingIssues(f->first, f->second, matching)) result.subtract(matching);
+    }
+}
+
+/** Count the issues that pass the filters, per value of some select properties
+  *
+  * The counts are the sizes of the intersections of the bitmaps of the
+  * values with the bitmap of the selected issues. The issues that have
+  * no value are counted under the empty value.
+  *
+  * @param[out] facets
+  *     { property : { value : number of issues } }, without the values of
+  *     no selected issue
+  *
+  * @return
+  *     false if a filter or a facet property is not a select property
+  *     (nothing is counted)
+  */
+bool FilterIndex::countValues(const std::map<std::string, Issue*> &issues,
+                              const std::set<std::string> &selectProperties,
+                              const std::map<std::string, std::list<std::string> > &filterIn,
+                              const std::map<std::string, std::list<std::string> > &filterOut,
+                              const std::list<std::string> &facetProperties,
+                              std::map<std::string, std::map<std::string, size_t> > &facets, size_t &total)
+{
+    std::map<std::string, std::list<std::string> >::const_iterator f;
+    FOREACH(f, filterIn) if (!selectProperties.count(f->first)) return false;
+    FOREACH(f, filterOut) if (!selectProperties.count(f->first)) return false;
+    std::list<std::string>::const_iterator name;
+    FOREACH(name, facetProperties) if (!selectProperties.count(*name)) return false;
+
+    buildIfNeeded(issues, selectProperties);
+
+    ScopeLocker scopeLocker(locker, LOCK_READ_ONLY);
+    Bitmap result;
+    getSelection(filterIn, filterOut, result);
+    total = result.countIntersection(alive);
+
+    FOREACH(name, facetProperties) {
+        std::map<std::string, size_t> &counts = facets[*name];
+        std::map<std::string, ValueBitmaps>::const_iterator values = properties.find(*name);
+        if (values == properties.end()) continue;
+        ValueBitmaps::const_iterator value;
+        FOREACH(value, values->second) {
+            size_t n = value->second.countIntersection(result);
+            if (n) counts[value->first] = n;
+        }
+    }
+    return true;
+}
+
+/** Exchange the contents of 2 indexes (see BuildLocker)
+  */
+void FilterIndex::swap(FilterIndex &other)
+{
+    std::swap(built, other.built);
+    properties.swap(other.properties);
+    std::swap(alive, other.alive);
+    ordinals.swap(other.ordinals);
+    ordinalOfIssue.swap(other.ordinalOfIssue);
+}
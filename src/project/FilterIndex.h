@@ -0,0 +1,93 @@
+#ifndef _FilterIndex_h
+#define _FilterIndex_h
+
+#include <string>
+#include <map>
+#include <set>
+#include <list>
+#include <vector>
+#include <stdint.h>
+
+#include "utils/mutexTools.h"
+
+class Issue;
+
+/** Set of issue ordinals
+  *
+  * The ordinals are allocated densely from 0, so a plain array of
+  * words is compact.
+  */
+class Bitmap {
+public:
+    inline void set(uint32_t i) {
+        if (i / 64 >= words.size()) words.resize(i / 64 + 1, 0);
+        words[i / 64] |= (uint64_t)1 << (i % 64);
+    }
+    inline void clear(uint32_t i) {
+        if (i / 64 < words.size()) words[i / 64] &= ~((uint64_t)1 << (i % 64));
+    }
+    void intersect(const Bitmap &other);
+    void unite(const Bitmap &other);
+    void subtract(const Bitmap &other);
+    void getMembers(std::vector<uint32_t> &members) const;
+    size_t countIntersection(const Bitmap &other) const;
+
+private:
+    std::vector<uint64_t> words;
+};
+
+/** Bitmap index of the values of the select properties of the issues
+  *
+  * For each property of type select, multiselect or selectUser, and for
+  * each value of this property, the index has the bitmap of the issues
+  * that have this value. An issue that has no value for the property is
+  * indexed under the empty value, as Issue::isInFilter considers it so.
+  *
+  * The filter values (possibly wildcards) are matched against the
+  * distinct values of the property, instead of the values of each issue.
+  * Then filterin and filterout are evaluated as operations on the
+  * bitmaps.
+  *
+  * The index is built on the first use, and built again if the select
+  * properties of the project change. Then it is kept up to date by the
+  * modifications of the project (see BuildLocker).
+  */
+class FilterIndex {
+public:
+    FilterIndex();
+    void update(const Issue *issue);
+    void removeIssue(const Issue *issue);
+    bool select(const std::map<std::string, Issue*> &issues, const std::set<std::string> &selectProperties,
+                const std::map<std::string, std::list<std::string> > &filterIn,
+                const std::map<std::string, std::list<std::string> > &filterOut,
+                std::vector<const Issue*> &selected,
+                std::map<std::string, std::list<std::string> > &otherFilterIn,
+                std::map<std::string, std::list<std::string> > &otherFilterOut);
+    bool countValues(const std::map<std::string, Issue*> &issues, const std::set<std::string> &selectProperties,
+                     const std::map<std::string, std::list<std::string> > &filterIn,
+                     const std::map<std::string, std::list<std::string> > &filterOut,
+                     const std::list<std::string> &facetProperties,
+                     std::map<std::string, std::map<std::string, size_t> > &facets, size_t &total);
+    void swap(FilterIndex &other);
+
+private:
+    typedef std::map<std::string, Bitmap> ValueBitmaps; // key: value of the property
+    uint32_t getOrdinal(const Issue *issue);
+    void updateUnlocked(const Issue *issue);
+    void build(const std::map<std::string, Issue*> &issues, const std::set<std::string> &selectProperties);
+    bool isBuilt(const std::set<std::string> &selectProperties) const;
+    void buildIfNeeded(const std::map<std::string, Issue*> &issues, const std::set<std::string> &selectProperties);
+    void getSelection(const std::map<std::string, std::list<std::string> > &filterIn,
+                      const std::map<std::string, std::list<std::string> > &filterOut, Bitmap &result) const;
+    bool getMatchingIssues(const std::string &property, const std::list<std::string> &filteredValues,
+                           Bitmap &result) const;
+
+    bool built;
+    std::map<std::string, ValueBitmaps> properties; // key: name of the select property
+    Bitmap alive; // issues present in the project
+    std::vector<const Issue*> ordinals; // null if the issue was removed
+    std::map<const Issue*, uint32_t> ordinalOfIssue;
+    Locker locker;
+};
+
+#endif
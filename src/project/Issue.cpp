@@ -35,6 +35,7 @@
 #include "utils/logging.h"
 #include "utils/identifiers.h"
 #include "utils/stringTools.h"
+#include "utils/stringSearch.h"
 #include "global.h"
 #include "mg_win32.h"
 #include "fnmatch.h"
@@ -109,10 +110,9 @@ Issue *Issue::load(const std::string &objectsDir, const std::string &latestEntry
     std::string entryid = latestEntryOfIssue;
     int error = 0;
     while (entryid.size() && entryid != K_PARENT_NULL) {
-        std::string entryPath = objectsDir + '/' + Entry::getSubpath(entryid);
-        Entry *e = Entry::loadEntry(entryPath, entryid);
+        Entry *e = Entry::loadEntry(objectsDir, entryid);
         if (!e) {
-            LOG_ERROR("Cannot load entry '%s'", entryPath.c_str());
+            LOG_ERROR("Cannot load entry '%s'", entryid.c_str());
             error = 1;
             break; // abort the loading of this issue
         }
@@ -139,33 +139,12 @@ Issue *Issue::load(const std::string &objectsDir, const std::string &latestEntry
     return issue;
 }
 
-/** Amend the given Entry with a new message
-  *
-  * The former message will be replaced by the new one
-  * in the consolidation of the issue.
-  */
-Entry *Issue::amendEntry(const std::string &entryId, const std::string &newMsg, const std::string &username)
-{
-    PropertiesMap properties;
-    properties[K_MESSAGE].push_back(newMsg);
-    properties[K_AMEND].push_back(entryId);
-    Entry *amendingEntry = Entry::createNewEntry(properties, username, latest);
-
-    addEntry(amendingEntry);
-
-    consolidateAmendment(amendingEntry);
-
-    return amendingEntry;
-}
-
-
-
 /** Copy properties of an entry to an issue.
   */
 void Issue::consolidateWithSingleEntry(Entry *e) {
-    std::map<std::string, std::list<std::string> >::iterator p;
+    PropertiesCIt p;
     FOREACH(p, e->properties) {
-        if (p->first.size() && p->first[0] == '+') continue; // do not consolidate these (+file, +message, etc.)
+        if (p->first.size() && p->first.str()[0] == '+') continue; // do not consolidate these (+file, +message, etc.)
         properties[p->first] = p->second;
     }
     // update also mtime of the issue
@@ -179,7 +158,7 @@ void Issue::consolidateWithSingleEntry(Entry *e) {
   */
 void Issue::consolidateAmendment(Entry *e)
 {
-    PropertiesIt p = e->properties.find(K_AMEND);
+    PropertiesCIt p = e->properties.find(K_AMEND);
     if (p == e->properties.end()) return; // no amendment
     if (p->second.empty()) {
         LOG_ERROR("cannot consolidateAmendment with no entry to consolidate");
@@ -187,14 +166,7 @@ void Issue::consolidateAmendment(Entry *e)
     }
     std::string amendedEntryId = p->second.front();
 
-    p = e->properties.find(K_MESSAGE);
-    const std::string *newMsg = 0;
-    if (p == e->properties.end()) return; // no amending message
-    if (p->second.empty()) {
-        LOG_ERROR("cannot consolidateAmendment with no message");
-        // consider the message as empty
-
-    } else newMsg = &(p->second.front());
+    if (!e->isMessageInObject() && !e->properties.count(K_MESSAGE)) return; // no amending message
 
     // find this entry and modify its message
     Entry *amendedEntry = e;
@@ -208,7 +180,7 @@ void Issue::consolidateAmendment(Entry *e)
 
     amendments[amendedEntry->id].push_back(e->id);
     // overwrite previous message
-    amendedEntry->setMessage(newMsg);
+    amendedEntry->setMessageOwner(e);
 }
 
 /** Consolidate an issue by accumulating all its entries
@@ -270,20 +242,29 @@ int Issue::makeSnapshot(time_t datetime)
 }
 
 
+/** Match a value against a filtered value (a glob pattern), ignoring case
+  *
+  * The filtered values are usually plain values, compared without fnmatch.
+  */
+static inline bool matchFilteredValue(const std::string &filteredValue, const char *value)
+{
+    if (!isGlobPattern(filteredValue.c_str())) return equalNoCase(filteredValue.c_str(), value);
+    return FNM_NOMATCH != fnmatch(filteredValue.c_str(), value, FNM_CASEFOLD);
+}
+
 /** Look if any value of the given multi-valued property is present in the given list
   *
   * Ignore case.
   */
-bool isPropertyInFilter(const std::list<std::string> &propertyValue,
+bool isPropertyInFilter(const PropertyValues &propertyValue,
                         const std::list<std::string> &filteredValues)
 {
     std::list<std::string>::const_iterator fv;
-    std::list<std::string>::const_iterator v;
+    PropertyValuesIt v;
 
     FOREACH (fv, filteredValues) {
         FOREACH (v, propertyValue) {
-            if (FNM_NOMATCH != fnmatch(fv->c_str(), v->c_str(), FNM_CASEFOLD)) return true;
-            //if ((*v) == (*fv)) return true;
+            if (matchFilteredValue(*fv, v->c_str())) return true;
         }
     }
     return false; // not found
@@ -299,8 +280,7 @@ bool isPropertyInFilter(const std::string &propertyValue,
     std::list<std::string>::const_iterator fv;
 
     FOREACH (fv, filteredValues) {
-        if (FNM_NOMATCH != fnmatch(fv->c_str(), propertyValue.c_str(), FNM_CASEFOLD)) return true;
-        //if (propertyValue == *fv) return true;
+        if (matchFilteredValue(*fv, propertyValue.c_str())) return true;
     }
 
     return false; // not found
@@ -347,8 +327,7 @@ bool Issue::isInFilter(const std::map<std::string, std::list<std::string> > &fil
             doesMatch = isPropertyInFilter(id, f->second);
 
         } else {
-            std::map<std::string, std::list<std::string> >::const_iterator p;
-            p = properties.find(examinedProperty);
+            PropertiesCIt p = properties.find(examinedProperty);
             // If the issue has no such property, or if the property of this issue has no value,
             // then consider that the property has an empty value.
             if (p == properties.end() || p->second.empty()) {
@@ -367,6 +346,15 @@ bool Issue::isInFilter(const std::map<std::string, std::list<std::string> > &fil
 }
 
 
+/** Look if a string contains a text, ignoring case
+  *
+  * The string is taken up to its first null character (as mg_strcasestr).
+  */
+static inline bool containsNoCase(const std::string &s, const char *text, size_t textLen)
+{
+    return findNoCase(s.c_str(), strlen(s.c_str()), text, textLen) != 0;
+}
+
 /** Search for the given text through the issue properties
   * and the messages of the entries.
   *
@@ -377,17 +365,17 @@ bool Issue::isInFilter(const std::map<std::string, std::list<std::string> > &fil
 bool Issue::searchFullText(const char *text) const
 {
     if (!text) return true;
+    size_t textLen = strlen(text);
 
     // look if id contains the fulltextSearch
-    if (mg_strcasestr(id.c_str(), text)) return true; // found
+    if (containsNoCase(id, text, textLen)) return true; // found
 
     // look through the properties of the issue
-    std::map<std::string, std::list<std::string> >::const_iterator p;
+    PropertiesCIt p;
     for (p = properties.begin(); p != properties.end(); p++) {
-        std::list<std::string>::const_iterator pp;
-        std::list<std::string> listOfValues = p->second;
-        for (pp = listOfValues.begin(); pp != listOfValues.end(); pp++) {
-            if (mg_strcasestr(pp->c_str(), text)) return true;  // found
+        PropertyValuesIt pp;
+        for (pp = p->second.begin(); pp != p->second.end(); pp++) {
+            if (containsNoCase(*pp, text, textLen)) return true;  // found
         }
     }
 
@@ -397,19 +385,20 @@ bool Issue::searchFullText(const char *text) const
         // do not search through amending entries
         if (!e->isAmending()) {
             // look through the message
-            if (mg_strcasestr(e->getMessage().c_str(), text)) return true; // found
+            std::string holder;
+            if (containsNoCase(e->getMessage(holder), text, textLen)) return true; // found
 
             // look through uploaded files
-            PropertiesIt files = e->properties.find(K_FILE);
+            PropertiesCIt files = e->properties.find(K_FILE);
             if (files != e->properties.end()) {
-                std::list<std::string>::const_iterator f;
+                PropertyValuesIt f;
                 FOREACH(f, files->second) {
-                    if (mg_strcasestr(f->c_str(), text)) return true; // found
+                    if (containsNoCase(*f, text, textLen)) return true; // found
                 }
             }
 
             // look at the author of the entry
-            if (mg_strcasestr(e->author.c_str(), text)) return true; // found
+            if (containsNoCase(e->author, text, textLen)) return true; // found
         }
         e = e->getNext();
     }
@@ -454,62 +443,207 @@ bool Issue::hasTag(const std::string &entryId, const std::string &tagname) const
     return true;
 }
 
+const AssociationTable::Map AssociationTable::NoAssociations;
+
+/** Build a table with the contents of the map (the map is emptied)
+  */
+AssociationTable::AssociationTable(Map &map) : shared(0)
+{
+    if (map.empty()) return;
+    shared = new SharedTable();
+    shared->map.swap(map);
+}
+
+AssociationTable &AssociationTable::operator=(const AssociationTable &other)
+{
+    if (other.shared) other.shared->acquire();
+    if (shared) shared->release();
+    shared = other.shared;
+    return *this;
+}
+
 IssueCopy::IssueCopy(const Issue &i) : Issue(i)
 {
 }
 
-bool IssueCopy::lessThan(const IssueCopy &other, const std::list<std::pair<bool, std::string> > &sortingSpec) const
+/** Value of a sorting key of an issue
+  */
+struct SortKeyValue {
+    long number; // id, ctime, mtime
+    const std::string *text; // id, project
+    const PropertyValues *values; // property (null if the issue has no such property)
+};
+
+static int compareValues(IssueSorter::SortKeyType type, const SortKeyValue &a, const SortKeyValue &b)
 {
-    return lessThan(&other, sortingSpec);
+    switch (type) {
+    case IssueSorter::SORT_ID:
+        if (a.number != b.number) return a.number < b.number ? -1 : +1;
+        return a.text->compare(*b.text);
+
+    case IssueSorter::SORT_CTIME:
+    case IssueSorter::SORT_MTIME:
+        if (a.number < b.number) return -1;
+        else if (a.number > b.number) return +1;
+        return 0;
+
+    case IssueSorter::SORT_PROJECT:
+        return a.text->compare(*b.text);
+
+    case IssueSorter::SORT_PROPERTY:
+    default:
+        if (!a.values && !b.values) return 0;
+        else if (!a.values) return -1; // arbitrary choice
+        else if (!b.values) return +1; // arbitrary choice
+        else {
+            PropertyValuesIt v1 = a.values->begin();
+            PropertyValuesIt v2 = b.values->begin();
+            while (v1 != a.values->end() && v2 != b.values->end()) {
+                int lt = v1->compare(*v2);
+                if (lt) return lt < 0 ? -1 : +1;
+                v1++;
+                v2++;
+            }
+            if (v1 == a.values->end() && v2 == b.values->end()) return 0;
+            else if (v1 == a.values->end()) return -1; // arbitrary choice
+            else return +1; // arbitrary choice
+        }
+    }
 }
 
-/** Compare 2 issues after sortingSpec.
+/** Compare the rows of keys of 2 issues, given by their indexes
+  */
+class SortKeysComparator {
+public:
+    SortKeysComparator(const std::vector<IssueSorter::SortKey> &k, const std::vector<SortKeyValue> &v) :
+        keys(k), values(v) {}
+    inline bool operator() (uint32_t i, uint32_t j) const {
+        size_t n = keys.size();
+        for (size_t k = 0; k < n; k++) {
+            int result = compareValues(keys[k].type, values[i*n+k], values[j*n+k]);
+            if (!keys[k].ascending) result = -result; // descending order
+            if (result) return result < 0;
+        }
+        return i < j; // keep the initial order of the equal issues
+    }
+private:
+    const std::vector<IssueSorter::SortKey> &keys;
+    const std::vector<SortKeyValue> &values;
+};
+
+/** Compile a sorting spec
   *
   * sortingSpec: a list of pairs (ascending-order, property-name)
-  *
-  * @return
-  *     true or false
-  *     If they are equal, false is returned.
   */
-bool IssueCopy::lessThan(const IssueCopy* other, const std::list<std::pair<bool, std::string> > &sortingSpec) const
+IssueSorter::IssueSorter(const std::list<std::pair<bool, std::string> > &sortingSpec)
+{
+    std::list<std::pair<bool, std::string> >::const_iterator s;
+    FOREACH(s, sortingSpec) {
+        SortKey key;
+        key.ascending = s->first;
+        if (s->second == "id") key.type = SORT_ID;
+        else if (s->second == "ctime") key.type = SORT_CTIME;
+        else if (s->second == "mtime") key.type = SORT_MTIME;
+        else if (s->second == "p") key.type = SORT_PROJECT;
+        else {
+            key.type = SORT_PROPERTY;
+            key.name = s->second;
+        }
+        keys.push_back(key);
+    }
+}
+
+/** Get the value of a sorting key of an issue
+  */
+static void getKeyValue(const IssueSorter::SortKey &key, const Issue *issue, SortKeyValue &v)
 {
-    if (!other) return false;
+    v.number = 0;
+    v.text = 0;
+    v.values = 0;
+    switch (key.type) {
+    case IssueSorter::SORT_ID:
+        v.number = atol(issue->id.c_str());
+        v.text = &issue->id;
+        break;
+    case IssueSorter::SORT_CTIME: v.number = issue->ctime; break;
+    case IssueSorter::SORT_MTIME: v.number = issue->mtime; break;
+    case IssueSorter::SORT_PROJECT: v.text = &issue->project; break;
+    case IssueSorter::SORT_PROPERTY: {
+        PropertiesCIt p = issue->properties.find(key.name);
+        if (p != issue->properties.end()) v.values = &p->second;
+        break;
+    }
+    }
+}
 
-    int result = 0; // 0 means equal, <0 means less-than, >0 means greater-than
-    std::list<std::pair<bool, std::string> >::const_iterator s = sortingSpec.begin();
+/** Compute the sorted order of issues
+  *
+  * @param[out] order
+  *     The indexes of the issues, in sorted order.
+  *     The equal issues keep their initial order.
+  *
+  * @param count
+  *     Number of first issues needed. Only these are sorted (partial sort)
+  *     and returned.
+  */
+void IssueSorter::getOrder(const std::vector<const Issue*> &issues, std::vector<uint32_t> &order,
+                           size_t count) const
+{
+    size_t n = keys.size();
+    std::vector<SortKeyValue> values(issues.size() * n);
 
-    while ( (result == 0) && (s != sortingSpec.end()) ) {
-        // case of id, ctime, mtime
-        if (s->second == "id") {
-            if (id == other->id) result = 0;
-            else if (atoi(id.c_str()) < atoi(other->id.c_str())) result = -1;
-            else result = +1;
+    for (size_t i = 0; i < issues.size(); i++) {
+        for (size_t k = 0; k < n; k++) getKeyValue(keys[k], issues[i], values[i*n+k]);
+    }
 
-        } else if (s->second == "ctime") {
-            if (ctime < other->ctime) result = -1;
-            else if (ctime > other->ctime) result = +1;
-            else result = 0;
+    order.resize(issues.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    if (count >= order.size()) {
+        if (n) std::sort(order.begin(), order.end(), SortKeysComparator(keys, values));
+    } else {
+        if (n) std::partial_sort(order.begin(), order.begin() + count, order.end(),
+                                 SortKeysComparator(keys, values));
+        order.resize(count);
+    }
+}
 
-        } else if (s->second == "mtime") {
-            if (mtime < other->mtime) result = -1;
-            else if (mtime > other->mtime) result = +1;
-            else result = 0;
+/** Sort issues, keeping only the first count issues
+  */
+void IssueSorter::sort(std::vector<const Issue*> &issues, size_t count) const
+{
+    if (keys.empty()) {
+        if (count < issues.size()) issues.resize(count);
+        return;
+    }
 
-        } else if (s->second == "p") {
-            if (project < other->project) result = -1;
-            else if (project == other->project) result = 0;
-            else result = +1;
+    std::vector<uint32_t> order;
+    getOrder(issues, order, count);
 
-        } else {
-            // the other properties
+    std::vector<const Issue*> sorted;
+    sorted.reserve(issues.size());
+    std::vector<uint32_t>::const_iterator i;
+    FOREACH(i, order) sorted.push_back(issues[*i]);
+    issues.swap(sorted);
+}
 
-            result = compareProperties(properties, other->properties, s->second);
-        }
-        if (!s->first) result = -result; // descending order
-        s++;
+/** Compare 2 issues
+  *
+  * @return
+  *     <0 if a is before b, >0 if a is after b, 0 if they are equal
+  *     (same order as getOrder, but without a rank for the equal issues)
+  */
+int IssueSorter::compare(const Issue *a, const Issue *b) const
+{
+    SortKeyValue va, vb;
+    std::vector<SortKey>::const_iterator key;
+    FOREACH(key, keys) {
+        getKeyValue(*key, a, va);
+        getKeyValue(*key, b, vb);
+        int result = compareValues(key->type, va, vb);
+        if (!key->ascending) result = -result; // descending order
+        if (result) return result;
     }
-    if (result<0) return true;
-    else return false;
+    return 0;
 }
 
 /**
@@ -518,8 +652,27 @@ bool IssueCopy::lessThan(const IssueCopy* other, const std::list<std::pair<bool,
   */
 void IssueCopy::sort(std::vector<IssueCopy> &inout, const std::list<std::pair<bool, std::string> > &sortingSpec)
 {
-    if (sortingSpec.size()==0) return;
-
-    IssueComparator ic(sortingSpec);
-    std::sort(inout.begin(), inout.end(), ic);
+    IssueSorter sorter(sortingSpec);
+    if (sorter.empty()) return;
+
+    std::vector<const Issue*> issues;
+    issues.reserve(inout.size());
+    std::vector<IssueCopy>::const_iterator i;
+    FOREACH(i, inout) issues.push_back(&(*i));
+
+    std::vector<uint32_t> order;
+    sorter.getOrder(issues, order);
+
+    // apply the permutation, following its cycles
+    std::vector<bool> done(order.size(), false);
+    for (size_t start = 0; start < order.size(); start++) {
+        if (done[start]) continue;
+        size_t pos = start;
+        while (order[pos] != start) {
+            std::swap(inout[pos], inout[order[pos]]);
+            done[pos] = true;
+            pos = order[pos];
+        }
+        done[pos] = true;
+    }
 }
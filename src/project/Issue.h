@@ -45,7 +45,7 @@ struct Issue {
 
     // mutable members, that may be modified when a user posts an entry
     int mtime; // modification time (the one of the last entry)
-    PropertiesMap properties;
+    Properties properties;
     Entry *latest; // the latest entry
     std::map<std::string, std::list<std::string> > amendments; // key: amended entry-id, value: amending entries
     std::map<std::string, std::set<std::string> > tags; // key: entry-id, value: tags
@@ -69,7 +69,6 @@ struct Issue {
     void addEntry(Entry *e);
     static Issue *load(const std::string &objectsDir, const std::string &latestEntryOfIssue);
     void insertEntry(Entry *e);
-    Entry *amendEntry(const std::string &entryId, const std::string &newMsg, const std::string &username);
 
     std::string getProperty(const std::string &propertyName) const;
     int makeSnapshot(time_t datetime);
@@ -81,30 +80,84 @@ struct IssueSummary {
     inline bool operator< (const IssueSummary &other) const { return id < other.id; }
 };
 
+/** Summaries of the issues associated to an issue
+  *
+  * { association-name : [IssueSummary,...] }
+  *
+  * The project builds a new table each time the associations of the issue
+  * or the summaries of the associated issues change. A table is never
+  * modified once built, so that the copies of the issues share it
+  * (reference-counted) instead of copying it.
+  */
+class AssociationTable {
+public:
+    typedef std::map<AssociationId, std::set<IssueSummary> > Map;
+    typedef Map::const_iterator const_iterator;
+
+    inline AssociationTable() : shared(0) {}
+    inline AssociationTable(const AssociationTable &other) : shared(other.shared) { if (shared) shared->acquire(); }
+    AssociationTable(Map &map);
+    inline ~AssociationTable() { if (shared) shared->release(); }
+    AssociationTable &operator=(const AssociationTable &other);
+
+    inline const_iterator begin() const { return getMap().begin(); }
+    inline const_iterator end() const { return getMap().end(); }
+    inline bool empty() const { return getMap().empty(); }
+    inline const_iterator find(const AssociationId &name) const { return getMap().find(name); }
+
+private:
+    struct SharedTable {
+        Map map;
+        int refs;
+        inline SharedTable() : refs(1) {}
+        inline void acquire() { __sync_add_and_fetch(&refs, 1); }
+        inline void release() { if (__sync_sub_and_fetch(&refs, 1) == 0) delete this; }
+    };
+    inline const Map &getMap() const { return shared ? shared->map : NoAssociations; }
+
+    static const Map NoAssociations;
+    SharedTable *shared; // null if no associations
+};
+
 /** Copy of an issue, used for offline reading
   */
 struct IssueCopy : public Issue {
-    // associations table, consolidated only at users' request
-    // { association-name : [IssueSummary,...] }
-    std::map<AssociationId, std::set<IssueSummary> > associations; // issues referenced by this
-    std::map<AssociationId, std::set<IssueSummary> > reverseAssociations; // issues that reference this
+    // associations tables, attached only at users' request
+    AssociationTable associations; // issues referenced by this
+    AssociationTable reverseAssociations; // issues that reference this
 
     IssueCopy(const Issue &i);
     IssueCopy() {}
 
-    bool lessThan(const IssueCopy &other, const std::list<std::pair<bool, std::string> > &sortingSpec) const;
-    bool lessThan(const IssueCopy *other, const std::list<std::pair<bool, std::string> > &sortingSpec) const;
     static void sort(std::vector<IssueCopy> &inout, const std::list<std::pair<bool, std::string> > &sortingSpec);
 };
 
+bool isPropertyInFilter(const std::string &propertyValue, const std::list<std::string> &filteredValues);
 
-class IssueComparator {
+/** Sorting spec compiled into typed keys
+  *
+  * The keys of the issues are extracted once into an array, and the
+  * indexes of the issues are sorted, so that the issues themselves are
+  * not moved during the sort.
+  */
+class IssueSorter {
 public:
-    IssueComparator(const std::list<std::pair<bool, std::string> > &sSpec) : sortingSpec(sSpec) { }
-    inline bool operator() (const IssueCopy* i, const IssueCopy* j) { return i->lessThan(j, sortingSpec); }
-    inline bool operator() (const IssueCopy &i, const IssueCopy &j) { return i.lessThan(j, sortingSpec); }
+    IssueSorter(const std::list<std::pair<bool, std::string> > &sortingSpec);
+    inline bool empty() const { return keys.empty(); }
+    void getOrder(const std::vector<const Issue*> &issues, std::vector<uint32_t> &order,
+                  size_t count = (size_t)-1) const;
+    void sort(std::vector<const Issue*> &issues, size_t count = (size_t)-1) const;
+    int compare(const Issue *a, const Issue *b) const;
+
+    enum SortKeyType { SORT_ID, SORT_CTIME, SORT_MTIME, SORT_PROJECT, SORT_PROPERTY };
+    struct SortKey {
+        SortKeyType type;
+        bool ascending;
+        std::string name; // for SORT_PROPERTY
+    };
+
 private:
-    const std::list<std::pair<bool, std::string> > &sortingSpec;
+    std::vector<SortKey> keys;
 };
 
 
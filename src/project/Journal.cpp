@@ -0,0 +1,585 @@
+/*   Small Issue Tracker
+ *   Copyright (C) 2013 Frederic Hoerni
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License v2 as published by
+ *   the Free Software Foundation.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ */
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#if defined(_WIN32)
+  #include <io.h>
+#endif
+
+#include "Journal.h"
+#include "Object.h"
+#include "utils/filesystem.h"
+#include "utils/identifiers.h"
+#include "utils/stringTools.h"
+#include "utils/logging.h"
+#include "global.h"
+
+// limit of the dropped records of an issue, until the issue is rolled back
+#define UNTIL_RESUMED ((uint64_t)-1)
+
+/** Sync the whole filesystem that contains the given file
+  *
+  * On Windows, the materialized files are not synced.
+  */
+static int syncFilesystem(int fd)
+{
+#if defined(_WIN32)
+    (void)fd;
+    return 0;
+#elif defined(__linux__)
+    return syncfs(fd);
+#else
+    (void)fd;
+    sync();
+    return 0;
+#endif
+}
+
+/** Sync the filesystem that contains the given directory
+  */
+static int syncFilesystemOf(const std::string &dir)
+{
+#if defined(_WIN32)
+    (void)dir;
+    return 0;
+#else
+    int fd = ::open(dir.c_str(), O_RDONLY);
+    if (fd < 0) return -1;
+    int r = syncFilesystem(fd);
+    close(fd);
+    return r;
+#endif
+}
+
+Journal::Journal() : fd(-1), opened(false), appendedSeq(0), committedSeq(0), committing(false),
+                     materializing(false), materializeFailed(false), materializerStarted(false),
+                     stopping(false)
+{
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&committed, NULL);
+    pthread_cond_init(&queued, NULL);
+    pthread_cond_init(&materialized, NULL);
+}
+
+/** Stop the materializer, once the queued records are stored
+  */
+Journal::~Journal()
+{
+    pthread_mutex_lock(&mutex);
+    bool started = materializerStarted;
+    stopping = true;
+    pthread_cond_signal(&queued);
+    pthread_mutex_unlock(&mutex);
+    if (started) pthread_join(materializer, NULL);
+
+    if (fd >= 0) close(fd);
+    pthread_cond_destroy(&materialized);
+    pthread_cond_destroy(&queued);
+    pthread_cond_destroy(&committed);
+    pthread_mutex_destroy(&mutex);
+}
+
+/** Set the location of the journal, and replay the records left by a previous run
+  *
+  * Opening an already opened journal does nothing.
+  */
+int Journal::open(const std::string &journalPath, const std::string &objDir, const std::string &issDir)
+{
+    pthread_mutex_lock(&mutex);
+    if (opened) {
+        pthread_mutex_unlock(&mutex);
+        return 0;
+    }
+    opened = true;
+    path = journalPath;
+    objectsDir = objDir;
+    issuesDir = issDir;
+
+    int r = 0;
+    if (fileExists(path)) r = replay();
+    pthread_mutex_unlock(&mutex);
+    return r;
+}
+
+/** Materialize the records of the journal, and remove it
+  *
+  * An incomplete or corrupted record ends the replay. It comes from a
+  * commit interrupted before its sync, that was never acknowledged.
+  *
+  * If a record cannot be materialized, the journal is kept (cut after
+  * its last complete record), and replayed again at the next checkpoint
+  * or at the next load.
+  */
+int Journal::replay()
+{
+    int replayed;
+    size_t end;
+    int failures = materializeJournal(replayed, end);
+    if (failures < 0) return -1;
+    LOG_INFO("Journal %s: %d record(s) replayed", path.c_str(), replayed);
+
+    if (failures > 0) {
+        LOG_ERROR("Journal %s: %d record(s) not materialized, journal kept", path.c_str(), failures);
+        materializeFailed = true;
+        int flags = O_WRONLY | O_APPEND;
+#if defined(_WIN32)
+        flags |= O_BINARY;
+#endif
+        fd = ::open(path.c_str(), flags);
+        if (fd < 0 || ftruncate(fd, end) != 0) {
+            LOG_ERROR("Cannot cut journal %s: %s", path.c_str(), strerror(errno));
+            return -1;
+        }
+        return 0;
+    }
+
+    fd = ::open(path.c_str(), O_RDONLY);
+    return checkpoint();
+}
+
+/** Materialize all the records of the journal file, in order
+  *
+  * @param[out] replayed
+  *     number of records read
+  * @param[out] end
+  *     offset of the end of the last complete record
+  *
+  * @return
+  *     the number of records that could not be materialized,
+  *     or -1 if the journal cannot be read
+  */
+int Journal::materializeJournal(int &replayed, size_t &end)
+{
+    std::string data;
+    int r = loadFile(path, data);
+    if (r != 0) {
+        LOG_ERROR("Cannot read journal %s: %s", path.c_str(), strerror(errno));
+        return -1;
+    }
+
+    size_t offset = 0;
+    int failures = 0;
+    replayed = 0;
+    while (offset < data.size()) {
+        size_t eol = data.find('\n', offset);
+        if (eol == std::string::npos) break;
+
+        Record record;
+        std::string header = data.substr(offset, eol - offset);
+        record.issueId = popToken(header, ' ');
+        record.ref = popToken(header, ' ');
+        record.objectId = popToken(header, ' ');
+        size_t size = strtoul(header.c_str(), 0, 10);
+        if (record.issueId.empty() || header.empty() || size > data.size() - eol - 1) break;
+
+        record.data = data.substr(eol + 1, size);
+        if (getSha1(record.data) != record.objectId) break;
+
+        if (materialize(record) != 0) failures++;
+        replayed++;
+        offset = eol + 1 + size;
+    }
+    if (offset < data.size()) {
+        LOG_ERROR("Journal %s: incomplete record dropped at offset %lu", path.c_str(), L(offset));
+    }
+    end = offset;
+    return failures;
+}
+
+/** Append a record to the journal
+  *
+  * Must be called under the write lock of the project, so that the
+  * records are in the order of the modifications of the project.
+  *
+  * @return
+  *     the sequence number of the record, to be passed to commit()
+  */
+uint64_t Journal::append(const std::string &issueId, const std::string &ref,
+                         const std::string &objectId, const std::string &data)
+{
+    Record record;
+    record.issueId = issueId;
+    record.ref = ref;
+    record.objectId = objectId;
+    record.data = data;
+
+    pthread_mutex_lock(&mutex);
+    pending.push_back(record);
+    uint64_t seq = ++appendedSeq;
+    pthread_mutex_unlock(&mutex);
+    return seq;
+}
+
+/** Wait until a record is written and synced
+  *
+  * Must be called outside of the lock of the project, so that the
+  * records appended in the meantime are committed in the same batch.
+  *
+  * The caller has already published the modification in memory. So the
+  * result tells if the record is stored:
+  * - if the journal cannot be written, the record is materialized and
+  *   the materialized files are synced directly, and the commit succeeds
+  *   if this succeeds,
+  * - if the journal is written, the commit succeeds, and the record is
+  *   materialized in the background (if it cannot be, it will be when
+  *   the journal is replayed).
+  *
+  * A record that is neither in the journal nor materialized is failed,
+  * and so are the records appended on top of it for the same issue (they
+  * are dropped). The caller must then roll back the issue to its stored
+  * state and call resume().
+  *
+  * @return
+  *     0 success: the record is stored
+  *    -1 the record is not stored, or may not be durable
+  */
+int Journal::commit(uint64_t seq)
+{
+    pthread_mutex_lock(&mutex);
+    commitUntil(seq);
+    int result = failedSeqs.erase(seq) ? -1 : 0;
+    // the caller rolls back the issue to its ref on disk, which must
+    // include the records committed before
+    if (result != 0) waitMaterialized();
+    pthread_mutex_unlock(&mutex);
+    return result;
+}
+
+/** Wait until all the records appended so far are written and materialized
+  *
+  * The errors are left to the committers of the records.
+  */
+void Journal::flush()
+{
+    pthread_mutex_lock(&mutex);
+    commitUntil(appendedSeq);
+    waitMaterialized();
+    pthread_mutex_unlock(&mutex);
+}
+
+/** Tell if the record 'seq' of an issue is to be dropped
+  *
+  * Must be called with the mutex held.
+  */
+bool Journal::isDropped(const std::string &issueId, uint64_t seq) const
+{
+    std::map<std::string, uint64_t>::const_iterator d = droppedIssues.find(issueId);
+    return d != droppedIssues.end() && seq <= d->second;
+}
+
+/** Accept again the records of an issue whose commit failed
+  *
+  * Must be called under the write lock of the project, once the issue
+  * has been rolled back to its stored state: the records appended until
+  * now are on top of the failed record and are dropped, and the records
+  * appended after are accepted.
+  */
+void Journal::resume(const std::string &issueId)
+{
+    pthread_mutex_lock(&mutex);
+    std::map<std::string, uint64_t>::iterator d = droppedIssues.find(issueId);
+    if (d != droppedIssues.end() && d->second == UNTIL_RESUMED) {
+        if (appendedSeq <= committedSeq) droppedIssues.erase(d);
+        else d->second = appendedSeq;
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+/** Commit the pending records, until the record 'seq' is committed
+  *
+  * Must be called with the mutex held.
+  */
+void Journal::commitUntil(uint64_t seq)
+{
+    while (committedSeq < seq) {
+        if (committing) {
+            // another thread is committing a batch, wait for it
+            pthread_cond_wait(&committed, &mutex);
+            continue;
+        }
+
+        // commit all the pending records as one batch
+        committing = true;
+        std::list<Record> batch;
+        batch.swap(pending);
+        uint64_t first = committedSeq + 1;
+        uint64_t last = appendedSeq;
+
+        // the records on top of a failed record of the same issue are
+        // dropped, as their parent is not stored
+        std::list<Record> records;
+        std::set<uint64_t> dropped;
+        uint64_t s = first;
+        std::list<Record>::const_iterator record;
+        FOREACH(record, batch) {
+            if (isDropped(record->issueId, s)) dropped.insert(s);
+            else records.push_back(*record);
+            s++;
+        }
+
+        pthread_mutex_unlock(&mutex);
+
+        int r = writeRecords(records);
+        bool full = (r == 0 && lseek(fd, 0, SEEK_END) >= JOURNAL_CHECKPOINT_SIZE);
+
+        std::set<uint64_t> failed = dropped;
+        std::set<std::string> failedIssues;
+
+        pthread_mutex_lock(&mutex);
+        if (r == 0) {
+            // the records are durable in the journal
+            queueForMaterializing(records);
+        } else {
+            // materialize the records directly, after the records of the
+            // previous batches, so that a ref is not overwritten by an older one
+            waitMaterialized();
+            pthread_mutex_unlock(&mutex);
+
+            s = first;
+            FOREACH(record, batch) {
+                if (dropped.count(s) || failedIssues.count(record->issueId)) {
+                    failed.insert(s);
+                } else if (materialize(*record) != 0) {
+                    // neither in the journal nor materialized
+                    failed.insert(s);
+                    failedIssues.insert(record->issueId);
+                }
+                s++;
+            }
+
+            if (syncFilesystemOf(issuesDir) != 0) {
+                // the materialized records may not be durable
+                LOG_ERROR("Cannot sync the records of %s: %s", path.c_str(), strerror(errno));
+                for (s = first; s <= last; s++) failed.insert(s);
+            }
+            pthread_mutex_lock(&mutex);
+        }
+
+        failedSeqs.insert(failed.begin(), failed.end());
+        std::set<std::string>::const_iterator issueId;
+        FOREACH(issueId, failedIssues) {
+            if (!droppedIssues.count(*issueId)) droppedIssues[*issueId] = UNTIL_RESUMED;
+        }
+        committedSeq = last;
+        std::map<std::string, uint64_t>::iterator d = droppedIssues.begin();
+        while (d != droppedIssues.end()) {
+            if (d->second <= committedSeq) droppedIssues.erase(d++);
+            else d++;
+        }
+        pthread_cond_broadcast(&committed);
+
+        if (full) {
+            // The committers of the batch are already woken up. The next
+            // batch waits until the journal is checkpointed, once all its
+            // records are materialized. If some records could not be,
+            // the whole journal is materialized again (in order, so that
+            // a ref is not overwritten by an older one), and it is kept
+            // if this fails again.
+            waitMaterialized();
+            bool retry = materializeFailed;
+            pthread_mutex_unlock(&mutex);
+            int failures = 0;
+            if (retry) {
+                int replayed;
+                size_t end;
+                failures = materializeJournal(replayed, end);
+                if (failures != 0) LOG_ERROR("Journal %s: records not materialized, journal kept", path.c_str());
+            }
+            if (failures == 0) checkpoint();
+            pthread_mutex_lock(&mutex);
+            if (failures == 0) materializeFailed = false;
+        }
+        committing = false;
+        pthread_cond_broadcast(&committed);
+    }
+}
+
+/** Queue committed records, to be materialized by the background thread
+  *
+  * The thread is started on the first use. If it cannot be started, the
+  * records are materialized directly.
+  *
+  * Must be called with the mutex held.
+  */
+void Journal::queueForMaterializing(const std::list<Record> &records)
+{
+    if (records.empty()) return;
+
+    if (!materializerStarted) {
+        int r = pthread_create(&materializer, NULL, materializerLoop, this);
+        if (r != 0) {
+            LOG_ERROR("Cannot start the materializer of %s: %s", path.c_str(), strerror(r));
+            std::list<Record>::const_iterator record;
+            FOREACH(record, records) {
+                if (materialize(*record) != 0) materializeFailed = true;
+            }
+            return;
+        }
+        materializerStarted = true;
+    }
+
+    toMaterialize.insert(toMaterialize.end(), records.begin(), records.end());
+    pthread_cond_signal(&queued);
+}
+
+/** Wait until the queued records are materialized
+  *
+  * Must be called with the mutex held.
+  */
+void Journal::waitMaterialized()
+{
+    while (!toMaterialize.empty() || materializing) pthread_cond_wait(&materialized, &mutex);
+}
+
+/** Materialize the queued records, in the order of the journal
+  *
+  * On error, the records stay in the journal: the journal is not removed
+  * until they are materialized (see commitUntil), or replayed when the
+  * project is loaded.
+  */
+void *Journal::materializerLoop(void *arg)
+{
+    Journal *journal = (Journal*)arg;
+
+    pthread_mutex_lock(&journal->mutex);
+    while (1) {
+        while (journal->toMaterialize.empty() && !journal->stopping) {
+            pthread_cond_wait(&journal->queued, &journal->mutex);
+        }
+        if (journal->toMaterialize.empty()) break; // stopping
+
+        std::list<Record> records;
+        records.swap(journal->toMaterialize);
+        journal->materializing = true;
+        pthread_mutex_unlock(&journal->mutex);
+
+        bool failed = false;
+        std::list<Record>::const_iterator record;
+        FOREACH(record, records) {
+            if (journal->materialize(*record) != 0) failed = true;
+        }
+
+        pthread_mutex_lock(&journal->mutex);
+        if (failed) journal->materializeFailed = true;
+        journal->materializing = false;
+        pthread_cond_broadcast(&journal->materialized);
+    }
+    pthread_mutex_unlock(&journal->mutex);
+    return 0;
+}
+
+/** Write and sync a batch of records
+  *
+  * The journal file is created if needed.
+  */
+int Journal::writeRecords(const std::list<Record> &records)
+{
+    if (fd < 0) {
+        int flags = O_WRONLY | O_CREAT | O_APPEND;
+#if defined(_WIN32)
+        flags |= O_BINARY;
+#endif
+        fd = ::open(path.c_str(), flags, S_IRUSR | S_IWUSR);
+        if (fd < 0) {
+            LOG_ERROR("Cannot open journal %s: %s", path.c_str(), strerror(errno));
+            return -1;
+        }
+    }
+
+    std::string buffer;
+    std::list<Record>::const_iterator record;
+    FOREACH(record, records) {
+        char size[32];
+        snprintf(size, sizeof(size), "%lu\n", L(record->data.size()));
+        buffer += record->issueId + " " + record->ref + " " + record->objectId + " " + size;
+        buffer += record->data;
+    }
+
+    // on error, the journal is cut back to its previous end, so that
+    // a partial record does not hide the records of the next batches
+    off_t end = lseek(fd, 0, SEEK_END);
+    const char *ptr = buffer.data();
+    size_t remaining = buffer.size();
+    while (remaining > 0) {
+        ssize_t n = write(fd, ptr, remaining);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("Cannot write journal %s: %s", path.c_str(), strerror(errno));
+            if (end >= 0 && ftruncate(fd, end) != 0) LOG_ERROR("Cannot restore journal %s", path.c_str());
+            return -1;
+        }
+        ptr += n;
+        remaining -= n;
+    }
+
+    int r = syncFile(fd);
+    if (r != 0) {
+        LOG_ERROR("Cannot sync journal %s: %s", path.c_str(), strerror(errno));
+        return -1;
+    }
+    LOG_DIAG("Journal %s: %ld record(s) committed", path.c_str(), L(records.size()));
+    return 0;
+}
+
+/** Store the object and the ref of a record
+  *
+  * The files are not synced: the journal keeps the record until the
+  * next checkpoint.
+  */
+int Journal::materialize(const Record &record)
+{
+    int r = Object::writeToId(objectsDir, record.data.data(), record.data.size(), record.objectId);
+    if (r < 0) {
+        LOG_ERROR("Journal: cannot store object %s", record.objectId.c_str());
+        return -1;
+    }
+    std::string refPath = issuesDir + "/" + record.issueId;
+    r = writeToFile(refPath, record.ref);
+    if (r != 0) {
+        LOG_ERROR("Journal: cannot store issue %s", record.issueId.c_str());
+        return -1;
+    }
+    return 0;
+}
+
+/** Sync the materialized files and remove the journal
+  *
+  * Must be called by the committing thread (or with the mutex held),
+  * once the records of the journal are materialized.
+  */
+int Journal::checkpoint()
+{
+    if (fd >= 0) {
+        int r = syncFilesystem(fd);
+        if (r != 0) {
+            LOG_ERROR("Cannot sync the materialized records of %s: %s", path.c_str(), strerror(errno));
+            return -1;
+        }
+        close(fd);
+        fd = -1;
+    }
+
+    int r = unlink(path.c_str());
+    if (r != 0) {
+        LOG_ERROR("Cannot remove journal %s: %s", path.c_str(), strerror(errno));
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,96 @@
+#ifndef _Journal_h
+#define _Journal_h
+
+#include <string>
+#include <list>
+#include <set>
+#include <map>
+#include <stdint.h>
+#include <pthread.h>
+
+#define JOURNAL_CHECKPOINT_SIZE (1024*1024) // bytes of journal above which it is removed
+
+/** Write-ahead journal of the entries of a project
+  *
+  * New entries are appended to the journal (under the write lock of the
+  * project) instead of being written directly as loose objects and refs.
+  * The records are then committed outside of the lock of the project:
+  * the first committer writes all the pending records in a row, syncs
+  * them with a single fdatasync (group commit), and wakes up the other
+  * committers. A background thread then materializes the records (loose
+  * objects and refs of issues), in the order of the journal.
+  *
+  * The journal is a file made of records:
+  *     <issue-id> <ref> <object-id> <size>\n
+  *     followed by the <size> bytes of the object
+  *
+  * A record means: store the object, and set the ref of the issue.
+  * As the materialized files are not synced, the journal is replayed
+  * when the project is loaded (after a crash), and removed only after
+  * the materialized files have been synced (checkpoint), and never
+  * while a record could not be materialized. The journal file does not
+  * exist when it has no record.
+  *
+  * Until then, the files on disk may lag behind the project in memory:
+  * flush() waits until they are up to date.
+  *
+  * If the journal cannot be written, then the records are materialized
+  * and synced directly, after the records queued in the background.
+  * A commit fails only if its record is neither in the journal nor
+  * materialized (see commit). The following records of the same issue
+  * are then dropped, until the issue is rolled back and resume() is
+  * called.
+  */
+class Journal {
+public:
+    Journal();
+    ~Journal();
+    int open(const std::string &path, const std::string &objectsDir, const std::string &issuesDir);
+    uint64_t append(const std::string &issueId, const std::string &ref,
+                    const std::string &objectId, const std::string &data);
+    int commit(uint64_t seq);
+    void resume(const std::string &issueId);
+    void flush();
+
+private:
+    struct Record {
+        std::string issueId;
+        std::string ref;
+        std::string objectId;
+        std::string data;
+    };
+    int replay();
+    int materializeJournal(int &replayed, size_t &end);
+    bool isDropped(const std::string &issueId, uint64_t seq) const;
+    void commitUntil(uint64_t seq);
+    int writeRecords(const std::list<Record> &records);
+    int materialize(const Record &record);
+    void queueForMaterializing(const std::list<Record> &records);
+    void waitMaterialized();
+    static void *materializerLoop(void *arg);
+    int checkpoint();
+
+    std::string path;
+    std::string objectsDir;
+    std::string issuesDir;
+    int fd;
+    bool opened;
+    std::list<Record> pending; // appended, not yet written
+    uint64_t appendedSeq; // sequence number of the last appended record
+    uint64_t committedSeq; // sequence number of the last committed record
+    std::set<uint64_t> failedSeqs; // records whose commit failed (not stored)
+    std::map<std::string, uint64_t> droppedIssues; // issue -> last seq of its dropped records
+    bool committing; // a committer is writing a batch, or doing a checkpoint
+    std::list<Record> toMaterialize; // committed in the journal, not yet materialized
+    bool materializing; // the materializer is storing records taken from toMaterialize
+    bool materializeFailed; // a record could not be materialized since the last checkpoint
+    bool materializerStarted;
+    bool stopping; // the materializer must stop once toMaterialize is empty
+    pthread_t materializer;
+    pthread_mutex_t mutex;
+    pthread_cond_t committed;
+    pthread_cond_t queued; // records added to toMaterialize, or stopping
+    pthread_cond_t materialized; // toMaterialize emptied and stored
+};
+
+#endif
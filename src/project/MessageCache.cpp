@@ -0,0 +1,107 @@
+/*   Small Issue Tracker
+ *   Copyright (C) 2013 Frederic Hoerni
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License v2 as published by
+ *   the Free Software Foundation.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ */
+#include "config.h"
+
+#include "MessageCache.h"
+#include "Entry.h"
+#include "utils/logging.h"
+#include "global.h"
+
+MessageCache MessageCache::Cache;
+
+/** Register the location of the objects of a project
+  *
+  * The messages of the entries of this project are loaded from there.
+  */
+void MessageCache::registerProject(const std::string &projectName, const std::string &objectsDir)
+{
+    ScopeLocker scopeLocker(Cache.locker, LOCK_READ_WRITE);
+    Cache.objectsDirs[projectName] = objectsDir;
+}
+
+/** Get the message of an entry
+  *
+  * On a cache miss, the entry is read and parsed from the object store
+  * (outside of the mutex), and its message is inserted in the cache.
+  */
+std::string MessageCache::get(const std::string &projectName, const std::string &entryId)
+{
+    std::string objectsDir;
+    {
+        ScopeLocker scopeLocker(Cache.locker, LOCK_READ_WRITE);
+
+        std::map<std::string, Item>::iterator i = Cache.items.find(entryId);
+        if (i != Cache.items.end()) {
+            Cache.hits++;
+            Cache.lru.splice(Cache.lru.begin(), Cache.lru, i->second.lruPosition);
+            return i->second.message;
+        }
+
+        Cache.misses++;
+        std::map<std::string, std::string>::const_iterator dir = Cache.objectsDirs.find(projectName);
+        if (dir == Cache.objectsDirs.end()) {
+            LOG_ERROR("Cannot get message of entry %s: unknown project '%s'", entryId.c_str(),
+                      projectName.c_str());
+            return "";
+        }
+        objectsDir = dir->second;
+    }
+
+    Entry *e = Entry::loadEntry(objectsDir, entryId);
+    if (!e) return "";
+
+    std::string message;
+    PropertiesCIt m = e->properties.find(K_MESSAGE);
+    if (m != e->properties.end() && !m->second.empty()) message = m->second.front();
+    delete e;
+
+    ScopeLocker scopeLocker(Cache.locker, LOCK_READ_WRITE);
+    Cache.insert(entryId, message);
+
+    return message;
+}
+
+/** Insert a message at the front of the LRU list, and evict the least recently used
+  *
+  * Must be called from a mutex-protected scope.
+  */
+void MessageCache::insert(const std::string &entryId, const std::string &message)
+{
+    if (message.size() > capacity) return; // too big to be cached
+    if (items.count(entryId)) return; // inserted meanwhile by another thread
+
+    lru.push_front(entryId);
+    Item &item = items[entryId];
+    item.message = message;
+    item.lruPosition = lru.begin();
+    size += message.size();
+
+    while (size > capacity && !lru.empty()) {
+        std::map<std::string, Item>::iterator oldest = items.find(lru.back());
+        size -= oldest->second.message.size();
+        items.erase(oldest);
+        lru.pop_back();
+    }
+}
+
+MessageCacheStats MessageCache::getStats()
+{
+    ScopeLocker scopeLocker(Cache.locker, LOCK_READ_ONLY);
+    MessageCacheStats stats;
+    stats.capacity = Cache.capacity;
+    stats.size = Cache.size;
+    stats.count = Cache.items.size();
+    stats.hits = Cache.hits;
+    stats.misses = Cache.misses;
+    return stats;
+}
@@ -0,0 +1,55 @@
+#ifndef _MessageCache_h
+#define _MessageCache_h
+
+#include <string>
+#include <map>
+#include <list>
+
+#include "utils/mutexTools.h"
+
+struct MessageCacheStats {
+    size_t capacity; // bytes
+    size_t size; // bytes
+    size_t count; // number of messages in the cache
+    unsigned long hits;
+    unsigned long misses;
+    MessageCacheStats() : capacity(0), size(0), count(0), hits(0), misses(0) {}
+};
+
+/** Bounded LRU cache of the messages of the entries
+  *
+  * When enabled (non-zero capacity), the messages are removed from the
+  * entries after the loading of the projects (see Entry::dropMessage),
+  * and Entry::getMessage() fetches them from the object store through
+  * this cache.
+  *
+  * Messages are keyed by entry id, shared by all the projects.
+  */
+class MessageCache {
+public:
+    static inline void setCapacity(size_t bytes) { Cache.capacity = bytes; }
+    static inline bool isEnabled() { return Cache.capacity > 0; }
+    static void registerProject(const std::string &projectName, const std::string &objectsDir);
+    static std::string get(const std::string &projectName, const std::string &entryId);
+    static MessageCacheStats getStats();
+
+private:
+    static MessageCache Cache;
+    MessageCache() : capacity(0), size(0), hits(0), misses(0) {}
+    void insert(const std::string &entryId, const std::string &message);
+
+    struct Item {
+        std::string message;
+        std::list<std::string>::iterator lruPosition;
+    };
+    size_t capacity;
+    size_t size;
+    unsigned long hits;
+    unsigned long misses;
+    std::map<std::string, Item> items;
+    std::list<std::string> lru; // entry ids, most recently used first
+    std::map<std::string, std::string> objectsDirs; // key: project name
+    Locker locker;
+};
+
+#endif
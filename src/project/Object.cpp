@@ -1,10 +1,27 @@
 #include "config.h"
 
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <vector>
+#include <fcntl.h>
+#include <zlib.h>
+
 #include "Object.h"
+#include "ObjectPack.h"
 #include "utils/identifiers.h"
 #include "utils/filesystem.h"
 #include "utils/stringTools.h"
 #include "utils/logging.h"
+#include "global.h"
+
+#define OBJECT_MAGIC "\0SMZ"
+#define OBJECT_MAGIC_SIZE 4
+#define OBJECT_COMPRESSION_MIN_SIZE 256 // smaller objects are not worth compressing
+
+int Object::Compression = OBJECT_CODEC_NONE;
 
 
 std::string Object::getSubpath(const std::string &id) {
@@ -25,7 +42,9 @@ std::string Object::getSubdir(const std::string &id) {
     }
 }
 
-/** Get the next object in the objects database
+/** Get the next loose object in the objects database
+  *
+  * Packed objects are not iterated through.
   *
   * All directory descriptors will be closed
   * after all the objects have been iterated through.
@@ -50,6 +69,7 @@ std::string Object::getNextObject(ObjectIteraror &objectIt)
                 closeDir(objectIt.root);
                 return "";
             }
+            if (objectIt.subdirname == PACK_SUBDIR) continue;
 
             std::string subdirpath = objectIt.path + "/" + objectIt.subdirname;
             objectIt.subdir = openDir(subdirpath);
@@ -74,6 +94,157 @@ std::string Object::getNextObject(ObjectIteraror &objectIt)
     }
 }
 
+/** Compress data with gzip, and prefix it with the header of compressed objects
+  *
+  * @return
+  *     0 success
+  *    -1 error
+  */
+static int encodeGzip(const char *data, size_t size, std::string &stored)
+{
+    if (size > UINT_MAX) return -1; // not supported by a single call to deflate
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    int r = deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15+16, 8, Z_DEFAULT_STRATEGY);
+    if (r != Z_OK) {
+        LOG_ERROR("deflateInit2 error: %d", r);
+        return -1;
+    }
+
+    stored.assign(OBJECT_MAGIC, OBJECT_MAGIC_SIZE);
+    stored += (char)OBJECT_CODEC_GZIP;
+    putU64(stored, size);
+    size_t offset = stored.size();
+    size_t bound = deflateBound(&zs, size);
+    stored.resize(offset + bound);
+
+    zs.next_in = (Bytef*)data;
+    zs.avail_in = size;
+    zs.next_out = (Bytef*)&stored[offset];
+    zs.avail_out = bound;
+    r = deflate(&zs, Z_FINISH);
+    size_t compressedSize = zs.total_out;
+    deflateEnd(&zs);
+
+    if (r != Z_STREAM_END) {
+        LOG_ERROR("deflate error: %d", r);
+        return -1;
+    }
+    stored.resize(offset + compressedSize);
+    return 0;
+}
+
+/** Get the codec of stored bytes of an object
+  *
+  * @return
+  *     OBJECT_CODEC_NONE if the stored bytes have no header (raw contents)
+  */
+int Object::getCodec(const char *stored, size_t size)
+{
+    if (size < OBJECT_HEADER_SIZE) return OBJECT_CODEC_NONE;
+    if (0 != memcmp(stored, OBJECT_MAGIC, OBJECT_MAGIC_SIZE)) return OBJECT_CODEC_NONE;
+    return (uint8_t)stored[OBJECT_MAGIC_SIZE];
+}
+
+/** Get the size of the contents of an object from its stored bytes
+  *
+  * @param stored
+  *     the stored bytes, or at least their header
+  *
+  * @param size
+  *     size of all the stored bytes
+  */
+static long getUncompressedSize(const char *stored, size_t size)
+{
+    if (size < OBJECT_HEADER_SIZE) return size;
+    if (Object::getCodec(stored, OBJECT_HEADER_SIZE) == OBJECT_CODEC_NONE) return size;
+    return getU64((const uint8_t*)stored + OBJECT_MAGIC_SIZE + 1);
+}
+
+/** Read the header of a loose object
+  *
+  * @return
+  *     0 success
+  *    -1 the file cannot be read or is smaller than a header
+  */
+static int readHeader(const std::string &path, char *header)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return -1;
+    ssize_t n = read(fd, header, OBJECT_HEADER_SIZE);
+    close(fd);
+    if (n != OBJECT_HEADER_SIZE) return -1;
+    return 0;
+}
+
+/** Get the codec of an object, without loading it
+  */
+int Object::getCodec(const std::string &objectsDir, const std::string &id)
+{
+    size_t size;
+    const char *packed = ObjectPack::lookup(objectsDir, id, size);
+    if (packed) return getCodec(packed, size);
+
+    char header[OBJECT_HEADER_SIZE];
+    if (0 != readHeader(objectsDir + "/" + getSubpath(id), header)) return OBJECT_CODEC_NONE;
+    return getCodec(header, OBJECT_HEADER_SIZE);
+}
+
+/** Get the contents of an object from its stored bytes
+  *
+  * @return
+  *     0 success
+  *    -1 error (unknown codec or corrupted compressed contents)
+  */
+int Object::decode(const char *stored, size_t size, std::string &data)
+{
+    int codec = getCodec(stored, size);
+    if (codec == OBJECT_CODEC_NONE) {
+        data.assign(stored, size);
+        return 0;
+    }
+    if (codec != OBJECT_CODEC_GZIP) {
+        LOG_ERROR("Unsupported object codec: %d", codec);
+        errno = EINVAL;
+        return -1;
+    }
+
+    uint64_t uncompressedSize = getUncompressedSize(stored, size);
+    if (uncompressedSize > UINT_MAX || size - OBJECT_HEADER_SIZE > UINT_MAX) {
+        LOG_ERROR("Compressed object too big: %lu bytes", L(uncompressedSize));
+        errno = EINVAL;
+        return -1;
+    }
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    int r = inflateInit2(&zs, 15+16);
+    if (r != Z_OK) {
+        LOG_ERROR("inflateInit2 error: %d", r);
+        errno = EINVAL;
+        return -1;
+    }
+
+    char empty;
+    data.resize(uncompressedSize);
+    zs.next_in = (Bytef*)stored + OBJECT_HEADER_SIZE;
+    zs.avail_in = size - OBJECT_HEADER_SIZE;
+    zs.next_out = (Bytef*)(uncompressedSize ? &data[0] : &empty);
+    zs.avail_out = uncompressedSize;
+    r = inflate(&zs, Z_FINISH);
+    bool ok = (r == Z_STREAM_END && zs.total_out == uncompressedSize);
+    inflateEnd(&zs);
+
+    if (!ok) {
+        LOG_ERROR("Cannot uncompress object: %d", r);
+        data.clear();
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
 /** Write an object into a database, with a given id
   *
   * @param objectsDir
@@ -97,16 +268,43 @@ int Object::writeToId(const std::string &objectsDir, const char *data, size_t si
 
     LOG_DIAG("Write object: %s", path.c_str());
 
+    // new objects are always written loose, unless already packed
+    std::string existing;
+    size_t packedSize;
+    const char *packed = ObjectPack::lookup(objectsDir, id, packedSize);
+    if (packed) {
+        int r = decode(packed, packedSize, existing);
+        if (r != 0 || 0 != existing.compare(0, existing.size(), data, size)) {
+            LOG_ERROR("SHA1 conflict on packed object %s", id.c_str());
+            return -2;
+        }
+        LOG_DIAG("Object already packed with same contents: %s", id.c_str());
+        return 1;
+    }
+
     if (fileExists(path)) {
         // check if files are the same
-        int r = cmpContents(data, size, path);
-        if (r != 0) {
+        int r = load(objectsDir, id, existing);
+        if (r != 0 || 0 != existing.compare(0, existing.size(), data, size)) {
             LOG_ERROR("SHA1 conflict on object %s", path.c_str());
             return -2;
         }
         LOG_DIAG("File already exists with same contents: %s", path.c_str());
         return 1; // file already exists with same contents
     }
+
+    // Compress if configured. Raw contents that look like a header
+    // are always compressed, so that they cannot be misinterpreted.
+    std::string encoded;
+    if ( (Compression == OBJECT_CODEC_GZIP && size >= OBJECT_COMPRESSION_MIN_SIZE) ||
+         getCodec(data, size) != OBJECT_CODEC_NONE) {
+        int r = encodeGzip(data, size, encoded);
+        if (r == 0 && (encoded.size() < size || getCodec(data, size) != OBJECT_CODEC_NONE)) {
+            data = encoded.data();
+            size = encoded.size();
+        }
+    }
+
     std::string subdir = objectsDir + "/" + getSubdir(id);
     mkdir(subdir);
     int r = writeToFile(path.c_str(), data, size);
@@ -140,8 +338,201 @@ int Object::write(const std::string &objectsDir, const std::string &data, std::s
     return write(objectsDir, data.data(), data.size(), id);
 }
 
-int Object::load(const std::string &objectsDir, std::string &id, std::string &data)
+/** Load the stored bytes of an object, either packed or loose
+  *
+  * The stored bytes may be compressed (see decode).
+  *
+  * @return
+  *     0 success
+  *    -1 error (the object does not exist)
+  */
+int Object::loadStored(const std::string &objectsDir, const std::string &id, std::string &stored)
 {
+    size_t size;
+    const char *packed = ObjectPack::lookup(objectsDir, id, size);
+    if (packed) {
+        stored.assign(packed, size);
+        return 0;
+    }
+
     std::string path = objectsDir + "/" + getSubpath(id);
-    return loadFile(path.c_str(), data);
+    int r = loadFile(path.c_str(), stored);
+    if (r == 0) return 0;
+
+    // the object may have been packed in the meantime
+    int err = errno;
+    ObjectPack::rescan(objectsDir);
+    packed = ObjectPack::lookup(objectsDir, id, size);
+    if (packed) {
+        stored.assign(packed, size);
+        return 0;
+    }
+    errno = err;
+    return -1;
+}
+
+/** Load an object, either packed or loose, and uncompress it if needed
+  *
+  * @return
+  *     0 success
+  *    -1 error (the object does not exist, or cannot be uncompressed)
+  */
+int Object::load(const std::string &objectsDir, const std::string &id, std::string &data)
+{
+    std::string stored;
+    int r = loadStored(objectsDir, id, stored);
+    if (r != 0) return r;
+
+    if (getCodec(stored.data(), stored.size()) == OBJECT_CODEC_NONE) {
+        data.swap(stored);
+        return 0;
+    }
+    return decode(stored.data(), stored.size(), data);
+}
+
+bool Object::exists(const std::string &objectsDir, const std::string &id)
+{
+    size_t size;
+    if (ObjectPack::lookup(objectsDir, id, size)) return true;
+    if (fileExists(objectsDir + "/" + getSubpath(id))) return true;
+    ObjectPack::rescan(objectsDir);
+    if (ObjectPack::lookup(objectsDir, id, size)) return true;
+    return false;
+}
+
+/** Get the size of an object
+  *
+  * @return
+  *     size in bytes, or -1 if the object does not exist
+  */
+long Object::getSize(const std::string &objectsDir, const std::string &id)
+{
+    size_t size;
+    const char *packed = ObjectPack::lookup(objectsDir, id, size);
+    if (packed) return getUncompressedSize(packed, size);
+
+    std::string path = objectsDir + "/" + getSubpath(id);
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0) {
+        char header[OBJECT_HEADER_SIZE];
+        if (0 == readHeader(path, header)) return getUncompressedSize(header, st.st_size);
+        return st.st_size;
+    }
+
+    ObjectPack::rescan(objectsDir);
+    packed = ObjectPack::lookup(objectsDir, id, size);
+    if (packed) return getUncompressedSize(packed, size);
+    return -1;
+}
+
+/** Get the ids of all objects, packed and loose
+  */
+void Object::getObjects(const std::string &objectsDir, std::list<std::string> &objects)
+{
+    ObjectPack::rescan(objectsDir);
+    ObjectPack::getIds(objectsDir, objects);
+
+    ObjectIteraror oit(objectsDir);
+    std::string objectId;
+    size_t size;
+    while ( (objectId = getNextObject(oit)) != "") {
+        if (ObjectPack::lookup(objectsDir, objectId, size)) continue; // already listed
+        objects.push_back(objectId);
+    }
+}
+
+bool Object::isSha1Id(const std::string &id)
+{
+    return id.size() == 40 && id.find_first_not_of("0123456789abcdef") == std::string::npos;
+}
+
+/** Verify that the contents of an object match its id
+  *
+  * A packed object is hashed in place in the mapped pack, unless compressed.
+  * The sha1 is computed on the uncompressed contents.
+  *
+  * @return
+  *     0 the object is valid
+  *    -1 the object cannot be loaded
+  *    -2 the sha1 of the contents does not match the id
+  */
+int Object::verify(const std::string &objectsDir, const std::string &id, Sha1Hasher &hasher)
+{
+    std::string sha1;
+    size_t size;
+    const char *packed = ObjectPack::lookup(objectsDir, id, size);
+    if (packed && getCodec(packed, size) == OBJECT_CODEC_NONE) {
+        sha1 = hasher.digest(packed, size);
+    } else {
+        std::string data;
+        int r = load(objectsDir, id, data);
+        if (r != 0) return -1;
+        sha1 = hasher.digest(data.data(), data.size());
+    }
+
+    if (sha1 != id) return -2;
+    return 0;
+}
+
+/** Move all the loose objects into a new pack
+  *
+  * Loose objects that were already packed are removed.
+  * Loose files whose name is not a SHA1 are left untouched.
+  *
+  * @return
+  *     number of objects newly packed
+  *    -1 error
+  */
+int Object::repack(const std::string &objectsDir)
+{
+    ObjectPack::rescan(objectsDir);
+
+    std::vector<std::string> ids;
+    std::list<std::string> obsolete;
+    ObjectIteraror oit(objectsDir);
+    std::string objectId;
+    while ( (objectId = getNextObject(oit)) != "") {
+        if (!isSha1Id(objectId)) {
+            LOG_INFO("Not packing '%s': not a SHA1", objectId.c_str());
+            continue;
+        }
+        size_t size;
+        if (ObjectPack::lookup(objectsDir, objectId, size)) obsolete.push_back(objectId);
+        else ids.push_back(objectId);
+    }
+
+    if (!ids.empty()) {
+        std::string name;
+        int r = ObjectPack::create(objectsDir, ids, name);
+        if (r != 0) return -1;
+
+        ObjectPack::rescan(objectsDir);
+        LOG_INFO("Pack %s: %ld objects", name.c_str(), L(ids.size()));
+    }
+
+    // remove the loose objects that are now packed
+    obsolete.insert(obsolete.end(), ids.begin(), ids.end());
+    std::list<std::string>::const_iterator id;
+    FOREACH(id, obsolete) {
+        std::string path = objectsDir + "/" + getSubpath(*id);
+        size_t size;
+        const char *packed = ObjectPack::lookup(objectsDir, *id, size);
+        if (!packed) {
+            LOG_ERROR("Object missing in pack, not removed: %s", id->c_str());
+            continue;
+        }
+        if (0 != cmpContents(packed, size, path)) {
+            LOG_ERROR("Loose object differs from packed one, not removed: %s", path.c_str());
+            continue;
+        }
+        if (0 != unlink(path.c_str())) {
+            LOG_ERROR("Cannot remove '%s': %s", path.c_str(), STRERROR(errno));
+            continue;
+        }
+        // remove the subdir if empty (fails silently otherwise)
+        std::string subdir = objectsDir + "/" + getSubdir(*id);
+        rmdir(subdir.c_str());
+    }
+
+    return ids.size();
 }
@@ -3,12 +3,19 @@
 
 
 #include <string>
+#include <list>
 #include <dirent.h>
 
 #define K_PARENT "+parent"
 #define K_AUTHOR "+author"
 #define K_CTIME "+ctime"
 
+#define OBJECT_CODEC_NONE 0
+#define OBJECT_CODEC_GZIP 1
+#define OBJECT_HEADER_SIZE 13 // header of compressed objects: "\0SMZ" <codec:1> <uncompressed-size:8>
+
+class Sha1Hasher;
+
 struct ObjectIteraror {
     std::string path;
     std::string subdirname;
@@ -17,6 +24,16 @@ struct ObjectIteraror {
     ObjectIteraror(const std::string p) : path(p), root(0), subdir(0) {}
 };
 
+/** Objects database
+  *
+  * Objects are identified by the sha1 of their contents.
+  *
+  * An object may be stored compressed: in this case the stored bytes are
+  * a header (OBJECT_HEADER_SIZE) followed by the compressed contents.
+  * The id remains the sha1 of the uncompressed contents.
+  * With OBJECT_CODEC_GZIP, the compressed contents are a gzip stream
+  * (RFC 1952), that may be sent as is to HTTP clients accepting gzip.
+  */
 class Object {
 
 public:
@@ -32,8 +49,22 @@ public:
     static int writeToId(const std::string &objectsDir, const char *data, size_t size, const std::string &id);
     static int write(const std::string &objectsDir, const char *data, size_t size, std::string &id);
     static int write(const std::string &objectsDir, const std::string &data, std::string &id);
-    static int load(const std::string &objectsDir, std::string &id, std::string &data);
+    static int load(const std::string &objectsDir, const std::string &id, std::string &data);
+    static int loadStored(const std::string &objectsDir, const std::string &id, std::string &stored);
+    static int decode(const char *stored, size_t size, std::string &data);
+    static int getCodec(const char *stored, size_t size);
+    static int getCodec(const std::string &objectsDir, const std::string &id);
+    static inline void setCompression(int codec) { Compression = codec; }
+    static inline int getCompression() { return Compression; }
+    static bool exists(const std::string &objectsDir, const std::string &id);
+    static long getSize(const std::string &objectsDir, const std::string &id);
+    static void getObjects(const std::string &objectsDir, std::list<std::string> &objects);
+    static int repack(const std::string &objectsDir);
+    static int verify(const std::string &objectsDir, const std::string &id, Sha1Hasher &hasher);
+    static bool isSha1Id(const std::string &id);
 
+private:
+    static int Compression; // codec of the new objects
 };
 
 #endif
@@ -0,0 +1,444 @@
+/*   Small Issue Tracker
+ *   Copyright (C) 2013 Frederic Hoerni
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License v2 as published by
+ *   the Free Software Foundation.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ */
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <map>
+#include <set>
+#include <algorithm>
+#if !defined(_WIN32)
+  #include <sys/mman.h>
+#endif
+
+#include "ObjectPack.h"
+#include "Object.h"
+#include "utils/identifiers.h"
+#include "utils/filesystem.h"
+#include "utils/stringTools.h"
+#include "utils/mutexTools.h"
+#include "utils/logging.h"
+#include "global.h"
+
+#define PACK_MAGIC "SMPK"
+#define IDX_MAGIC "SMIX"
+#define PACK_VERSION 1
+#define HEADER_SIZE 12
+#define FANOUT_SIZE (256*4)
+#define SHA1_SIZE 20
+#define RECORD_SIZE (SHA1_SIZE+8+8)
+
+/** Convert a 40-characters hexadecimal id to binary
+  *
+  * @return
+  *     0 success
+  *    -1 the id is not a SHA1
+  */
+static int hexToSha1(const std::string &id, uint8_t *sha1)
+{
+    if (id.size() != 2*SHA1_SIZE) return -1;
+    for (size_t i = 0; i < SHA1_SIZE; i++) {
+        uint8_t byte = 0;
+        for (size_t j = 0; j < 2; j++) {
+            char c = id[2*i+j];
+            byte <<= 4;
+            if (c >= '0' && c <= '9') byte |= c - '0';
+            else if (c >= 'a' && c <= 'f') byte |= c - 'a' + 10;
+            else return -1;
+        }
+        sha1[i] = byte;
+    }
+    return 0;
+}
+
+int MappedFile::map(const std::string &path)
+{
+#if !defined(_WIN32)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    size = st.st_size;
+    if (size == 0) {
+        close(fd);
+        data = 0;
+        return 0;
+    }
+    void *p = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        size = 0;
+        return -1;
+    }
+    data = (const char*)p;
+    return 0;
+#else
+    std::string contents;
+    int r = loadFile(path.c_str(), contents);
+    if (r != 0) return -1;
+    size = contents.size();
+    char *buffer = (char*)malloc(size+1);
+    if (!buffer) return -1;
+    memcpy(buffer, contents.data(), size);
+    data = buffer;
+    return 0;
+#endif
+}
+
+void MappedFile::unmap()
+{
+    if (!data) return;
+#if !defined(_WIN32)
+    munmap((void*)data, size);
+#else
+    free((void*)data);
+#endif
+    data = 0;
+    size = 0;
+}
+
+ObjectPack::~ObjectPack()
+{
+    pack.unmap();
+    idx.unmap();
+}
+
+/** Open a pack and its index
+  *
+  * @return
+  *     a pointer to a newly allocated ObjectPack, or NULL in case of error
+  */
+ObjectPack *ObjectPack::open(const std::string &packPath, const std::string &idxPath)
+{
+    ObjectPack *op = new ObjectPack;
+    op->name = getBasename(packPath);
+
+    if (op->idx.map(idxPath) != 0) {
+        LOG_ERROR("Cannot map pack index '%s': %s", idxPath.c_str(), STRERROR(errno));
+        delete op;
+        return 0;
+    }
+    if (op->pack.map(packPath) != 0) {
+        LOG_ERROR("Cannot map pack '%s': %s", packPath.c_str(), STRERROR(errno));
+        delete op;
+        return 0;
+    }
+
+    const uint8_t *p = (const uint8_t*)op->idx.data;
+    if (op->idx.size < HEADER_SIZE + FANOUT_SIZE || 0 != memcmp(p, IDX_MAGIC, 4) ||
+            getU32(p+4) != PACK_VERSION) {
+        LOG_ERROR("Invalid pack index '%s'", idxPath.c_str());
+        delete op;
+        return 0;
+    }
+    op->count = getU32(p+8);
+    if (op->idx.size != HEADER_SIZE + FANOUT_SIZE + (size_t)op->count * RECORD_SIZE) {
+        LOG_ERROR("Invalid size of pack index '%s'", idxPath.c_str());
+        delete op;
+        return 0;
+    }
+    op->fanout = p + HEADER_SIZE;
+    op->records = op->fanout + FANOUT_SIZE;
+
+    if (op->pack.size < HEADER_SIZE || 0 != memcmp(op->pack.data, PACK_MAGIC, 4) ||
+            getU32((const uint8_t*)op->pack.data+8) != op->count) {
+        LOG_ERROR("Invalid pack '%s'", packPath.c_str());
+        delete op;
+        return 0;
+    }
+
+    return op;
+}
+
+/** Look for an object in the pack
+  *
+  * @param[out] size
+  *
+  * @return
+  *     a pointer to the contents of the object (not null-terminated),
+  *     or NULL if the object is not in this pack
+  */
+const char *ObjectPack::find(const std::string &id, size_t &size) const
+{
+    uint8_t sha1[SHA1_SIZE];
+    if (hexToSha1(id, sha1) != 0) return 0;
+
+    // narrow the search with the fanout table
+    uint32_t lo = (sha1[0] == 0) ? 0 : getU32(fanout + 4*(sha1[0]-1));
+    uint32_t hi = getU32(fanout + 4*sha1[0]);
+    if (hi > count) hi = count;
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        const uint8_t *record = records + (size_t)mid * RECORD_SIZE;
+        int c = memcmp(sha1, record, SHA1_SIZE);
+        if (c == 0) {
+            uint64_t offset = getU64(record + SHA1_SIZE);
+            uint64_t length = getU64(record + SHA1_SIZE + 8);
+            if (offset + length > pack.size) {
+                LOG_ERROR("Corrupted pack %s: object %s out of bounds", name.c_str(), id.c_str());
+                return 0;
+            }
+            size = length;
+            return pack.data + offset;
+        } else if (c < 0) hi = mid;
+        else lo = mid + 1;
+    }
+    return 0;
+}
+
+std::string ObjectPack::getId(uint32_t i) const
+{
+    return bin2hex(records + (size_t)i * RECORD_SIZE, SHA1_SIZE);
+}
+
+static int writeAll(FILE *f, const char *data, size_t size)
+{
+    if (size == 0) return 0;
+    size_t n = fwrite(data, 1, size, f);
+    if (n != size) return -1;
+    return 0;
+}
+
+/** Create a pack from loose objects
+  *
+  * The loose objects are not removed. The pack, its index and the pack
+  * directory are synced, so that the loose objects may then be removed.
+  *
+  * @param ids
+  *     ids of the loose objects to be packed. They are sorted on return.
+  *
+  * @param[out] name
+  *     name of the new pack (pack-<sha1>)
+  *
+  * @return
+  *     0 success
+  *    -1 error
+  */
+int ObjectPack::create(const std::string &objectsDir, std::vector<std::string> &ids, std::string &name)
+{
+    std::sort(ids.begin(), ids.end());
+
+    std::string concatenatedIds;
+    std::vector<std::string>::const_iterator id;
+    FOREACH(id, ids) concatenatedIds += *id;
+    name = PACK_PREFIX + getSha1(concatenatedIds);
+
+    std::string packDir = objectsDir + "/" PACK_SUBDIR;
+    mkdir(packDir);
+    std::string packPath = packDir + "/" + name + PACK_SUFFIX;
+    std::string idxPath = packDir + "/" + name + PACK_IDX_SUFFIX;
+    std::string packTmp = getTmpPath(packPath);
+
+    FILE *f = fopen(packTmp.c_str(), "wb");
+    if (!f) {
+        LOG_ERROR("Cannot create pack '%s': %s", packTmp.c_str(), STRERROR(errno));
+        return -1;
+    }
+
+    std::string header = PACK_MAGIC;
+    putU32(header, PACK_VERSION);
+    putU32(header, ids.size());
+    int r = writeAll(f, header.data(), header.size());
+
+    uint32_t fanout[256];
+    memset(fanout, 0, sizeof(fanout));
+    std::string records;
+    uint64_t offset = header.size();
+
+    FOREACH(id, ids) {
+        if (r != 0) break;
+
+        uint8_t sha1[SHA1_SIZE];
+        if (hexToSha1(*id, sha1) != 0) {
+            LOG_ERROR("Cannot pack object with invalid id: %s", id->c_str());
+            r = -1;
+            break;
+        }
+
+        std::string path = objectsDir + "/" + Object::getSubpath(*id);
+        std::string data;
+        r = loadFile(path.c_str(), data);
+        if (r != 0) {
+            LOG_ERROR("Cannot load object '%s': %s", path.c_str(), STRERROR(errno));
+            break;
+        }
+
+        r = writeAll(f, data.data(), data.size());
+
+        records.append((const char*)sha1, SHA1_SIZE);
+        putU64(records, offset);
+        putU64(records, data.size());
+        offset += data.size();
+        fanout[sha1[0]]++;
+    }
+
+    // the pack and its index are synced before the loose objects are removed (see Object::repack)
+    if (r == 0 && (fflush(f) != 0 || syncFile(fileno(f)) != 0)) r = -1;
+    if (fclose(f) != 0) r = -1;
+    if (r != 0) {
+        LOG_ERROR("Cannot write pack '%s': %s", packTmp.c_str(), STRERROR(errno));
+        unlink(packTmp.c_str());
+        return -1;
+    }
+
+    // build the index
+    std::string index = IDX_MAGIC;
+    putU32(index, PACK_VERSION);
+    putU32(index, ids.size());
+    uint32_t cumul = 0;
+    for (int i = 0; i < 256; i++) {
+        cumul += fanout[i];
+        putU32(index, cumul);
+    }
+    index += records;
+
+    // the pack must be in place before its index, as the index
+    // is what makes a pack visible
+    r = rename(packTmp.c_str(), packPath.c_str());
+    if (r != 0) {
+        LOG_ERROR("Cannot rename '%s' -> '%s': %s", packTmp.c_str(), packPath.c_str(), STRERROR(errno));
+        unlink(packTmp.c_str());
+        return -1;
+    }
+    r = writeToFile(idxPath, index, true);
+    if (r != 0) {
+        LOG_ERROR("Cannot write pack index '%s'", idxPath.c_str());
+        return -1;
+    }
+    r = syncDir(packDir);
+    if (r != 0) {
+        LOG_ERROR("Cannot sync '%s': %s", packDir.c_str(), STRERROR(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/** Registry of the packs, per objects directory
+  *
+  * Packs are never unmapped once registered, so that the pointers
+  * returned by lookup() remain valid for the lifetime of the process.
+  */
+struct PackSet {
+    std::list<ObjectPack*> packs;
+    std::set<std::string> names;
+    time_t mtime; // modification time of the pack directory at last scan
+    time_t scanTime; // time of the last scan
+    PackSet() : mtime(0), scanTime(0) {}
+};
+
+static std::map<std::string, PackSet> Registry;
+static Locker RegistryLocker;
+
+static PackSet *getPackSet(const std::string &objectsDir)
+{
+    std::map<std::string, PackSet>::iterator ps = Registry.find(objectsDir);
+    if (ps == Registry.end()) return 0;
+    return &ps->second;
+}
+
+/** Register the packs of an objects directory that are not registered yet
+  *
+  * The directory is not read again if its modification time has not changed
+  * since the previous scan (and the previous scan was not done within the
+  * same second as the modification).
+  *
+  * @return
+  *     number of new packs
+  */
+int ObjectPack::rescan(const std::string &objectsDir)
+{
+    std::string packDir = objectsDir + "/" PACK_SUBDIR;
+    struct stat st;
+    time_t mtime = 0;
+    if (stat(packDir.c_str(), &st) == 0) mtime = st.st_mtime;
+
+    ScopeLocker scopeLocker(RegistryLocker, LOCK_READ_WRITE);
+
+    PackSet &ps = Registry[objectsDir];
+    if (mtime == 0) return 0; // no pack directory
+    if (ps.mtime == mtime && ps.scanTime > mtime) return 0; // no change
+    ps.mtime = mtime;
+    ps.scanTime = time(0);
+
+    DIR *dirp = openDir(packDir);
+    if (!dirp) return 0;
+
+    int n = 0;
+    std::string f;
+    while ((f = getNextFile(dirp)) != "") {
+        size_t len = strlen(PACK_IDX_SUFFIX);
+        if (f.size() <= len || f.compare(f.size()-len, len, PACK_IDX_SUFFIX) != 0) continue;
+        if (0 != f.compare(0, strlen(PACK_PREFIX), PACK_PREFIX)) continue;
+
+        std::string name = f.substr(0, f.size()-len);
+        if (ps.names.count(name)) continue; // already registered
+
+        std::string base = packDir + "/" + name;
+        ObjectPack *op = ObjectPack::open(base + PACK_SUFFIX, base + PACK_IDX_SUFFIX);
+        if (!op) continue;
+
+        LOG_DIAG("Pack registered: %s (%u objects)", base.c_str(), op->getCount());
+        ps.packs.push_back(op);
+        ps.names.insert(name);
+        n++;
+    }
+    closeDir(dirp);
+    return n;
+}
+
+/** Look for an object in the registered packs of an objects directory
+  *
+  * @return
+  *     a pointer to the contents of the object, or NULL if not found
+  */
+const char *ObjectPack::lookup(const std::string &objectsDir, const std::string &id, size_t &size)
+{
+    ScopeLocker scopeLocker(RegistryLocker, LOCK_READ_ONLY);
+
+    PackSet *ps = getPackSet(objectsDir);
+    if (!ps) return 0;
+
+    std::list<ObjectPack*>::const_iterator op;
+    FOREACH(op, ps->packs) {
+        const char *data = (*op)->find(id, size);
+        if (data) return data;
+    }
+    return 0;
+}
+
+/** Get the ids of all the packed objects of an objects directory
+  */
+void ObjectPack::getIds(const std::string &objectsDir, std::list<std::string> &ids)
+{
+    ScopeLocker scopeLocker(RegistryLocker, LOCK_READ_ONLY);
+
+    PackSet *ps = getPackSet(objectsDir);
+    if (!ps) return;
+
+    std::list<ObjectPack*>::const_iterator op;
+    FOREACH(op, ps->packs) {
+        for (uint32_t i = 0; i < (*op)->getCount(); i++) ids.push_back((*op)->getId(i));
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef _ObjectPack_h
+#define _ObjectPack_h
+
+#include <string>
+#include <list>
+#include <vector>
+#include <stdint.h>
+
+#define PACK_SUBDIR "pack"
+#define PACK_PREFIX "pack-"
+#define PACK_SUFFIX ".pack"
+#define PACK_IDX_SUFFIX ".idx"
+
+/** Memory mapping of a whole file (read-only)
+  *
+  * On Windows the file is simply loaded in memory.
+  */
+struct MappedFile {
+    const char *data;
+    size_t size;
+    MappedFile() : data(0), size(0) {}
+    int map(const std::string &path);
+    void unmap();
+};
+
+/** Pack of objects
+  *
+  * A pack is a pair of files in <objects>/pack:
+  *
+  * pack-<name>.pack
+  *     "SMPK" <version:4> <count:4>
+  *     followed by the raw contents of the objects, concatenated
+  *
+  * pack-<name>.idx
+  *     "SMIX" <version:4> <count:4>
+  *     <fanout:256*4>   number of objects whose first byte of id is <= i
+  *     <count> records of: <sha1:20> <offset:8> <size:8>, sorted by sha1
+  *
+  * Integers are big-endian. <name> is the SHA1 of the sorted ids.
+  *
+  * Packs are immutable. They are memory-mapped and looked up by
+  * binary search in the index.
+  */
+class ObjectPack {
+public:
+    ~ObjectPack();
+    static ObjectPack *open(const std::string &packPath, const std::string &idxPath);
+    const char *find(const std::string &id, size_t &size) const;
+    inline uint32_t getCount() const { return count; }
+    std::string getId(uint32_t i) const;
+    inline const std::string &getName() const { return name; }
+
+    static int create(const std::string &objectsDir, std::vector<std::string> &ids, std::string &name);
+
+    // registry of the packs of each objects directory
+    static const char *lookup(const std::string &objectsDir, const std::string &id, size_t &size);
+    static void getIds(const std::string &objectsDir, std::list<std::string> &ids);
+    static int rescan(const std::string &objectsDir);
+
+private:
+    ObjectPack() : count(0), fanout(0), records(0) {}
+    std::string name;
+    MappedFile pack;
+    MappedFile idx;
+    uint32_t count;
+    const uint8_t *fanout;
+    const uint8_t *records;
+};
+
+#endif
@@ -24,8 +24,10 @@
 #include <dirent.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <limits.h>
 #include <time.h>
 #include <algorithm>
+#include <iterator>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -36,9 +38,16 @@
 #include "utils/logging.h"
 #include "utils/identifiers.h"
 #include "utils/stringTools.h"
+#include "utils/dateTools.h"
+#include "utils/threadPool.h"
+#include "utils/epoch.h"
 #include "global.h"
 #include "mg_win32.h"
 #include "Tag.h"
+#include "ProjectCache.h"
+#include "MessageCache.h"
+
+#define LOADING_BATCH_SIZE 64 // number of issues loaded by a worker in a row
 
 const char *Project::reservedNames[] = {
     "public", // reserved because 'public' is an existing folder
@@ -143,13 +152,34 @@ bool Project::isReservedName(const std::string &name)
 }
 
 
-/** Load a project: configuration, views, entries, tags
+/** Load a project: journal, configuration, views, entries, tags
   *
   * @return
   *     0 on success, -1 on error.
   */
 int Project::load()
 {
+    // replay the entries committed but not materialized before a crash
+    journal.open(path + "/" PATH_JOURNAL, getObjectsDir(), getIssuesDir());
+
+    if (MessageCache::isEnabled()) MessageCache::registerProject(getName(), getObjectsDir());
+
+    return loadContents();
+}
+
+/** Load the contents of a project: configuration, views, entries, tags
+  *
+  * If a cache of the project is present (see ProjectCache) and if its
+  * refs/project matches, then the issues whose ref did not change are
+  * taken from the cache, and the other ones are loaded from the entries.
+  *
+  * @return
+  *     0 on success, -1 on error.
+  */
+int Project::loadContents()
+{
+    double t0 = getSeconds();
+
     int r = loadConfig();
     if (r == -1) {
         LOG_DEBUG("Project '%s' not loaded because of errors while reading the config.", path.c_str());
@@ -158,62 +188,97 @@ int Project::load()
 
     loadPredefinedViews();
 
-    r = loadIssues();
+    ProjectCache cache;
+    const ProjectCache *validCache = 0;
+    r = cache.open(path + "/" PATH_CACHE);
+    cachedRefProject = cache.getRefProject();
+    if (r == 0) {
+        if (cache.getRefProject() != config.id) {
+            LOG_INFO("Project %s: cache outdated (refs/project)", path.c_str());
+        } else if (cache.hasLazyMessages() && !MessageCache::isEnabled()) {
+            LOG_INFO("Project %s: cache without messages", path.c_str());
+        } else validCache = &cache;
+    }
+
+    size_t nFromCache = 0;
+    r = loadIssues(validCache, nFromCache);
     if (r == -1) {
         LOG_ERROR("Project '%s' not loaded because of errors while reading the entries.", path.c_str());
         return r;
     }
 
-    loadTags();
-
-    LOG_INFO("Project %s loaded: %ld issues", path.c_str(), L(issues.size()));
+    bool tagsFromCache = loadTags(validCache);
 
     computeAssociations();
 
+    // the cache needs to be stored again if anything was not taken from it
+    modifiedSinceCache = !tagsFromCache || nFromCache != issues.size() || nFromCache != cache.getNumIssues();
+
+    LOG_INFO("Project %s loaded: %ld issues, %ld from cache (%.3fs)", path.c_str(), L(issues.size()),
+             L(nFromCache), getSeconds() - t0);
+
     return 0;
 }
 
 /** computeAssociations
   * For each issue, look if it has some F_ASSOCIATION properties
-  * and if so, then update the associations tables
+  * and if so, then update the associations tables.
+  * Then build the summaries of all the associations.
   */
 void Project::computeAssociations()
 {
+    associations.clear();
+    reverseAssociations.clear();
+
     std::map<std::string, Issue*>::iterator i;
     for (i = issues.begin(); i != issues.end(); i++) {
         Issue *currentIssue = i->second;
         std::list<PropertySpec>::const_iterator pspec;
-
         FOREACH(pspec, config.properties) {
-            if (pspec->type == F_ASSOCIATION) {
-                std::map<std::string, std::list<std::string> >::const_iterator p;
-                p = currentIssue->properties.find(pspec->name);
-                if (p != currentIssue->properties.end()) {
-                    updateAssociations(currentIssue, pspec->name, p->second);
-                }
+            if (pspec->type != F_ASSOCIATION) continue;
+            PropertiesCIt p = currentIssue->properties.find(pspec->name);
+            if (p == currentIssue->properties.end()) continue;
+            if (p->second.empty() || p->second.front() == "") continue;
+
+            // same as updateAssociations, the summaries being built once at the end
+            PropertyValuesIt otherIssue;
+            FOREACH(otherIssue, p->second) {
+                associations[currentIssue->id][pspec->name].insert(*otherIssue);
+                if (otherIssue->empty()) continue;
+                reverseAssociations[*otherIssue][pspec->name].insert(currentIssue->id);
             }
         }
     }
+
+    associationSummaries.clear();
+    reverseAssociationSummaries.clear();
+    std::map<IssueId, std::map<AssociationId, std::set<IssueId> > >::const_iterator a;
+    FOREACH(a, associations) updateAssociationSummaries(a->first, true);
+    FOREACH(a, reverseAssociations) updateAssociationSummaries(a->first, false);
 }
 
-int Project::loadIssues()
-{
-    std::string pathToIssues = getIssuesDir();
-    LOG_DEBUG("Loading issues: %s", pathToIssues.c_str());
+/** Batch of issues loaded by a worker thread
+  */
+struct IssueLoadingJob {
+    std::string pathToIssues;
+    std::string pathToObjects;
+    const ProjectCache *cache;
+    bool dropMessages;
+    std::vector<std::string> issueIds;
+    std::vector<Issue*> issues; // loaded issues (null if error)
+    size_t nFromCache;
+};
 
-    DIR *issuesDirHandle;
-    if ((issuesDirHandle = openDir(pathToIssues.c_str())) == NULL) {
-        LOG_ERROR("Cannot open directory '%s'", pathToIssues.c_str());
-        return -1;
-    }
+static void loadIssuesJob(void *arg)
+{
+    IssueLoadingJob *job = (IssueLoadingJob*)arg;
+    job->issues.resize(job->issueIds.size(), 0);
+    job->nFromCache = 0;
 
-    // walk through all issues
-    std::string pathToObjects = path + '/' + PATH_OBJECTS;
-    std::string issueId;
-    int localMaxId = 0;
-    while ((issueId = getNextFile(issuesDirHandle)) != "") {
+    for (size_t i = 0; i < job->issueIds.size(); i++) {
+        const std::string &issueId = job->issueIds[i];
         std::string latestEntryOfIssue;
-        std::string path = pathToIssues + '/' + issueId;
+        std::string path = job->pathToIssues + '/' + issueId;
         int r = loadFile(path, latestEntryOfIssue);
         if (r != 0) {
             LOG_ERROR("Cannot read file '%s': %s", path.c_str(), strerror(errno));
@@ -221,45 +286,133 @@ int Project::loadIssues()
         }
         trim(latestEntryOfIssue);
 
-        Issue *issue = Issue::load(pathToObjects, latestEntryOfIssue);
+        Issue *issue = 0;
+        if (job->cache) issue = job->cache->loadIssue(issueId, latestEntryOfIssue);
+        if (issue) {
+            job->nFromCache++;
+        } else {
+            issue = Issue::load(job->pathToObjects, latestEntryOfIssue);
+        }
         if (!issue) {
             LOG_ERROR("Cannot load issue %s", issueId.c_str());
             continue;
         }
-        issue->project = getName();
-
-        Entry *e = issue->latest; // take the latest entry
 
-        // update lastModified
-        updateLastModified(e);
-
-        // store the entries in the 'entries' table
-        while (e) {
-            int r = insertEntryInTable(e);
-            if (r != 0) {
-                // this should not happen
-                // maybe 2 issues pointing to the same first entry?
-                LOG_ERROR("Cannot load issue %s", issueId.c_str());
+        if (job->dropMessages) {
+            Entry *e = issue->first;
+            while (e) {
+                e->dropMessage();
+                e = e->getNext();
             }
-            e = e->getPrev();
         }
+        job->issues[i] = issue;
+    }
+}
+
+/** Load the issues of the project
+  *
+  * The chains of entries of the issues are loaded concurrently by
+  * batches (with at most Database::getIssueLoadWorkers() threads), and then
+  * merged into the tables of the project.
+  *
+  * @param cache
+  *     If not null, the issues whose ref is unchanged are taken from it.
+  *
+  * @param[out] nFromCache
+  *     Number of issues taken from the cache
+  */
+int Project::loadIssues(const ProjectCache *cache, size_t &nFromCache)
+{
+    std::string pathToIssues = getIssuesDir();
+    LOG_DEBUG("Loading issues: %s", pathToIssues.c_str());
 
-        // update the maximum id
-        int intId = atoi(issueId.c_str());
-        if (intId > 0 && intId > localMaxId) localMaxId = intId;
+    DIR *issuesDirHandle;
+    if ((issuesDirHandle = openDir(pathToIssues.c_str())) == NULL) {
+        LOG_ERROR("Cannot open directory '%s'", pathToIssues.c_str());
+        return -1;
+    }
 
-        // store the issue in memory
-        issue->id = issueId;
-        insertIssueInTable(issue);
+    // walk through all issues and dispatch them in batches
+    std::vector<IssueLoadingJob> jobs;
+    std::string issueId;
+    while ((issueId = getNextFile(issuesDirHandle)) != "") {
+        if (jobs.empty() || jobs.back().issueIds.size() >= LOADING_BATCH_SIZE) {
+            jobs.push_back(IssueLoadingJob());
+            jobs.back().pathToIssues = pathToIssues;
+            jobs.back().pathToObjects = path + '/' + PATH_OBJECTS;
+            jobs.back().cache = cache;
+            jobs.back().dropMessages = MessageCache::isEnabled();
+        }
+        jobs.back().issueIds.push_back(issueId);
     }
 
     closeDir(issuesDirHandle);
 
+    int nWorkers = Database::getIssueLoadWorkers();
+    if (nWorkers > (int)jobs.size()) nWorkers = jobs.size();
+
+    std::vector<IssueLoadingJob>::iterator job;
+    if (nWorkers <= 1) {
+        // not worth starting threads
+        FOREACH(job, jobs) loadIssuesJob(&(*job));
+    } else {
+        ThreadPool pool(nWorkers);
+        FOREACH(job, jobs) pool.submit(loadIssuesJob, &(*job));
+        pool.waitAll();
+    }
+
+    // merge the loaded issues
+    int localMaxId = 0;
+    nFromCache = 0;
+    FOREACH(job, jobs) {
+        for (size_t i = 0; i < job->issueIds.size(); i++) {
+            Issue *issue = job->issues[i];
+            if (!issue) continue;
+            mergeLoadedIssue(issue, job->issueIds[i], localMaxId);
+        }
+        nFromCache += job->nFromCache;
+    }
+
     updateMaxIssueId(localMaxId);
 
     return 0;
 }
 
+/** Insert a freshly loaded issue and its entries in the tables
+  *
+  * @param[in,out] localMaxId
+  */
+void Project::mergeLoadedIssue(Issue *issue, const std::string &issueId, int &localMaxId)
+{
+    issue->project = getName();
+
+    Entry *e = issue->latest; // take the latest entry
+
+    // update lastModified
+    updateLastModified(e);
+
+    // store the entries in the 'entries' table
+    while (e) {
+        int r = insertEntryInTable(e);
+        if (r != 0) {
+            // this should not happen
+            // maybe 2 issues pointing to the same first entry?
+            LOG_ERROR("Cannot load issue %s", issueId.c_str());
+        }
+        e = e->getPrev();
+    }
+    // the issue has been consolidated from the entries before their values were interned
+    internSelectValues(issue->properties);
+
+    // update the maximum id
+    int intId = atoi(issueId.c_str());
+    if (intId > 0 && intId > localMaxId) localMaxId = intId;
+
+    // store the issue in memory
+    issue->id = issueId;
+    insertIssueInTable(issue);
+}
+
 Issue *Project::getIssue(const std::string &id) const
 {
     std::map<std::string, Issue*>::const_iterator i;
@@ -268,38 +421,19 @@ Issue *Project::getIssue(const std::string &id) const
     else return i->second;
 }
 
-/** Consolidate the copy of the issue with the associations
+/** Attach the summaries of the associated issues to the copy of an issue
+  *
+  * The tables are shared with the project (see AssociationTable).
   */
 void Project::consolidateAssociations(IssueCopy &issue, bool forward) const
 {
-    std::map<IssueId, std::map<AssociationId, std::set<IssueId> > >::const_iterator ait;
-    std::map<AssociationId, std::set<IssueSummary> > *associationTable;
-    if (forward) {
-        // Forward Associations
-        ait = associations.find(issue.id);
-        if (ait == associations.end()) return;
-        associationTable = &issue.associations;
-    } else {
-        // reverse
-        ait = reverseAssociations.find(issue.id);
-        if (ait == reverseAssociations.end()) return;
-        associationTable = &issue.reverseAssociations;
-    }
+    const std::map<IssueId, AssociationTable> &summaries = forward ? associationSummaries :
+                                                                     reverseAssociationSummaries;
+    std::map<IssueId, AssociationTable>::const_iterator table = summaries.find(issue.id);
+    if (table == summaries.end()) return;
 
-    std::map<AssociationId, std::set<IssueId> >::const_iterator a;
-    FOREACH(a, ait->second) {
-        AssociationId associationName = a->first;
-        const std::set<IssueId> &otherIssues = a->second;
-        std::set<IssueId>::const_iterator otherIssue;
-        FOREACH(otherIssue, otherIssues) {
-            Issue *oi = getIssue(*otherIssue);
-            if (!oi) continue; // a bad issue id was fulfilled by a user
-            IssueSummary is;
-            is.id = oi->id;
-            is.summary = oi->getSummary();
-            (*associationTable)[associationName].insert(is);
-        }
-    }
+    if (forward) issue.associations = table->second;
+    else issue.reverseAssociations = table->second;
 }
 
 /** Return a given issue
@@ -357,9 +491,7 @@ int Project::loadConfig()
 
     trim(objectid);
 
-    std::string pathToProjectConfig = getObjectsDir() + "/" + Object::getSubpath(objectid);
-
-    r = ProjectConfig::load(pathToProjectConfig, config, objectid);
+    r = ProjectConfig::load(getObjectsDir(), config, objectid);
     return r;
 }
 
@@ -372,37 +504,56 @@ int Project::modifyConfig(std::list<std::list<std::string> > &tokens, const std:
     return modifyConfig(c, author);
 }
 
+/** Store and publish a new config
+  *
+  * The object of the new config is written without the locker, so that
+  * the readers of the config are blocked only for writing the ref and
+  * publishing the new config. If the config was modified meanwhile, then
+  * the new config is written again on top of it.
+  */
 int Project::modifyConfig(ProjectConfig newConfig, const std::string &author)
 {
     LOG_FUNC();
-    ScopeLocker scopeLocker(lockerForConfig, LOCK_READ_WRITE);
 
-    newConfig.ctime = time(0);
-    newConfig.parent = config.id;
-    newConfig.author = author;
+    while (1) {
+        std::string parentId;
+        {
+            ScopeLocker scopeLocker(lockerForConfig, LOCK_READ_ONLY);
+            parentId = config.id;
+        }
+
+        newConfig.ctime = time(0);
+        newConfig.parent = parentId;
+        newConfig.author = author;
 
-    // write to file
-    std::string data = newConfig.serialize();
+        // write to file
+        std::string data = newConfig.serialize();
 
-    // write into objects database
-    std::string newid;
-    int r = Object::write(getObjectsDir(), data, newid);
-    if (r < 0) {
-        LOG_ERROR("Cannot write new config of project: id=%s", newid.c_str());
-        return -1;
-    }
-    // write ref
-    std::string newProjectRef = path + "/" PATH_PROJECT_CONFIG;
-    r = writeToFile(newProjectRef, newid);
-    if (r != 0) {
-        LOG_ERROR("Cannot write new config of project: %s", newProjectRef.c_str());
-        return -1;
-    }
+        // write into objects database
+        std::string newid;
+        int r = Object::write(getObjectsDir(), data, newid);
+        if (r < 0) {
+            LOG_ERROR("Cannot write new config of project: id=%s", newid.c_str());
+            return -1;
+        }
 
-    config = newConfig;
-    config.id = newid;
+        ScopeLocker scopeLocker(lockerForConfig, LOCK_READ_WRITE);
+        if (config.id != parentId) continue; // modified meanwhile
 
-    return 0;
+        // write ref
+        std::string newProjectRef = path + "/" PATH_PROJECT_CONFIG;
+        r = writeToFile(newProjectRef, newid);
+        if (r != 0) {
+            LOG_ERROR("Cannot write new config of project: %s", newProjectRef.c_str());
+            return -1;
+        }
+
+        config = newConfig;
+        config.id = newid;
+        queryCache.invalidate();
+
+        return 0;
+    }
 }
 
 /** get a predefined view
@@ -648,16 +799,12 @@ int Project::toggleTag(const std::string &entryId, const std::string &tagname, c
     tag.id = getSha1(tagContents);
 
     // store the tag object to persistent storage
-    std::string tagSubdir = getObjectsDir() + "/" + Object::getSubdir(tag.id);
-    mkdir(tagSubdir);
-    std::string objectPath = getObjectsDir() + "/" + Object::getSubpath(tag.id);
-    if (fileExists(objectPath)) {
-        LOG_ERROR("Cannot set tag, file exists: %s", objectPath.c_str());
+    int r = Object::writeToId(getObjectsDir(), tagContents.data(), tagContents.size(), tag.id);
+    if (r == 1) {
+        LOG_ERROR("Cannot set tag, object exists: %s", tag.id.c_str());
         return -1;
-    }
-    int r = writeToFile(objectPath, tagContents);
-    if (r != 0) {
-        LOG_ERROR("Cannot set tag '%s': %s", objectPath.c_str(), STRERROR(errno));
+    } else if (r < 0) {
+        LOG_ERROR("Cannot set tag '%s'", tag.id.c_str());
         return -1;
     }
 
@@ -670,6 +817,7 @@ int Project::toggleTag(const std::string &entryId, const std::string &tagname, c
 
     // invert the tag in RAM
     e->issue->toggleTag(e->id, tagname);
+    setModified();
 
     return 0;
 }
@@ -697,187 +845,699 @@ void Project::updateMaxIssueId(uint32_t i)
 }
 
 /** Reload a whole project
+  *
+  * The project is loaded aside, without the lockers, then published by
+  * swapping the contents under the write locks (a constant time operation),
+  * so that the readers are not blocked by the loading.
+  *
+  * If the project is modified during the loading, then the loaded contents
+  * are outdated: the loading is done again, and after RELOAD_ATTEMPTS
+  * attempts the project is loaded under the write locks.
+  *
+  * The former contents are retired (see Epoch), as some readers may still
+  * use pointers to the entries.
   */
 int Project::reload()
 {
-    ScopeLocker L1(locker, LOCK_READ_WRITE);
-    ScopeLocker L2(lockerForConfig, LOCK_READ_WRITE);
-
     LOG_INFO("Reloading project '%s'...", getName().c_str());
 
-    // delete all issues
-    std::map<std::string, Issue*>::iterator issue;
-    FOREACH(issue, issues) {
-        delete issue->second;
-    }
-    issues.clear();
+    for (int attempt = 1; ; attempt++) {
+        bool lastAttempt = (attempt >= RELOAD_ATTEMPTS);
+        ScopeLocker L1(locker, lastAttempt ? LOCK_READ_WRITE : LOCK_READ_ONLY);
+        ScopeLocker L2(lockerForConfig, lastAttempt ? LOCK_READ_WRITE : LOCK_READ_ONLY);
+        uint64_t loadedGeneration = generation;
+        std::string loadedConfigId = config.id;
+        if (!lastAttempt) {
+            L2.unlock();
+            L1.unlock();
+        }
 
-    // delete all entries
-    std::map<std::string, Entry*>::iterator entry;
-    FOREACH(entry, entries) {
-        delete entry->second;
-    }
-    entries.clear();
+        // the records appended to the journal before must be on disk
+        journal.flush();
 
-    // delete all associations
-    associations.clear();
-    reverseAssociations.clear();
+        Project *loaded = new Project;
+        loaded->name = name;
+        loaded->path = path;
+        loaded->lastModified = -1;
+        int r = loaded->loadContents();
+        if (r != 0) {
+            destroyContents(loaded);
+            return r;
+        }
 
-    // load the project again
-    int r = load();
-    return r;
+        if (!lastAttempt) {
+            ScopeLocker W1(locker, LOCK_READ_WRITE);
+            ScopeLocker W2(lockerForConfig, LOCK_READ_WRITE);
+            if (generation != loadedGeneration || config.id != loadedConfigId) {
+                LOG_INFO("Project '%s' modified while reloading (attempt %d)", getName().c_str(), attempt);
+                W2.unlock();
+                W1.unlock();
+                destroyContents(loaded);
+                continue;
+            }
+            swapContents(*loaded);
+        } else {
+            swapContents(*loaded);
+            L2.unlock();
+            L1.unlock();
+        }
+
+        Epoch::retire(destroyContents, loaded);
+
+        // the views may have been modified during the loading
+        reloadPredefinedViews();
+        return 0;
+    }
 }
 
-/** Get the list of all objects of the project
+/** Exchange the contents of 2 projects (issues, entries, config, tags)
   *
+  * Must be called with the write lockers held.
   */
-void Project::getObjects(std::list<std::string> &objects) const
+void Project::swapContents(Project &other)
 {
-    ScopeLocker L1(locker, LOCK_READ_ONLY);
-
-    ObjectIteraror oit(getObjectsDir());
-    std::string objectId;
-    while ( (objectId = Object::getNextObject(oit)) != "") {
-        objects.push_back(objectId);
-    }
+    std::swap(config, other.config);
+    entries.swap(other.entries);
+    issues.swap(other.issues);
+    associations.swap(other.associations);
+    reverseAssociations.swap(other.reverseAssociations);
+    associationSummaries.swap(other.associationSummaries);
+    reverseAssociationSummaries.swap(other.reverseAssociationSummaries);
+    fullTextIndex.swap(other.fullTextIndex);
+    filterIndex.swap(other.filterIndex);
+    snapshotIndex.swap(other.snapshotIndex);
+    entryIndex.swap(other.entryIndex);
+    latestTagId.swap(other.latestTagId);
+    cachedRefProject.swap(other.cachedRefProject);
+    std::swap(lastModified, other.lastModified);
+    std::swap(modifiedSinceCache, other.modifiedSinceCache);
+    // the ids of issues already allocated are kept
+    if (other.maxIssueId > maxIssueId) maxIssueId = other.maxIssueId;
+    generation++;
 }
 
-
-/** Insert a file in the directory of attached files
-  *
-  * @param basename
-  *     The file must be already present in the tmp directory of the project.
-  *
-  * @return
-  *     0 : ok
-  *     -1: file already exists
-  *     -2: file name does not match hash of the file contents
-  *     -3: internal error: cannot rename
+/** Delete a project and its issues and entries
   */
-int Project::addFile(const std::string &objectId)
+void Project::destroyContents(void *project)
 {
-    ScopeLocker L1(locker, LOCK_READ_WRITE);
+    Project *p = (Project*)project;
 
-    std::string srcPath = getTmpDir() + "/" + objectId;
-    std::string destPath = getObjectsDir() + "/" + Object::getSubpath(objectId);
+    std::map<std::string, Issue*>::iterator issue;
+    FOREACH(issue, p->issues) delete issue->second;
 
-    // TODO use Object::insertFile(getObjectsDir(), srcPath, id)
+    std::map<std::string, Entry*>::iterator entry;
+    FOREACH(entry, p->entries) delete entry->second;
 
-    // check that the hash of the file contents matches the file name (the 40 first characters)
-    std::string sha1 = getSha1OfFile(srcPath);
-    // check the SHA1
-    if (sha1 != objectId) {
-        LOG_ERROR("SHA1 does not match: %s (%s)", objectId.c_str(), sha1.c_str());
-        // remove tmp file
-        return -1;
-    }
+    delete p;
+}
 
-    if (fileExists(destPath)) {
-        int r = cmpFiles(srcPath, destPath);
-        if (r != 0) {
-            LOG_ERROR("ID collision, files differ(%d): %s", r, objectId.c_str());
-            return -2;
-        } else {
-            // ok the are the same
-            return 0;
+/** Apply the ref of an issue modified out-of-band (see RefWatcher)
+  *
+  * The new entries are loaded without the lock, from the ref back to the
+  * first entry already known. Then:
+  * - if this known entry is the latest of the issue, then the new entries
+  *   are appended to the issue,
+  * - else (new issue, or history of the issue rewritten), the issue is replaced.
+  *   In this case, the whole issue is loaded before taking the write lock,
+  *   and the issue is left as is if it cannot be loaded.
+  *
+  * A ref pointing to a known entry is considered already applied
+  * (typically, the ref materialized by the journal after an entry was added).
+  * A removed ref removes the issue.
+  *
+  * @param rollback
+  *     Restore the issue to its ref, even if it points to a known entry,
+  *     after a failed commit (see Journal::commit). The entries added on
+  *     top of the ref are removed, and the journal resumes the issue.
+  *
+  * @return
+  *     0 nothing to do
+  *     1 the issue has been updated, created or removed
+  *    -1 error
+  */
+int Project::reloadIssue(const std::string &issueId, bool rollback)
+{
+    std::string refPath = getIssuesDir() + "/" + issueId;
+    std::string ref;
+    int r = loadFile(refPath, ref);
+    if (r != 0) {
+        if (fileExists(refPath)) {
+            LOG_ERROR("Cannot read file '%s': %s", refPath.c_str(), strerror(errno));
+            return -1;
         }
-    }
+        ScopeLocker scopeLocker(locker, LOCK_READ_WRITE);
+        ScopeLocker scopeLockerConfig(lockerForConfig, LOCK_READ_ONLY);
+        if (rollback) journal.resume(issueId);
+        Issue *i = getIssue(issueId);
+        if (!i) return 0;
+        LOG_INFO("Project %s: issue %s removed", getName().c_str(), issueId.c_str());
+        removeIssueFromTables(i);
+        updateAssociationSummariesAround(issueId);
+        return 1;
+    }
+    trim(ref);
+
+    // The entries are loaded from the disk without the write lock. If the issue
+    // has been modified in the meantime, then they are loaded again.
+    while (1) {
+        // load the new entries (oldest first)
+        std::list<Entry*> newEntries;
+        std::list<Entry*>::iterator e;
+        std::string knownId = ref;
+        while (knownId != K_PARENT_NULL) {
+            {
+                ScopeLocker scopeLocker(locker, LOCK_READ_ONLY);
+                if (getEntry(knownId)) break;
+            }
+            Entry *newEntry = Entry::loadEntry(getObjectsDir(), knownId);
+            if (!newEntry) {
+                LOG_ERROR("Cannot load entry '%s' of issue %s", knownId.c_str(), issueId.c_str());
+                FOREACH(e, newEntries) delete *e;
+                return -1;
+            }
+            if (MessageCache::isEnabled()) newEntry->dropMessage();
+            newEntries.push_front(newEntry);
+            knownId = newEntry->parent;
+        }
+        if (newEntries.empty() && !rollback) return 0;
 
-    // rename to final location
-    std::string subdir = getObjectsDir() + "/" + Object::getSubdir(objectId);
-    mkdir(subdir);
-    int r = rename(srcPath.c_str(), destPath.c_str());
-    if (r != 0) {
-        LOG_ERROR("cannot rename %s -> %s: %s", srcPath.c_str(), destPath.c_str(), strerror(errno));
-        // remove tmp file
-        return -3;
-    }
+        std::string latestId; // latest entry of the issue, empty if no such issue
+        {
+            ScopeLocker scopeLocker(locker, LOCK_READ_ONLY);
+            Issue *i = getIssue(issueId);
+            if (i && i->latest) latestId = i->latest->id;
+        }
 
-    return 0;
-}
+        // the chain starts from an older entry (history rewritten): load the whole issue
+        Issue *loaded = 0;
+        if (knownId != K_PARENT_NULL && latestId != knownId) {
+            FOREACH(e, newEntries) delete *e;
+            newEntries.clear();
+            loaded = Issue::load(getObjectsDir(), ref);
+            if (!loaded) {
+                LOG_ERROR("Cannot load issue %s", issueId.c_str());
+                return -1; // the issue is left as is
+            }
+            if (MessageCache::isEnabled()) {
+                for (Entry *x = loaded->first; x; x = x->getNext()) x->dropMessage();
+            }
+        }
 
+        ScopeLocker scopeLocker(locker, LOCK_READ_WRITE);
+        ScopeLocker scopeLockerConfig(lockerForConfig, LOCK_READ_ONLY);
 
-size_t Project::getNumIssues() const
-{
-    ScopeLocker scopeLocker(locker, LOCK_READ_ONLY);
-    return issues.size();
-}
+        Issue *i = getIssue(issueId);
+        if ((i && i->latest ? i->latest->id : std::string()) != latestId) {
+            // modified in the meantime
+            if (loaded) destroyIssue(loaded);
+            FOREACH(e, newEntries) delete *e;
+            continue;
+        }
 
-long Project::getLastModified() const
-{
-    ScopeLocker scopeLocker(locker, LOCK_READ_ONLY);
-    return lastModified;
-}
+        if (rollback) journal.resume(issueId);
+        if (newEntries.empty() && !loaded) return 0;
+
+        if (i && latestId == knownId) {
+            // fast-forward
+            FOREACH(e, newEntries) {
+                insertEntryInTable(*e);
+                i->addEntry(*e);
+                i->consolidateAmendment(*e);
+                fullTextIndex.update(i, *e);
+                filterIndex.update(i);
+                snapshotIndex.update(i);
+                updateLastModified(*e);
+            }
+            LOG_INFO("Project %s: issue %s: %ld new entries", getName().c_str(), issueId.c_str(),
+                     L(newEntries.size()));
+            updateIssueAssociations(i);
+            updateAssociationSummariesAround(i->id);
+            return 1;
+        }
 
+        std::map<std::string, std::set<std::string> > tags;
+        if (i) {
+            tags = i->tags;
+            removeIssueFromTables(i);
+        }
 
-void Project::loadPredefinedViews()
-{
-    LOG_FUNC();
+        if (loaded) {
+            i = loaded;
+        } else {
+            i = new Issue();
+            FOREACH(e, newEntries) i->addEntryInTable(*e);
+            i->consolidate();
+        }
 
-    std::string viewsPath = path + '/' + PATH_VIEWS;
+        int localMaxId = 0;
+        mergeLoadedIssue(i, issueId, localMaxId);
+        updateMaxIssueId(localMaxId);
 
-    std::string id;
-    int n = loadFile(viewsPath.c_str(), id);
-    if (n == 0) {
-        trim(id); // remove possible \n
-        std::string path = getObjectsDir() + "/" + Object::getSubpath(id);
-        PredefinedView::loadViews(path, predefinedViews);
-    } // else error of empty file
+        // keep the tags of the remaining entries
+        std::map<std::string, std::set<std::string> >::const_iterator tagged;
+        FOREACH(tagged, tags) {
+            if (getEntry(tagged->first)) i->tags.insert(*tagged);
+        }
+        LOG_INFO("Project %s: issue %s loaded", getName().c_str(), issueId.c_str());
 
-    LOG_DEBUG("predefined views loaded: %ld", L(predefinedViews.size()));
+        updateIssueAssociations(i);
+        updateAssociationSummariesAround(i->id);
+        return 1;
+    }
 }
 
-/** Load tags, strating from the latest, ie: <p>/refs/tags
+/** Apply the refs/tags modified out-of-band (see RefWatcher)
   *
+  * The new tags are loaded without the lock, back to the latest known tag.
+  * If they do not chain to it, then all the tags are replayed.
+  *
+  * @return
+  *     0 nothing to do
+  *     1 the tags have been updated
+  *    -1 error
   */
-void Project::loadTags()
+int Project::reloadTags()
 {
     std::string tagRef = getPath() + "/" + PATH_TAGS;
     std::string latestTag;
     int r = loadFile(tagRef, latestTag);
     if (r != 0) {
-        // No tag ref. No tag in this project.
         LOG_DIAG("Cannot load '%s': %s", tagRef.c_str(), STRERROR(errno));
-        return;
+        return 0;
     }
-
     trim(latestTag);
-    latestTagId = latestTag;
 
-    // load all the tags, chained from the latest
+    std::string knownTag;
+    {
+        ScopeLocker scopeLocker(locker, LOCK_READ_ONLY);
+        knownTag = latestTagId;
+    }
+    if (latestTag == knownTag) return 0;
 
-    int n = 0;
+    // load the new tags (latest first)
+    std::list<Tag*> newTags;
+    std::list<Tag*>::iterator tag;
     std::string currentTag = latestTag;
-    while (currentTag != K_PARENT_NULL) {
-        std::string path = getObjectsDir() + "/" + Object::getSubpath(currentTag);
-        Tag *tag = Tag::load(path, currentTag);
-        if (!tag) break;
-
-        Entry *e = getEntry(tag->entryId);
-        if (!e) {
-            LOG_ERROR("Tag to unknown entry: %s -> %s", path.c_str(), tag->entryId.c_str());
-        } else if (!e->issue) {
-            LOG_ERROR("Tagged entry has unknwon issue: %s", e->id.c_str());
-        } else {
-            // Toggle the tag of the entry
-            e->issue->toggleTag(e->id, tag->tagName);
-            n++;
+    while (!currentTag.empty() && currentTag != K_PARENT_NULL && currentTag != knownTag) {
+        Tag *t = Tag::load(getObjectsDir(), currentTag);
+        if (!t) {
+            LOG_ERROR("Cannot load tag '%s'", currentTag.c_str());
+            FOREACH(tag, newTags) delete *tag;
+            return -1;
         }
+        newTags.push_back(t);
+        currentTag = t->parent;
+    }
 
-        currentTag = tag->parent;
-        delete tag;
+    ScopeLocker scopeLocker(locker, LOCK_READ_WRITE);
+
+    if (currentTag == knownTag && latestTagId == knownTag) {
+        FOREACH(tag, newTags) {
+            Entry *e = getEntry((*tag)->entryId);
+            if (!e || !e->issue) {
+                LOG_ERROR("Tag to unknown entry: %s", (*tag)->entryId.c_str());
+                continue;
+            }
+            e->issue->toggleTag(e->id, (*tag)->tagName);
+        }
+        latestTagId = latestTag;
+    } else {
+        // the tags do not chain to the known ones: replay all of them
+        std::map<std::string, Issue*>::iterator i;
+        FOREACH(i, issues) i->second->tags.clear();
+        loadTags(0);
     }
-    LOG_INFO("Project %s: %d tags", getName().c_str(), n);
-}
+    FOREACH(tag, newTags) delete *tag;
 
+    setModified();
+    return 1;
+}
 
-/** Parse the sorting specification
-  * Input syntax is:
-  *    aa+bb-cc
-  * (aa, bb, cc are property names)
-  *
-  * Ouput will be like:
-  *    [ (true, 'aa'), (true, 'bb'), (false, 'cc') ]
+/** Apply the refs/project modified out-of-band (see RefWatcher)
+  *
+  * @return
+  *     0 nothing to do
+  *     1 the config has been updated
+  *    -1 error
+  */
+int Project::reloadConfig()
+{
+    std::string projectRef = path + "/" PATH_PROJECT_CONFIG;
+    std::string objectid;
+    int r = loadFile(projectRef, objectid);
+    if (r != 0) {
+        LOG_ERROR("Cannot load project config '%s': %s", projectRef.c_str(), strerror(errno));
+        return -1;
+    }
+    trim(objectid);
+
+    std::string knownId;
+    {
+        ScopeLocker scopeLocker(lockerForConfig, LOCK_READ_ONLY);
+        knownId = config.id;
+    }
+    if (objectid == knownId) return 0;
+
+    ProjectConfig newConfig;
+    r = ProjectConfig::load(getObjectsDir(), newConfig, objectid);
+    if (r != 0) return -1;
+
+    ScopeLocker L1(locker, LOCK_READ_WRITE);
+    ScopeLocker L2(lockerForConfig, LOCK_READ_WRITE);
+
+    // a config modified meanwhile is more recent
+    if (config.id != knownId) return 0;
+    config = newConfig;
+    queryCache.invalidate();
+
+    // the association properties may have changed
+    computeAssociations();
+
+    LOG_INFO("Project %s: config reloaded", getName().c_str());
+    return 1;
+}
+
+/** Apply the refs/views modified out-of-band (see RefWatcher)
+  *
+  * @return
+  *     1 the views have been reloaded
+  */
+int Project::reloadPredefinedViews()
+{
+    ScopeLocker scopeLocker(lockerForViews, LOCK_READ_WRITE);
+    predefinedViews.clear();
+    loadPredefinedViews();
+    return 1;
+}
+
+/** Delete an issue and its entries (see removeIssueFromTables)
+  */
+void Project::destroyIssue(void *issue)
+{
+    Issue *i = (Issue*)issue;
+    Entry *e = i->first;
+    while (e) {
+        Entry *tobeDeleted = e;
+        e = e->getNext();
+        delete tobeDeleted;
+    }
+    delete i;
+}
+
+/** Remove an issue and its entries from the tables
+  *
+  * The copies of the issue given to concurrent requests share its entries,
+  * so the issue and its entries are retired (see Epoch), not deleted.
+  *
+  * Must be called under the write lock.
+  */
+void Project::removeIssueFromTables(Issue *i)
+{
+    // remove its associations
+    std::list<PropertySpec>::const_iterator pspec;
+    FOREACH(pspec, config.properties) {
+        if (pspec->type == F_ASSOCIATION) updateAssociations(i, pspec->name, std::list<std::string>());
+    }
+
+    Entry *e;
+    for (e = i->first; e; e = e->getNext()) {
+        entries.erase(e->id);
+        entryIndex.removeEntry(e);
+    }
+    issues.erase(i->id);
+    fullTextIndex.removeIssue(i);
+    filterIndex.removeIssue(i);
+    snapshotIndex.removeIssue(i);
+    Epoch::retire(destroyIssue, i);
+    setModified();
+}
+
+/** Update the associations tables with the association properties of an issue
+  *
+  * Must be called under the write lock.
+  */
+void Project::updateIssueAssociations(const Issue *i)
+{
+    std::list<PropertySpec>::const_iterator pspec;
+    FOREACH(pspec, config.properties) {
+        if (pspec->type != F_ASSOCIATION) continue;
+        PropertiesCIt p = i->properties.find(pspec->name);
+        if (p != i->properties.end()) updateAssociations(i, pspec->name, p->second);
+        else updateAssociations(i, pspec->name, std::list<std::string>());
+    }
+}
+
+/** Store the binary image of the project (see ProjectCache)
+  *
+  * Nothing is done if the project was not modified since the
+  * cache was loaded or stored.
+  *
+  * The image is serialized under the read lock, and written without
+  * any lock, so that the writers of the project are not blocked by the
+  * disk. If the project has been modified in the meantime, it stays
+  * modified since the cache (stored again at the next call).
+  *
+  * @return
+  *     0 success or nothing to do
+  *    -1 error
+  */
+int Project::storeCache()
+{
+    std::string cachePath = path + "/" PATH_CACHE;
+    std::string image;
+    uint64_t serializedGeneration;
+    std::string serializedRefProject;
+    double t0 = getSeconds();
+    {
+        ScopeLocker L1(locker, LOCK_READ_ONLY);
+        ScopeLocker L2(lockerForConfig, LOCK_READ_ONLY);
+
+        if (!modifiedSinceCache && cachedRefProject == config.id) return 0;
+
+        image = ProjectCache::serialize(config.id, latestTagId, issues, MessageCache::isEnabled());
+        serializedGeneration = generation;
+        serializedRefProject = config.id;
+    }
+
+    int r = writeToFile(cachePath, image);
+    if (r != 0) {
+        LOG_ERROR("Cannot store cache of project %s", getName().c_str());
+        return -1;
+    }
+
+    ScopeLocker L1(locker, LOCK_READ_WRITE);
+    ScopeLocker L2(lockerForConfig, LOCK_READ_ONLY);
+    if (generation == serializedGeneration && config.id == serializedRefProject) {
+        modifiedSinceCache = false;
+        cachedRefProject = serializedRefProject;
+    }
+
+    LOG_INFO("Project %s: cache stored (%ld bytes, %.3fs)", getName().c_str(), L(image.size()),
+             getSeconds() - t0);
+    return 0;
+}
+
+/** Estimate the memory used by the issues and entries of the project
+  */
+ProjectMemoryUsage Project::getMemoryUsage() const
+{
+    ScopeLocker scopeLocker(locker, LOCK_READ_ONLY);
+
+    ProjectMemoryUsage usage;
+    usage.nIssues = issues.size();
+    std::map<std::string, Entry*>::const_iterator e;
+    FOREACH(e, entries) {
+        const Entry *entry = e->second;
+        usage.nEntries++;
+        usage.entriesSize += entry->getResidentSize();
+        if (entry->isMessageInObject()) {
+            usage.nLazyMessages++;
+        } else {
+            PropertiesCIt m = entry->properties.find(K_MESSAGE);
+            if (m != entry->properties.end()) {
+                usage.nResidentMessages++;
+                if (!m->second.empty()) usage.residentMessagesSize += m->second.front().size();
+            }
+        }
+    }
+    return usage;
+}
+
+ProjectLockStats Project::getLockStats() const
+{
+    ScopeLocker scopeLocker(locker, LOCK_READ_ONLY);
+    return lockStats;
+}
+
+/** Account the hold time of the write lock, taken at 'lockTime'
+  *
+  * Must be called under the write lock.
+  */
+void Project::updateLockStats(double lockTime)
+{
+    double hold = getSeconds() - lockTime;
+    lockStats.nWrites++;
+    lockStats.totalHold += hold;
+    if (hold > lockStats.maxHold) lockStats.maxHold = hold;
+}
+
+/** Get the list of all objects of the project
+  *
+  */
+void Project::getObjects(std::list<std::string> &objects) const
+{
+    ScopeLocker L1(locker, LOCK_READ_ONLY);
+
+    Object::getObjects(getObjectsDir(), objects);
+}
+
+
+/** Insert a file in the directory of attached files
+  *
+  * The file is stored through Object::writeToId, so that it is compressed
+  * as configured (and escaped if its contents look like a header). The
+  * objects are immutable, so this does not need the lock of the project.
+  *
+  * @param basename
+  *     The file must be already present in the tmp directory of the project.
+  *     It is removed once stored.
+  *
+  * @return
+  *     0 : ok (possibly already stored with the same contents)
+  *     -1: file name does not match hash of the file contents
+  *     -2: an object with the same id but different contents exists
+  *     -3: internal error: cannot store
+  */
+int Project::addFile(const std::string &objectId)
+{
+    std::string srcPath = getTmpDir() + "/" + objectId;
+
+    std::string data;
+    int r = loadFile(srcPath, data);
+    if (r != 0) {
+        LOG_ERROR("Cannot load file '%s': %s", srcPath.c_str(), strerror(errno));
+        return -3;
+    }
+
+    // check that the hash of the file contents matches the file name
+    std::string sha1 = getSha1(data);
+    if (sha1 != objectId) {
+        LOG_ERROR("SHA1 does not match: %s (%s)", objectId.c_str(), sha1.c_str());
+        return -1;
+    }
+
+    r = Object::writeToId(getObjectsDir(), data.data(), data.size(), objectId);
+    if (r == -2) {
+        LOG_ERROR("ID collision, files differ: %s", objectId.c_str());
+        return -2;
+    }
+    if (r < 0) return -3;
+
+    unlink(srcPath.c_str());
+    return 0;
+}
+
+
+size_t Project::getNumIssues() const
+{
+    ScopeLocker scopeLocker(locker, LOCK_READ_ONLY);
+    return issues.size();
+}
+
+long Project::getLastModified() const
+{
+    ScopeLocker scopeLocker(locker, LOCK_READ_ONLY);
+    return lastModified;
+}
+
+
+void Project::loadPredefinedViews()
+{
+    LOG_FUNC();
+
+    std::string viewsPath = path + '/' + PATH_VIEWS;
+
+    std::string id;
+    int n = loadFile(viewsPath.c_str(), id);
+    if (n == 0) {
+        trim(id); // remove possible \n
+        PredefinedView::loadViews(getObjectsDir(), id, predefinedViews);
+    } // else error of empty file
+
+    LOG_DEBUG("predefined views loaded: %ld", L(predefinedViews.size()));
+}
+
+/** Load tags, strating from the latest, ie: <p>/refs/tags
+  *
+  * If the cache was written with the current refs/tags, then the tags
+  * are taken from it. Otherwise all the tags are replayed.
+  *
+  * @return
+  *     true if the tags were taken from the cache
+  */
+bool Project::loadTags(const ProjectCache *cache)
+{
+    std::string tagRef = getPath() + "/" + PATH_TAGS;
+    std::string latestTag;
+    int r = loadFile(tagRef, latestTag);
+    if (r != 0) {
+        // No tag ref. No tag in this project.
+        LOG_DIAG("Cannot load '%s': %s", tagRef.c_str(), STRERROR(errno));
+        return (cache && cache->getRefTags().empty());
+    }
+
+    trim(latestTag);
+    latestTagId = latestTag;
+
+    int n = 0;
+    if (cache && cache->getRefTags() == latestTag) {
+        std::map<std::string, std::set<std::string> >::const_iterator tagged;
+        FOREACH(tagged, cache->getTags()) {
+            Entry *e = getEntry(tagged->first);
+            if (!e || !e->issue) {
+                LOG_ERROR("Tag to unknown entry in cache: %s", tagged->first.c_str());
+                continue;
+            }
+            e->issue->tags[tagged->first] = tagged->second;
+            n += tagged->second.size();
+        }
+        LOG_INFO("Project %s: %d tags (from cache)", getName().c_str(), n);
+        return true;
+    }
+
+    // load all the tags, chained from the latest
+
+    std::string currentTag = latestTag;
+    while (currentTag != K_PARENT_NULL) {
+        Tag *tag = Tag::load(getObjectsDir(), currentTag);
+        if (!tag) break;
+
+        Entry *e = getEntry(tag->entryId);
+        if (!e) {
+            LOG_ERROR("Tag to unknown entry: %s -> %s", currentTag.c_str(), tag->entryId.c_str());
+        } else if (!e->issue) {
+            LOG_ERROR("Tagged entry has unknwon issue: %s", e->id.c_str());
+        } else {
+            // Toggle the tag of the entry
+            e->issue->toggleTag(e->id, tag->tagName);
+            n++;
+        }
+
+        currentTag = tag->parent;
+        delete tag;
+    }
+    LOG_INFO("Project %s: %d tags", getName().c_str(), n);
+    return false;
+}
+
+
+/** Parse the sorting specification
+  * Input syntax is:
+  *    aa+bb-cc
+  * (aa, bb, cc are property names)
+  *
+  * Ouput will be like:
+  *    [ (true, 'aa'), (true, 'bb'), (false, 'cc') ]
   *
   */
 std::list<std::pair<bool, std::string> > parseSortingSpec(const char *sortingSpec)
@@ -909,25 +1569,70 @@ std::list<std::pair<bool, std::string> > parseSortingSpec(const char *sortingSpe
 }
 
 
-void Project::searchEntries(const char *sortingSpec, std::vector<Entry> &entries, int limit) const
+/** Get the entries of the project
+  *
+  *   sortingSpec: see search (id, ctime, author or the properties of the entries)
+  *   limit: maximum number of entries (-1 for no limit)
+  *   cursor: id of an entry (optional): only the entries after it, in the order of the
+  *           sort, are returned (for paging through the entries)
+  *
+  * The entries sorted only by ctime ("ctime" or "-ctime") are read from the index
+  * of the entries (see EntryIndex), and only those returned are copied.
+  *
+  * @return
+  *     0 on success, -1 if the cursor is not an entry of the project
+  */
+int Project::searchEntries(const char *sortingSpec, std::vector<Entry> &result, int limit,
+                           const std::string &cursor) const
 {
     ScopeLocker scopeLocker(locker, LOCK_READ_ONLY);
+
+    const Entry *cursorEntry = 0;
+    if (!cursor.empty()) {
+        cursorEntry = getEntry(cursor);
+        if (!cursorEntry) return -1;
+    }
+
+    std::list<std::pair<bool, std::string> > sSpec;
+    if (sortingSpec) sSpec = parseSortingSpec(sortingSpec);
+
+    if (sSpec.size() == 1 && sSpec.front().second == "ctime") {
+        std::vector<const Entry*> page;
+        entryIndex.getEntries(entries, sSpec.front().first, cursorEntry, limit, page);
+        result.reserve(result.size() + page.size());
+        std::vector<const Entry*>::const_iterator e;
+        FOREACH(e, page) result.push_back(**e);
+        return 0;
+    }
+
+    std::vector<Entry> all;
     std::map<std::string, Issue*>::const_iterator i;
     FOREACH(i, issues) {
         Entry *e = i->second->first;
         while (e) {
-            entries.push_back(*e);
+            all.push_back(*e);
             e = e->getNext();
         }
     }
 
-    if (sortingSpec) {
-        std::list<std::pair<bool, std::string> > sSpec = parseSortingSpec(sortingSpec);
-        Entry::sort(entries, sSpec);
+    Entry::sort(all, sSpec);
+
+    std::vector<Entry>::iterator begin = all.begin();
+    if (cursorEntry) {
+        while (begin != all.end() && begin->id != cursor) begin++;
+        if (begin != all.end()) begin++; // start after the cursor
     }
 
     // limit the number of items
-    if (limit >= 0 && (size_t)limit < entries.size()) entries.erase(entries.begin()+limit, entries.end());
+    std::vector<Entry>::iterator end = all.end();
+    if (limit >= 0 && (size_t)limit < (size_t)(end - begin)) end = begin + limit;
+    result.insert(result.end(), begin, end);
+    return 0;
+}
+
+static bool lessIssueId(const Issue *a, const Issue *b)
+{
+    return a->id < b->id;
 }
 
 /** search
@@ -937,6 +1642,14 @@ void Project::searchEntries(const char *sortingSpec, std::vector<Entry> &entries
   *   filterOut: list of propName:value
   *   sortingSpec: aa+bb-cc (+ for ascending, - for descending order)
   *                sort issues by aa ascending, then by bb ascending, then by cc descending
+  *   offset, limit: page of the matching issues to be returned (limit -1 for no limit)
+  *                Only the issues of this page are sorted (partial sort) and copied.
+  *   total: (out) number of matching issues, including those not returned (optional)
+  *   withAssociations: attach the summaries of the associated issues to the returned
+  *                issues (only needed for rendering their full contents)
+  *
+  * The matching issues of the latest queries are cached (see QueryCache), until the
+  * issues, entries, tags or config are modified.
   *
   * @return
   *    The list of matching issues.
@@ -957,24 +1670,393 @@ void Project::search(const char *fulltextSearch,
                      const std::map<std::string, std::list<std::string> > &filterIn,
                      const std::map<std::string, std::list<std::string> > &filterOut,
                      const char *sortingSpec,
-                     std::vector<IssueCopy> &returnedIssues) const
+                     std::vector<IssueCopy> &returnedIssues,
+                     size_t offset, int limit, size_t *total, bool withAssociations) const
 {
     ScopeLocker scopeLocker(locker, LOCK_READ_ONLY);
+    searchUnlocked(fulltextSearch, filterIn, filterOut, sortingSpec, returnedIssues, offset, limit, total,
+                   withAssociations);
+}
 
+/** Search, see search()
+  *
+  * Must be called under the read lock.
+  */
+void Project::searchUnlocked(const char *fulltextSearch,
+                             const std::map<std::string, std::list<std::string> > &filterIn,
+                             const std::map<std::string, std::list<std::string> > &filterOut,
+                             const char *sortingSpec,
+                             std::vector<IssueCopy> &returnedIssues,
+                             size_t offset, int limit, size_t *total, bool withAssociations) const
+{
     // General algorithm:
-    // For each issue:
+    // 1. get the matching issues (from the cache of the results, or else see getMatchingIssues)
+    // 2. then, do the sorting according to <sortingSpec>, up to the end of the requested page
+    //    (on pointers, before copying the issues)
+    // 3. then, copy the resulting issues of the page
+
+    size_t end = (size_t)-1;
+    if (limit >= 0) end = offset + limit;
+
+    std::string key = QueryCache::getKey(fulltextSearch, filterIn, filterOut, sortingSpec);
+    std::vector<const Issue*> issuesOfPage;
+    size_t nMatching = 0;
+    QueryCacheStatus cached = queryCache.get(key, generation, end, issuesOfPage, nMatching);
+
+    if (cached != QUERY_HIT_SORTED) {
+        std::vector<const Issue*> matching;
+        if (cached == QUERY_HIT_UNSORTED) matching.swap(issuesOfPage);
+        else getMatchingIssues(fulltextSearch, filterIn, filterOut, matching);
+        nMatching = matching.size();
+
+        // sort a copy, so that the cache keeps the order of the table of issues
+        // (the result of a deeper sort is the same as without the cache)
+        issuesOfPage = matching;
+        if (end > issuesOfPage.size()) end = issuesOfPage.size();
+        if (sortingSpec) {
+            IssueSorter sorter(parseSortingSpec(sortingSpec));
+            sorter.sort(issuesOfPage, end);
+            issuesOfPage.resize(end);
+            queryCache.put(key, generation, matching, issuesOfPage);
+        } else {
+            queryCache.put(key, generation, matching, matching);
+            issuesOfPage.resize(end);
+        }
+    }
+
+    if (total) *total = nMatching;
+    if (offset >= issuesOfPage.size()) return;
+
+    returnedIssues.reserve(returnedIssues.size() + issuesOfPage.size() - offset);
+    std::vector<const Issue*>::const_iterator i;
+    for (i = issuesOfPage.begin() + offset; i != issuesOfPage.end(); i++) {
+        returnedIssues.push_back(IssueCopy(**i));
+        if (!withAssociations) continue;
+        consolidateAssociations(returnedIssues.back(), true);
+        consolidateAssociations(returnedIssues.back(), false);
+    }
+}
+
+struct ProjectSearchJob {
+    ProjectSearch *search;
+    const char *sortingSpec;
+    size_t limit; // (size_t)-1 for no limit
+};
+
+/** Search in a project, for searchProjects
+  *
+  * This function is suitable for a ThreadPool job.
+  */
+void Project::searchProjectJob(void *arg)
+{
+    ProjectSearchJob *job = (ProjectSearchJob*)arg;
+    ProjectSearch *s = job->search;
+    // a project cannot have more issues than INT_MAX, so a greater limit is no limit
+    int limit = (job->limit > (size_t)INT_MAX) ? -1 : (int)job->limit;
+    s->project->searchUnlocked(s->fulltextSearch.c_str(), s->filterIn, s->filterOut, job->sortingSpec,
+                               s->issues, 0, limit, &s->total, false);
+}
+
+/** Position in the results of a project, for merging the results of the projects
+  */
+struct MergeHead {
+    size_t search; // index of the project search
+    size_t position; // next issue of this project
+};
+
+/** Order of the heads in the heap (the top is the next issue of the merged list)
+  *
+  * The equal issues are taken in the order of the projects.
+  */
+class MergeHeadComparator {
+public:
+    MergeHeadComparator(const IssueSorter &s, const std::vector<ProjectSearch> &p) : sorter(s), searches(p) {}
+    inline bool operator() (const MergeHead &a, const MergeHead &b) const {
+        int result = sorter.compare(&searches[a.search].issues[a.position],
+                                    &searches[b.search].issues[b.position]);
+        if (result) return result > 0;
+        return a.search > b.search;
+    }
+private:
+    const IssueSorter &sorter;
+    const std::vector<ProjectSearch> &searches;
+};
+
+/** Search several projects
+  *
+  *   searches: the projects and their filters (see ProjectSearch)
+  *   sortingSpec, offset, limit, total: see search (for the merged list of issues)
+  *
+  * The projects are searched in parallel by the pool of threads shared
+  * by the requests (see Database::getSearchWorkers), each project
+  * sorting its first offset+limit issues. These sorted lists are
+  * then merged (k-way merge), up to the end of the requested page. The
+  * result is the same as sorting all the matching issues of the projects
+  * (stable sort, in the order of the projects).
+  *
+  * All the projects are locked for reading during the searches, so that
+  * the results come from the same state of the projects. The projects are
+  * never locked for writing several at a time, so this cannot deadlock.
+  */
+void Project::searchProjects(std::vector<ProjectSearch> &searches, const char *sortingSpec,
+                             std::vector<IssueCopy> &returnedIssues, size_t offset, int limit, size_t *total)
+{
+    size_t end = (size_t)-1;
+    if (limit >= 0) end = offset + limit;
+
+    std::vector<ProjectSearchJob> jobs(searches.size());
+    for (size_t i = 0; i < searches.size(); i++) {
+        searches[i].issues.clear();
+        searches[i].total = 0;
+        jobs[i].search = &searches[i];
+        jobs[i].sortingSpec = sortingSpec;
+        jobs[i].limit = end;
+    }
+
+    ThreadPool *pool = 0;
+    if (jobs.size() > 1 && ThreadPool::getNumCpus() > 1) pool = Database::getSearchWorkers();
+
+    std::vector<ProjectSearch>::iterator s;
+    FOREACH(s, searches) s->project->locker.lockForReading();
+
+    std::vector<ProjectSearchJob>::iterator job;
+    if (!pool) {
+        // not worth waking up threads
+        FOREACH(job, jobs) searchProjectJob(&(*job));
+    } else {
+        ThreadPool::JobGroup group;
+        FOREACH(job, jobs) pool->submit(searchProjectJob, &(*job), &group);
+        pool->wait(group);
+    }
+
+    FOREACH(s, searches) s->project->locker.unlock();
+
+    // merge the sorted lists of the projects
+    size_t nMatching = 0;
+    std::vector<MergeHead> heap;
+    for (size_t i = 0; i < searches.size(); i++) {
+        nMatching += searches[i].total;
+        if (searches[i].issues.empty()) continue;
+        MergeHead head = { i, 0 };
+        heap.push_back(head);
+    }
+    if (total) *total = nMatching;
+
+    IssueSorter sorter(parseSortingSpec(sortingSpec ? sortingSpec : ""));
+    MergeHeadComparator comparator(sorter, searches);
+    std::make_heap(heap.begin(), heap.end(), comparator);
+
+    size_t n = 0;
+    while (!heap.empty() && n < end) {
+        std::pop_heap(heap.begin(), heap.end(), comparator);
+        MergeHead &head = heap.back();
+        if (n >= offset) returnedIssues.push_back(searches[head.search].issues[head.position]);
+        n++;
+        head.position++;
+        if (head.position < searches[head.search].issues.size()) {
+            std::push_heap(heap.begin(), heap.end(), comparator);
+        } else {
+            heap.pop_back();
+        }
+    }
+}
+
+/** Search the issues as they were at several datetimes (snapshots)
+  *
+  *   datetimes: seconds since 1 Jan 1970 (Epoch) UTC
+  *   filterIn, filterOut, sortingSpec, offset, limit, withAssociations: see search
+  *              (evaluated on the states of the issues at each datetime)
+  *   snapshots: (out) the page of the matching issues, for each datetime
+  *   totals: (out) number of matching issues, for each datetime (optional)
+  *
+  * The states are given by the temporal index (see SnapshotIndex), in one
+  * pass over the issues for all the datetimes. Only the issues of the pages
+  * are copied, and a limit of 0 gives only the totals.
+  *
+  * The associations of the returned issues are the current ones.
+  */
+void Project::searchSnapshots(const std::vector<long> &datetimes,
+                              const std::map<std::string, std::list<std::string> > &filterIn,
+                              const std::map<std::string, std::list<std::string> > &filterOut,
+                              const char *sortingSpec,
+                              std::vector<std::vector<IssueCopy> > &snapshots,
+                              size_t offset, int limit, std::vector<size_t> *totals,
+                              bool withAssociations) const
+{
+    ScopeLocker scopeLocker(locker, LOCK_READ_ONLY);
+
+    std::vector<size_t> nMatching;
+    std::vector<std::vector<IssueSnapshot> > states;
+    snapshotIndex.getSnapshots(issues, datetimes, filterIn, filterOut, nMatching, limit != 0 ? &states : 0);
+    if (totals) *totals = nMatching;
+
+    snapshots.clear();
+    snapshots.resize(datetimes.size());
+    if (limit == 0) return;
+
+    std::list<std::pair<bool, std::string> > sSpec;
+    if (sortingSpec) sSpec = parseSortingSpec(sortingSpec);
+    IssueSorter sorter(sSpec);
+
+    for (size_t k = 0; k < states.size(); k++) {
+        size_t end = states[k].size();
+        if (limit > 0 && offset + limit < end) end = offset + limit;
+        if (offset >= end) continue;
+
+        // the issues as they were at this datetime, for sorting them
+        std::vector<Issue> issuesAtDatetime(states[k].size());
+        std::vector<const Issue*> issuesOfPage(states[k].size());
+        for (size_t j = 0; j < states[k].size(); j++) {
+            const IssueSnapshot &state = states[k][j];
+            Issue &issue = issuesAtDatetime[j];
+            issue.id = state.issue->id;
+            issue.project = state.issue->project;
+            issue.ctime = state.issue->ctime;
+            issue.mtime = state.mtime;
+            issue.properties = state.properties;
+            issuesOfPage[j] = &issue;
+        }
+        if (!sorter.empty()) sorter.sort(issuesOfPage, end);
+
+        snapshots[k].reserve(end - offset);
+        for (size_t j = offset; j < end; j++) {
+            const IssueSnapshot &state = states[k][issuesOfPage[j] - &issuesAtDatetime[0]];
+            snapshots[k].push_back(IssueCopy(*state.issue));
+            IssueCopy &copy = snapshots[k].back();
+            copy.mtime = state.mtime;
+            copy.properties = state.properties;
+            if (!withAssociations) continue;
+            consolidateAssociations(copy, true);
+            consolidateAssociations(copy, false);
+        }
+    }
+}
+
+/** Count the matching issues per value of some properties (facets)
+  *
+  *   fulltextSearch, filterIn, filterOut: see search
+  *   properties: names of the properties to be counted
+  *   facets: (out) for each property, the number of matching issues per value.
+  *           An issue that has no value is counted under the empty value, and
+  *           an issue that has several values (multiselect) under each of them.
+  *   total: (out) number of matching issues (optional)
+  *
+  * If the filters and the counted properties are all select properties, and
+  * without full-text search, the counts are taken from the bitmaps of the
+  * filter index. Else, they are counted in a single pass over the matching issues.
+  */
+void Project::getFacets(const char *fulltextSearch,
+                        const std::map<std::string, std::list<std::string> > &filterIn,
+                        const std::map<std::string, std::list<std::string> > &filterOut,
+                        const std::list<std::string> &properties, FacetCounts &facets, size_t *total) const
+{
+    ScopeLocker scopeLocker(locker, LOCK_READ_ONLY);
+
+    facets.clear();
+    if (!fulltextSearch || !fulltextSearch[0]) {
+        std::set<std::string> selectProperties;
+        getSelectProperties(selectProperties);
+        size_t n = 0;
+        if (filterIndex.countValues(issues, selectProperties, filterIn, filterOut, properties, facets, n)) {
+            if (total) *total = n;
+            return;
+        }
+    }
+
+    std::vector<const Issue*> matching;
+    getMatchingIssues(fulltextSearch, filterIn, filterOut, matching);
+    if (total) *total = matching.size();
+
+    std::vector<std::pair<std::string, std::map<std::string, size_t>*> > counts; // each property once
+    std::list<std::string>::const_iterator name;
+    FOREACH(name, properties) {
+        if (facets.count(*name)) continue;
+        counts.push_back(std::make_pair(*name, &facets[*name]));
+    }
+
+    std::vector<const Issue*>::const_iterator i;
+    FOREACH(i, matching) {
+        std::vector<std::pair<std::string, std::map<std::string, size_t>*> >::const_iterator c;
+        FOREACH(c, counts) {
+            PropertiesCIt p = (*i)->properties.find(c->first);
+            if (p == (*i)->properties.end() || p->second.empty()) {
+                (*c->second)[""]++;
+            } else {
+                PropertyValuesIt v;
+                FOREACH(v, p->second) (*c->second)[*v]++;
+            }
+        }
+    }
+}
+
+/** Get the names of the properties of type select, multiselect or selectUser
+  */
+void Project::getSelectProperties(std::set<std::string> &names) const
+{
+    ScopeLocker scopeLockerConfig(lockerForConfig, LOCK_READ_ONLY);
+    std::list<PropertySpec>::const_iterator pspec;
+    FOREACH(pspec, config.properties) {
+        if (pspec->type == F_SELECT || pspec->type == F_MULTISELECT || pspec->type == F_SELECT_USER) {
+            names.insert(pspec->name);
+        }
+    }
+}
+
+/** Get the issues that match the filters and the full-text search, in the order of the table of issues
+  *
+  * Must be called under the read lock.
+  */
+void Project::getMatchingIssues(const char *fulltextSearch,
+                                const std::map<std::string, std::list<std::string> > &filterIn,
+                                const std::map<std::string, std::list<std::string> > &filterOut,
+                                std::vector<const Issue*> &matching) const
+{
+    // For each issue (only the candidates of the indexes, if any):
     //     1. keep only those specified by filterIn and filterOut
     //     2. then, if fulltext is not null, walk through these issues and their
     //        related messages and keep those that contain <fulltext>
-    //     3. then, do the sorting according to <sortingSpec>
 
-    std::map<std::string, Issue*>::const_iterator i;
-    for (i=issues.begin(); i!=issues.end(); i++) {
-
-        const Issue* issue = i->second;
-        // 1. filters
-        if (!filterIn.empty() && !issue->isInFilter(filterIn, FILTER_IN)) continue;
-        if (!filterOut.empty() && issue->isInFilter(filterOut, FILTER_OUT)) continue;
+    // the filter index evaluates the filters on select properties
+    std::set<std::string> selectProperties;
+    if (!filterIn.empty() || !filterOut.empty()) getSelectProperties(selectProperties);
+    std::vector<const Issue*> selected;
+    std::map<std::string, std::list<std::string> > otherFilterIn;
+    std::map<std::string, std::list<std::string> > otherFilterOut;
+    const std::map<std::string, std::list<std::string> > *in = &filterIn;
+    const std::map<std::string, std::list<std::string> > *out = &filterOut;
+    bool filtered = filterIndex.select(issues, selectProperties, filterIn, filterOut, selected,
+                                       otherFilterIn, otherFilterOut);
+    if (filtered) {
+        // keep the order of the table of issues
+        std::sort(selected.begin(), selected.end(), lessIssueId);
+        in = &otherFilterIn;
+        out = &otherFilterOut;
+    }
+
+    // the full-text index gives the issues that may contain <fulltext>
+    std::vector<const Issue*> candidates;
+    bool indexed = fullTextIndex.getCandidates(issues, fulltextSearch, candidates);
+    if (indexed) std::sort(candidates.begin(), candidates.end(), lessIssueId);
+
+    if (filtered && indexed) {
+        std::vector<const Issue*> both;
+        std::set_intersection(selected.begin(), selected.end(), candidates.begin(), candidates.end(),
+                              std::back_inserter(both), lessIssueId);
+        candidates.swap(both);
+    } else if (filtered) {
+        candidates.swap(selected);
+    } else if (!indexed) {
+        std::map<std::string, Issue*>::const_iterator i;
+        FOREACH(i, issues) candidates.push_back(i->second);
+    }
+
+    std::vector<const Issue*>::const_iterator i;
+    FOREACH(i, candidates) {
+
+        const Issue* issue = *i;
+        // 1. filters (those not evaluated by the filter index)
+        if (!in->empty() && !issue->isInFilter(*in, FILTER_IN)) continue;
+        if (!out->empty() && issue->isInFilter(*out, FILTER_OUT)) continue;
 
         // 2. search full text
         if (! issue->searchFullText(fulltextSearch)) {
@@ -983,16 +2065,7 @@ void Project::search(const char *fulltextSearch,
         }
 
         // keep this issue in the result
-        IssueCopy icopy(*issue);
-        consolidateAssociations(icopy, true);
-        consolidateAssociations(icopy, false);
-        returnedIssues.push_back(icopy);
-    }
-
-    // 4. do the sorting
-    if (sortingSpec) {
-        std::list<std::pair<bool, std::string> > sSpec = parseSortingSpec(sortingSpec);
-        IssueCopy::sort(returnedIssues, sSpec);
+        matching.push_back(issue);
     }
 }
 
@@ -1020,6 +2093,10 @@ int Project::insertIssueInTable(Issue *i)
 
     // add the issue in the table
     issues[i->id] = i;
+    fullTextIndex.addIssue(i);
+    filterIndex.update(i);
+    snapshotIndex.update(i);
+    setModified();
     return 0;
 }
 
@@ -1044,11 +2121,33 @@ int Project::insertEntryInTable(Entry *e)
         return -3;
     }
 
+    internSelectValues(e->properties);
+
     // add the issue in the table
     entries[e->id] = e;
+    entryIndex.addEntry(e);
+    setModified();
     return 0;
 }
 
+/** Intern the values of the select properties (see IString)
+  *
+  * The values of the other properties (texts, etc.) remain owned, so that
+  * the table of interned strings (never freed) does not grow with them.
+  * The values are interned according to the configuration when the entry
+  * is inserted: a later change of the type of a property does not affect
+  * the entries already loaded.
+  */
+void Project::internSelectValues(Properties &properties) const
+{
+    std::list<PropertySpec>::const_iterator pspec;
+    FOREACH(pspec, config.properties) {
+        if (pspec->type == F_SELECT || pspec->type == F_MULTISELECT || pspec->type == F_SELECT_USER) {
+            properties.internValues(pspec->name);
+        }
+    }
+}
+
 void Project::updateLastModified(Entry *e)
 {
     if (!e) return;
@@ -1112,6 +2211,10 @@ int Project::renameIssue(Issue &i, const std::string &newId)
 
     // set the new id
     i.id = newId;
+    fullTextIndex.update(&i, 0);
+    updateAssociationSummariesAround(oldId);
+    updateAssociationSummariesAround(newId);
+    setModified();
 
     // store the new id on disk
     int r = storeRefIssue(newId, i.latest->id);
@@ -1155,6 +2258,14 @@ void Project::updateAssociations(const Issue *i, const std::string &associationN
 
     if (!i) return;
 
+    // the issues formerly referenced, whose reverse associations are cleaned up below
+    std::set<IssueId> formerIssues;
+    std::map<IssueId, std::map<AssociationId, std::set<IssueId> > >::iterator aIssue = associations.find(i->id);
+    if (aIssue != associations.end()) {
+        std::map<AssociationId, std::set<IssueId> >::iterator aAssoName = aIssue->second.find(associationName);
+        if (aAssoName != aIssue->second.end()) formerIssues.swap(aAssoName->second);
+    }
+
     if (issues.empty() || issues.front() == "") {
         if (associations.find(i->id) != associations.end()) {
             associations[i->id].erase(associationName);
@@ -1170,8 +2281,11 @@ void Project::updateAssociations(const Issue *i, const std::string &associationN
     }
 
     // clean up reverse associations, to cover the case where an association has been removed
-    std::map<IssueId, std::map<AssociationId, std::set<IssueId> > >::iterator raIssue;
-    FOREACH(raIssue, reverseAssociations) {
+    std::set<IssueId>::const_iterator formerIssue;
+    FOREACH(formerIssue, formerIssues) {
+        std::map<IssueId, std::map<AssociationId, std::set<IssueId> > >::iterator raIssue;
+        raIssue = reverseAssociations.find(*formerIssue);
+        if (raIssue == reverseAssociations.end()) continue;
         std::map<AssociationId, std::set<IssueId> >::iterator raAssoName;
         raAssoName = raIssue->second.find(associationName);
         if (raAssoName != raIssue->second.end()) raAssoName->second.erase(i->id);
@@ -1184,20 +2298,129 @@ void Project::updateAssociations(const Issue *i, const std::string &associationN
         reverseAssociations[*otherIssue][associationName].insert(i->id);
     }
 
-#if 0
-    // debug
-    // dump associations
-    FOREACH(raIssue, reverseAssociations) {
-        std::map<std::string, std::set<std::string> >::iterator raAssoName;
-        FOREACH(raAssoName, raIssue->second) {
-            std::set<std::string>::iterator x;
-            FOREACH(x, raAssoName->second) {
-                LOG_DEBUG("reverseAssociations[%s][%s]=%s", raIssue->first.c_str(),
-                          raAssoName->first.c_str(), x->c_str());
+    // update the summaries of the associations
+    updateAssociationSummaries(i->id, true);
+    FOREACH(formerIssue, formerIssues) updateAssociationSummaries(*formerIssue, false);
+    FOREACH(otherIssue, issues) {
+        if (otherIssue->empty()) continue;
+        if (formerIssues.count(*otherIssue)) continue; // already done
+        updateAssociationSummaries(*otherIssue, false);
+    }
+}
+
+/** Build the summaries of the associations of an issue (forward or reverse)
+  *
+  * The former table is replaced (and not modified), as it may be shared
+  * with copies of the issue. Must be called under the write lock.
+  */
+void Project::updateAssociationSummaries(const IssueId &id, bool forward)
+{
+    const std::map<IssueId, std::map<AssociationId, std::set<IssueId> > > &table = forward ? associations :
+                                                                                          reverseAssociations;
+    std::map<IssueId, AssociationTable> &summaries = forward ? associationSummaries :
+                                                               reverseAssociationSummaries;
+
+    AssociationTable::Map summaryTable;
+    std::map<IssueId, std::map<AssociationId, std::set<IssueId> > >::const_iterator ait = table.find(id);
+    if (ait != table.end()) {
+        std::map<AssociationId, std::set<IssueId> >::const_iterator a;
+        FOREACH(a, ait->second) {
+            const std::set<IssueId> &otherIssues = a->second;
+            std::set<IssueId>::const_iterator otherIssue;
+            FOREACH(otherIssue, otherIssues) {
+                Issue *oi = getIssue(*otherIssue);
+                if (!oi) continue; // a bad issue id was fulfilled by a user
+                IssueSummary is;
+                is.id = oi->id;
+                is.summary = oi->getSummary();
+                summaryTable[a->first].insert(is);
             }
         }
     }
-#endif
+
+    if (summaryTable.empty()) summaries.erase(id);
+    else summaries[id] = AssociationTable(summaryTable);
+}
+
+/** Replace the summary of an issue in the summaries of the associations of another issue
+  */
+static void replaceSummary(std::map<IssueId, AssociationTable> &summaries, const IssueId &otherIssue,
+                           const IssueSummary &is)
+{
+    std::map<IssueId, AssociationTable>::iterator table = summaries.find(otherIssue);
+    if (table == summaries.end()) return;
+
+    AssociationTable::Map map(table->second.begin(), table->second.end());
+    AssociationTable::Map::iterator a;
+    FOREACH(a, map) {
+        if (a->second.erase(is)) a->second.insert(is); // the summaries are compared by id
+    }
+    table->second = AssociationTable(map);
+}
+
+/** Update the summary of an issue in the summaries of the associations that show it
+  *
+  * Same as updateAssociationSummariesAround, for an issue whose summary
+  * changed: the other summaries are copied instead of being looked up.
+  * Must be called under the write lock.
+  */
+void Project::updateSummaryInAssociations(const Issue *i)
+{
+    IssueSummary is;
+    is.id = i->id;
+    is.summary = i->getSummary();
+
+    std::map<IssueId, std::map<AssociationId, std::set<IssueId> > >::const_iterator ait;
+    std::map<AssociationId, std::set<IssueId> >::const_iterator a;
+    std::set<IssueId> otherIssues;
+    std::set<IssueId>::const_iterator otherIssue;
+
+    // the issues referenced by this one show it in their reverse associations
+    ait = associations.find(i->id);
+    if (ait != associations.end()) {
+        FOREACH(a, ait->second) otherIssues.insert(a->second.begin(), a->second.end());
+    }
+    FOREACH(otherIssue, otherIssues) replaceSummary(reverseAssociationSummaries, *otherIssue, is);
+
+    // the issues that reference this one show it in their associations
+    otherIssues.clear();
+    ait = reverseAssociations.find(i->id);
+    if (ait != reverseAssociations.end()) {
+        FOREACH(a, ait->second) otherIssues.insert(a->second.begin(), a->second.end());
+    }
+    FOREACH(otherIssue, otherIssues) replaceSummary(associationSummaries, *otherIssue, is);
+}
+
+/** Update the summaries of the associations that show a given issue
+  *
+  * To be called when the issue is created, removed or renamed, or when
+  * its summary may have changed. Must be called under the write lock.
+  */
+void Project::updateAssociationSummariesAround(const IssueId &id)
+{
+    std::map<IssueId, std::map<AssociationId, std::set<IssueId> > >::const_iterator ait;
+    std::map<AssociationId, std::set<IssueId> >::const_iterator a;
+    std::set<IssueId>::const_iterator otherIssue;
+
+    // the issues referenced by this one show it in their reverse associations
+    ait = associations.find(id);
+    if (ait != associations.end()) {
+        FOREACH(a, ait->second) {
+            FOREACH(otherIssue, a->second) updateAssociationSummaries(*otherIssue, false);
+        }
+    }
+
+    // the issues that reference this one show it in their associations
+    ait = reverseAssociations.find(id);
+    if (ait != reverseAssociations.end()) {
+        FOREACH(a, ait->second) {
+            FOREACH(otherIssue, a->second) updateAssociationSummaries(*otherIssue, true);
+        }
+    }
+
+    // the issue itself may have been created (or renamed) after being referenced
+    updateAssociationSummaries(id, true);
+    updateAssociationSummaries(id, false);
 }
 
 void parseAssociation(std::list<std::string> &values)
@@ -1275,185 +2498,205 @@ int Project::storeEntry(const Entry *e)
   * @return
   *     0 if no error. The entryId is fullfilled.
   *    >0 no entry was created due to no change.
-  *    -1 error
+  *    -1 error (if the entry cannot be stored, the issue is rolled back)
   */
 int Project::addEntry(PropertiesMap properties, std::string &issueId,
                       Entry *&entry, std::string username, IssueCopy &oldIssue)
 {
-    ScopeLocker scopeLocker(locker, LOCK_READ_WRITE);
-    ScopeLocker scopeLockerConfig(lockerForConfig, LOCK_READ_ONLY);
-
     entry = 0;
 
+    // The entry is added in two phases, so that the write lock is held
+    // only for publishing it:
+    // 1. under the read lock, the properties are compared to the issue,
+    //    then the entry is built, serialized and hashed without any lock
+    // 2. under the write lock, the entry is inserted in the tables and in
+    //    the journal, unless the issue has been modified in the meantime
+    //    by another entry (in which case phase 1 is done again).
+
     // Check that all properties are in the project config, else remove them.
     // Also parse the associations, if any.
     //
     // Note that the values of properties that have a type select, multiselect and selectUser
     // are not verified (this is a known issue) TODO.
     std::map<std::string, std::list<std::string> >::iterator p;
-    p = properties.begin();
-    while (p != properties.end()) {
-        bool doErase = false;
-        std::string propertyName = p->first;
-
-        if ( (propertyName == K_MESSAGE) ||
-             (propertyName == K_FILE)    || (propertyName == K_AMEND) )  {
-            if (p->second.size() && p->second.front().empty()) {
-                // erase if message or file is emtpy
-                doErase = true;
-            }
-        } else {
-            const PropertySpec *pspec = config.getPropertySpec(propertyName);
-            if (!pspec && (propertyName != K_SUMMARY)) {
-                // erase property because it is not part of the user properties of the project
-                doErase = true;
-            } // else do not erase and parse the association
-            else if (pspec && pspec->type == F_ASSOCIATION) parseAssociation(p->second);
-        }
-
-        if (doErase) {
-            // here we remove an item from the list that we are walking through
-            // be careful...
-            std::map<std::string, std::list<std::string> >::iterator itemToErase = p;
-            p++;
-            properties.erase(itemToErase);
-        } else p++;
-
-    }
-
-    Issue *i = NULL;
-    if (issueId.size() > 0) {
-        // adding an entry to an existing issue
-
-        i = getIssue(issueId);
-        if (!i) {
-            LOG_INFO("Cannot add new entry to unknown issue: %s", issueId.c_str());
-            return -1;
-        }
-
-        oldIssue = copyIssue(*i);
-
-        // Simplify the entry by removing properties that have the same value
-        // in the issue (only the modified fields are stored)
-
-        // Note that keep-old values are pruned here : values that are no longer
-        // in the official values (select, multiselect, selectUser), but
-        // that might still be used in some old issues.
-        std::map<std::string, std::list<std::string> >::iterator entryProperty;
-        entryProperty = properties.begin();
-        while (entryProperty != properties.end()) {
+    {
+        ScopeLocker scopeLockerConfig(lockerForConfig, LOCK_READ_ONLY);
+        p = properties.begin();
+        while (p != properties.end()) {
             bool doErase = false;
+            std::string propertyName = p->first;
 
-            std::map<std::string, std::list<std::string> >::iterator issueProperty;
-            issueProperty = i->properties.find(entryProperty->first);
-            if (issueProperty != i->properties.end()) {
-                if (issueProperty->second == entryProperty->second) {
-                    // the value of this property has not changed
+            if ( (propertyName == K_MESSAGE) ||
+                 (propertyName == K_FILE)    || (propertyName == K_AMEND) )  {
+                if (p->second.size() && p->second.front().empty()) {
+                    // erase if message or file is emtpy
                     doErase = true;
                 }
+            } else {
+                const PropertySpec *pspec = config.getPropertySpec(propertyName);
+                if (!pspec && (propertyName != K_SUMMARY)) {
+                    // erase property because it is not part of the user properties of the project
+                    doErase = true;
+                } // else do not erase and parse the association
+                else if (pspec && pspec->type == F_ASSOCIATION) parseAssociation(p->second);
             }
 
             if (doErase) {
                 // here we remove an item from the list that we are walking through
                 // be careful...
-                std::map<std::string, std::list<std::string> >::iterator itemToErase = entryProperty;
-                entryProperty++;
+                std::map<std::string, std::list<std::string> >::iterator itemToErase = p;
+                p++;
                 properties.erase(itemToErase);
-            } else entryProperty++;
+            } else p++;
         }
     }
 
-    if (properties.size() == 0) {
-        LOG_INFO("addEntry: no change. return without adding entry.");
-        return 1; // no change
-    }
+    while (1) {
+        PropertiesMap entryProperties = properties;
+        std::string parentId = K_PARENT_NULL;
 
-    // at this point properties have been cleaned up
+        if (issueId.size() > 0) {
+            // adding an entry to an existing issue
+            ScopeLocker scopeLocker(locker, LOCK_READ_ONLY);
 
-    FOREACH(p, properties) {
-        LOG_DEBUG("properties: %s => %s", p->first.c_str(), join(p->second, ", ").c_str());
-    }
+            Issue *i = getIssue(issueId);
+            if (!i) {
+                LOG_INFO("Cannot add new entry to unknown issue: %s", issueId.c_str());
+                return -1;
+            }
 
-    // write the entry to disk
+            oldIssue = copyIssue(*i);
+            if (i->latest) parentId = i->latest->id;
+
+            // Simplify the entry by removing properties that have the same value
+            // in the issue (only the modified fields are stored)
+
+            // Note that keep-old values are pruned here : values that are no longer
+            // in the official values (select, multiselect, selectUser), but
+            // that might still be used in some old issues.
+            std::map<std::string, std::list<std::string> >::iterator entryProperty;
+            entryProperty = entryProperties.begin();
+            while (entryProperty != entryProperties.end()) {
+                bool doErase = false;
+
+                PropertiesCIt issueProperty = i->properties.find(entryProperty->first);
+                if (issueProperty != i->properties.end()) {
+                    if (issueProperty->second == entryProperty->second) {
+                        // the value of this property has not changed
+                        doErase = true;
+                    }
+                }
 
-    // if issueId is empty, create a new issue
-    bool newIssueCreated = false;
-    if (!i) {
-        newIssueCreated = true;
-        i = createNewIssue();
-        if (!i) return -1;
-        issueId = i->id; // update @param[out]
-    }
+                if (doErase) {
+                    // here we remove an item from the list that we are walking through
+                    // be careful...
+                    std::map<std::string, std::list<std::string> >::iterator itemToErase = entryProperty;
+                    entryProperty++;
+                    entryProperties.erase(itemToErase);
+                } else entryProperty++;
+            }
+        }
 
-    // create the new entry object
-    Entry *e = Entry::createNewEntry(properties, username, i->latest);
+        if (entryProperties.size() == 0) {
+            LOG_INFO("addEntry: no change. return without adding entry.");
+            return 1; // no change
+        }
 
-    // add the entry to the project
-    int r = addNewEntry(e);
-    if (r < 0) {
-        delete e;
-        return r; // already exists
-    }
+        // at this point properties have been cleaned up
 
-    // add the entry to the issue
-    i->addEntry(e);
+        FOREACH(p, entryProperties) {
+            LOG_DEBUG("properties: %s => %s", p->first.c_str(), join(p->second, ", ").c_str());
+        }
 
-    if (newIssueCreated) {
-        r = insertIssueInTable(i);
-        if (r != 0) return r; // already exists
-    }
+        // create the new entry object, outside of the lockers
+        std::string data;
+        Entry *e = Entry::createNewEntry(entryProperties, username, parentId, data);
+
+        ScopeLocker scopeLocker(locker, LOCK_READ_WRITE);
+        ScopeLocker scopeLockerConfig(lockerForConfig, LOCK_READ_ONLY);
+        double lockTime = getSeconds();
+
+        Issue *i = NULL;
+        if (issueId.size() > 0) {
+            i = getIssue(issueId);
+            if (!i || !i->latest || i->latest->id != parentId) {
+                // another entry has been added to the issue since phase 1.
+                // Each retry means that another entry has progressed.
+                LOG_DIAG("addEntry: issue %s modified concurrently, retry", issueId.c_str());
+                delete e;
+                continue;
+            }
+        }
 
-	// update latest entry of issue on disk
-    r = storeRefIssue(i->id, e->id);
-    if (r < 0) return r;
+        // if issueId is empty, create a new issue
+        bool newIssueCreated = false;
+        if (!i) {
+            newIssueCreated = true;
+            i = createNewIssue();
+            if (!i) {
+                delete e;
+                return -1;
+            }
+            issueId = i->id; // update @param[out]
+        }
 
-    updateLastModified(e);
+        // add the entry to the project
+        int r = insertEntryInTable(e);
+        if (r < 0) {
+            delete e;
+            return r; // already exists
+        }
 
-    // if some association has been updated, then update the associations tables
-    FOREACH(p, properties) {
-        const PropertySpec *pspec = config.getPropertySpec(p->first);
-        if (pspec && pspec->type == F_ASSOCIATION) {
-            updateAssociations(i, p->first, p->second);
+        // add the entry to the issue
+        i->addEntry(e);
+
+        if (newIssueCreated) {
+            r = insertIssueInTable(i);
+            if (r != 0) return r; // already exists
+        } else {
+            fullTextIndex.update(i, e);
+            filterIndex.update(i);
+            snapshotIndex.update(i);
         }
-    }
 
-    entry = e;
+        // store the entry and the latest entry of the issue, through the journal
+        uint64_t seq = journal.append(i->id, e->id, e->id, data);
 
-    return 0; // success
-}
+        updateLastModified(e);
 
-/** Add a new entry to the project
-  */
-int Project::addNewEntry(Entry *e)
-{
-    // add this entry in internal in-memory tables
-    int r = insertEntryInTable(e);
-    if (r != 0) return r; // already exists
+        // if some association has been updated, then update the associations tables
+        FOREACH(p, entryProperties) {
+            const PropertySpec *pspec = config.getPropertySpec(p->first);
+            if (pspec && pspec->type == F_ASSOCIATION) {
+                updateAssociations(i, p->first, p->second);
+            }
+        }
 
-    r = storeEntry(e); // TODO move the storage before the insertion in RAM
+        // the associated issues show the summary of this one
+        if (newIssueCreated) updateAssociationSummariesAround(i->id);
+        else if (entryProperties.count(K_SUMMARY)) updateSummaryInAssociations(i);
 
-    return r;
-}
+        entry = e;
 
-int Project::addPushedEntry(Entry *e, const std::string &data)
-{
-    // store the data (unchanged)
-    int ret = Object::writeToId(getObjectsDir(), data.data(), data.size(), e->id);
-    if (ret < 0) {
-        // error.
-        LOG_ERROR("Could not write pushed entry to disk");
-        return -1;
-    }
+        updateLockStats(lockTime);
 
-    // add this entry in internal in-memory tables
-    ret = insertEntryInTable(e);
-    if (ret != 0) return ret; // already exists
+        // wait for the journal outside of the lockers, so that concurrent
+        // entries are committed together
+        scopeLockerConfig.unlock();
+        scopeLocker.unlock();
+        r = journal.commit(seq);
+        if (r != 0) {
+            // not stored: roll back the issue (with the entries added on top of it)
+            reloadIssue(issueId, true);
+            entry = 0;
+            return -1;
+        }
 
-    return ret;
+        return 0; // success
+    }
 }
 
 
-
 /** Push an uploaded entry in the database
   *
   * An error is raised in any of the following cases:
@@ -1479,6 +2722,13 @@ int Project::pushEntry(std::string &issueId, const std::string &entryId,
     LOG_FUNC();
     LOG_DEBUG("pushEntry(%s, %s, %s, ...)", issueId.c_str(), entryId.c_str(), username.c_str());
 
+    // the data is stored under the given id: they must match
+    std::string hash = getSha1(data);
+    if (hash != entryId) {
+        LOG_ERROR("pushEntry error: hash does not match: entry=%s, sha1=%s", entryId.c_str(), hash.c_str());
+        return -1;
+    }
+
     // load the file as an entry
     Entry *e = Entry::loadEntryFromBuffer(data, entryId);
     if (!e) return -1;
@@ -1494,6 +2744,8 @@ int Project::pushEntry(std::string &issueId, const std::string &entryId,
     Issue *i = 0;
     Issue *newI = 0;
     ScopeLocker scopeLocker(locker, LOCK_READ_WRITE);
+    ScopeLocker scopeLockerConfig(lockerForConfig, LOCK_READ_ONLY);
+    double lockTime = getSeconds();
 
     // check if the entry already exists
     Entry *existingEntry = getEntry(entryId);
@@ -1536,24 +2788,38 @@ int Project::pushEntry(std::string &issueId, const std::string &entryId,
         }
     }
 
+    // add the new entry in the project (before the issue consolidates its properties)
+    int r = insertEntryInTable(e);
+    if (r != 0) {
+        delete e;
+        return -2;
+    }
+
     // insert the new entry in the issue
     i->addEntry(e);
     if (e->isAmending()) i->consolidateAmendment(e);
 
-    // add the new entry in the project
-    int r = addPushedEntry(e, data);
-    if (r != 0) return -2;
+    fullTextIndex.update(i, e);
+    filterIndex.update(i);
+    snapshotIndex.update(i);
+    if (newI) updateAssociationSummariesAround(i->id);
+    else if (e->properties.count(K_SUMMARY)) updateSummaryInAssociations(i);
 
-    // store the new ref of the issue
-    r = storeRefIssue(i->id, i->latest->id);
+    // store the data (unchanged) and the new ref of the issue, through the journal
+    uint64_t seq = journal.append(i->id, i->latest->id, e->id, data);
+
+    updateLastModified(e);
+    updateLockStats(lockTime);
+
+    scopeLockerConfig.unlock();
+    scopeLocker.unlock();
+    r = journal.commit(seq);
     if (r != 0) {
-        if (newI) delete newI;
-        delete e;
+        // not stored: roll back the issue (with the entries added on top of it)
+        reloadIssue(i->id, true);
         return -2;
     }
 
-    updateLastModified(e);
-
     return 0;
 }
 
@@ -1595,49 +2861,95 @@ ProjectParameters Project::getProjectParameters() const
   * @return
   *     0 success, an entry has been created
   *    >0 no entry was created due to no change
-  *    <0 error
+  *    <0 error (if the entry cannot be stored, the issue is rolled back)
   */
 int Project::amendEntry(const std::string &entryId, const std::string &msg,
                         Entry *&entryOut, const std::string &username, IssueCopy &oldIssue)
 {
-    LOCK_SCOPE(locker, LOCK_READ_WRITE);
-
-    Entry *e = getEntry(entryId);
-    if (!e) return -1;
+    // The amending entry is added in two phases, as in addEntry:
+    // 1. under the read lock, the entry to be amended is checked, then the
+    //    current message is read (possibly from the disk, see MessageCache)
+    //    and the amending entry is built, serialized and hashed without any lock
+    // 2. under the write lock, the amending entry is inserted in the tables
+    //    and in the journal, unless the issue has been modified in the meantime
+    //    (in which case phase 1 is done again).
+    while (1) {
+        const Entry *owner;
+        std::string issueId;
+        std::string parentId;
+        {
+            ScopeLocker scopeLocker(locker, LOCK_READ_ONLY);
+            Entry *e = getEntry(entryId);
+            if (!e) return -1;
+
+            if (time(0) - e->ctime > Database::getEditDelay()) return -1; // too late!
+
+            if (e->author != username) return -1; // one cannot amend the message of somebody else
+
+            if (e->isAmending()) return -1; // one cannot amend an amending message
+
+            owner = e->getMessageOwner();
+            issueId = e->issue->id;
+            parentId = e->issue->latest->id;
+            oldIssue = copyIssue(*(e->issue));
+        }
+        // the entries are retired, not deleted, while a request is in progress (see Epoch)
+        std::string holder;
+        const std::string &currentMessage = owner ? owner->getOwnMessage(holder) : holder;
+
+        if (msg == currentMessage) return 0; // no change (the message is the same)
+
+        // create the amending entry, outside of the lockers
+        PropertiesMap properties;
+        properties[K_MESSAGE].push_back(msg);
+        properties[K_AMEND].push_back(entryId);
+        std::string data;
+        Entry *amendingEntry = Entry::createNewEntry(properties, username, parentId, data);
+
+        ScopeLocker scopeLocker(locker, LOCK_READ_WRITE);
+        ScopeLocker scopeLockerConfig(lockerForConfig, LOCK_READ_ONLY);
+        double lockTime = getSeconds();
+
+        Issue *i = getIssue(issueId);
+        Entry *e = getEntry(entryId);
+        if (!i || !e || !i->latest || i->latest->id != parentId || e->getMessageOwner() != owner) {
+            // the issue has been modified in the meantime: check again
+            LOG_DIAG("amendEntry: issue %s modified concurrently, retry", issueId.c_str());
+            delete amendingEntry;
+            continue;
+        }
 
-    if (time(0) - e->ctime > Database::getEditDelay()) return -1; // too late!
+        int r = insertEntryInTable(amendingEntry);
+        if (r != 0) {
+            delete amendingEntry;
+            return -2;
+        }
 
-    if (e->author != username) return -1; // one cannot amend the message of somebody else
+        i->addEntry(amendingEntry);
+        i->consolidateAmendment(amendingEntry);
+        fullTextIndex.update(i, amendingEntry);
+        snapshotIndex.update(i);
 
-    if (e->isAmending()) return -1; // one cannot amend an amending message
+        // store the entry and the latest entry of the issue, through the journal
+        uint64_t seq = journal.append(i->id, amendingEntry->id, amendingEntry->id, data);
 
-    if (msg == e->getMessage()) return 0; // no change (the message is the same)
+        updateLastModified(amendingEntry);
 
-    // ok, we can proceed
+        entryOut = amendingEntry;
+        updateLockStats(lockTime);
 
-    oldIssue = copyIssue(*(e->issue));
+        scopeLockerConfig.unlock();
+        scopeLocker.unlock();
+        r = journal.commit(seq);
+        if (r != 0) {
+            // not stored: roll back the issue (with the entries added on top of it)
+            reloadIssue(issueId, true);
+            entryOut = 0;
+            return -2;
+        }
 
-    Entry *amendingEntry = e->issue->amendEntry(entryId, msg, username);
-    if (!amendingEntry) {
-        // should never happen
-        LOG_ERROR("amending entry: null");
-        return -2;
+        return 0;
     }
-
-    // in case of further error, we should delete the entry
-    // TODO (memory leak at the moment)
-
-    int r = addNewEntry(amendingEntry);
-    if (r != 0) return -2;
-
-    // update latest entry of issue on disk
-    r = storeRefIssue(e->issue->id, amendingEntry->id);
-    if (r < 0) return -2;
-
-    updateLastModified(amendingEntry);
-
-    entryOut = amendingEntry;
-    return 0;
 }
 
 /** Get the external program referenced by the trigger
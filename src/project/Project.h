@@ -14,6 +14,12 @@
 #include "View.h"
 #include "Issue.h"
 #include "ProjectConfig.h"
+#include "Journal.h"
+#include "TrigramIndex.h"
+#include "FilterIndex.h"
+#include "QueryCache.h"
+#include "SnapshotIndex.h"
+#include "EntryIndex.h"
 
 #define PATH_SMIP ".smip"
 #define PATH_REFS        PATH_SMIP "/refs"
@@ -25,6 +31,31 @@
 #define PATH_VIEWS          PATH_REFS "/views"
 #define PATH_TAGS           PATH_REFS "/tags"
 #define PATH_TRIGGER        PATH_REFS "/trigger"
+#define PATH_CACHE          PATH_SMIP "/cache" // binary image of the project, see ProjectCache
+#define PATH_JOURNAL        PATH_SMIP "/journal" // write-ahead journal of the entries, see Journal
+#define RELOAD_ATTEMPTS 3 // optimistic reloads before reloading under the lock
+
+class ProjectCache;
+
+struct ProjectMemoryUsage {
+    size_t nIssues;
+    size_t nEntries;
+    size_t entriesSize; // bytes, including the resident messages
+    size_t nResidentMessages;
+    size_t residentMessagesSize; // bytes
+    size_t nLazyMessages; // messages not resident, see MessageCache
+    ProjectMemoryUsage() : nIssues(0), nEntries(0), entriesSize(0), nResidentMessages(0),
+                           residentMessagesSize(0), nLazyMessages(0) {}
+};
+
+/** Hold times of the write lock of a project, when adding entries
+  */
+struct ProjectLockStats {
+    unsigned long nWrites; // entries added, pushed or amended
+    double totalHold; // seconds
+    double maxHold; // seconds
+    ProjectLockStats() : nWrites(0), totalHold(0), maxHold(0) {}
+};
 
 /** Class for holding project config and some other info
   */
@@ -35,6 +66,27 @@ struct ProjectParameters {
     std::map<std::string, PredefinedView> views;
 };
 
+class Project;
+
+/** Numbers of issues per value of some properties
+  *
+  * { property : { value : number of issues } }
+  */
+typedef std::map<std::string, std::map<std::string, size_t> > FacetCounts;
+
+/** Search in one of the projects of a search across projects (see Project::searchProjects)
+  */
+struct ProjectSearch {
+    const Project *project;
+    std::string fulltextSearch;
+    std::map<std::string, std::list<std::string> > filterIn;
+    std::map<std::string, std::list<std::string> > filterOut;
+
+    // results of the search in the project
+    std::vector<IssueCopy> issues; // the first issues, sorted
+    size_t total; // number of matching issues
+};
+
 class Project {
 public:
     static Project *init(const std::string &path, const std::string &repo);
@@ -47,8 +99,25 @@ public:
                 const std::map<std::string, std::list<std::string> > &filterIn,
                 const std::map<std::string, std::list<std::string> > &filterOut,
                 const char *sortingSpec,
-                std::vector<IssueCopy> &returnedIssues) const;
-    void searchEntries(const char *sortingSpec, std::vector<Entry> &entries, int limit) const;
+                std::vector<IssueCopy> &returnedIssues,
+                size_t offset = 0, int limit = -1, size_t *total = 0,
+                bool withAssociations = true) const;
+    void searchSnapshots(const std::vector<long> &datetimes,
+                         const std::map<std::string, std::list<std::string> > &filterIn,
+                         const std::map<std::string, std::list<std::string> > &filterOut,
+                         const char *sortingSpec,
+                         std::vector<std::vector<IssueCopy> > &snapshots,
+                         size_t offset = 0, int limit = -1, std::vector<size_t> *totals = 0,
+                         bool withAssociations = true) const;
+    int searchEntries(const char *sortingSpec, std::vector<Entry> &entries, int limit,
+                      const std::string &cursor = "") const;
+    void getFacets(const char *fulltextSearch,
+                   const std::map<std::string, std::list<std::string> > &filterIn,
+                   const std::map<std::string, std::list<std::string> > &filterOut,
+                   const std::list<std::string> &properties, FacetCounts &facets, size_t *total = 0) const;
+    static void searchProjects(std::vector<ProjectSearch> &searches, const char *sortingSpec,
+                               std::vector<IssueCopy> &returnedIssues,
+                               size_t offset = 0, int limit = -1, size_t *total = 0);
 
     int get(const std::string &issueId, IssueCopy &issue) const;
     void getAllIssues(std::vector<Issue*> &issuesList);
@@ -65,6 +134,9 @@ public:
                    Entry *&entryOut, const std::string &username, IssueCopy &oldIssue);
 
     size_t getNumIssues() const;
+    ProjectMemoryUsage getMemoryUsage() const;
+    ProjectLockStats getLockStats() const;
+    inline QueryCacheStats getQueryCacheStats() const { return queryCache.getStats(); }
     long getLastModified() const;
 
     // methods for handling project
@@ -85,12 +157,16 @@ public:
     static int createProjectFiles(const std::string &repositoryPath, const std::string &projectName,
                                   std::string &resultingPath);
     int reload(); // reload a project from disk storage
+    // apply the refs modified out-of-band (see RefWatcher)
+    int reloadIssue(const std::string &issueId, bool rollback = false);
+    int reloadTags();
+    int reloadConfig();
+    int reloadPredefinedViews();
+    int storeCache(); // store the binary image of the project
+    inline void flushJournal() { journal.flush(); } // store the committed entries on disk
 
     // methods for database access
     inline std::string getObjectsDir() const { return path + '/' + PATH_OBJECTS; }
-    inline static std::string getObjectPath(const std::string path, const std::string &oid) {
-        return path + '/' + PATH_OBJECTS + '/' + Object::getSubpath(oid);
-    }
     inline std::string getIssuesDir() const { return path + '/' + PATH_ISSUES; }
     void getObjects(std::list<std::string> &objects) const;
 
@@ -115,7 +191,7 @@ public:
 
     std::string getTriggerCmdline() const;
 
-    Project() : maxIssueId(0) {}
+    Project() : maxIssueId(0), modifiedSinceCache(true), generation(0) {}
 
 private:
     // private member variables
@@ -128,6 +204,12 @@ private:
     mutable Locker locker; // mutex for issues and entries
     mutable Locker lockerForConfig; // mutext for config
     mutable Locker lockerForViews; // mutext for views
+    Journal journal; // new entries and refs of issues, committed outside of the locker
+    mutable TrigramIndex fullTextIndex; // candidates of the full-text searches
+    mutable FilterIndex filterIndex; // filters on select properties
+    mutable QueryCache queryCache; // results of the latest searches
+    mutable SnapshotIndex snapshotIndex; // states of the issues in the past
+    mutable EntryIndex entryIndex; // entries in the order of their ctime
 
     // associations table
     // { issue : { association-name : [other-issues] } }
@@ -136,6 +218,11 @@ private:
     // reverse associations table
     std::map<IssueId, std::map<AssociationId, std::set<IssueId> > > reverseAssociations;
 
+    // summaries of the associated issues, maintained with the associations
+    // tables and the summaries of the issues (attached to the copies of the issues)
+    std::map<IssueId, AssociationTable> associationSummaries;
+    std::map<IssueId, AssociationTable> reverseAssociationSummaries;
+
     // views
     std::map<std::string, PredefinedView> predefinedViews;
 
@@ -144,30 +231,58 @@ private:
 
     long lastModified; // date of latest entry
 
+    bool modifiedSinceCache; // issues, entries or tags modified since the cache was stored
+    uint64_t generation; // incremented by each modification of the issues, entries or tags
+    ProjectLockStats lockStats; // modified under the write lock
+    std::string cachedRefProject; // refs/project of the stored cache
+
     static const char *reservedNames[];
 
     // private member methods
     Issue *createNewIssue();
     std::string allocateNewIssueId();
     void updateMaxIssueId(uint32_t i);
-    int addNewEntry(Entry *e);
-    int addPushedEntry(Entry *e, const std::string &data);
-    int load(); // load a project: config, views, entries, tags
+    int load(); // load a project: journal, config, views, entries, tags
+    int loadContents(); // load config, views, entries, tags
+    void swapContents(Project &other);
+    static void destroyContents(void *project);
+    static void destroyIssue(void *issue);
+    inline void setModified() { modifiedSinceCache = true; generation++; }
     int loadConfig();
-    int loadIssues();
+    int loadIssues(const ProjectCache *cache, size_t &nFromCache);
+    void mergeLoadedIssue(Issue *issue, const std::string &issueId, int &localMaxId);
     void loadPredefinedViews();
-    void loadTags();
+    bool loadTags(const ProjectCache *cache);
     void computeAssociations();
     void cleanupMultiselect(std::list<std::string> &values,
                             const std::list<std::string> &selectOptions);
     int storeViewsToFile();
     Issue *getIssue(const std::string &id) const;
+    void searchUnlocked(const char *fulltextSearch,
+                        const std::map<std::string, std::list<std::string> > &filterIn,
+                        const std::map<std::string, std::list<std::string> > &filterOut,
+                        const char *sortingSpec,
+                        std::vector<IssueCopy> &returnedIssues,
+                        size_t offset, int limit, size_t *total, bool withAssociations) const;
+    static void searchProjectJob(void *arg);
+    void getSelectProperties(std::set<std::string> &names) const;
+    void getMatchingIssues(const char *fulltextSearch,
+                           const std::map<std::string, std::list<std::string> > &filterIn,
+                           const std::map<std::string, std::list<std::string> > &filterOut,
+                           std::vector<const Issue*> &matching) const;
     int insertEntryInTable(Entry *e);
+    void internSelectValues(Properties &properties) const;
     int insertIssueInTable(Issue *i);
+    void removeIssueFromTables(Issue *i);
     void updateAssociations(const Issue *i, const std::string &associationName,
                             const std::list<std::string> &issues);
+    void updateIssueAssociations(const Issue *i);
+    void updateAssociationSummaries(const IssueId &id, bool forward);
+    void updateAssociationSummariesAround(const IssueId &id);
+    void updateSummaryInAssociations(const Issue *i);
 
     void updateLastModified(Entry *e);
+    void updateLockStats(double lockTime);
     IssueCopy copyIssue(const Issue &issue) const;
 
 };
@@ -0,0 +1,261 @@
+/*   Small Issue Tracker
+ *   Copyright (C) 2013 Frederic Hoerni
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License v2 as published by
+ *   the Free Software Foundation.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ */
+#include "config.h"
+
+#include <string.h>
+
+#include "ProjectCache.h"
+#include "utils/stringTools.h"
+#include "utils/logging.h"
+#include "global.h"
+
+#define CACHE_MAGIC "SMCI"
+#define CACHE_END_MAGIC "SMCE"
+
+/** Bounded reader of the image
+  *
+  * Any read beyond the end of the image sets the error flag,
+  * and the subsequent reads return empty values.
+  */
+struct ImageReader {
+    const uint8_t *ptr;
+    const uint8_t *end;
+    bool error;
+
+    ImageReader(const char *data, size_t size) :
+        ptr((const uint8_t*)data), end((const uint8_t*)data + size), error(false) {}
+
+    bool ensure(size_t n) {
+        if (error || (size_t)(end - ptr) < n) error = true;
+        return !error;
+    }
+    void skip(size_t n) {
+        if (ensure(n)) ptr += n;
+    }
+    uint32_t u32() {
+        if (!ensure(4)) return 0;
+        uint32_t x = getU32(ptr);
+        ptr += 4;
+        return x;
+    }
+    uint64_t u64() {
+        if (!ensure(8)) return 0;
+        uint64_t x = getU64(ptr);
+        ptr += 8;
+        return x;
+    }
+    std::string str() {
+        uint32_t len = u32();
+        if (!ensure(len)) return "";
+        std::string s((const char*)ptr, len);
+        ptr += len;
+        return s;
+    }
+    bool magic(const char *m) {
+        if (!ensure(4)) return false;
+        if (0 != memcmp(ptr, m, 4)) error = true;
+        else ptr += 4;
+        return !error;
+    }
+};
+
+static void putString(std::string &out, const std::string &s)
+{
+    putU32(out, s.size());
+    out += s;
+}
+
+ProjectCache::~ProjectCache()
+{
+    image.unmap();
+}
+
+/** Map and validate the image
+  *
+  * Only the directory of the issues and the tags are decoded here.
+  * The entries of an issue are decoded by loadIssue().
+  *
+  * @return
+  *     0 success
+  *    -1 no image, or invalid image
+  */
+int ProjectCache::open(const std::string &path)
+{
+    int r = image.map(path);
+    if (r != 0) {
+        LOG_DIAG("Cannot map cache '%s'", path.c_str());
+        return -1;
+    }
+
+    ImageReader reader(image.data, image.size);
+    reader.magic(CACHE_MAGIC);
+    uint32_t version = reader.u32();
+    if (!reader.error && version != CACHE_VERSION) {
+        LOG_INFO("Ignoring cache of unsupported version %u: %s", version, path.c_str());
+        image.unmap();
+        return -1;
+    }
+
+    flags = reader.u32();
+    refProject = reader.str();
+    refTags = reader.str();
+
+    uint32_t n = reader.u32();
+    while (n-- > 0 && !reader.error) {
+        std::string issueId = reader.str();
+        IssueRecord record;
+        record.ref = reader.str();
+        record.size = reader.u32();
+        record.offset = reader.ptr - (const uint8_t*)image.data;
+        reader.skip(record.size);
+        issues[issueId] = record;
+    }
+
+    n = reader.u32();
+    while (n-- > 0 && !reader.error) {
+        std::string entryId = reader.str();
+        std::set<std::string> &entryTags = tags[entryId];
+        uint32_t nTags = reader.u32();
+        while (nTags-- > 0 && !reader.error) entryTags.insert(reader.str());
+    }
+
+    reader.magic(CACHE_END_MAGIC);
+
+    if (reader.error || reader.ptr != reader.end) {
+        LOG_ERROR("Invalid cache: %s", path.c_str());
+        issues.clear();
+        tags.clear();
+        image.unmap();
+        return -1;
+    }
+
+    return 0;
+}
+
+/** Build an issue from the image
+  *
+  * Thread-safe: the image is only read.
+  *
+  * @return
+  *     The new issue, or null if the issue is not in the image,
+  *     if its ref differs, or if its record is corrupted.
+  */
+Issue *ProjectCache::loadIssue(const std::string &issueId, const std::string &ref) const
+{
+    std::map<std::string, IssueRecord>::const_iterator record = issues.find(issueId);
+    if (record == issues.end()) return 0;
+    if (record->second.ref != ref) return 0;
+
+    ImageReader reader(image.data + record->second.offset, record->second.size);
+
+    Issue *issue = new Issue();
+    uint32_t nEntries = reader.u32();
+    while (nEntries-- > 0 && !reader.error) {
+        Entry *e = new Entry;
+        e->id = reader.str();
+        e->parent = reader.str();
+        e->ctime = (long)reader.u64();
+        e->author = reader.str();
+        uint32_t entryFlags = reader.u32();
+        if (entryFlags & ENTRY_FLAG_MESSAGE_IN_OBJECT) e->setMessageInObject();
+        uint32_t nProperties = reader.u32();
+        while (nProperties-- > 0 && !reader.error) {
+            PropertyValues &values = e->properties[reader.str()];
+            uint32_t nValues = reader.u32();
+            while (nValues-- > 0 && !reader.error) values.push_back(reader.str());
+        }
+        e->updateMessage();
+        issue->addEntryInTable(e);
+    }
+
+    if (reader.error || reader.ptr != reader.end || !issue->latest || issue->latest->id != ref) {
+        LOG_ERROR("Corrupted issue in cache: %s", issueId.c_str());
+        Entry *e = issue->first;
+        while (e) {
+            Entry *tobeDeleted = e;
+            e = e->getNext();
+            delete tobeDeleted;
+        }
+        delete issue;
+        return 0;
+    }
+
+    issue->consolidate();
+    return issue;
+}
+
+/** Serialize the issues and tags of a project
+  *
+  * Must be called from a mutex-protected scope.
+  *
+  * @param lazyMessages
+  *     Tell if the messages of the entries may have been dropped (see MessageCache)
+  */
+std::string ProjectCache::serialize(const std::string &refProject, const std::string &refTags,
+                                    const std::map<std::string, Issue*> &issues, bool lazyMessages)
+{
+    std::string out = CACHE_MAGIC;
+    putU32(out, CACHE_VERSION);
+    putU32(out, lazyMessages ? CACHE_FLAG_LAZY_MESSAGES : 0);
+    putString(out, refProject);
+    putString(out, refTags);
+
+    putU32(out, issues.size());
+    uint32_t nTagged = 0;
+    std::map<std::string, Issue*>::const_iterator i;
+    FOREACH(i, issues) {
+        const Issue *issue = i->second;
+        putString(out, i->first);
+        putString(out, issue->latest ? issue->latest->id : "");
+
+        std::string entries;
+        uint32_t nEntries = 0;
+        const Entry *e = issue->first;
+        while (e) {
+            putString(entries, e->id);
+            putString(entries, e->parent);
+            putU64(entries, (uint64_t)e->ctime);
+            putString(entries, e->author);
+            putU32(entries, e->isMessageInObject() ? ENTRY_FLAG_MESSAGE_IN_OBJECT : 0);
+            putU32(entries, e->properties.size());
+            PropertiesCIt p;
+            FOREACH(p, e->properties) {
+                putString(entries, p->first);
+                putU32(entries, p->second.size());
+                PropertyValuesIt v;
+                FOREACH(v, p->second) putString(entries, *v);
+            }
+            nEntries++;
+            e = e->getNext();
+        }
+        putU32(out, entries.size() + 4);
+        putU32(out, nEntries);
+        out += entries;
+
+        nTagged += issue->tags.size();
+    }
+
+    putU32(out, nTagged);
+    FOREACH(i, issues) {
+        std::map<std::string, std::set<std::string> >::const_iterator t;
+        FOREACH(t, i->second->tags) {
+            putString(out, t->first);
+            putU32(out, t->second.size());
+            std::set<std::string>::const_iterator tag;
+            FOREACH(tag, t->second) putString(out, *tag);
+        }
+    }
+
+    out += CACHE_END_MAGIC;
+    return out;
+}
@@ -0,0 +1,72 @@
+#ifndef _ProjectCache_h
+#define _ProjectCache_h
+
+#include <string>
+#include <map>
+#include <set>
+#include <stdint.h>
+
+#include "ObjectPack.h"
+#include "Issue.h"
+
+#define CACHE_VERSION 2
+
+#define CACHE_FLAG_LAZY_MESSAGES 0x1 // messages of entries are not in the image
+#define ENTRY_FLAG_MESSAGE_IN_OBJECT 0x1
+
+/** Binary image of the in-memory state of a project
+  *
+  * The image lets a project be loaded without parsing again the entries
+  * of the issues that did not change since the image was written.
+  * It is only a cache: it may be removed at any time.
+  *
+  * Format:
+  *     "SMCI" <version:4> <flags:4>
+  *     <ref-project> <ref-tags>     refs/project and refs/tags when written
+  *     <n-issues:4>
+  *     n-issues times:
+  *         <issue-id> <ref> <size:4> <entries:size>
+  *     <n-tagged:4>
+  *     n-tagged times:
+  *         <entry-id> <n-tags:4> <tag>...
+  *     "SMCE"
+  *
+  * <entries> is:
+  *     <n-entries:4>
+  *     n-entries times, from the first entry to the latest:
+  *         <id> <parent> <ctime:8> <author> <flags:4> <n-properties:4>
+  *         n-properties times:
+  *             <name> <n-values:4> <value>...
+  *
+  * Strings are <length:4> followed by the bytes. Integers are big-endian.
+  */
+class ProjectCache {
+public:
+    ProjectCache() : flags(0) {}
+    ~ProjectCache();
+    int open(const std::string &path);
+    inline const std::string &getRefProject() const { return refProject; }
+    inline const std::string &getRefTags() const { return refTags; }
+    inline bool hasLazyMessages() const { return flags & CACHE_FLAG_LAZY_MESSAGES; }
+    inline size_t getNumIssues() const { return issues.size(); }
+    Issue *loadIssue(const std::string &issueId, const std::string &ref) const;
+    inline const std::map<std::string, std::set<std::string> > &getTags() const { return tags; }
+
+    static std::string serialize(const std::string &refProject, const std::string &refTags,
+                                 const std::map<std::string, Issue*> &issues, bool lazyMessages);
+
+private:
+    struct IssueRecord {
+        std::string ref;
+        size_t offset;
+        size_t size;
+    };
+    MappedFile image;
+    uint32_t flags;
+    std::string refProject;
+    std::string refTags;
+    std::map<std::string, IssueRecord> issues;
+    std::map<std::string, std::set<std::string> > tags; // key: entry-id, value: tags
+};
+
+#endif
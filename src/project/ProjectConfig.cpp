@@ -19,6 +19,7 @@
 #include "utils/logging.h"
 #include "utils/filesystem.h"
 #include "utils/parseConfig.h"
+#include "Object.h"
 
 /** Convert a property type to a string
   *
@@ -299,16 +300,16 @@ PropertySpec PropertySpec::parsePropertySpec(std::list<std::string> & tokens)
     return pspec;
 }
 
-/** Load a project configuration from a file
+/** Load a project configuration from the objects database
   *
   * @param[out] config
   */
-int ProjectConfig::load(const std::string &path, ProjectConfig &config, const std::string &objid)
+int ProjectConfig::load(const std::string &objectsDir, ProjectConfig &config, const std::string &objid)
 {
     std::string data;
-    int r = loadFile(path, data);
+    int r = Object::load(objectsDir, objid, data);
     if (r != 0) {
-        LOG_ERROR("Cannot load project config '%s': %s", path.c_str(), strerror(errno));
+        LOG_ERROR("Cannot load project config '%s': %s", objid.c_str(), strerror(errno));
         return -1;
     }
 
@@ -0,0 +1,158 @@
+/*   Small Issue Tracker
+ *   Copyright (C) 2013 Frederic Hoerni
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License v2 as published by
+ *   the Free Software Foundation.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ */
+#include "config.h"
+
+#include "QueryCache.h"
+#include "global.h"
+#include "utils/stringTools.h"
+
+/** Append a field to a key of the cache
+  *
+  * The field is prefixed by its type and its length, so that
+  * a key cannot be forged by values containing separators.
+  */
+static void appendField(std::string &key, char type, const std::string &value)
+{
+    key += type;
+    key += toString((int)value.size());
+    key += ':';
+    key += value;
+}
+
+static void appendFilter(std::string &key, char mode,
+                         const std::map<std::string, std::list<std::string> > &filter)
+{
+    std::map<std::string, std::list<std::string> >::const_iterator f;
+    FOREACH(f, filter) {
+        // the values of a property are OR-ed: their order does not matter
+        std::list<std::string> values = f->second;
+        values.sort();
+        appendField(key, mode, f->first);
+        key += toString((int)values.size());
+        std::list<std::string>::const_iterator v;
+        FOREACH(v, values) appendField(key, 'v', *v);
+    }
+}
+
+/** Normalize a query into a key of the cache
+  *
+  * A null full-text search or sorting spec is the same as an empty one.
+  */
+std::string QueryCache::getKey(const char *fulltextSearch,
+                               const std::map<std::string, std::list<std::string> > &filterIn,
+                               const std::map<std::string, std::list<std::string> > &filterOut,
+                               const char *sortingSpec)
+{
+    std::string key;
+    appendField(key, 's', sortingSpec ? sortingSpec : "");
+    appendField(key, 'q', fulltextSearch ? fulltextSearch : "");
+    appendFilter(key, '+', filterIn);
+    appendFilter(key, '-', filterOut);
+    return key;
+}
+
+/** Get the result of a query
+  *
+  * @param count
+  *     number of sorted issues needed (offset + limit of the page)
+  *
+  * @param[out] issues
+  *     QUERY_HIT_SORTED: the first sorted issues (at most count)
+  *     QUERY_HIT_UNSORTED: all the matching issues, in the order of the table
+  *     of issues (to be sorted by the caller, and put back in the cache)
+  *
+  * @param[out] total
+  *     number of matching issues (if hit)
+  */
+QueryCacheStatus QueryCache::get(const std::string &key, uint64_t gen, size_t count,
+                                 std::vector<const Issue*> &issues, size_t &total)
+{
+    ScopeLocker scopeLocker(locker, LOCK_READ_WRITE);
+
+    std::map<std::string, Result>::iterator r = results.find(key);
+    if (gen != generation || r == results.end()) {
+        misses++;
+        return QUERY_MISS;
+    }
+
+    hits++;
+    lru.splice(lru.begin(), lru, r->second.lruPosition);
+    total = r->second.matching.size();
+    if (count > total) count = total;
+
+    if (r->second.sorted.size() >= count) {
+        issues.assign(r->second.sorted.begin(), r->second.sorted.begin() + count);
+        return QUERY_HIT_SORTED;
+    }
+    issues = r->second.matching;
+    return QUERY_HIT_UNSORTED;
+}
+
+/** Store the result of a query
+  *
+  * The result replaces the former result of the same query. A result of
+  * a generation older than the results of the cache is not stored.
+  */
+void QueryCache::put(const std::string &key, uint64_t gen, const std::vector<const Issue*> &matching,
+                     const std::vector<const Issue*> &sorted)
+{
+    ScopeLocker scopeLocker(locker, LOCK_READ_WRITE);
+
+    if (gen < generation) return; // the project was modified meanwhile
+    if (gen > generation) {
+        clear();
+        generation = gen;
+    }
+
+    std::map<std::string, Result>::iterator r = results.find(key);
+    if (r == results.end()) {
+        lru.push_front(key);
+        r = results.insert(std::make_pair(key, Result())).first;
+        r->second.lruPosition = lru.begin();
+    } else {
+        lru.splice(lru.begin(), lru, r->second.lruPosition);
+    }
+    r->second.matching = matching;
+    r->second.sorted = sorted;
+
+    while (results.size() > QUERY_CACHE_MAX_RESULTS) {
+        results.erase(lru.back());
+        lru.pop_back();
+    }
+}
+
+/** Drop all the results (eg: the config of the project changed)
+  */
+void QueryCache::invalidate()
+{
+    ScopeLocker scopeLocker(locker, LOCK_READ_WRITE);
+    clear();
+}
+
+/** Must be called from a mutex-protected scope
+  */
+void QueryCache::clear()
+{
+    results.clear();
+    lru.clear();
+}
+
+QueryCacheStats QueryCache::getStats() const
+{
+    ScopeLocker scopeLocker(locker, LOCK_READ_ONLY);
+    QueryCacheStats stats;
+    stats.count = results.size();
+    stats.hits = hits;
+    stats.misses = misses;
+    return stats;
+}
@@ -0,0 +1,71 @@
+#ifndef _QueryCache_h
+#define _QueryCache_h
+
+#include <string>
+#include <map>
+#include <list>
+#include <vector>
+#include <stdint.h>
+
+#include "utils/mutexTools.h"
+
+#define QUERY_CACHE_MAX_RESULTS 32 // results kept per project
+
+class Issue;
+
+struct QueryCacheStats {
+    size_t count; // number of results in the cache
+    unsigned long hits;
+    unsigned long misses;
+    QueryCacheStats() : count(0), hits(0), misses(0) {}
+};
+
+enum QueryCacheStatus {
+    QUERY_MISS,
+    QUERY_HIT_SORTED, // the first issues, sorted
+    QUERY_HIT_UNSORTED // all the matching issues, not sorted far enough
+};
+
+/** Bounded LRU cache of the results of the searches of a project
+  *
+  * A result is kept for a normalized query (full-text, filters, sorting)
+  * and a generation of the project (see Project::setModified): the
+  * matching issues, and the first of them sorted (up to the deepest page
+  * requested so far).
+  *
+  * The results store pointers to the issues, valid only under the read
+  * lock of the project, and only while the generation is unchanged. All
+  * the results are dropped when a result of a newer generation is stored,
+  * or by invalidate().
+  */
+class QueryCache {
+public:
+    static std::string getKey(const char *fulltextSearch,
+                              const std::map<std::string, std::list<std::string> > &filterIn,
+                              const std::map<std::string, std::list<std::string> > &filterOut,
+                              const char *sortingSpec);
+    QueryCache() : generation(0), hits(0), misses(0) {}
+    QueryCacheStatus get(const std::string &key, uint64_t generation, size_t count,
+                         std::vector<const Issue*> &issues, size_t &total);
+    void put(const std::string &key, uint64_t generation, const std::vector<const Issue*> &matching,
+             const std::vector<const Issue*> &sorted);
+    void invalidate();
+    QueryCacheStats getStats() const;
+
+private:
+    struct Result {
+        std::vector<const Issue*> matching; // in the order of the table of issues
+        std::vector<const Issue*> sorted; // first matching issues, sorted
+        std::list<std::string>::iterator lruPosition;
+    };
+    void clear();
+
+    uint64_t generation; // generation of the project of the results
+    unsigned long hits;
+    unsigned long misses;
+    std::map<std::string, Result> results;
+    std::list<std::string> lru; // keys, most recently used first
+    mutable Locker locker;
+};
+
+#endif
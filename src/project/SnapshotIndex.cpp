@@ -0,0 +1,199 @@
+/*   Small Issue Tracker
+ *   Copyright (C) 2013 Frederic Hoerni
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License v2 as published by
+ *   the Free Software Foundation.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ */
+#include "config.h"
+
+#include <algorithm>
+
+#include "SnapshotIndex.h"
+#include "Issue.h"
+#include "utils/dateTools.h"
+#include "utils/logging.h"
+#include "global.h"
+
+SnapshotIndex::SnapshotIndex() : built(false)
+{
+}
+
+bool SnapshotIndex::lessName(const PropertyChange &a, const PropertyChange &b)
+{
+    return a.name < b.name;
+}
+
+void SnapshotIndex::updateUnlocked(const Issue *issue)
+{
+    IssueHistory &history = histories[issue];
+    history.ctimes.clear();
+    history.maxCtimes.clear();
+    history.changes.clear();
+
+    uint32_t index = 0;
+    long maxCtime = 0;
+    for (const Entry *e = issue->first; e; e = e->getNext(), index++) {
+        if (index == 0 || e->ctime > maxCtime) maxCtime = e->ctime;
+        history.ctimes.push_back(e->ctime);
+        history.maxCtimes.push_back(maxCtime);
+
+        PropertiesCIt p;
+        FOREACH(p, e->properties) {
+            if (p->first.size() && p->first.str()[0] == '+') continue; // not consolidated (+file, +message, etc.)
+            PropertyChange change;
+            change.name = p->first;
+            change.entry = index;
+            change.e = e;
+            history.changes.push_back(change);
+        }
+    }
+
+    // the changes of each property remain in the order of the entries
+    std::stable_sort(history.changes.begin(), history.changes.end(), lessName);
+}
+
+/** Index the entries of an issue (new or modified)
+  *
+  * Does nothing if the index is not built yet.
+  */
+void SnapshotIndex::update(const Issue *issue)
+{
+    ScopeLocker scopeLocker(locker, LOCK_READ_WRITE);
+    if (built) updateUnlocked(issue);
+}
+
+/** Remove an issue from the index, before it is deleted
+  */
+void SnapshotIndex::removeIssue(const Issue *issue)
+{
+    ScopeLocker scopeLocker(locker, LOCK_READ_WRITE);
+    histories.erase(issue);
+}
+
+void SnapshotIndex::build(const std::map<std::string, Issue*> &issues)
+{
+    double t0 = getSeconds();
+
+    histories.clear();
+    size_t nChanges = 0;
+    std::map<std::string, Issue*>::const_iterator i;
+    FOREACH(i, issues) {
+        updateUnlocked(i->second);
+        nChanges += histories[i->second].changes.size();
+    }
+    built = true;
+
+    LOG_INFO("Snapshot index built: %ld issues, %ld changes (%.3fs)", L(issues.size()), L(nChanges),
+             getSeconds() - t0);
+}
+
+/** Build the index, if not built yet (see BuildLocker)
+  */
+void SnapshotIndex::buildIfNeeded(const std::map<std::string, Issue*> &issues)
+{
+    BuildLocker buildLocker(locker);
+    if (built) return;
+
+    buildLocker.lockForBuilding();
+    if (!built) build(issues); // else built by a concurrent query meanwhile
+}
+
+/** Get the properties consolidated over the first entries of an issue
+  */
+void SnapshotIndex::getProperties(const IssueHistory &history, uint32_t nEntries, Properties &properties)
+{
+    const std::vector<PropertyChange> &changes = history.changes;
+    size_t c = 0;
+    while (c < changes.size()) {
+        // the latest change of this property within the first entries
+        const PropertyChange *latest = 0;
+        size_t next = c;
+        while (next < changes.size() && changes[next].name == changes[c].name) {
+            if (changes[next].entry < nEntries) latest = &changes[next];
+            next++;
+        }
+        if (latest) {
+            PropertiesCIt p = latest->e->properties.find(latest->name);
+            if (p != latest->e->properties.end()) properties.append(*p);
+        }
+        c = next;
+    }
+}
+
+/** Get the states of the issues at several datetimes, in one pass over the issues
+  *
+  * The issues created after a datetime are not part of its snapshot. The
+  * filters are evaluated on the states of the issues (see Issue::isInFilter).
+  *
+  * @param[out] totals
+  *     number of matching issues, for each datetime
+  *
+  * @param[out] snapshots
+  *     if not null, the states of the matching issues for each datetime,
+  *     in the order of the table of issues
+  */
+void SnapshotIndex::getSnapshots(const std::map<std::string, Issue*> &issues, const std::vector<long> &datetimes,
+                                 const std::map<std::string, std::list<std::string> > &filterIn,
+                                 const std::map<std::string, std::list<std::string> > &filterOut,
+                                 std::vector<size_t> &totals, std::vector<std::vector<IssueSnapshot> > *snapshots)
+{
+    buildIfNeeded(issues);
+
+    ScopeLocker scopeLocker(locker, LOCK_READ_ONLY);
+    totals.assign(datetimes.size(), 0);
+    if (snapshots) {
+        snapshots->clear();
+        snapshots->resize(datetimes.size());
+    }
+
+    Issue state; // for evaluating the filters
+    std::map<std::string, Issue*>::const_iterator i;
+    FOREACH(i, issues) {
+        std::map<const Issue*, IssueHistory>::const_iterator h = histories.find(i->second);
+        if (h == histories.end()) continue;
+        const IssueHistory &history = h->second;
+
+        state.id = i->second->id;
+        uint32_t nEntriesOfState = 0;
+        bool matching = false;
+        for (size_t k = 0; k < datetimes.size(); k++) {
+            uint32_t nEntries = std::upper_bound(history.maxCtimes.begin(), history.maxCtimes.end(), datetimes[k]) -
+                                history.maxCtimes.begin();
+            if (nEntries == 0) continue; // the issue did not exist yet
+
+            // the state is often the same at several datetimes (eg: an issue not modified meanwhile)
+            if (nEntries != nEntriesOfState) {
+                state.properties.clear();
+                getProperties(history, nEntries, state.properties);
+                nEntriesOfState = nEntries;
+                matching = true;
+                if (!filterIn.empty() && !state.isInFilter(filterIn, FILTER_IN)) matching = false;
+                else if (!filterOut.empty() && state.isInFilter(filterOut, FILTER_OUT)) matching = false;
+            }
+            if (!matching) continue;
+
+            totals[k]++;
+            if (snapshots) {
+                IssueSnapshot snapshot;
+                snapshot.issue = i->second;
+                snapshot.mtime = history.ctimes[nEntries - 1];
+                snapshot.properties = state.properties; // shared (see Properties)
+                (*snapshots)[k].push_back(snapshot);
+            }
+        }
+    }
+}
+
+/** Exchange the contents of 2 indexes (see BuildLocker)
+  */
+void SnapshotIndex::swap(SnapshotIndex &other)
+{
+    std::swap(built, other.built);
+    histories.swap(other.histories);
+}
@@ -0,0 +1,73 @@
+#ifndef _SnapshotIndex_h
+#define _SnapshotIndex_h
+
+#include <string>
+#include <map>
+#include <list>
+#include <vector>
+#include <stdint.h>
+
+#include "utils/properties.h"
+#include "utils/mutexTools.h"
+
+class Issue;
+class Entry;
+
+/** State of an issue at the datetime of a snapshot
+  */
+struct IssueSnapshot {
+    const Issue *issue; // the current issue
+    long mtime; // ctime of the latest entry before the snapshot
+    Properties properties; // properties consolidated up to this entry
+};
+
+/** Temporal index of the changes of the properties of the issues
+  *
+  * For each issue, the index has the ctimes of its entries and the changes
+  * of its properties (property, entry that sets its values), sorted by
+  * property and then by entry. The state of an issue at a datetime is
+  * then found by binary search, instead of replaying its entries (as
+  * Issue::makeSnapshot does, with the same result):
+  * - the entries taken into account are those before the first entry
+  *   more recent than the datetime (the maximum of the ctimes of the
+  *   first entries is increasing),
+  * - the value of a property is the one set by the latest of these
+  *   entries that has this property.
+  *
+  * The index is built on the first use, and then kept up to date by the
+  * modifications of the project (see BuildLocker).
+  */
+class SnapshotIndex {
+public:
+    SnapshotIndex();
+    void update(const Issue *issue);
+    void removeIssue(const Issue *issue);
+    void getSnapshots(const std::map<std::string, Issue*> &issues, const std::vector<long> &datetimes,
+                      const std::map<std::string, std::list<std::string> > &filterIn,
+                      const std::map<std::string, std::list<std::string> > &filterOut,
+                      std::vector<size_t> &totals, std::vector<std::vector<IssueSnapshot> > *snapshots);
+    void swap(SnapshotIndex &other);
+
+private:
+    struct PropertyChange {
+        IString name;
+        uint32_t entry; // index of the entry in the issue
+        const Entry *e;
+    };
+    struct IssueHistory {
+        std::vector<long> ctimes; // ctimes of the entries
+        std::vector<long> maxCtimes; // maximum of the ctimes of the entries up to each one
+        std::vector<PropertyChange> changes; // sorted by property name, then by entry
+    };
+    void updateUnlocked(const Issue *issue);
+    void build(const std::map<std::string, Issue*> &issues);
+    void buildIfNeeded(const std::map<std::string, Issue*> &issues);
+    static bool lessName(const PropertyChange &a, const PropertyChange &b);
+    static void getProperties(const IssueHistory &history, uint32_t nEntries, Properties &properties);
+
+    bool built;
+    std::map<const Issue*, IssueHistory> histories;
+    Locker locker;
+};
+
+#endif
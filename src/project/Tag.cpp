@@ -21,12 +21,12 @@ std::string Tag::serialize() const
     return s.str();
 }
 
-Tag *Tag::load(const std::string &path, const std::string &id)
+Tag *Tag::load(const std::string &objectsDir, const std::string &id)
 {
     std::string data;
-    int r = loadFile(path, data);
+    int r = Object::load(objectsDir, id, data);
     if (r != 0) {
-        LOG_ERROR("Cannot load tag '%s': %s", path.c_str(), STRERROR(errno));
+        LOG_ERROR("Cannot load tag '%s': %s", id.c_str(), STRERROR(errno));
         return 0;
     }
     std::list<std::list<std::string> > tokens = parseConfigTokens(data.c_str(), data.size());
@@ -48,7 +48,7 @@ Tag *Tag::load(const std::string &path, const std::string &id)
     }
 
     if (tag->tagName.empty() || tag->entryId.empty()) {
-        LOG_ERROR("Incomplete tag in '%s': tagName=%s, entryId=%s", path.c_str(), tag->tagName.c_str(),
+        LOG_ERROR("Incomplete tag in '%s': tagName=%s, entryId=%s", id.c_str(), tag->tagName.c_str(),
                   tag->entryId.c_str());
         delete tag;
         return 0;
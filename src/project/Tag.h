@@ -13,7 +13,7 @@ public:
     std::string entryId;
     std::string tagName;
     std::string serialize() const;
-    static Tag *load(const std::string &path, const std::string &id);
+    static Tag *load(const std::string &objectsDir, const std::string &id);
 };
 
 struct TagSpec {
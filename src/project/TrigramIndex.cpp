@@ -0,0 +1,256 @@
+/*   Small Issue Tracker
+ *   Copyright (C) 2013 Frederic Hoerni
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License v2 as published by
+ *   the Free Software Foundation.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ */
+#include "config.h"
+
+#include <string.h>
+#include <ctype.h>
+#include <algorithm>
+#include <iterator>
+
+#include "TrigramIndex.h"
+#include "Issue.h"
+#include "Entry.h"
+#include "utils/stringTools.h"
+#include "utils/dateTools.h"
+#include "utils/logging.h"
+#include "global.h"
+
+TrigramIndex::TrigramIndex() : built(false)
+{
+}
+
+/** Case-fold a character, the same way as findNoCase
+  */
+static inline uint32_t fold(char c)
+{
+    return (uint32_t)tolower((unsigned char)c);
+}
+
+/** Append the case-folded trigrams of a text
+  *
+  * The text is taken up to its first null character, as findNoCase(text, pattern) does.
+  */
+void TrigramIndex::getTrigrams(const char *text, std::vector<Trigram> &trigrams)
+{
+    size_t n = strlen(text);
+    if (n < 3) return;
+
+    Trigram t = (fold(text[0]) << 8) | fold(text[1]);
+    for (size_t i = 2; i < n; i++) {
+        t = ((t << 8) | fold(text[i])) & 0xffffff;
+        trigrams.push_back(t);
+    }
+}
+
+/** Append the trigrams of the id and of the properties of an issue
+  */
+void TrigramIndex::getIssueTrigrams(const Issue *issue, std::vector<Trigram> &trigrams)
+{
+    getTrigrams(issue->id.c_str(), trigrams);
+
+    PropertiesCIt p;
+    FOREACH(p, issue->properties) {
+        PropertyValuesIt value;
+        FOREACH(value, p->second) getTrigrams(value->c_str(), trigrams);
+    }
+}
+
+/** Append the trigrams of the message, files and author of an entry
+  */
+void TrigramIndex::getEntryTrigrams(const Entry *e, std::vector<Trigram> &trigrams)
+{
+    std::string holder;
+    if (e->isAmending()) {
+        // the message of the amending entry replaces the message of the amended entry
+        getTrigrams(e->getOwnMessage(holder).c_str(), trigrams);
+        return;
+    }
+
+    getTrigrams(e->getMessage(holder).c_str(), trigrams);
+
+    PropertiesCIt files = e->properties.find(K_FILE);
+    if (files != e->properties.end()) {
+        PropertyValuesIt f;
+        FOREACH(f, files->second) getTrigrams(f->c_str(), trigrams);
+    }
+
+    getTrigrams(e->author.c_str(), trigrams);
+}
+
+/** Get the id of the document of an issue, allocating it if needed
+  */
+TrigramIndex::DocId TrigramIndex::getDocId(const Issue *issue)
+{
+    std::map<const Issue*, DocId>::const_iterator d = docIds.find(issue);
+    if (d != docIds.end()) return d->second;
+
+    DocId doc = docs.size();
+    docs.push_back(issue);
+    docIds[issue] = doc;
+    return doc;
+}
+
+/** Add a document to the postings of trigrams
+  *
+  * The trigrams are sorted and deduplicated in place.
+  */
+void TrigramIndex::addTrigrams(DocId doc, std::vector<Trigram> &trigrams)
+{
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+    std::vector<Trigram>::const_iterator t;
+    FOREACH(t, trigrams) {
+        std::vector<DocId> &posting = postings[*t];
+        if (posting.empty() || posting.back() < doc) {
+            posting.push_back(doc); // usual case: the document is the latest one
+        } else {
+            std::vector<DocId>::iterator it = std::lower_bound(posting.begin(), posting.end(), doc);
+            if (it == posting.end() || *it != doc) posting.insert(it, doc);
+        }
+    }
+}
+
+void TrigramIndex::addIssueUnlocked(const Issue *issue)
+{
+    std::vector<Trigram> trigrams;
+    getIssueTrigrams(issue, trigrams);
+    for (const Entry *e = issue->first; e; e = e->getNext()) {
+        getEntryTrigrams(e, trigrams);
+    }
+    addTrigrams(getDocId(issue), trigrams);
+}
+
+/** Index all the searchable texts of an issue
+  *
+  * Does nothing if the index is not built yet.
+  */
+void TrigramIndex::addIssue(const Issue *issue)
+{
+    ScopeLocker scopeLocker(locker, LOCK_READ_WRITE);
+    if (built) addIssueUnlocked(issue);
+}
+
+/** Index the id and the properties of an issue, and a new entry of this issue
+  *
+  * @param newEntry
+  *     may be null (eg: if the issue has been renamed)
+  *
+  * Does nothing if the index is not built yet.
+  */
+void TrigramIndex::update(const Issue *issue, const Entry *newEntry)
+{
+    ScopeLocker scopeLocker(locker, LOCK_READ_WRITE);
+    if (built) {
+        std::vector<Trigram> trigrams;
+        getIssueTrigrams(issue, trigrams);
+        if (newEntry) getEntryTrigrams(newEntry, trigrams);
+        addTrigrams(getDocId(issue), trigrams);
+    }
+}
+
+/** Remove an issue from the index, before it is deleted
+  *
+  * Its document id is not reused, and remains in the postings.
+  */
+void TrigramIndex::removeIssue(const Issue *issue)
+{
+    ScopeLocker scopeLocker(locker, LOCK_READ_WRITE);
+    std::map<const Issue*, DocId>::iterator d = docIds.find(issue);
+    if (d != docIds.end()) {
+        docs[d->second] = 0;
+        docIds.erase(d);
+    }
+}
+
+/** Build the index, if not built yet (see BuildLocker)
+  */
+void TrigramIndex::buildIfNeeded(const std::map<std::string, Issue*> &issues)
+{
+    BuildLocker buildLocker(locker);
+    if (built) return;
+
+    buildLocker.lockForBuilding();
+    if (built) return; // built by a concurrent search meanwhile
+
+    double t0 = getSeconds();
+    std::map<std::string, Issue*>::const_iterator i;
+    FOREACH(i, issues) addIssueUnlocked(i->second);
+    built = true;
+    LOG_INFO("Full-text index built: %ld issues, %ld trigrams (%.3fs)", L(issues.size()),
+             L(postings.size()), getSeconds() - t0);
+}
+
+/** Get the issues that may contain a text
+  *
+  * The index is built from the issues on the first call.
+  *
+  * @return
+  *     true if the candidates have been computed
+  *     false if the index cannot select the issues (no text, or text shorter
+  *           than a trigram): all the issues are candidates
+  */
+bool TrigramIndex::getCandidates(const std::map<std::string, Issue*> &issues, const char *text,
+                                 std::vector<const Issue*> &candidates)
+{
+    if (!text) return false;
+
+    std::vector<Trigram> trigrams;
+    getTrigrams(text, trigrams);
+    if (trigrams.empty()) return false;
+
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+    buildIfNeeded(issues);
+
+    ScopeLocker scopeLocker(locker, LOCK_READ_ONLY);
+
+    // get the postings, shortest first
+    std::vector<std::pair<size_t, const std::vector<DocId>*> > lists;
+    std::vector<Trigram>::const_iterator t;
+    FOREACH(t, trigrams) {
+        std::map<Trigram, std::vector<DocId> >::const_iterator posting = postings.find(*t);
+        if (posting == postings.end()) {
+            // no issue contains this trigram
+            return true;
+        }
+        lists.push_back(std::make_pair(posting->second.size(), &posting->second));
+    }
+    std::sort(lists.begin(), lists.end());
+
+    // intersect the postings
+    std::vector<DocId> result = *lists[0].second;
+    for (size_t k = 1; k < lists.size() && !result.empty(); k++) {
+        std::vector<DocId> intersection;
+        std::set_intersection(result.begin(), result.end(), lists[k].second->begin(), lists[k].second->end(),
+                              std::back_inserter(intersection));
+        result.swap(intersection);
+    }
+
+    std::vector<DocId>::const_iterator doc;
+    FOREACH(doc, result) {
+        if (docs[*doc]) candidates.push_back(docs[*doc]);
+    }
+    return true;
+}
+
+/** Exchange the contents of 2 indexes (see BuildLocker)
+  */
+void TrigramIndex::swap(TrigramIndex &other)
+{
+    std::swap(built, other.built);
+    postings.swap(other.postings);
+    docs.swap(other.docs);
+    docIds.swap(other.docIds);
+}
@@ -0,0 +1,57 @@
+#ifndef _TrigramIndex_h
+#define _TrigramIndex_h
+
+#include <string>
+#include <map>
+#include <vector>
+#include <stdint.h>
+
+#include "utils/mutexTools.h"
+
+class Issue;
+class Entry;
+
+/** Inverted index of the trigrams of the searchable texts of the issues
+  *
+  * The searchable texts are those looked through by Issue::searchFullText:
+  * id, values of the properties, and messages, file names and authors of
+  * the entries. The trigrams are case-folded the same way as findNoCase.
+  *
+  * The index gives a superset of the issues that contain a text: the
+  * texts that are no longer searchable (eg: replaced property values)
+  * are not removed from the index. The candidates must then be verified
+  * by Issue::searchFullText.
+  *
+  * The index is built on the first search (not at the loading, in order
+  * not to fetch all the lazy messages), and then kept up to date by the
+  * modifications of the project (see BuildLocker).
+  */
+class TrigramIndex {
+public:
+    TrigramIndex();
+    void addIssue(const Issue *issue);
+    void update(const Issue *issue, const Entry *newEntry);
+    void removeIssue(const Issue *issue);
+    bool getCandidates(const std::map<std::string, Issue*> &issues, const char *text,
+                       std::vector<const Issue*> &candidates);
+    void swap(TrigramIndex &other);
+
+private:
+    typedef uint32_t Trigram;
+    typedef uint32_t DocId;
+    static void getTrigrams(const char *text, std::vector<Trigram> &trigrams);
+    static void getIssueTrigrams(const Issue *issue, std::vector<Trigram> &trigrams);
+    static void getEntryTrigrams(const Entry *e, std::vector<Trigram> &trigrams);
+    DocId getDocId(const Issue *issue);
+    void addIssueUnlocked(const Issue *issue);
+    void buildIfNeeded(const std::map<std::string, Issue*> &issues);
+    void addTrigrams(DocId doc, std::vector<Trigram> &trigrams);
+
+    bool built;
+    std::map<Trigram, std::vector<DocId> > postings; // sorted ids of the documents containing each trigram
+    std::vector<const Issue*> docs; // indexed by DocId, null if the issue was removed
+    std::map<const Issue*, DocId> docIds;
+    Locker locker;
+};
+
+#endif
@@ -16,6 +16,7 @@
 #include "global.h"
 #include "utils/logging.h"
 #include "utils/parseConfig.h"
+#include "Object.h"
 #include "utils/filesystem.h"
 
 /** @param filter
@@ -166,6 +167,10 @@ PredefinedView PredefinedView::loadFromQueryString(const std::string &q)
     std::string limit = getFirstParamFromQueryString(q, "limit");
     if (!limit.empty()) v.limit = atoi(limit.c_str());
     else v.limit = -1; // no limit
+    std::string offset = getFirstParamFromQueryString(q, "offset");
+    int n = atoi(offset.c_str());
+    if (n > 0) v.offset = n;
+    else v.offset = 0;
     return v;
 }
 
@@ -211,16 +216,17 @@ std::string PredefinedView::serializeViews(const std::map<std::string, Predefine
     return out;
 }
 
-/** Load views from a file
+/** Load views from the objects database
   *
   * @param[out] views
   */
-int PredefinedView::loadViews(const std::string &path, std::map<std::string, PredefinedView> &views)
+int PredefinedView::loadViews(const std::string &objectsDir, const std::string &id,
+                              std::map<std::string, PredefinedView> &views)
 {
     std::string contents;
-    int n = loadFile(path.c_str(), contents);
+    int n = Object::load(objectsDir, id, contents);
     if (n != 0) {
-        LOG_ERROR("Cannot load views '%s': %s", path.c_str(), strerror(errno));
+        LOG_ERROR("Cannot load views '%s': %s", id.c_str(), strerror(errno));
         return -1;
     }
 
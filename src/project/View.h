@@ -21,10 +21,11 @@ struct PredefinedView {
     std::string colspec;
     std::string sort;
     std::string search;
-    int limit;
+    int limit; // maximum number of returned items (-1 for no limit)
+    size_t offset; // number of matching items skipped before the returned ones
     bool isDefault; // indicate if this view should be chosen by default when query string is empty
 
-    PredefinedView() : limit(-1), isDefault(false) {}
+    PredefinedView() : limit(-1), offset(0), isDefault(false) {}
     static std::string getDirectionName(bool d);
     static std::string getDirectionSign(const std::string &text);
     std::string generateQueryString() const;
@@ -35,7 +36,7 @@ struct PredefinedView {
     static void parsePredefinedViews(std::list<std::list<std::string> > lines,
                                      std::map<std::string, PredefinedView> &views);
 
-    static int loadViews(const std::string &path, std::map<std::string, PredefinedView> &views);
+    static int loadViews(const std::string &objectsDir, const std::string &id, std::map<std::string, PredefinedView> &views);
     static std::map<std::string, PredefinedView> getDefaultViews();
 
 };
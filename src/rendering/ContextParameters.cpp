@@ -49,4 +49,8 @@ void ContextParameters::init(const ResponseContext *request, const User &u)
     req = request;
     originView = 0;
     userRole = ROLE_NONE;
+    limit = -1;
+    offset = 0;
+    nIssuesFound = 0;
+    facets = 0;
 }
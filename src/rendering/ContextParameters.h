@@ -18,6 +18,10 @@ public:
     std::string sort;
     std::map<std::string, std::list<std::string> > filterin;
     std::map<std::string, std::list<std::string> > filterout;
+    int limit; // size of the pages of a list of issues (-1 for no pagination)
+    size_t offset; // offset of the current page of a list of issues
+    size_t nIssuesFound; // number of issues of the list, including those of the other pages
+    const FacetCounts *facets; // numbers of issues of the list per value of some properties (optional)
 
     // project parameters
     std::string projectPath; // empty if no project defined
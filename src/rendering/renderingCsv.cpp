@@ -103,11 +103,8 @@ void RCsv::printIssueList(const RequestContext *req, const std::vector<IssueCopy
             else if (column == "ctime") text = epochToString(i->ctime);
             else if (column == "mtime") text = epochToString(i->mtime);
             else {
-                std::map<std::string, std::list<std::string> >::const_iterator p;
-                const std::map<std::string, std::list<std::string> > & properties = i->properties;
-
-                p = properties.find(column);
-                if (p != properties.end()) text = toString(p->second);
+                PropertiesCIt p = i->properties.find(column);
+                if (p != i->properties.end()) text = toString(p->second);
             }
 
             req->printf("%s", doubleQuoteCsv(text).c_str());
@@ -150,7 +147,7 @@ void RCsv::printIssue(const RequestContext *req, const IssueCopy &issue, const P
     req->printf("\r\n"); // new line
 
     // print entries
-    PropertiesIt pit;
+    PropertiesCIt pit;
     Entry *e = issue.first;
     while (e) {
         // author
@@ -169,10 +166,9 @@ void RCsv::printIssue(const RequestContext *req, const IssueCopy &issue, const P
 
         // message
         req->printf("%s", separator);
-        pit = e->properties.find(K_MESSAGE);
-        if (pit != e->properties.end()) {
-            req->printf("%s", doubleQuoteCsv(toString(pit->second)).c_str());
-        }
+        std::string holder;
+        const std::string &message = e->getOwnMessage(holder);
+        if (!message.empty()) req->printf("%s", doubleQuoteCsv(message).c_str());
 
         // files
         req->printf("%s", separator);
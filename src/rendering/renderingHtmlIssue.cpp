@@ -48,14 +48,74 @@ static std::string renderIssueSummary(const ContextParameters &ctx, const IssueC
     return ss.str();
 }
 
+/** Print the number of issues found, and the links to the other pages if the list is paginated
+  */
+static void printIssuesCount(const ContextParameters &ctx, const std::vector<IssueCopy> &issueList)
+{
+    size_t nFound = issueList.size();
+    if (ctx.limit >= 0) nFound = ctx.nIssuesFound;
+    ctx.req->printf("<div class=\"sm_issues_count\">%s: <span class=\"sm_issues_count\">%lu</span></div>\n",
+                    _("Issues found"), L(nFound));
+
+    if (ctx.limit < 0) return;
+
+    std::string qs = ctx.req->getQueryString();
+    ctx.req->printf("<div class=\"sm_issues_pages\">");
+    if (ctx.offset > 0) {
+        size_t previous = 0;
+        if (ctx.offset > (size_t)ctx.limit) previous = ctx.offset - ctx.limit;
+        ctx.req->printf("<a href=\"?%s\" class=\"sm_issues_page_previous\">&lt; %s</a> ",
+                        getQsPage(qs, previous).c_str(), _("Previous"));
+    }
+    if (!issueList.empty()) {
+        ctx.req->printf("<span class=\"sm_issues_page_range\">%lu-%lu</span>",
+                        L(ctx.offset + 1), L(ctx.offset + issueList.size()));
+    }
+    if (ctx.offset + issueList.size() < ctx.nIssuesFound) {
+        ctx.req->printf(" <a href=\"?%s\" class=\"sm_issues_page_next\">%s &gt;</a>",
+                        getQsPage(qs, ctx.offset + issueList.size()).c_str(), _("Next"));
+    }
+    ctx.req->printf("</div>\n");
+}
+
+/** Print the numbers of issues per value of some properties (facets), if requested
+  *
+  * Each value links to the list restricted to this value.
+  */
+static void printFacets(const ContextParameters &ctx)
+{
+    if (!ctx.facets) return;
+
+    std::string qs = getQsPage(ctx.req->getQueryString(), 0);
+    if (!qs.empty()) qs += '&';
+
+    ctx.req->printf("<div class=\"sm_issues_facets\">\n");
+    const FacetCounts &facets = *ctx.facets;
+    FacetCounts::const_iterator facet;
+    FOREACH(facet, facets) {
+        ctx.req->printf("<div class=\"sm_issues_facet\"><span class=\"sm_issues_facet_name\">%s</span>\n",
+                        htmlEscape(ctx.projectConfig.getLabelOfProperty(facet->first)).c_str());
+        std::map<std::string, size_t>::const_iterator value;
+        FOREACH(value, facet->second) {
+            std::string filter = "filterin=" + urlEncode(facet->first) + ':' + urlEncode(value->first);
+            std::string label = value->first;
+            if (label.empty()) label = _("(none)");
+            ctx.req->printf("<a href=\"?%s\" class=\"sm_issues_facet_value\">%s</a> "
+                            "<span class=\"sm_issues_facet_count\">%lu</span><br>\n",
+                            (qs + filter).c_str(), htmlEscape(label).c_str(), L(value->second));
+        }
+        ctx.req->printf("</div>\n");
+    }
+    ctx.req->printf("</div>\n");
+}
+
 void RHtmlIssue::printIssueListFullContents(const ContextParameters &ctx, const std::vector<IssueCopy> &issueList)
 {
     ctx.req->printf("<div class=\"sm_issues\">\n");
 
     printFilters(ctx);
     // number of issues
-    ctx.req->printf("<div class=\"sm_issues_count\">%s: <span class=\"sm_issues_count\">%lu</span></div>\n",
-                    _("Issues found"), L(issueList.size()));
+    printIssuesCount(ctx, issueList);
 
     std::vector<IssueCopy>::const_iterator i;
     FOREACH (i, issueList) {
@@ -85,8 +145,8 @@ void RHtmlIssue::printIssueList(const ContextParameters &ctx, const std::vector<
     printFilters(ctx);
 
     // number of issues
-    ctx.req->printf("<div class=\"sm_issues_count\">%s: <span class=\"sm_issues_count\">%lu</span></div>\n",
-                    _("Issues found"), L(issueList.size()));
+    printIssuesCount(ctx, issueList);
+    printFacets(ctx);
 
     PropertyType groupPropertyType;
     std::string group = getPropertyForGrouping(ctx.projectConfig, ctx.sort, groupPropertyType);
@@ -151,11 +211,8 @@ void RHtmlIssue::printIssueList(const ContextParameters &ctx, const std::vector<
             else if (column == "mtime") text << epochToStringDelta(i->mtime);
             else if (column == "p") text << i->project;
             else {
-                std::map<std::string, std::list<std::string> >::const_iterator p;
-                const std::map<std::string, std::list<std::string> > & properties = i->properties;
-
-                p = properties.find(column);
-                if (p != properties.end()) text << toString(p->second);
+                PropertiesCIt p = i->properties.find(column);
+                if (p != i->properties.end()) text << toString(p->second);
             }
             // add href if column is 'id' or 'summary'
             std::string href_lhs = "";
@@ -234,8 +291,8 @@ static std::string renderAssociations(const ContextParameters &ctx, const std::s
     ss.printf("<td class=\"sm_issue_plabel\">%s: </td>", htmlEscape(label).c_str());
     ss.printf("<td colspan=\"3\" class=\"sm_issue_asso\">");
 
-    std::map<AssociationId, std::set<IssueSummary> >::const_iterator ait;
-    const std::map<AssociationId, std::set<IssueSummary> > *atable;
+    AssociationTable::const_iterator ait;
+    const AssociationTable *atable;
     if (reverse) atable = &i.reverseAssociations;
     else atable = &i.associations;
 
@@ -280,7 +337,7 @@ std::string RHtmlIssue::renderPropertiesTable(const ContextParameters &ctx, cons
         enum PropertyType type = pspec->type;
 
         // take the value of this property
-        std::map<std::string, std::list<std::string> >::const_iterator p = issue.properties.find(pname);
+        PropertiesCIt p = issue.properties.find(pname);
 
         // if the property is an association, but with no value (ie: no associated issue), then do not display
         if (type == F_ASSOCIATION) {
@@ -364,7 +421,7 @@ std::string RHtmlIssue::renderPropertiesTable(const ContextParameters &ctx, cons
 
     // reverse associated issues, if any
     if (!issue.reverseAssociations.empty()) {
-        std::map<AssociationId, std::set<IssueSummary> >::const_iterator ra;
+        AssociationTable::const_iterator ra;
         FOREACH(ra, issue.reverseAssociations) {
             if (ra->second.empty()) continue;
             if (!ctx.projectConfig.isValidPropertyName(ra->first)) continue;
@@ -429,8 +486,9 @@ std::string RHtmlIssue::getEntryExtraStyles(const ProjectConfig &pconfig, const
 
     // look if class sm_no_contents is applicable
     // an entry has no contents if no message and no file
-    if (ee.getMessage().empty() || ee.isAmending()) {
-        std::map<std::string, std::list<std::string> >::const_iterator files = ee.properties.find(K_FILE);
+    std::string holder;
+    if (ee.getMessage(holder).empty() || ee.isAmending()) {
+        PropertiesCIt files = ee.properties.find(K_FILE);
         if (files == ee.properties.end() || files->second.empty()) {
             extraStyles += " sm_entry_no_contents";
         }
@@ -546,7 +604,8 @@ std::string RHtmlIssue::renderEntry(const ContextParameters &ctx, const IssueCop
 
     ss.printf("</div>\n"); // end header
 
-    std::string m = ee.getMessage();
+    std::string holder;
+    const std::string &m = ee.getMessage(holder);
     if (! m.empty() && !ee.isAmending()) {
         ss.printf("<div class=\"sm_entry_message\">");
         ss.printf("%s\n", convertToRichText(htmlEscape(m)).c_str());
@@ -555,10 +614,10 @@ std::string RHtmlIssue::renderEntry(const ContextParameters &ctx, const IssueCop
 
 
     // uploaded / attached files
-    std::map<std::string, std::list<std::string> >::const_iterator files = ee.properties.find(K_FILE);
+    PropertiesCIt files = ee.properties.find(K_FILE);
     if (files != ee.properties.end() && files->second.size() > 0) {
         ss.printf("<div class=\"sm_entry_files\">\n");
-        std::list<std::string>::const_iterator itf;
+        PropertyValuesIt itf;
         FOREACH(itf, files->second) {
             std::string f = *itf;
             std::string objectId = popToken(f, '/');
@@ -573,9 +632,10 @@ std::string RHtmlIssue::renderEntry(const ContextParameters &ctx, const IssueCop
             }
             ss.printf("%s", htmlEscape(basename).c_str());
             // size of the file
-            std::string path = Project::getObjectPath(ctx.projectPath, objectId);
-            std::string size = getFileSize(path);
-            ss.printf("<span> (%s)</span>", size.c_str());
+            std::string objectsDir = ctx.projectPath + '/' + PATH_OBJECTS;
+            long size = Object::getSize(objectsDir, objectId);
+            std::string sizeStr = (size < 0) ? _("N/A") : formatFileSize(size);
+            ss.printf("<span> (%s)</span>", sizeStr.c_str());
             ss.printf("</a>");
             ss.printf("</div>\n"); // end file
         }
@@ -624,10 +684,20 @@ std::string RHtmlIssue::printOtherProperties(const ContextParameters &ctx, const
     std::ostringstream otherProperties;
     StringStream ss;
 
+    const Properties *properties = &ee.properties;
+    Properties propertiesWithMessage;
+    if (printMessageHeading && ee.isMessageInObject()) {
+        // the message is not resident
+        propertiesWithMessage = ee.properties;
+        std::string holder;
+        propertiesWithMessage[K_MESSAGE].push_back(ee.getOwnMessage(holder));
+        properties = &propertiesWithMessage;
+    }
+
     // process summary first as it is not part of orderedFields
-    PropertiesIt p;
+    PropertiesCIt p;
     bool first = true;
-    FOREACH(p, ee.properties) {
+    FOREACH(p, (*properties)) {
 
         if (p->first == K_MESSAGE && !printMessageHeading) continue;
 
@@ -709,7 +779,8 @@ void RHtmlIssue::printEditMessage(const ContextParameters &ctx, const IssueCopy
     ctx.req->printf("<input type=\"hidden\" value=\"%s\" name=\"%s\">", urlEncode(eToBeAmended.id).c_str(), K_AMEND);
     ctx.req->printf("<table class=\"sm_issue_properties\">");
 
-    printFormMessage(ctx, eToBeAmended.getMessage());
+    std::string holder;
+    printFormMessage(ctx, eToBeAmended.getMessage(holder));
 
     ctx.req->printf("<tr><td></td>\n");
     ctx.req->printf("<td colspan=\"3\">\n");
@@ -780,7 +851,7 @@ void RHtmlIssue::printIssueForm(const ContextParameters &ctx, const IssueCopy *i
         std::string pname = pspec->name;
         std::string label = pconfig.getLabelOfProperty(pname);
 
-        std::map<std::string, std::list<std::string> >::const_iterator p = issue->properties.find(pname);
+        PropertiesCIt p = issue->properties.find(pname);
         std::list<std::string> propertyValues;
         if (p!=issue->properties.end()) propertyValues = p->second;
 
@@ -27,6 +27,28 @@ std::string getQsAddFilterOut(std::string qs, const std::string &propertyName, c
 	return qs;
 }
 
+/** Modify the query string so that it points to the page at the given offset
+  *
+  * The existing offset, if any, is replaced.
+  */
+std::string getQsPage(std::string qs, size_t offset)
+{
+    const char *OFFSET_HEADER = "offset=";
+    std::string result;
+    while (qs.size() > 0) {
+        std::string part = popToken(qs, '&');
+        if (part.empty()) continue;
+        if (0 == strncmp(OFFSET_HEADER, part.c_str(), strlen(OFFSET_HEADER))) continue;
+        if (!result.empty()) result += '&';
+        result += part;
+    }
+    if (offset > 0) {
+        if (!result.empty()) result += '&';
+        result += OFFSET_HEADER + toString((int)offset);
+    }
+    return result;
+}
+
 /** Modify the query string by removing the given property from the colspec
   *
   * @param qs
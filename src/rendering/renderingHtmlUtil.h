@@ -10,6 +10,7 @@
 #define QS_GOTO_PREVIOUS "previous"
 
 std::string getQsAddFilterOut(std::string qs, const std::string &propertyName, const std::string &propertyValue);
+std::string getQsPage(std::string qs, size_t offset);
 std::string getQsRemoveColumn(std::string qs, const std::string &property, const std::list<std::string> &defaultCols);
 std::string getQsSubSorting(std::string qs, const std::string &property, bool exclusive);
 std::string getPropertyForGrouping(const ProjectConfig &pconfig, const std::string &sortingSpec, PropertyType &type);
@@ -47,11 +47,8 @@ void RJson::printIssueList(const RequestContext *req, const std::vector<IssueCop
             else if (column == "ctime") text = toString(i->ctime);
             else if (column == "mtime") text = toString(i->mtime);
             else {
-                std::map<std::string, std::list<std::string> >::const_iterator p;
-                const std::map<std::string, std::list<std::string> > & properties = i->properties;
-
-                p = properties.find(column);
-                if (p != properties.end()) text = toString(p->second);
+                PropertiesCIt p = i->properties.find(column);
+                if (p != i->properties.end()) text = toString(p->second);
             }
             if (c != colspec.begin()) singleIssueJson += ", ";
             singleIssueJson += toJsonString(text);
@@ -69,7 +66,7 @@ void RJson::printIssueList(const RequestContext *req, const std::vector<IssueCop
     req->printf("%s", issuesJson.c_str());
 }
 
-static std::string propertyToJson(PropertiesIt pit)
+static std::string propertyToJson(PropertiesCIt pit)
 {
     std::string result = toJsonString(pit->first) + ":";
     if (pit->second.size() == 1) {
@@ -116,18 +113,17 @@ static void printEntries(const RequestContext *req, const std::vector<Entry> &en
 
         entryJson += ",";
 
-        std::string message;
         std::string amend;
         std::list<std::string> files;
 
         // properties
         entryJson += toJsonString("properties") + ":{";
-        PropertiesIt p;
-        const PropertiesMap & properties = e->properties;
+        PropertiesCIt p;
+        const Properties &properties = e->properties;
         bool needsComma = false;
         for (p=properties.begin(); p!=properties.end(); p++) {
             std::string pname = p->first;
-            if (pname == K_MESSAGE && p->second.size()) message = p->second.front();
+            if (pname == K_MESSAGE) continue; // handled below
             else if (pname == K_AMEND && p->second.size()) amend = p->second.front();
             else if (pname == K_FILE) files = p->second;
             else {
@@ -140,6 +136,8 @@ static void printEntries(const RequestContext *req, const std::vector<Entry> &en
         entryJson += "}";
 
         // message
+        std::string holder;
+        const std::string &message = e->getOwnMessage(holder);
         if (message.size()) {
             entryJson += "," + toJsonString("message") + ":";
             entryJson += toJsonString(message);
@@ -176,7 +174,7 @@ void RJson::printIssue(const RequestContext *req, const IssueCopy &issue)
 
     req->printf("{\"properties\":");
     std::string issueProperties = "{";
-    PropertiesIt pit;
+    PropertiesCIt pit;
     FOREACH(pit, issue.properties) {
         if (pit != issue.properties.begin()) issueProperties += ",";
         issueProperties += propertyToJson(pit);
@@ -204,3 +202,24 @@ void RJson::printEntryList(const RequestContext *req, const std::vector<Entry> &
     printEntries(req, entries);
 }
 
+/** Print the numbers of issues per value of some properties
+  *
+  * Eg: {"total":12,"facets":{"status":{"closed":8,"open":4}}}
+  */
+void RJson::printFacets(const RequestContext *req, size_t total, const FacetCounts &facets)
+{
+    req->printf("Content-Type: " CONTENT_TYPE_JSON "\r\n\r\n");
+    req->printf("{\"total\":%lu,\"facets\":{", L(total));
+    FacetCounts::const_iterator facet;
+    FOREACH(facet, facets) {
+        if (facet != facets.begin()) req->printf(",");
+        req->printf("\n%s:{", toJsonString(facet->first).c_str());
+        std::map<std::string, size_t>::const_iterator value;
+        FOREACH(value, facet->second) {
+            if (value != facet->second.begin()) req->printf(",");
+            req->printf("%s:%lu", toJsonString(value->first).c_str(), L(value->second));
+        }
+        req->printf("}");
+    }
+    req->printf("}}\n");
+}
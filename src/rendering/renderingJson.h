@@ -6,6 +6,7 @@
 
 #include "server/HttpContext.h"
 #include "project/Issue.h"
+#include "project/Project.h"
 
 class RJson {
 public:
@@ -13,6 +14,7 @@ public:
                                std::list<std::string> colspec);
     static void printIssue(const RequestContext *req, const IssueCopy &issue);
     static void printEntryList(const RequestContext *req, const std::vector<Entry> &entries);
+    static void printFacets(const RequestContext *req, size_t total, const FacetCounts &facets);
 };
 
 #endif
@@ -53,11 +53,8 @@ void RText::printIssueList(const RequestContext *req, const std::vector<IssueCop
             else if (column == "ctime") text = epochToString(i->ctime);
             else if (column == "mtime") text = epochToString(i->mtime);
             else {
-                std::map<std::string, std::list<std::string> >::const_iterator p;
-                const std::map<std::string, std::list<std::string> > & properties = i->properties;
-
-                p = properties.find(column);
-                if (p != properties.end()) text = toString(p->second);
+                PropertiesCIt p = i->properties.find(column);
+                if (p != i->properties.end()) text = toString(p->second);
             }
 
             req->printf("%s", text.c_str());
@@ -67,9 +67,9 @@ static int attachFiles(const ContextParameters &ctx, struct archive *a, const st
     Entry *e = issue.first;
     std::set<std::string> sentFiles; // used to detect duplicated files (same name)
     while (e) {
-        PropertiesIt files = e->properties.find(K_FILE);
+        PropertiesCIt files = e->properties.find(K_FILE);
         if (files != e->properties.end()) {
-            std::list<std::string>::const_iterator f;
+            PropertyValuesIt f;
             FOREACH(f, files->second) {
                 std::string fname = *f;
                 std::string objectId = popToken(fname, '/');
@@ -83,7 +83,7 @@ static int attachFiles(const ContextParameters &ctx, struct archive *a, const st
                 }
 
                 // prefix with the issue id
-                std::string fpath = issue.id + "/" RESOURCE_FILES  "/" + (*f);
+                std::string fpath = issue.id + "/" RESOURCE_FILES  "/" + f->str();
 
                 // check if same file was already added to the archive
                 if (sentFiles.count(fpath) > 0) {
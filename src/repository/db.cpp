@@ -29,11 +29,13 @@
 #include <unistd.h>
 
 #include "db.h"
+#include "refWatcher.h"
 #include "utils/parseConfig.h"
 #include "utils/logging.h"
 #include "utils/identifiers.h"
 #include "utils/stringTools.h"
 #include "utils/filesystem.h"
+#include "utils/threadPool.h"
 #include "global.h"
 #include "mg_win32.h"
 #include "project/Project.h"
@@ -76,52 +78,108 @@ int Database::loadConfig(const std::string &path)
         FOREACH (line, lines) {
             // editDelay
             // sessionDuration
+            // objectCompression
             if (line->size() != 2) continue;
             std::string key = line->front();
             std::string value = line->back();
             if (key == "editDelay") editDelay = atoi(value.c_str());
             else if (key == "sessionDuration") sessionDuration = atoi(value.c_str());
-            else {
+            else if (key == "objectCompression") {
+                if (value == "gzip") Object::setCompression(OBJECT_CODEC_GZIP);
+                else if (value == "none") Object::setCompression(OBJECT_CODEC_NONE);
+                else LOG_ERROR("Invalid objectCompression in configuration of repository: %s", value.c_str());
+            } else {
                 LOG_ERROR("Invalid key in configuration of repository: %s", key.c_str());
             }
         }
     }
-    LOG_INFO("Repository config: editDelay=%ds, sessionDuration=%ds", editDelay, sessionDuration);
+    LOG_INFO("Repository config: editDelay=%ds, sessionDuration=%ds, objectCompression=%s", editDelay, sessionDuration,
+             Object::getCompression() == OBJECT_CODEC_GZIP ? "gzip" : "none");
     return err;
 }
 
 
-/** Recursively load all projects under the given path
+/** Recursively find the paths of all projects under the given path
   *
-  * @return
-  *    number of projects found
+  * @param[out] paths
   */
-int Database::loadProjects(const std::string &path, bool recurse)
+void Database::findProjects(const std::string &path, bool recurse, std::list<std::string> &paths)
 {
-    LOG_DEBUG("loadProjects(%s)", path.c_str());
-
-    int result = 0;
-
-    if (Project::isProject(path)) {
-        Project *p = Database::loadProject(path);
-        if (p) result += 1;
-    }
+    if (Project::isProject(path)) paths.push_back(path);
 
     if (recurse) {
         DIR *dirp;
         if ((dirp = openDir(path)) == NULL) {
-            return 0;
+            return;
 
         } else {
             std::string f;
             while ((f = getNextFile(dirp)) != "") {
                 if (f[0] == '.') continue; // do not look through hidden files
                 std::string subpath = path + "/" + f;
-                result += loadProjects(subpath, recurse); // recurse
+                findProjects(subpath, recurse, paths); // recurse
             }
             closedir(dirp);
         }
     }
+}
+
+struct ProjectLoadingJob {
+    std::string path;
+    Project *project;
+};
+
+static void loadProjectJob(void *arg)
+{
+    ProjectLoadingJob *job = (ProjectLoadingJob*)arg;
+    job->project = Database::loadProject(job->path);
+}
+
+/** Recursively load all projects under the given path
+  *
+  * The projects are loaded concurrently by a pool of
+  * at most Database::getLoadWorkers() threads. Each of them loads the
+  * issues of its project with its share of the workers, so that the
+  * threads of both levels remain within this bound.
+  *
+  * @return
+  *    number of projects found
+  */
+int Database::loadProjects(const std::string &path, bool recurse)
+{
+    LOG_DEBUG("loadProjects(%s)", path.c_str());
+
+    std::list<std::string> paths;
+    findProjects(path, recurse, paths);
+    if (paths.empty()) return 0;
+
+    int nWorkers = Db.loadWorkers;
+    if (nWorkers > (int)paths.size()) nWorkers = paths.size();
+    LOG_DEBUG("Loading %ld projects with %d workers", L(paths.size()), nWorkers);
+
+    Db.issueLoadWorkers = Db.loadWorkers / nWorkers;
+    if (Db.issueLoadWorkers < 1) Db.issueLoadWorkers = 1;
+
+    std::vector<ProjectLoadingJob> jobs(paths.size());
+    {
+        ThreadPool pool(nWorkers);
+        size_t i = 0;
+        std::list<std::string>::const_iterator p;
+        FOREACH(p, paths) {
+            jobs[i].path = *p;
+            jobs[i].project = 0;
+            pool.submit(loadProjectJob, &jobs[i]);
+            i++;
+        }
+        pool.waitAll();
+    }
+    Db.issueLoadWorkers = Db.loadWorkers;
+
+    int result = 0;
+    std::vector<ProjectLoadingJob>::const_iterator job;
+    FOREACH(job, jobs) {
+        if (job->project) result += 1;
+    }
 
     return result;
 }
@@ -134,6 +192,7 @@ Project *Database::createProject(const std::string &name)
     if (r != 0) return 0;
 
     Project *p = loadProject(resultingPath.c_str());
+    if (p) RefWatcher::addProject(p->getName());
     return p;
 }
 
@@ -265,6 +324,59 @@ std::list<std::string> Database::getProjects()
     return result;
 }
 
+static ThreadPool *SearchWorkers = 0;
+static pthread_once_t SearchWorkersOnce = PTHREAD_ONCE_INIT;
+
+static void createSearchWorkers()
+{
+    SearchWorkers = new ThreadPool(ThreadPool::getNumCpus());
+}
+
+/** Get the pool of threads shared by the searches of several projects
+  *
+  * The pool is created on the first use, and then shared by all the
+  * requests, so that the number of threads remains bounded by the
+  * number of processors.
+  */
+ThreadPool *Database::getSearchWorkers()
+{
+    pthread_once(&SearchWorkersOnce, createSearchWorkers);
+    return SearchWorkers;
+}
+
+/** Store the cache of all the projects (see Project::storeCache)
+  */
+void Database::storeCaches()
+{
+    std::list<Project*> projectsToStore;
+    {
+        // do not hold the lock of the database while storing,
+        // as a writer of a project may need it (allocateNewIssueId)
+        ScopeLocker scopeLocker(Db.locker, LOCK_READ_ONLY);
+        std::map<std::string, Project*>::iterator p;
+        FOREACH(p, Database::Db.projects) projectsToStore.push_back(p->second);
+    }
+
+    std::list<Project*>::iterator p;
+    FOREACH(p, projectsToStore) (*p)->storeCache();
+}
+
+/** Store on disk the entries committed in the journals of all the projects
+  *
+  * (see Journal::flush)
+  */
+void Database::flushJournals()
+{
+    std::list<Project*> projectsToFlush;
+    {
+        ScopeLocker scopeLocker(Db.locker, LOCK_READ_ONLY);
+        std::map<std::string, Project*>::iterator p;
+        FOREACH(p, Database::Db.projects) projectsToFlush.push_back(p->second);
+    }
+
+    std::list<Project*>::iterator p;
+    FOREACH(p, projectsToFlush) (*p)->flushJournal();
+}
 
 std::string Database::allocateNewIssueId(const std::string &realm)
 {
@@ -283,6 +395,8 @@ std::string Database::allocateNewIssueId(const std::string &realm)
 
 void Database::updateMaxIssueId(const std::string &realm, uint32_t i)
 {
+    ScopeLocker scopeLocker(Db.locker, LOCK_READ_WRITE);
+
     if (i > Db.maxIssueId) Db.maxIssueId = i;
 }
 
@@ -10,6 +10,7 @@
 
 #include "utils/ustring.h"
 #include "utils/mutexTools.h"
+#include "utils/threadPool.h"
 #include "utils/stringTools.h"
 #include "project/Project.h"
 
@@ -33,7 +34,9 @@ public:
     static Database Db;
     Database() : maxIssueId(0),
         editDelay(10*60), // default 10 minutes
-        sessionDuration(60*60*36) // default 1.5 days
+        sessionDuration(60*60*36), // default 1.5 days
+        loadWorkers(ThreadPool::getNumCpus()),
+        issueLoadWorkers(loadWorkers)
         {}
     static Project *lookupProject(std::string &resource);
     static void lookupProjectsWildcard(std::string &resource, const std::list<std::string> &projects,
@@ -50,6 +53,13 @@ public:
     inline size_t getNumProjects() const { return projects.size(); }
     Project *getNextProject(const Project *p) const;
     static int loadProjects(const std::string &path, bool recurse);
+    static void findProjects(const std::string &path, bool recurse, std::list<std::string> &paths);
+    static void storeCaches();
+    static void flushJournals();
+    static inline void setLoadWorkers(int n) { Db.loadWorkers = n; Db.issueLoadWorkers = n; }
+    static inline int getLoadWorkers() { return Db.loadWorkers; }
+    static inline int getIssueLoadWorkers() { return Db.issueLoadWorkers; }
+    static ThreadPool *getSearchWorkers();
     int loadConfig(const std::string &path);
     static inline int getEditDelay() { return Db.editDelay; }
     static inline int getSessionDuration() { return Db.sessionDuration; }
@@ -61,6 +71,8 @@ private:
     std::map<std::string, uint32_t> allocatedIds;
     int editDelay; //< delay after which a message cannot be amended (seconds)
     int sessionDuration; //< duration of a user session (seconds)
+    int loadWorkers; //< number of threads for loading the projects
+    int issueLoadWorkers; //< number of threads for loading the issues of a project
 };
 
 
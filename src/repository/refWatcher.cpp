@@ -0,0 +1,206 @@
+/*   Small Issue Tracker
+ *   Copyright (C) 2013 Frederic Hoerni
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License v2 as published by
+ *   the Free Software Foundation.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ */
+#include "config.h"
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <set>
+#include <list>
+#if defined(__linux__)
+  #include <sys/inotify.h>
+#endif
+
+#include "refWatcher.h"
+#include "db.h"
+#include "project/Project.h"
+#include "utils/logging.h"
+#include "global.h"
+
+#define REFWATCH_EVENTS_SIZE (64*1024) // bytes of inotify events read in a row
+
+RefWatcher RefWatcher::Instance;
+
+/** Apply a modified ref to its project
+  *
+  * @param name
+  *     issue id if 'isIssue', else basename of the ref in refs/
+  */
+int RefWatcher::applyRef(const std::string &project, bool isIssue, const std::string &name)
+{
+    Project *p = Database::getProject(project);
+    if (!p) return 0;
+
+    int r = 0;
+    if (isIssue) r = p->reloadIssue(name);
+    else if (name == "tags") r = p->reloadTags();
+    else if (name == "views") r = p->reloadPredefinedViews();
+    else if (name == "project") r = p->reloadConfig();
+    // other refs (trigger, etc.) are read when needed
+
+    ScopeLocker scopeLocker(locker, LOCK_READ_WRITE);
+    if (r > 0) stats.applied++;
+    else if (r < 0) stats.errors++;
+    return r;
+}
+
+#if defined(__linux__)
+
+void *RefWatcher::run(void *arg)
+{
+    RefWatcher *watcher = (RefWatcher*)arg;
+    char *buffer = new char[REFWATCH_EVENTS_SIZE];
+
+    while (1) {
+        ssize_t n = read(watcher->fd, buffer, REFWATCH_EVENTS_SIZE);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            LOG_ERROR("RefWatcher: cannot read events: %s", strerror(errno));
+            break;
+        }
+
+        // a ref modified several times in a batch of events is applied once
+        std::set<std::pair<int, std::string> > modified;
+        bool overflow = false;
+        ssize_t offset = 0;
+        while (offset < n) {
+            const struct inotify_event *event = (const struct inotify_event *)(buffer + offset);
+            offset += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) overflow = true;
+            if (!event->len || event->name[0] == '.') continue; // temporary file of writeToFile
+            modified.insert(std::make_pair(event->wd, std::string(event->name)));
+        }
+
+        std::map<int, WatchedDir> watches;
+        {
+            ScopeLocker scopeLocker(watcher->locker, LOCK_READ_ONLY);
+            watches = watcher->watches;
+        }
+
+        if (overflow) {
+            // some events were lost: reload the whole projects
+            LOG_ERROR("RefWatcher: events overflow, reloading the projects");
+            std::set<std::string> projects;
+            std::map<int, WatchedDir>::const_iterator w;
+            FOREACH(w, watches) projects.insert(w->second.project);
+            std::set<std::string>::const_iterator pname;
+            FOREACH(pname, projects) {
+                Project *p = Database::getProject(*pname);
+                if (p) p->reload();
+            }
+            continue;
+        }
+
+        std::set<std::pair<int, std::string> >::const_iterator ref;
+        FOREACH(ref, modified) {
+            std::map<int, WatchedDir>::const_iterator w = watches.find(ref->first);
+            if (w == watches.end()) continue;
+            LOG_DIAG("RefWatcher: %s: %s%s", w->second.project.c_str(),
+                     w->second.isIssues ? "issues/" : "", ref->second.c_str());
+            watcher->applyRef(w->second.project, w->second.isIssues, ref->second);
+        }
+    }
+
+    delete[] buffer;
+    return 0;
+}
+
+/** Start watching the refs of the projects
+  *
+  * @return
+  *     0 success
+  *    -1 error
+  */
+int RefWatcher::start()
+{
+    Instance.fd = inotify_init1(IN_CLOEXEC);
+    if (Instance.fd < 0) {
+        LOG_ERROR("Cannot start the watch of refs: %s", strerror(errno));
+        return -1;
+    }
+
+    std::list<std::string> projects = Database::getProjects();
+    std::list<std::string>::const_iterator pname;
+    FOREACH(pname, projects) addProject(*pname);
+
+    pthread_t thread;
+    int r = pthread_create(&thread, NULL, run, &Instance);
+    if (r != 0) {
+        LOG_ERROR("Cannot start the watch of refs: %s", strerror(r));
+        close(Instance.fd);
+        Instance.fd = -1;
+        return -1;
+    }
+    pthread_detach(thread);
+    return 0;
+}
+
+/** Watch the refs of a project
+  *
+  * Nothing is done if the watcher is not started.
+  */
+int RefWatcher::addProject(const std::string &project)
+{
+    if (Instance.fd < 0) return 0;
+
+    Project *p = Database::getProject(project);
+    if (!p) return -1;
+
+    const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM;
+    WatchedDir dir;
+    dir.project = project;
+
+    ScopeLocker scopeLocker(Instance.locker, LOCK_READ_WRITE);
+
+    dir.isIssues = false;
+    std::string refsDir = p->getPath() + "/" PATH_REFS;
+    int wd = inotify_add_watch(Instance.fd, refsDir.c_str(), mask);
+    if (wd < 0) {
+        LOG_ERROR("Cannot watch %s: %s", refsDir.c_str(), strerror(errno));
+        return -1;
+    }
+    Instance.watches[wd] = dir;
+
+    dir.isIssues = true;
+    wd = inotify_add_watch(Instance.fd, p->getIssuesDir().c_str(), mask);
+    if (wd < 0) {
+        LOG_ERROR("Cannot watch %s: %s", p->getIssuesDir().c_str(), strerror(errno));
+        return -1;
+    }
+    Instance.watches[wd] = dir;
+    return 0;
+}
+
+#else
+
+int RefWatcher::start()
+{
+    LOG_INFO("The watch of refs is not supported on this platform");
+    return -1;
+}
+
+int RefWatcher::addProject(const std::string &project)
+{
+    (void)project;
+    return 0;
+}
+
+#endif
+
+RefWatcherStats RefWatcher::getStats()
+{
+    ScopeLocker scopeLocker(Instance.locker, LOCK_READ_ONLY);
+    return Instance.stats;
+}
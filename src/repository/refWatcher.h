@@ -0,0 +1,49 @@
+#ifndef _refWatcher_h
+#define _refWatcher_h
+
+#include <string>
+#include <map>
+
+#include "utils/mutexTools.h"
+
+struct RefWatcherStats {
+    unsigned long applied; // number of refs that modified a project
+    unsigned long errors; // number of refs that could not be applied
+    RefWatcherStats() : applied(0), errors(0) {}
+};
+
+/** Watch of the refs of the projects modified out-of-band
+  *
+  * The refs of the projects may be modified while the server is running,
+  * by repository sync scripts for instance. Instead of reloading the whole
+  * project, a background thread watches the refs with inotify, and applies
+  * only the modified ones: refs/issues/<id>, refs/tags, refs/views and
+  * refs/project (see Project::reloadIssue, etc.).
+  *
+  * The refs written by the server itself are notified as well, and are
+  * found already applied.
+  *
+  * Available on Linux only.
+  */
+class RefWatcher {
+public:
+    static int start();
+    static int addProject(const std::string &project);
+    static RefWatcherStats getStats();
+
+private:
+    static RefWatcher Instance;
+    RefWatcher() : fd(-1) {}
+    static void *run(void *arg);
+    int applyRef(const std::string &project, bool isIssue, const std::string &name);
+    struct WatchedDir {
+        std::string project;
+        bool isIssues; // refs/issues, else refs
+    };
+    int fd; // inotify instance
+    std::map<int, WatchedDir> watches; // key: watch descriptor
+    RefWatcherStats stats;
+    Locker locker;
+};
+
+#endif
@@ -0,0 +1,165 @@
+/*   Small Issue Tracker
+ *   Copyright (C) 2013 Frederic Hoerni
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License v2 as published by
+ *   the Free Software Foundation.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ */
+#include "config.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "scrubber.h"
+#include "db.h"
+#include "project/Object.h"
+#include "utils/identifiers.h"
+#include "utils/logging.h"
+#include "global.h"
+
+#define SCRUB_BATCH_PAUSE_US (10*1000) // pause between 2 batches of the background thread
+
+Scrubber Scrubber::Instance;
+
+/** Split the objects of a project in batches
+  *
+  * Files whose name is not a sha1 are not verified.
+  * The batches must be deleted by the caller.
+  */
+void Scrubber::makeBatches(const std::string &project, const std::string &objectsDir,
+                           std::list<ObjectBatch*> &batches)
+{
+    std::list<std::string> objects;
+    Object::getObjects(objectsDir, objects);
+
+    ObjectBatch *batch = 0;
+    std::list<std::string>::const_iterator id;
+    FOREACH(id, objects) {
+        if (!Object::isSha1Id(*id)) continue;
+        if (!batch || batch->ids.size() >= SCRUB_BATCH_SIZE) {
+            batch = new ObjectBatch;
+            batch->project = project;
+            batch->objectsDir = objectsDir;
+            batch->ids.reserve(SCRUB_BATCH_SIZE);
+            batches.push_back(batch);
+        }
+        batch->ids.push_back(*id);
+    }
+}
+
+/** Verify the objects of a batch
+  *
+  * The ids of the corrupted objects are stored in batch->corrupted.
+  * This function is suitable for a ThreadPool job.
+  */
+void Scrubber::verifyBatch(void *arg)
+{
+    ObjectBatch *batch = (ObjectBatch*)arg;
+    Sha1Hasher hasher;
+
+    std::vector<std::string>::const_iterator id;
+    FOREACH(id, batch->ids) {
+        int r = Object::verify(batch->objectsDir, *id, hasher);
+        if (r == -1) {
+            LOG_ERROR("%s: cannot load object %s", batch->project.c_str(), id->c_str());
+            batch->corrupted.push_back(*id);
+        } else if (r < 0) {
+            LOG_ERROR("%s: corrupted object %s", batch->project.c_str(), id->c_str());
+            batch->corrupted.push_back(*id);
+        }
+    }
+}
+
+/** Verify all the objects of a project, in the background thread
+  *
+  * The previous report of the project is replaced at the end of the pass.
+  */
+void Scrubber::scrubProject(const std::string &project, const std::string &objectsDir)
+{
+    std::list<ObjectBatch*> batches;
+    makeBatches(project, objectsDir, batches);
+
+    std::set<std::string> corrupted;
+    std::list<ObjectBatch*>::iterator batch;
+    FOREACH(batch, batches) {
+        verifyBatch(*batch);
+        corrupted.insert((*batch)->corrupted.begin(), (*batch)->corrupted.end());
+        {
+            ScopeLocker scopeLocker(locker, LOCK_READ_WRITE);
+            stats.verified += (*batch)->ids.size();
+        }
+        delete *batch;
+        usleep(SCRUB_BATCH_PAUSE_US); // let the other threads work
+    }
+
+    ScopeLocker scopeLocker(locker, LOCK_READ_WRITE);
+    if (corrupted.empty()) stats.corrupted.erase(project);
+    else stats.corrupted[project] = corrupted;
+}
+
+void *Scrubber::run(void *arg)
+{
+    Scrubber *scrubber = (Scrubber*)arg;
+    while (1) {
+        time_t start = time(0);
+        LOG_DIAG("Scrubber: start pass");
+
+        std::list<std::string> projects = Database::getProjects();
+        std::list<std::string>::const_iterator pname;
+        FOREACH(pname, projects) {
+            Project *p = Database::getProject(*pname);
+            if (!p) continue;
+            scrubber->scrubProject(*pname, p->getObjectsDir());
+        }
+
+        size_t nCorrupted = 0;
+        {
+            ScopeLocker scopeLocker(scrubber->locker, LOCK_READ_WRITE);
+            scrubber->stats.passes++;
+            scrubber->stats.lastPass = time(0);
+            std::map<std::string, std::set<std::string> >::const_iterator c;
+            FOREACH(c, scrubber->stats.corrupted) nCorrupted += c->second.size();
+        }
+        if (nCorrupted) LOG_ERROR("Scrubber: %ld corrupted object(s)", L(nCorrupted));
+        LOG_INFO("Scrubber: pass completed (%lds)", L(time(0) - start));
+
+        long remaining = scrubber->period - (time(0) - start);
+        if (remaining > 0) sleep(remaining);
+    }
+    return 0;
+}
+
+/** Start the background thread
+  *
+  * @param period
+  *     seconds between the start of 2 passes over all the projects
+  *
+  * @return
+  *     0 success
+  *    -1 error
+  */
+int Scrubber::start(int period)
+{
+    Instance.period = period;
+
+    pthread_t thread;
+    int r = pthread_create(&thread, NULL, run, &Instance);
+    if (r != 0) {
+        LOG_ERROR("Cannot start scrubber: %s", strerror(r));
+        return -1;
+    }
+    pthread_detach(thread);
+    return 0;
+}
+
+ScrubberStats Scrubber::getStats()
+{
+    ScopeLocker scopeLocker(Instance.locker, LOCK_READ_ONLY);
+    return Instance.stats;
+}
@@ -0,0 +1,59 @@
+#ifndef _scrubber_h
+#define _scrubber_h
+
+#include <string>
+#include <map>
+#include <set>
+#include <list>
+#include <vector>
+#include <time.h>
+
+#include "utils/mutexTools.h"
+
+#define SCRUB_BATCH_SIZE 1000 // number of objects verified in a row
+
+/** Objects of a project to be verified
+  */
+struct ObjectBatch {
+    std::string project;
+    std::string objectsDir;
+    std::vector<std::string> ids;
+    std::list<std::string> corrupted; // result of the verification
+};
+
+struct ScrubberStats {
+    unsigned long passes; // number of complete passes
+    unsigned long verified; // number of objects verified
+    time_t lastPass; // end of the last complete pass
+    std::map<std::string, std::set<std::string> > corrupted; // key: project name, value: object ids
+    ScrubberStats() : passes(0), verified(0), lastPass(0) {}
+};
+
+/** Verification of the integrity of the objects
+  *
+  * The sha1 of the objects is not verified when loading the projects.
+  * Instead, the scrubber periodically verifies all the objects of the
+  * projects, in a background thread and by batches, and reports the
+  * corrupted objects in the stats page.
+  *
+  * The same batches are verified by 'smit fsck', in parallel.
+  */
+class Scrubber {
+public:
+    static void makeBatches(const std::string &project, const std::string &objectsDir,
+                            std::list<ObjectBatch*> &batches);
+    static void verifyBatch(void *batch);
+    static int start(int period);
+    static ScrubberStats getStats();
+
+private:
+    static Scrubber Instance;
+    Scrubber() : period(0) {}
+    static void *run(void *arg);
+    void scrubProject(const std::string &project, const std::string &objectsDir);
+    int period; // seconds between the start of 2 passes
+    ScrubberStats stats;
+    Locker locker;
+};
+
+#endif
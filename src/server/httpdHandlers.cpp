@@ -30,18 +30,24 @@
 #include "httpdHandlers.h"
 #include "httpdUtils.h"
 #include "repository/db.h"
+#include "repository/scrubber.h"
+#include "repository/refWatcher.h"
+#include "project/MessageCache.h"
 #include "utils/logging.h"
 #include "utils/identifiers.h"
 #include "utils/parseConfig.h"
 #include "utils/stringTools.h"
+#include "utils/stringTable.h"
 #include "utils/cpio.h"
 #include "utils/filesystem.h"
+#include "utils/epoch.h"
 #include "rendering/renderingText.h"
 #include "rendering/renderingHtml.h"
 #ifdef ZIP_ENABLED
   #include "rendering/renderingZip.h"
 #endif
 #include "rendering/renderingHtmlIssue.h"
+#include "rendering/renderingHtmlUtil.h"
 #include "rendering/ContextParameters.h"
 #include "rendering/renderingCsv.h"
 #include "rendering/renderingJson.h"
@@ -222,6 +228,56 @@ void handleGetStats(const RequestContext *request)
     others -= HttpStats.httpCodes[H_413];
     others -= HttpStats.httpCodes[H_500];
     request->printf("Others:   %4d\r\n", others);
+
+    request->printf("Memory:\r\n");
+    std::list<std::string> projects = Database::getProjects();
+    std::list<std::string>::const_iterator pname;
+    FOREACH(pname, projects) {
+        Project *p = Database::getProject(*pname);
+        if (!p) continue;
+        ProjectMemoryUsage usage = p->getMemoryUsage();
+        request->printf("  %s: %lu issues, %lu entries, %lu kB (messages: %lu resident, %lu kB, %lu not resident)\r\n",
+                        pname->c_str(), L(usage.nIssues), L(usage.nEntries), L(usage.entriesSize/1024),
+                        L(usage.nResidentMessages), L(usage.residentMessagesSize/1024), L(usage.nLazyMessages));
+    }
+    request->printf("Write lock:\r\n");
+    FOREACH(pname, projects) {
+        Project *p = Database::getProject(*pname);
+        if (!p) continue;
+        ProjectLockStats ls = p->getLockStats();
+        double avg = ls.nWrites ? ls.totalHold / ls.nWrites : 0;
+        request->printf("  %s: %lu entries, held %.3f ms average, %.3f ms max\r\n",
+                        pname->c_str(), ls.nWrites, avg*1000, ls.maxHold*1000);
+    }
+    request->printf("Query cache:\r\n");
+    FOREACH(pname, projects) {
+        Project *p = Database::getProject(*pname);
+        if (!p) continue;
+        QueryCacheStats qs = p->getQueryCacheStats();
+        request->printf("  %s: %lu results, %lu hits, %lu misses\r\n",
+                        pname->c_str(), L(qs.count), qs.hits, qs.misses);
+    }
+    MessageCacheStats mcs = MessageCache::getStats();
+    request->printf("Message cache: %lu messages, %lu/%lu kB, %lu hits, %lu misses\r\n",
+                    L(mcs.count), L(mcs.size/1024), L(mcs.capacity/1024), mcs.hits, mcs.misses);
+
+    StringTableStats sts = StringTable::getStats();
+    request->printf("Interned strings: %lu strings, %lu kB\r\n", L(sts.count), L(sts.size/1024));
+
+    RefWatcherStats rs = RefWatcher::getStats();
+    request->printf("Refs watcher: %lu refs applied, %lu errors\r\n", rs.applied, rs.errors);
+
+    ScrubberStats ss = Scrubber::getStats();
+    size_t nCorrupted = 0;
+    std::map<std::string, std::set<std::string> >::const_iterator c;
+    FOREACH(c, ss.corrupted) nCorrupted += c->second.size();
+    request->printf("Integrity: %lu objects verified, %lu passes, %lu corrupted\r\n",
+                    ss.verified, ss.passes, L(nCorrupted));
+    if (ss.passes) request->printf("  last pass: %s\r\n", epochToString(ss.lastPass).c_str());
+    FOREACH(c, ss.corrupted) {
+        std::set<std::string>::const_iterator id;
+        FOREACH(id, c->second) request->printf("  corrupted: %s %s\r\n", c->first.c_str(), id->c_str());
+    }
 }
 
 void handleMessagePreview(const RequestContext *req)
@@ -1351,6 +1407,7 @@ std::string getRedirectionToIssue(const Project &p, std::vector<IssueCopy> &issu
     }
     return redirectUrl;
 }
+
 void httpIssuesAccrossProjects(const RequestContext *req, const User &u, const std::string &uri, const std::list<Project *> &projects)
 {
     if (uri != "issues") return sendHttpHeader404(req);
@@ -1359,24 +1416,25 @@ void httpIssuesAccrossProjects(const RequestContext *req, const User &u, const s
     std::string q = req->getQueryString();
     PredefinedView v = PredefinedView::loadFromQueryString(q); // unamed view, used as handle on the viewing parameters
 
-    std::vector<IssueCopy> issues;
-
-    // foreach project, get list of issues
+    // the filters of each project (with user "me" replaced, if any)
+    std::vector<ProjectSearch> searches(projects.size());
+    size_t i = 0;
     std::list<Project *>::const_iterator p;
     FOREACH(p, projects) {
-        // replace user "me" if any...
-        PredefinedView vcopy = v;
-        replaceUserMe(vcopy.filterin, **p, u.username);
-        replaceUserMe(vcopy.filterout, **p, u.username);
-        if (vcopy.search == "me") vcopy.search = u.username;
-
-        // search, without sorting
-        (*p)->search(vcopy.search.c_str(), vcopy.filterin, vcopy.filterout, 0, issues);
+        ProjectSearch &search = searches[i++];
+        search.project = *p;
+        search.fulltextSearch = (v.search == "me") ? u.username : v.search;
+        search.filterIn = v.filterin;
+        search.filterOut = v.filterout;
+        replaceUserMe(search.filterIn, **p, u.username);
+        replaceUserMe(search.filterOut, **p, u.username);
     }
 
-    // sort
-    std::list<std::pair<bool, std::string> > sSpec = parseSortingSpec(v.sort.c_str());
-    IssueCopy::sort(issues, sSpec);
+    // search the projects in parallel, and merge their sorted pages
+    // (the offset is used only with a limit)
+    std::vector<IssueCopy> issues;
+    size_t nIssuesFound = 0;
+    Project::searchProjects(searches, v.sort.c_str(), issues, v.limit < 0 ? 0 : v.offset, v.limit, &nIssuesFound);
 
     // get the colspec
     std::list<std::string> cols;
@@ -1399,6 +1457,9 @@ void httpIssuesAccrossProjects(const RequestContext *req, const User &u, const s
         ctx.filterout = v.filterout;
         ctx.search = v.search;
         ctx.sort = v.sort;
+        ctx.limit = v.limit;
+        ctx.offset = v.offset;
+        ctx.nIssuesFound = nIssuesFound;
 
         RHtml::printPageIssueAccrossProjects(ctx, issues, cols);
     }
@@ -1469,7 +1530,7 @@ void httpCloneIssues(const RequestContext *req, const Project &p)
 
     // get all the issues, sorted by id
     std::vector<IssueCopy> issues;
-    p.search(0, filterIn, filterOut, "id", issues);
+    p.search(0, filterIn, filterOut, "id", issues, 0, -1, 0, false);
     std::vector<IssueCopy>::const_iterator i;
     FOREACH(i, issues) {
         if (!i->first) continue;
@@ -1479,8 +1540,47 @@ void httpCloneIssues(const RequestContext *req, const Project &p)
     }
 }
 
+/** Print the HTTP headers that give the pagination of a list of issues
+  *
+  * Link (RFC 5988) gives the URLs of the previous and next pages,
+  * and X-Total-Count the number of issues of all the pages.
+  */
+static void printPaginationHeaders(const RequestContext *req, const std::string &url, const PredefinedView &v,
+                                   size_t nIssuesFound, size_t nReturned)
+{
+    if (v.limit < 0) return; // not paginated
+
+    req->printf("X-Total-Count: %lu\r\n", L(nIssuesFound));
+
+    std::string q = req->getQueryString();
+    std::string links;
+    if (v.offset > 0) {
+        size_t previous = 0;
+        if (v.offset > (size_t)v.limit) previous = v.offset - v.limit;
+        links += "<" + url + "?" + getQsPage(q, previous) + ">; rel=\"prev\"";
+    }
+    if (v.offset + nReturned < nIssuesFound) {
+        if (!links.empty()) links += ", ";
+        links += "<" + url + "?" + getQsPage(q, v.offset + nReturned) + ">; rel=\"next\"";
+    }
+    if (!links.empty()) req->printf("Link: %s\r\n", links.c_str());
+}
+
+/** Send a list of issues
+  *
+  * @param issueList
+  *     The issues of the requested page (see the offset and limit of the query string)
+  *
+  * @param nIssuesFound
+  *     The number of issues of all the pages
+  *
+  * @param facets
+  *     The numbers of issues per value of some properties, shown aside
+  *     the list (HTML only, optional)
+  */
 void httpSendIssueList(const RequestContext *req, const Project &p,
-                       const User &u, const std::vector<IssueCopy> &issueList)
+                       const User &u, const std::vector<IssueCopy> &issueList, size_t nIssuesFound,
+                       const FacetCounts *facets = 0)
 {
     std::string q = req->getQueryString();
     PredefinedView v = PredefinedView::loadFromQueryString(q);
@@ -1497,6 +1597,8 @@ void httpSendIssueList(const RequestContext *req, const Project &p,
     enum RenderingFormat format = getFormat(req);
 
     sendHttpHeader200(req);
+    std::string url = req->getUrlRewritingRoot() + "/" + p.getUrlName() + "/issues/";
+    printPaginationHeaders(req, url, v, nIssuesFound, issueList.size());
 
     if (format == RENDERING_TEXT) RText::printIssueList(req, issueList, cols);
     else if (format == RENDERING_JSON) RJson::printIssueList(req, issueList, cols);
@@ -1508,6 +1610,10 @@ void httpSendIssueList(const RequestContext *req, const Project &p,
         ctx.filterout = v.filterout;
         ctx.search = v.search;
         ctx.sort = v.sort;
+        ctx.limit = v.limit;
+        ctx.offset = v.offset;
+        ctx.nIssuesFound = nIssuesFound;
+        ctx.facets = facets;
 
         std::string full = getFirstParamFromQueryString(q, "full"); // full-contents indicator
 
@@ -1522,14 +1628,23 @@ void httpSendIssueList(const RequestContext *req, const Project &p,
 /** Get a list of entries
   *
   * Query-String: ?sort=-ctime&limit=20
+  *
+  * The optional parameter "cursor" is the id of an entry: only the entries
+  * after it (in the order of the sort) are returned. Eg: the id of the last
+  * entry of a page of ?sort=-ctime&limit=20 gives the next older page.
   */
 void httpGetListOfEntries(const RequestContext *req, const Project &p, const User &u)
 {
     std::string q = req->getQueryString();
     PredefinedView v = PredefinedView::loadFromQueryString(q); // unamed view, used as handler on the viewing parameters
+    std::string cursor = getFirstParamFromQueryString(q, "cursor");
 
     std::vector<Entry> entries;
-    p.searchEntries(v.sort.c_str(), entries, v.limit);
+    int r = p.searchEntries(v.sort.c_str(), entries, v.limit, cursor);
+    if (r != 0) {
+        sendHttpHeader400(req, "Unknown cursor");
+        return;
+    }
 
     enum RenderingFormat format = getFormat(req);
 
@@ -1549,45 +1664,74 @@ void httpGetListOfEntries(const RequestContext *req, const Project &p, const Use
     }
 }
 
+/** Tell if a list of issues is rendered with the full contents of the issues
+  *
+  * Only this rendering shows the summaries of the associated issues.
+  */
+static bool isFullContents(const RequestContext *req)
+{
+    enum RenderingFormat format = getFormat(req);
+    if (format == RENDERING_TEXT || format == RENDERING_JSON || format == RENDERING_CSV) return false;
+    return getFirstParamFromQueryString(req->getQueryString(), "full") == "1";
+}
+
 /** Get the list of issues at the moment indicated by the snapshot
   *
   * @param snapshot
   *     Seconds since 1 Jan 1970 (Epoch) UTC.
+  *     Several datetimes may be given, separated by commas. In this case,
+  *     only the number of matching issues at each datetime is returned
+  *     (text/plain, one line "<datetime> <number>" per datetime).
+  *
+  * The filters (filterin, filterout) and the sorting are applied to the
+  * states of the issues at the datetime of the snapshot.
   *
   * When taking a snapshot, the following query-string parameters are ignored:
-  *   - filterin
-  *   - filterout
   *   - search
-  *   - sort
   */
 void httpGetListOfIssues(const RequestContext *req, const Project &p, const User &u, const std::string &snapshot)
 {
-    std::vector<IssueCopy> issueList;
-    std::map<std::string, std::list<std::string> > emptyFilter;
-
-    p.search(0, emptyFilter, emptyFilter, 0, issueList);
-
-    time_t datetime = atoi(snapshot.c_str());
-
-    // for each returned issue:
-    // - update the issue according to the snapshot datetime
-    // - if the ctime is after the snapshot datetime, then remove the issue
-    std::vector<IssueCopy>::iterator i = issueList.begin();
-    while (i != issueList.end()) {
-        int n = i->makeSnapshot(datetime);
-        if (n == 0) {
-            // Issue has not entry before datetime. ie: not existing.
-            // Remove it from the list.
-            i = issueList.erase(i);
-        } else {
-            i++;
+    PredefinedView v = PredefinedView::loadFromQueryString(req->getQueryString());
+
+    // replace user "me" if any...
+    replaceUserMe(v.filterin, p, u.username);
+    replaceUserMe(v.filterout, p, u.username);
+
+    std::vector<long> datetimes;
+    std::list<std::string> tokens = split(snapshot, ",");
+    std::list<std::string>::const_iterator t;
+    FOREACH(t, tokens) datetimes.push_back(atol(t->c_str()));
+
+    std::vector<std::vector<IssueCopy> > snapshots;
+    std::vector<size_t> totals;
+
+    if (datetimes.size() > 1) {
+        // only count the matching issues at each datetime
+        p.searchSnapshots(datetimes, v.filterin, v.filterout, 0, snapshots, 0, 0, &totals, false);
+
+        sendHttpHeader200(req);
+        req->printf("Content-Type: text/plain\r\n\r\n");
+        for (size_t k = 0; k < datetimes.size(); k++) {
+            req->printf("%ld %ld\n", datetimes[k], L(totals[k]));
         }
+        return;
     }
 
-    httpSendIssueList(req, p, u, issueList);
+    p.searchSnapshots(datetimes, v.filterin, v.filterout, v.sort.c_str(), snapshots,
+                      v.offset, v.limit, &totals, isFullContents(req));
 
+    httpSendIssueList(req, p, u, snapshots[0], totals[0]);
 }
 
+/** Get a list of issues
+  *
+  * The optional parameter "facets" gives the names of properties, separated
+  * by '+' (Eg: facets=status+owner). For each of them, the number of
+  * matching issues per value is computed:
+  * - format=json: only the numbers are returned
+  *   (Eg: {"total":12,"facets":{"status":{"closed":8,"open":4}}})
+  * - format=html: the numbers are shown aside the list
+  */
 void httpGetListOfIssues(const RequestContext *req, const Project &p, const User &u)
 {
     if (getFormat(req) == X_SMIT) return httpCloneIssues(req, p); // used for cloning
@@ -1596,6 +1740,7 @@ void httpGetListOfIssues(const RequestContext *req, const Project &p, const User
     //     colspec    which fields are to be displayed in the table, and their order
     //     filter     select issues with fields of the given values
     //     sort       indicate sorting
+    //     facets     properties of which the values are counted
 
     std::string q = req->getQueryString();
 
@@ -1624,12 +1769,40 @@ void httpGetListOfIssues(const RequestContext *req, const Project &p, const User
     replaceUserMe(v.filterout, p, u.username);
     if (v.search == "me") v.search = u.username;
 
-    std::vector<IssueCopy> issueList;
-    p.search(v.search.c_str(), v.filterin, v.filterout, v.sort.c_str(), issueList);
+    std::list<std::string> facetProperties;
+    std::list<std::string> tokens = split(getFirstParamFromQueryString(q, "facets"), "+ ");
+    std::list<std::string>::const_iterator t;
+    FOREACH(t, tokens) if (!t->empty()) facetProperties.push_back(*t);
+
+    enum RenderingFormat format = getFormat(req);
+    if (!facetProperties.empty() && format == RENDERING_JSON) {
+        // only the numbers of issues, without the list
+        FacetCounts facets;
+        size_t total = 0;
+        p.getFacets(v.search.c_str(), v.filterin, v.filterout, facetProperties, facets, &total);
+        sendHttpHeader200(req);
+        RJson::printFacets(req, total, facets);
+        return;
+    }
 
     // check for redirection to specific issue (used for previous/next)
     std::string next = getFirstParamFromQueryString(q, QS_GOTO_NEXT);
     std::string previous = getFirstParamFromQueryString(q, QS_GOTO_PREVIOUS);
+
+    // only the requested page is sorted and copied (except for a redirection,
+    // that needs the neighbours of the issue in the whole list).
+    // The offset is used only with a limit, as for the search across the projects.
+    std::vector<IssueCopy> issueList;
+    size_t nIssuesFound = 0;
+    if (next.size() || previous.size()) {
+        p.search(v.search.c_str(), v.filterin, v.filterout, v.sort.c_str(), issueList,
+                 0, -1, 0, isFullContents(req));
+        nIssuesFound = issueList.size();
+    } else {
+        p.search(v.search.c_str(), v.filterin, v.filterout, v.sort.c_str(), issueList,
+                 v.limit < 0 ? 0 : v.offset, v.limit, &nIssuesFound, isFullContents(req));
+    }
+
     std::string redirectionUrl;
     if (next.size()) {
         redirectionUrl = getRedirectionToIssue(p, issueList, next, ISSUE_NEXT, q);
@@ -1645,7 +1818,14 @@ void httpGetListOfIssues(const RequestContext *req, const Project &p, const User
         return;
     }
 
-    httpSendIssueList(req, p, u, issueList);
+    if (!facetProperties.empty() && format == RENDERING_HTML && !isFullContents(req)) {
+        FacetCounts facets;
+        p.getFacets(v.search.c_str(), v.filterin, v.filterout, facetProperties, facets);
+        httpSendIssueList(req, p, u, issueList, nIssuesFound, &facets);
+        return;
+    }
+
+    httpSendIssueList(req, p, u, issueList, nIssuesFound);
 }
 
 void httpGetProject(const RequestContext *req, const Project &p, const User &u)
@@ -1734,10 +1914,32 @@ void httpGetObjects(const RequestContext *req, Project &p)
     }
 }
 
+/** Tell if the client accepts the gzip content-encoding
+  */
+static bool acceptsGzip(const RequestContext *req)
+{
+    const char *acceptEncoding = req->getHeader("Accept-Encoding");
+    if (!acceptEncoding) return false;
+    std::string value = acceptEncoding;
+    while (!value.empty()) {
+        std::string parameters = popToken(value, ',');
+        std::string coding = popToken(parameters, ';');
+        trim(coding);
+        if (coding != "gzip") continue;
+        trim(parameters);
+        if (0 == parameters.compare(0, 2, "q=") && atof(parameters.c_str() + 2) <= 0) return false;
+        return true;
+    }
+    return false;
+}
+
 /** Get an object
   *
   * Read access is supposed to have already been granted.
   *
+  * Loose uncompressed objects are sent by mongoose. The others are
+  * uncompressed, or sent as a gzip stream if the client accepts it.
+  *
   * @param object
   *    Must be <id>/<filename>, where:
   *    - <id> is the identifier of the object
@@ -1751,6 +1953,52 @@ void httpGetObject(const RequestContext *req, Project &p, std::string object)
     std::string basemane = object;
     std::string realpath = p.getObjectsDir() + "/" + Object::getSubpath(id);
     LOG_DEBUG("httpGetObject: basename=%s, realpath=%s", basemane.c_str(), realpath.c_str());
+
+    // an entry just committed may not be stored yet (see Journal)
+    if (!Object::exists(p.getObjectsDir(), id)) p.flushJournal();
+
+    if (!fileExists(realpath) || Object::getCodec(p.getObjectsDir(), id) != OBJECT_CODEC_NONE) {
+        // packed or compressed object
+        std::string stored;
+        int r = Object::loadStored(p.getObjectsDir(), id, stored);
+        if (r == 0) {
+            // objects are immutable, so their id is a valid etag
+            std::string etag = "\"" + id + "\"";
+            const char *inm = req->getHeader("If-None-Match");
+            if (inm && etag == inm) {
+                sendHttpHeader304(req);
+                return;
+            }
+
+            // send the gzip stream as is if the client accepts it
+            const char *data = stored.data();
+            size_t size = stored.size();
+            const char *encoding = 0;
+            std::string contents;
+            if (Object::getCodec(data, size) == OBJECT_CODEC_GZIP && acceptsGzip(req)) {
+                data += OBJECT_HEADER_SIZE;
+                size -= OBJECT_HEADER_SIZE;
+                encoding = "gzip";
+            } else {
+                r = Object::decode(data, size, contents);
+                if (r != 0) {
+                    sendHttpHeader500(req, "Cannot uncompress object");
+                    return;
+                }
+                data = contents.data();
+                size = contents.size();
+            }
+
+            sendHttpHeader200(req);
+            req->printf("ETag: %s\r\n", etag.c_str());
+            req->printf("Content-Type: %s\r\n", mg_get_builtin_mime_type(basemane.c_str()));
+            if (encoding) req->printf("Content-Encoding: %s\r\n", encoding);
+            req->printf("Vary: Accept-Encoding\r\n");
+            req->printf("Content-Length: %lu\r\n\r\n", L(size));
+            if (0 != strcmp(req->getMethod(), "HEAD")) req->write(data, size);
+            return;
+        }
+    }
     req->sendObject(basemane, realpath);
 }
 
@@ -1762,10 +2010,8 @@ void httpGetHeadObject(const RequestContext *req, Project &p, std::string object
 {
     LOG_FUNC();
     std::string id = popToken(object, '/');
-    std::string basemane = object;
-    std::string realpath = p.getObjectsDir() + "/" + Object::getSubpath(id);
 
-    if (fileExists(realpath)) {
+    if (Object::exists(p.getObjectsDir(), id)) {
         sendHttpHeader204(req, 0);
 
     } else {
@@ -2362,6 +2608,10 @@ int begin_request_handler(const RequestContext *req)
 {
     LOG_FUNC();
 
+    // the entries of a reloaded project are retired, not deleted, while the
+    // request may use them
+    ScopeEpoch scopeEpoch;
+
     std::string uri = req->getUri();
     std::string method = req->getMethod();
     LOG_DIAG("%s %s", method.c_str(), uri.c_str());
@@ -75,3 +75,14 @@ std::string epochToStringDelta(time_t t)
 
     return std::string(datetime);
 }
+
+/** Get the current time in seconds, with a microsecond resolution
+  *
+  * Used for measuring durations.
+  */
+double getSeconds()
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
@@ -6,5 +6,6 @@
 std::string getLocalTimestamp();
 std::string epochToString(time_t t);
 std::string epochToStringDelta(time_t t);
+double getSeconds();
 
 #endif
@@ -0,0 +1,80 @@
+/*   Small Issue Tracker
+ *   Copyright (C) 2013 Frederic Hoerni
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License v2 as published by
+ *   the Free Software Foundation.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ */
+#include "config.h"
+
+#include "epoch.h"
+#include "threadPool.h"
+#include "global.h"
+
+pthread_mutex_t Epoch::mutex = PTHREAD_MUTEX_INITIALIZER;
+uint64_t Epoch::current = 0;
+std::map<uint64_t, int> Epoch::readers;
+std::list<Epoch::Retired> Epoch::retired;
+ThreadPool *Epoch::reclaimer = 0;
+
+/** Enter the current epoch
+  *
+  * @return
+  *     the epoch, to be passed to leave()
+  */
+uint64_t Epoch::enter()
+{
+    pthread_mutex_lock(&mutex);
+    uint64_t epoch = current;
+    readers[epoch]++;
+    pthread_mutex_unlock(&mutex);
+    return epoch;
+}
+
+/** Leave an epoch, and destroy the objects that are no longer reachable
+  */
+void Epoch::leave(uint64_t epoch)
+{
+    pthread_mutex_lock(&mutex);
+    std::map<uint64_t, int>::iterator r = readers.find(epoch);
+    if (r != readers.end() && --r->second == 0) readers.erase(r);
+    reclaim();
+    pthread_mutex_unlock(&mutex);
+}
+
+/** Retire an object, that is no longer reachable by the readers entering from now
+  *
+  * The object is destroyed as soon as no reader may still use it.
+  */
+void Epoch::retire(DestroyFunction destroy, void *object)
+{
+    Retired r;
+    r.destroy = destroy;
+    r.object = object;
+
+    pthread_mutex_lock(&mutex);
+    r.epoch = current;
+    current++; // the readers entering from now cannot reach the object
+    retired.push_back(r);
+    reclaim();
+    pthread_mutex_unlock(&mutex);
+}
+
+/** Destroy the objects retired before the epoch of the oldest reader
+  *
+  * Must be called with the mutex held.
+  */
+void Epoch::reclaim()
+{
+    while (!retired.empty()) {
+        if (!readers.empty() && readers.begin()->first <= retired.front().epoch) break;
+        if (!reclaimer) reclaimer = new ThreadPool(1);
+        reclaimer->submit(retired.front().destroy, retired.front().object);
+        retired.pop_front();
+    }
+}
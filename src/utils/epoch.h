@@ -0,0 +1,55 @@
+#ifndef _epoch_h
+#define _epoch_h
+
+#include <list>
+#include <map>
+#include <stdint.h>
+#include <pthread.h>
+
+class ThreadPool;
+
+/** Epoch-based reclamation of shared objects
+  *
+  * Some readers keep pointers to shared objects after releasing the lock
+  * that protected them (eg: the entry returned by Project::addEntry, used
+  * by the triggers). Such readers enter an epoch for the duration of their
+  * work. An object retired by a writer is deleted only when all the readers
+  * that entered an epoch before its retirement have left.
+  *
+  * The objects are destroyed by a background thread, so that the last
+  * reader leaving does not pay for the destruction.
+  */
+class Epoch {
+public:
+    typedef void (*DestroyFunction)(void *object);
+
+    static uint64_t enter();
+    static void leave(uint64_t epoch);
+    static void retire(DestroyFunction destroy, void *object);
+
+private:
+    struct Retired {
+        uint64_t epoch;
+        DestroyFunction destroy;
+        void *object;
+    };
+    static void reclaim();
+    static pthread_mutex_t mutex;
+    static uint64_t current;
+    static std::map<uint64_t, int> readers; // key: epoch, value: number of readers in this epoch
+    static std::list<Retired> retired; // oldest first
+    static ThreadPool *reclaimer; // destroys the reclaimed objects
+};
+
+/** Reader inside an epoch, for the duration of a scope
+  */
+class ScopeEpoch {
+public:
+    inline ScopeEpoch() : epoch(Epoch::enter()) {}
+    inline ~ScopeEpoch() { Epoch::leave(epoch); }
+
+private:
+    uint64_t epoch;
+};
+
+#endif
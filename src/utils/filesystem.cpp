@@ -41,6 +41,7 @@
 #if defined(_WIN32)
 
 #include <windows.h>
+#include <io.h>
 
 #else
 
@@ -126,18 +127,52 @@ int loadFile(const char *filepath, const char **data)
 }
 
 
+/** Sync the data of a file to the disk
+  */
+int syncFile(int fd)
+{
+#if defined(_WIN32)
+    return _commit(fd);
+#else
+    return fdatasync(fd);
+#endif
+}
+
+/** Sync a directory, so that the files created, renamed or removed in it are on the disk
+  *
+  * On Windows, the directories cannot be synced.
+  */
+int syncDir(const std::string &path)
+{
+#if defined(_WIN32)
+    (void)path;
+    return 0;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return -1;
+    int r = fsync(fd);
+    close(fd);
+    return r;
+#endif
+}
+
 /** Write a string to a file
   *
   * @return
   *    0 if success
   *    <0 if error
   */
-int writeToFile(const std::string &filepath, const std::string &data)
+int writeToFile(const std::string &filepath, const std::string &data, bool sync)
 {
-    return writeToFile(filepath.c_str(), data.data(), data.size());
+    return writeToFile(filepath.c_str(), data.data(), data.size(), sync);
 }
 
-int writeToFile(const char *filepath, const char *data, size_t len)
+/** Write a file through a temporary file, renamed when complete
+  *
+  * @param sync
+  *     sync the data of the file before renaming it
+  */
+int writeToFile(const char *filepath, const char *data, size_t len, bool sync)
 {
     int result = 0;
     mode_t mode = O_CREAT | O_TRUNC | O_WRONLY;
@@ -169,6 +204,12 @@ int writeToFile(const char *filepath, const char *data, size_t len)
         }
     }
 
+    if (sync && syncFile(f) != 0) {
+        LOG_ERROR("Could not sync file '%s': (%d) %s", tmp.c_str(), errno, strerror(errno));
+        close(f);
+        return -1;
+    }
+
     close(f);
 
 #if defined(_WIN32)
@@ -280,7 +321,13 @@ std::string getFileSize(const std::string &path)
         LOG_ERROR("stat(%s) error: %s", path.c_str(), strerror(errno));
         return _("N/A");
     }
-    off_t size = fileStat.st_size;
+    return formatFileSize(fileStat.st_size);
+}
+
+/** Format a size in a human readable way (eg: 1.5ko)
+  */
+std::string formatFileSize(off_t size)
+{
     std::stringstream result;
     result.setf( std::ios::fixed, std:: ios::floatfield);
     result.precision(1);
@@ -13,8 +13,10 @@ int loadFile(const std::string &filepath, std::string &data);
 
 int loadFile(const char *filepath, std::string &data);
 int loadFile(const char *filepath, const char **data);
-int writeToFile(const std::string &filepath, const std::string &data);
-int writeToFile(const char *filepath, const char *data, size_t len);
+int writeToFile(const std::string &filepath, const std::string &data, bool sync = false);
+int writeToFile(const char *filepath, const char *data, size_t len, bool sync = false);
+int syncFile(int fd);
+int syncDir(const std::string &path);
 
 bool fileExists(const std::string &path);
 bool isDir(const std::string &path);
@@ -22,6 +24,7 @@ int mkdirs(const std::string &path);
 
 std::string getExePath();
 std::string getFileSize(const std::string &path);
+std::string formatFileSize(off_t size);
 
 DIR *openDir(const std::string &path);
 std::string getNextFile(DIR *d);
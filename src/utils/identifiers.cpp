@@ -13,6 +13,7 @@
 #include "config.h"
 
 #include <openssl/sha.h>
+#include <openssl/evp.h>
 #include <string.h>
 #include <fstream>
 
@@ -32,6 +33,37 @@ std::string getSha1(const std::string &data)
     return getSha1(data.data(), data.size());
 }
 
+Sha1Hasher::Sha1Hasher()
+{
+    ctx = EVP_MD_CTX_new();
+    if (!ctx) LOG_ERROR("Cannot allocate an EVP context: the sha1 digests will fail");
+}
+
+Sha1Hasher::~Sha1Hasher()
+{
+    EVP_MD_CTX_free(ctx);
+}
+
+/** Compute the sha1 of a buffer, in ascii-hexadecimal
+  *
+  * @return
+  *    the sha1, or an empty string on error
+  */
+std::string Sha1Hasher::digest(const char *data, size_t len)
+{
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int mdLen = 0;
+    if (!ctx) return ""; // already logged
+
+    if (!EVP_DigestInit_ex(ctx, EVP_sha1(), 0) ||
+        !EVP_DigestUpdate(ctx, data, len) ||
+        !EVP_DigestFinal_ex(ctx, md, &mdLen)) {
+        LOG_ERROR("Cannot compute sha1 with EVP");
+        return "";
+    }
+    return bin2hex(md, mdLen);
+}
+
 /** Read a file, and return its sha1 in ascii-hexadecimal
   *
   */
@@ -11,5 +11,26 @@ std::string getSha1(const std::string &data);
 std::string getSha1OfFile(const std::string &path);
 std::string getBase64Id(const uint8_t *data, size_t len);
 
+struct evp_md_ctx_st;
+
+/** SHA1 through the OpenSSL EVP interface
+  *
+  * EVP selects the fastest implementation for the processor (eg: SHA
+  * extensions). The context is allocated once and reused for each digest,
+  * which suits the verification of many objects in a row.
+  *
+  * Not thread-safe: use one instance per thread.
+  */
+class Sha1Hasher {
+public:
+    Sha1Hasher();
+    ~Sha1Hasher();
+    std::string digest(const char *data, size_t len);
+private:
+    Sha1Hasher(const Sha1Hasher &); // not copyable (owns the context), not implemented
+    Sha1Hasher &operator=(const Sha1Hasher &); // not implemented
+    struct evp_md_ctx_st *ctx;
+};
+
 
 #endif
@@ -23,19 +23,61 @@ enum LockMode { LOCK_READ_ONLY, LOCK_READ_WRITE };
 
 class ScopeLocker {
 public:
-    inline ScopeLocker(Locker &L, enum LockMode m) : locker(L), mode(m) {
+    inline ScopeLocker(Locker &L, enum LockMode m) : locker(L), mode(m), locked(true) {
         if (mode == LOCK_READ_ONLY) locker.lockForReading();
         else locker.lockForWriting();
     }
     inline ~ScopeLocker() {
-        locker.unlock();
+        if (locked) locker.unlock();
+    }
+    // release the lock before the end of the scope
+    inline void unlock() {
+        if (locked) locker.unlock();
+        locked = false;
     }
 
 private:
     Locker &locker;
     enum LockMode mode;
+    bool locked;
 };
 
+/** Lock an index that is built on its first use
+  *
+  * Such an index is built on its first use (not at the loading), and then
+  * kept up to date by the modifications of its owner (eg: the project),
+  * done under the write lock of the owner. The uses, under the read lock
+  * of the owner, share the locker of the index for reading, except the
+  * first one that builds the index, which takes it for writing. Likewise,
+  * the contents of 2 indexes are exchanged under the write lock of their
+  * owners, while no use is in progress.
+  *
+  * The BuildLocker takes the locker for reading, to check if the index
+  * is built. If not, lockForBuilding() takes it for writing, and the index
+  * must then be checked again, as it may have been built meanwhile by a
+  * concurrent use:
+  *
+  *     BuildLocker buildLocker(locker);
+  *     if (built) return;
+  *     buildLocker.lockForBuilding();
+  *     if (!built) build();
+  */
+class BuildLocker {
+public:
+    inline BuildLocker(Locker &L) : locker(L) {
+        locker.lockForReading();
+    }
+    inline ~BuildLocker() {
+        locker.unlock();
+    }
+    inline void lockForBuilding() {
+        locker.unlock();
+        locker.lockForWriting();
+    }
+
+private:
+    Locker &locker;
+};
 
 
 
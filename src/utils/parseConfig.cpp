@@ -193,6 +193,185 @@ std::list<std::list<std::string> > parseConfigTokens(const char *buf, size_t len
 }
 
 
+/** Move the current token to the decoded storage, if not already done
+  */
+static inline void decodeToken(TokenViews &views, TokenView &token)
+{
+    if (token.decoded) return;
+    size_t offset = views.decoded.size();
+    views.decoded.append(views.buffer + token.offset, token.size);
+    token.offset = offset;
+    token.decoded = true;
+}
+
+/** Append a character to the current token
+  *
+  * A token that is not decoded is contiguous in the buffer, and
+  * only its size needs to be incremented.
+  */
+static inline void appendToToken(TokenViews &views, TokenView &token, char c)
+{
+    if (token.decoded) views.decoded += c;
+    token.size++;
+}
+
+/** Parse a text buffer into views of tokens
+  *
+  * See parseConfigTokens() for the syntax.
+  */
+void TokenViews::parse(const char *buf, size_t len)
+{
+    buffer = buf;
+    decoded.clear();
+    tokens.clear();
+    lineEnds.clear();
+
+    size_t i = 0;
+    enum State {
+        P_NONE,
+        P_IN_TOKEN,
+        P_IN_COMMENT,
+        P_IN_BOUNDARY_HEADER,
+        P_IN_BOUNDARY
+    };
+    enum State state = P_NONE;
+    TokenView token; // current token
+    token.offset = 0;
+    token.size = 0;
+    token.decoded = false;
+    size_t lineStart = 0; // index of the first token of the current line
+    std::string boundary;
+    size_t boundedStart = 0;
+    bool doubleQuoted = false;
+    bool backslash = false;
+    bool percent = false;
+
+    for (i=0; i<len; i++) {
+        char c = buf[i];
+        switch (state) {
+        case P_IN_COMMENT:
+            if (c == '\n') state = P_NONE;
+            break;
+
+        case P_IN_BOUNDARY_HEADER:
+            if (c == '\n') {
+                state = P_IN_BOUNDARY;
+                boundary.insert(0, "\n"); // add a \n at the beginning
+                boundedStart = i + 1;
+            } else if (isblank(c)) continue; // ignore blanks
+            else {
+                boundary += c;
+            }
+            break;
+
+        case P_IN_BOUNDARY:
+            // check if the text before this character ends with the boundary
+            if (i - boundedStart >= boundary.size() &&
+                0 == memcmp(buf + i - boundary.size(), boundary.data(), boundary.size())) {
+                token.offset = boundedStart;
+                token.size = i - boundary.size() - boundedStart;
+                token.decoded = false;
+                tokens.push_back(token);
+                lineEnds.push_back(tokens.size());
+                lineStart = tokens.size();
+                state = P_NONE;
+            }
+            break;
+
+        case P_IN_TOKEN:
+            if (backslash || percent || doubleQuoted || c == '"' || c == '%' || c == '\\') {
+                decodeToken(*this, token);
+            }
+
+            if (backslash) {
+                if (c == 'n') appendToToken(*this, token, '\n');
+                else if (c == 'r') appendToToken(*this, token, '\r');
+                else if (c == 't') appendToToken(*this, token, '\t');
+                else if (c == '\n') ; // nothing particular here, continue on next line
+                else appendToToken(*this, token, c);
+
+                backslash = false;
+
+            } else if (percent) {
+                appendToToken(*this, token, '%');
+                percent = false;
+
+                if (c == '%') ; // correct syntax, do nothing more
+                else i--; // incorrect syntax, replay this character
+
+            } else if (doubleQuoted) {
+                if (c == '"') doubleQuoted = false; // end of the "..." portion
+                else if (c == '%') percent = true;
+                else if (c == '\\') backslash = true;
+                else appendToToken(*this, token, c);
+
+            } else {
+                if (c == '"') doubleQuoted = true;
+                else if (c == '%') percent = true;
+                else if (c == '\\') backslash = true;
+                else if (c == '\t' || c == ' ') {
+                    // end of token
+                    tokens.push_back(token);
+                    state = P_NONE;
+
+                } else if (c == '\r' || c == '\n') {
+                    // end of token and end of line
+                    tokens.push_back(token);
+                    lineEnds.push_back(tokens.size());
+                    lineStart = tokens.size();
+                    state = P_NONE;
+
+                } else appendToToken(*this, token, c);
+            }
+            break;
+
+        case P_NONE:
+        default:
+            if (c == '\r') ; // do nothing, ignore this
+            else if (backslash) {
+                if (c == '\n') backslash = false; // do nothing (concatenate next line with current line)
+                else {
+                    // this is part of a token
+                    // replay this character in P_IN_TOKEN
+                    token.offset = i;
+                    token.size = 0;
+                    token.decoded = false;
+                    i--;
+                    state = P_IN_TOKEN;
+                }
+            } else if (c == '\n') { // go to next line
+                if (tokens.size() > lineStart) { lineEnds.push_back(tokens.size()); lineStart = tokens.size(); }
+            } else if (c == ' ' || c == '\t') ; // do nothing
+            else if (c == '#') {
+                if (tokens.size() > lineStart) { lineEnds.push_back(tokens.size()); lineStart = tokens.size(); }
+                state = P_IN_COMMENT;
+            } else if (c == '\\')  backslash = true;
+            else if (c == '<') {
+                state = P_IN_BOUNDARY_HEADER;
+                boundary.clear();
+            } else {
+                // replay this character in P_IN_TOKEN
+                token.offset = i;
+                token.size = 0;
+                token.decoded = false;
+                state = P_IN_TOKEN;
+                i--;
+            }
+            break;
+        }
+    }
+    // purge remaininig token and line
+    if (state == P_IN_TOKEN) tokens.push_back(token);
+    if (tokens.size() > lineStart) lineEnds.push_back(tokens.size());
+}
+
+bool TokenViews::equals(const TokenView &t, const char *s) const
+{
+    size_t n = strlen(s);
+    return n == t.size && 0 == memcmp(data(t), s, n);
+}
+
+
 /** Look if a list contains a specific item
   */
 bool has(const std::list<std::string> &L, const std::string item)
@@ -5,8 +5,44 @@
 #include <stdint.h>
 #include <string>
 #include <list>
+#include <vector>
 
 std::list<std::list<std::string> > parseConfigTokens(const char *buf, size_t len);
+
+/** Location of a token, either in the parsed buffer or in the decoded storage
+  */
+struct TokenView {
+    size_t offset;
+    size_t size;
+    bool decoded; // true if the token is in TokenViews::decoded (it had quotes or escapes)
+};
+
+/** Tokens of a parsed buffer, as views over this buffer
+  *
+  * Same syntax and same result as parseConfigTokens(), but the tokens
+  * are not copied: only the tokens that contain double-quotes or
+  * escape sequences are decoded, into a single storage string.
+  *
+  * The parsed buffer must remain valid while the views are used.
+  */
+struct TokenViews {
+    const char *buffer;
+    std::string decoded;
+    std::vector<TokenView> tokens;
+    std::vector<size_t> lineEnds; // index in 'tokens' of the end of each line
+
+    TokenViews() : buffer(0) {}
+    void parse(const char *buf, size_t len);
+    inline size_t getNumLines() const { return lineEnds.size(); }
+    inline size_t lineBegin(size_t line) const { return line ? lineEnds[line-1] : 0; }
+    inline size_t lineEnd(size_t line) const { return lineEnds[line]; }
+    inline const char *data(const TokenView &t) const {
+        return t.decoded ? decoded.data() + t.offset : buffer + t.offset;
+    }
+    inline std::string str(const TokenView &t) const { return std::string(data(t), t.size); }
+    bool equals(const TokenView &t, const char *s) const;
+};
+
 std::list<std::string> parseColspec(const char *spec, const std::list<std::string> &knownProperties);
 std::string serializeSimpleToken(const std::string token);
 std::string serializeProperty(const std::string &propertyName, const std::string &value);
@@ -0,0 +1,226 @@
+/*   Small Issue Tracker
+ *   Copyright (C) 2013 Frederic Hoerni
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License v2 as published by
+ *   the Free Software Foundation.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ */
+#include "config.h"
+
+#include <algorithm>
+
+#include "properties.h"
+#include "global.h"
+
+PropertyValues::PropertyValues(const std::list<std::string> &list)
+{
+    values.reserve(list.size());
+    std::list<std::string>::const_iterator v;
+    FOREACH(v, list) values.push_back(IString(*v));
+}
+
+PropertyValues::operator std::list<std::string>() const
+{
+    std::list<std::string> list;
+    const_iterator v;
+    FOREACH(v, values) list.push_back(v->str());
+    return list;
+}
+
+bool PropertyValues::isInterned() const
+{
+    const_iterator v;
+    FOREACH(v, values) if (!v->isInterned()) return false;
+    return true;
+}
+
+void PropertyValues::intern()
+{
+    std::vector<IString>::iterator v;
+    FOREACH(v, values) if (!v->isInterned()) *v = IString::interned(v->str());
+}
+
+const std::vector<Properties::Property> Properties::NoProperties;
+
+Properties::Properties(const PropertiesMap &map) : shared(0)
+{
+    if (map.empty()) return;
+
+    // the map is already sorted by name
+    shared = new SharedProperties();
+    shared->properties.reserve(map.size());
+    PropertiesIt p;
+    FOREACH(p, map) shared->properties.push_back(Property(IString::interned(p->first), PropertyValues(p->second)));
+}
+
+Properties &Properties::operator=(const Properties &other)
+{
+    if (other.shared) other.shared->acquire();
+    if (shared) shared->release();
+    shared = other.shared;
+    return *this;
+}
+
+Properties::operator PropertiesMap() const
+{
+    PropertiesMap map;
+    const_iterator p;
+    FOREACH(p, getVector()) map[p->first] = p->second;
+    return map;
+}
+
+/** Get the vector for a modification, detaching it from the other copies if needed
+  */
+std::vector<Properties::Property> &Properties::getVectorForWrite()
+{
+    if (!shared) {
+        shared = new SharedProperties();
+
+    } else if (__atomic_load_n(&shared->refs, __ATOMIC_ACQUIRE) > 1) {
+        SharedProperties *copy = new SharedProperties();
+        copy->properties = shared->properties;
+        shared->release();
+        shared = copy;
+    }
+    return shared->properties;
+}
+
+void Properties::clear()
+{
+    if (shared) shared->release();
+    shared = 0;
+}
+
+static bool lessName(const Properties::Property &p, const std::string &name)
+{
+    return p.first.compare(name) < 0;
+}
+
+Properties::const_iterator Properties::find(const std::string &name) const
+{
+    const std::vector<Property> &properties = getVector();
+    const_iterator p = std::lower_bound(properties.begin(), properties.end(), name, lessName);
+    if (p != properties.end() && p->first == name) return p;
+    return properties.end();
+}
+
+void Properties::erase(const std::string &name)
+{
+    if (find(name) == end()) return; // do not detach for nothing
+
+    std::vector<Property> &properties = getVectorForWrite();
+    std::vector<Property>::iterator p = std::lower_bound(properties.begin(), properties.end(), name, lessName);
+    properties.erase(p);
+}
+
+/** Get the values of a property, inserting it if needed (as std::map::operator[])
+  */
+PropertyValues &Properties::operator[](const std::string &name)
+{
+    std::vector<Property> &properties = getVectorForWrite();
+    std::vector<Property>::iterator p = std::lower_bound(properties.begin(), properties.end(), name, lessName);
+    if (p != properties.end() && p->first == name) return p->second;
+    p = properties.insert(p, Property(IString::interned(name), PropertyValues()));
+    return p->second;
+}
+
+/** Append a property, whose name is after the names of the current properties
+  *
+  * Cheaper than operator[] for building the properties in the order of their names.
+  */
+void Properties::append(const Property &property)
+{
+    getVectorForWrite().push_back(property);
+}
+
+/** Intern the values of a property (eg: select property)
+  */
+void Properties::internValues(const std::string &name)
+{
+    const_iterator p = find(name);
+    if (p == end() || p->second.isInterned()) return; // do not detach for nothing
+
+    std::vector<Property> &properties = getVectorForWrite();
+    std::vector<Property>::iterator q = std::lower_bound(properties.begin(), properties.end(), name, lessName);
+    q->second.intern();
+}
+
+bool operator==(const PropertyValues &a, const PropertyValues &b)
+{
+    if (a.size() != b.size()) return false;
+    return std::equal(a.begin(), a.end(), b.begin());
+}
+
+bool operator==(const PropertyValues &a, const std::list<std::string> &b)
+{
+    if (a.size() != b.size()) return false;
+    return std::equal(a.begin(), a.end(), b.begin());
+}
+
+std::string toString(const PropertyValues &values, const char *sep)
+{
+    std::string text;
+    PropertyValues::const_iterator v;
+    for (v=values.begin(); v!=values.end(); v++) {
+        if (v != values.begin()) {
+            if (sep) text += sep;
+            else text += ", ";
+        }
+        text += v->c_str();
+    }
+    return text;
+}
+
+std::string getProperty(const Properties &properties, const std::string &name)
+{
+    Properties::const_iterator t = properties.find(name);
+    std::string propertyValue = "";
+    if (t != properties.end() && (t->second.size()>0) ) propertyValue = toString(t->second);
+
+    return propertyValue;
+}
+
+/** Look if any value of the properties has the given value
+ */
+bool hasPropertyValue(const Properties &properties, const std::string &value)
+{
+    Properties::const_iterator pit;
+    FOREACH(pit, properties) {
+        PropertyValues::const_iterator v;
+        FOREACH(v, pit->second) {
+            if (*v == value) return true;
+        }
+    }
+    return false;
+}
+
+int compareProperties(const Properties &plist1, const Properties &plist2, const std::string &name)
+{
+    Properties::const_iterator p1 = plist1.find(name);
+    Properties::const_iterator p2 = plist2.find(name);
+
+    if (p1 == plist1.end() && p2 == plist2.end()) return 0;
+    else if (p1 == plist1.end()) return -1; // arbitrary choice
+    else if (p2 == plist2.end()) return +1; // arbitrary choice
+    else {
+        PropertyValues::const_iterator v1 = p1->second.begin();
+        PropertyValues::const_iterator v2 = p2->second.begin();
+        while (v1 != p1->second.end() && v2 != p2->second.end()) {
+            int lt = v1->compare(*v2);
+            if (lt < 0) return -1;
+            else if (lt > 0) return +1;
+            // else continue
+            v1++;
+            v2++;
+        }
+        if (v1 == p1->second.end() && v2 == p2->second.end()) {
+            return 0; // they are equal
+        } else if (v1 == p1->second.end()) return -1; // arbitrary choice
+        else return +1; // arbitrary choice
+    }
+}
@@ -0,0 +1,108 @@
+#ifndef _properties_h
+#define _properties_h
+
+#include <string>
+#include <list>
+#include <vector>
+#include <map>
+
+#include "stringTable.h"
+#include "stringTools.h"
+
+/** Values of a property of an entry or of an issue
+  *
+  * The values are owned, unless interned by intern() (see IString). The
+  * conversion to a list of strings copies the values (for the rendering).
+  */
+class PropertyValues {
+public:
+    typedef std::vector<IString>::const_iterator const_iterator;
+
+    inline PropertyValues() {}
+    PropertyValues(const std::list<std::string> &list);
+    operator std::list<std::string>() const;
+
+    inline const_iterator begin() const { return values.begin(); }
+    inline const_iterator end() const { return values.end(); }
+    inline size_t size() const { return values.size(); }
+    inline bool empty() const { return values.empty(); }
+    inline const std::string &front() const { return values.front().str(); }
+    inline const std::string &back() const { return values.back().str(); }
+    inline void push_back(const std::string &value) { values.push_back(IString(value)); }
+    inline void clear() { values.clear(); }
+    bool isInterned() const;
+    void intern();
+
+private:
+    std::vector<IString> values;
+};
+
+/** Properties of an entry or of an issue
+  *
+  * Compact replacement of a PropertiesMap: a vector sorted by name (the
+  * order of iteration is the same as a PropertiesMap), whose names are
+  * interned.
+  *
+  * The vector is shared between the copies (copy-on-write): copying the
+  * properties (eg: IssueCopy) only takes a reference, and a modification
+  * (operator[], erase, clear) first detaches a private vector if another
+  * copy still references the current one. The references may be taken
+  * and released concurrently (eg: readers under the read lock of the
+  * project), but a given Properties object must not be modified while
+  * being copied (the writer holds the write lock).
+  */
+class Properties {
+public:
+    typedef std::pair<IString, PropertyValues> Property;
+    typedef std::vector<Property>::const_iterator const_iterator;
+
+    inline Properties() : shared(0) {}
+    inline Properties(const Properties &other) : shared(other.shared) { if (shared) shared->acquire(); }
+    Properties(const PropertiesMap &map);
+    inline ~Properties() { if (shared) shared->release(); }
+    Properties &operator=(const Properties &other);
+    operator PropertiesMap() const;
+
+    inline const_iterator begin() const { return getVector().begin(); }
+    inline const_iterator end() const { return getVector().end(); }
+    inline size_t size() const { return getVector().size(); }
+    inline bool empty() const { return getVector().empty(); }
+    void clear();
+    const_iterator find(const std::string &name) const;
+    inline size_t count(const std::string &name) const { return find(name) != end() ? 1 : 0; }
+    void erase(const std::string &name);
+    PropertyValues &operator[](const std::string &name);
+    void append(const Property &property);
+    void internValues(const std::string &name);
+
+private:
+    /** Reference-counted vector, never modified while shared
+      */
+    struct SharedProperties {
+        std::vector<Property> properties;
+        int refs;
+        inline SharedProperties() : refs(1) {}
+        inline void acquire() { __sync_add_and_fetch(&refs, 1); }
+        inline void release() { if (__sync_sub_and_fetch(&refs, 1) == 0) delete this; }
+    };
+    inline const std::vector<Property> &getVector() const { return shared ? shared->properties : NoProperties; }
+    std::vector<Property> &getVectorForWrite();
+
+    static const std::vector<Property> NoProperties;
+    SharedProperties *shared; // null if no properties
+};
+
+bool operator==(const PropertyValues &a, const PropertyValues &b);
+bool operator==(const PropertyValues &a, const std::list<std::string> &b);
+inline bool operator==(const std::list<std::string> &a, const PropertyValues &b) { return b == a; }
+inline bool operator!=(const PropertyValues &a, const PropertyValues &b) { return !(a == b); }
+
+typedef Properties::const_iterator PropertiesCIt;
+typedef PropertyValues::const_iterator PropertyValuesIt;
+
+std::string toString(const PropertyValues &values, const char *sep = 0);
+std::string getProperty(const Properties &properties, const std::string &name);
+bool hasPropertyValue(const Properties &properties, const std::string &value);
+int compareProperties(const Properties &plist1, const Properties &plist2, const std::string &name);
+
+#endif
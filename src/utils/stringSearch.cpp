@@ -0,0 +1,166 @@
+/*   Small Issue Tracker
+ *   Copyright (C) 2013 Frederic Hoerni
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License v2 as published by
+ *   the Free Software Foundation.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ */
+#include "config.h"
+
+#include "stringSearch.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define STRING_SEARCH_X86
+#include <immintrin.h>
+#endif
+
+static inline unsigned char foldAscii(char c)
+{
+    unsigned char u = (unsigned char)c;
+    if (u >= 'A' && u <= 'Z') return u + ('a' - 'A');
+    return u;
+}
+
+static inline bool equalNoCase(const char *a, const char *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        if (foldAscii(a[i]) != foldAscii(b[i])) return false;
+    }
+    return true;
+}
+
+static const char *findNoCaseScalar(const char *text, size_t n, const char *pattern, size_t m)
+{
+    if (m == 0) return text;
+    if (m > n) return 0;
+
+    unsigned char first = foldAscii(pattern[0]);
+    for (size_t i = 0; i + m <= n; i++) {
+        if (foldAscii(text[i]) == first && equalNoCase(text + i + 1, pattern + 1, m - 1)) return text + i;
+    }
+    return 0;
+}
+
+#ifdef STRING_SEARCH_X86
+
+// The blocks of the text at the positions of the first and last characters
+// of the pattern are compared to these characters. Then the candidates
+// positions are verified. The bytes >= 0x80 are negative in the signed
+// comparisons, and thus are not folded.
+
+__attribute__((target("sse2")))
+static inline __m128i foldAscii16(__m128i v)
+{
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)),
+                                  _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+    return _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+__attribute__((target("sse2")))
+static const char *findNoCaseSse2(const char *text, size_t n, const char *pattern, size_t m)
+{
+    if (m == 0) return text;
+    if (m > n) return 0;
+
+    const __m128i first = _mm_set1_epi8(foldAscii(pattern[0]));
+    const __m128i last = _mm_set1_epi8(foldAscii(pattern[m-1]));
+    size_t i = 0;
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        __m128i blockFirst = foldAscii16(_mm_loadu_si128((const __m128i*)(text + i)));
+        __m128i blockLast = foldAscii16(_mm_loadu_si128((const __m128i*)(text + i + m - 1)));
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(blockFirst, first),
+                                                        _mm_cmpeq_epi8(blockLast, last)));
+        while (mask) {
+            int bit = __builtin_ctz(mask);
+            if (equalNoCase(text + i + bit + 1, pattern + 1, m - 1)) return text + i + bit;
+            mask &= mask - 1;
+        }
+    }
+    return findNoCaseScalar(text + i, n - i, pattern, m);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i foldAscii32(__m256i v)
+{
+    __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('A' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), v));
+    return _mm256_or_si256(v, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+
+__attribute__((target("avx2")))
+static const char *findNoCaseAvx2(const char *text, size_t n, const char *pattern, size_t m)
+{
+    // short texts (most of the values of properties): do not touch the AVX
+    // registers, so that the transitions to the SSE code are cheap
+    if (m == 0 || m - 1 + 32 > n) return findNoCaseSse2(text, n, pattern, m);
+
+    const __m256i first = _mm256_set1_epi8(foldAscii(pattern[0]));
+    const __m256i last = _mm256_set1_epi8(foldAscii(pattern[m-1]));
+    size_t i = 0;
+    for (; i + m - 1 + 32 <= n; i += 32) {
+        __m256i blockFirst = foldAscii32(_mm256_loadu_si256((const __m256i*)(text + i)));
+        __m256i blockLast = foldAscii32(_mm256_loadu_si256((const __m256i*)(text + i + m - 1)));
+        unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first),
+                                                              _mm256_cmpeq_epi8(blockLast, last)));
+        while (mask) {
+            int bit = __builtin_ctz(mask);
+            if (equalNoCase(text + i + bit + 1, pattern + 1, m - 1)) return text + i + bit;
+            mask &= mask - 1;
+        }
+    }
+    _mm256_zeroupper(); // before the SSE code
+    return findNoCaseSse2(text + i, n - i, pattern, m);
+}
+
+#endif
+
+static FindNoCaseFunction selectFindNoCase()
+{
+#ifdef STRING_SEARCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return findNoCaseAvx2;
+    if (__builtin_cpu_supports("sse2")) return findNoCaseSse2;
+#endif
+    return findNoCaseScalar;
+}
+
+static const FindNoCaseFunction FindNoCase = selectFindNoCase();
+
+const char *findNoCase(const char *text, size_t textLen, const char *pattern, size_t patternLen)
+{
+    return FindNoCase(text, textLen, pattern, patternLen);
+}
+
+/** Compare 2 strings, ignoring the case (the same folding as findNoCase)
+  */
+bool equalNoCase(const char *a, const char *b)
+{
+    while (*a && foldAscii(*a) == foldAscii(*b)) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+/** Tell if a pattern has special characters for fnmatch
+  *
+  * If not, fnmatch(pattern, s, FNM_CASEFOLD) is the same as equalNoCase(pattern, s).
+  */
+bool isGlobPattern(const char *pattern)
+{
+    return strpbrk(pattern, "*?[\\") != 0;
+}
+
+void getFindNoCaseKernels(std::vector<std::pair<std::string, FindNoCaseFunction> > &kernels)
+{
+    kernels.push_back(std::make_pair(std::string("scalar"), findNoCaseScalar));
+#ifdef STRING_SEARCH_X86
+    if (__builtin_cpu_supports("sse2")) kernels.push_back(std::make_pair(std::string("sse2"), findNoCaseSse2));
+    if (__builtin_cpu_supports("avx2")) kernels.push_back(std::make_pair(std::string("avx2"), findNoCaseAvx2));
+#endif
+}
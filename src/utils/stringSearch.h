@@ -0,0 +1,40 @@
+#ifndef _stringSearch_h
+#define _stringSearch_h
+
+#include <string>
+#include <vector>
+#include <string.h>
+
+typedef const char *(*FindNoCaseFunction)(const char *text, size_t textLen,
+                                          const char *pattern, size_t patternLen);
+
+/** Case-insensitive search of a pattern in a text
+  *
+  * Only the ASCII letters are folded (the bytes of the UTF-8 multi-byte
+  * sequences are compared as they are), as tolower() in the C locale.
+  * An empty pattern is found at the beginning of the text.
+  *
+  * The search is vectorized (SSE2 or AVX2, selected at runtime).
+  *
+  * @return
+  *     pointer to the first occurrence, or null if not found
+  */
+const char *findNoCase(const char *text, size_t textLen, const char *pattern, size_t patternLen);
+
+/** Same as mg_strcasestr: the texts are taken up to their null character
+  */
+inline const char *findNoCase(const char *text, const char *pattern)
+{
+    return findNoCase(text, strlen(text), pattern, strlen(pattern));
+}
+
+bool equalNoCase(const char *a, const char *b);
+bool isGlobPattern(const char *pattern);
+
+/** Get the implementations of findNoCase supported by this CPU (for tests and benchmarks)
+  *
+  * The selected one is the last.
+  */
+void getFindNoCaseKernels(std::vector<std::pair<std::string, FindNoCaseFunction> > &kernels);
+
+#endif
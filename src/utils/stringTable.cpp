@@ -0,0 +1,94 @@
+/*   Small Issue Tracker
+ *   Copyright (C) 2013 Frederic Hoerni
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License v2 as published by
+ *   the Free Software Foundation.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ */
+#include "config.h"
+
+#include <set>
+#include <pthread.h>
+
+#include "stringTable.h"
+
+#define STRING_TABLE_STRIPES 32 // independent parts of the table, for the concurrent loading of projects
+
+/** Part of the table, selected by the hash of the strings
+  */
+struct StringTableStripe {
+    pthread_mutex_t mutex;
+    std::set<std::string> strings; // the addresses of the nodes are stable
+    size_t size;
+    StringTableStripe() : size(0) { pthread_mutex_init(&mutex, NULL); }
+};
+
+static StringTableStripe *getStripes()
+{
+    static StringTableStripe stripes[STRING_TABLE_STRIPES];
+    return stripes;
+}
+
+static uint32_t hashString(const std::string &s)
+{
+    uint32_t h = 2166136261u; // FNV-1a
+    for (size_t i = 0; i < s.size(); i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/** Get the interned copy of a string, creating it if needed
+  */
+const std::string *StringTable::intern(const std::string &s)
+{
+    StringTableStripe &stripe = getStripes()[hashString(s) % STRING_TABLE_STRIPES];
+    pthread_mutex_lock(&stripe.mutex);
+    std::pair<std::set<std::string>::iterator, bool> result = stripe.strings.insert(s);
+    if (result.second) stripe.size += s.size();
+    pthread_mutex_unlock(&stripe.mutex);
+    return &(*result.first);
+}
+
+StringTableStats StringTable::getStats()
+{
+    StringTableStats stats;
+    StringTableStripe *stripes = getStripes();
+    for (int i = 0; i < STRING_TABLE_STRIPES; i++) {
+        pthread_mutex_lock(&stripes[i].mutex);
+        stats.count += stripes[i].strings.size();
+        stats.size += stripes[i].size;
+        pthread_mutex_unlock(&stripes[i].mutex);
+    }
+    return stats;
+}
+
+IString &IString::operator=(const IString &other)
+{
+    if (this == &other) return *this;
+    uintptr_t newPtr = other.isInterned() ? other.ptr : own(other.str());
+    if (!isInterned()) delete (std::string*)ptr;
+    ptr = newPtr;
+    return *this;
+}
+
+/** Get an interned string (eg: names of properties, values of select properties)
+  */
+IString IString::interned(const std::string &s)
+{
+    IString result;
+    result.ptr = tag(StringTable::intern(s));
+    return result;
+}
+
+uintptr_t IString::EmptyString()
+{
+    static const uintptr_t empty = tag(StringTable::intern(""));
+    return empty;
+}
@@ -0,0 +1,70 @@
+#ifndef _stringTable_h
+#define _stringTable_h
+
+#include <string>
+#include <stdint.h>
+
+struct StringTableStats {
+    size_t count; // number of interned strings
+    size_t size; // bytes of the interned strings
+    StringTableStats() : count(0), size(0) {}
+};
+
+/** Global table of interned strings
+  *
+  * An interned string is stored once, and never freed: only the names
+  * of the properties and the values of the select properties are
+  * interned (see Project::internSelectValues). The table grows with the
+  * names and options of the configurations, and with the values pushed
+  * or set in select properties beyond their options.
+  */
+class StringTable {
+public:
+    static const std::string *intern(const std::string &s);
+    static StringTableStats getStats();
+};
+
+/** String of a property: either interned (shared), or owned
+  *
+  * The interned strings and the owned strings are both referenced by a
+  * pointer, the lowest bit telling if the string is interned. So the
+  * handle takes the size of a pointer. A string is owned, unless created
+  * by interned().
+  */
+class IString {
+public:
+    inline IString() : ptr(EmptyString()) {}
+    inline IString(const std::string &s) : ptr(own(s)) {}
+    inline IString(const IString &other) : ptr(other.isInterned() ? other.ptr : own(other.str())) {}
+    inline ~IString() { if (!isInterned()) delete (std::string*)ptr; }
+    IString &operator=(const IString &other);
+    static IString interned(const std::string &s);
+
+    inline const std::string &str() const { return *(const std::string*)(ptr & ~(uintptr_t)1); }
+    inline operator const std::string&() const { return str(); }
+    inline const char *c_str() const { return str().c_str(); }
+    inline size_t size() const { return str().size(); }
+    inline bool empty() const { return str().empty(); }
+    inline int compare(const std::string &s) const { return str().compare(s); }
+    inline int compare(const IString &other) const { return ptr == other.ptr ? 0 : str().compare(other.str()); }
+    inline bool sameAs(const IString &other) const { return ptr == other.ptr; }
+    inline bool isInterned() const { return (ptr & 1) != 0; }
+
+private:
+    static inline uintptr_t own(const std::string &s) { return (uintptr_t)new std::string(s); }
+    static inline uintptr_t tag(const std::string *s) { return (uintptr_t)s | 1; }
+    static uintptr_t EmptyString();
+    uintptr_t ptr;
+};
+
+inline bool operator==(const IString &a, const IString &b) { return a.sameAs(b) || a.str() == b.str(); }
+inline bool operator==(const IString &a, const std::string &b) { return a.str() == b; }
+inline bool operator==(const std::string &a, const IString &b) { return a == b.str(); }
+inline bool operator==(const IString &a, const char *b) { return a.str() == b; }
+inline bool operator!=(const IString &a, const IString &b) { return a.str() != b.str(); }
+inline bool operator!=(const IString &a, const std::string &b) { return a.str() != b; }
+inline bool operator!=(const std::string &a, const IString &b) { return a != b.str(); }
+inline bool operator!=(const IString &a, const char *b) { return a.str() != b; }
+inline bool operator<(const IString &a, const IString &b) { return a.str() < b.str(); }
+
+#endif
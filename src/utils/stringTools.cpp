@@ -50,6 +50,30 @@ std::string bin2hex(const uint8_t *buffer, size_t len)
 }
 
 
+uint32_t getU32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+uint64_t getU64(const uint8_t *p)
+{
+    return ((uint64_t)getU32(p) << 32) | getU32(p+4);
+}
+
+void putU32(std::string &out, uint32_t x)
+{
+    out += (char)(x >> 24);
+    out += (char)(x >> 16);
+    out += (char)(x >> 8);
+    out += (char)x;
+}
+
+void putU64(std::string &out, uint64_t x)
+{
+    putU32(out, (uint32_t)(x >> 32));
+    putU32(out, (uint32_t)x);
+}
+
 /** Take first token name out of string (typically uri)
   *
   * And consume the first separator encountered.
@@ -15,6 +15,12 @@ typedef std::map<std::string, std::list<std::string> >::const_iterator Propertie
 std::string bin2hex(const uint8_t *buffer, size_t len);
 std::string bin2hex(const ustring & in);
 
+// big-endian binary integers
+uint32_t getU32(const uint8_t *p);
+uint64_t getU64(const uint8_t *p);
+void putU32(std::string &out, uint32_t x);
+void putU64(std::string &out, uint64_t x);
+
 std::string popToken(std::string & uri, char separator);
 void trimLeft(std::string & s, const char *c);
 void trimRight(std::string &s, const char *c);
@@ -0,0 +1,147 @@
+/*   Small Issue Tracker
+ *   Copyright (C) 2013 Frederic Hoerni
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License v2 as published by
+ *   the Free Software Foundation.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ */
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#if defined(_WIN32)
+  #include <windows.h>
+#endif
+
+#include "threadPool.h"
+#include "logging.h"
+
+/** Create a pool and start its workers
+  *
+  * @param nWorkers
+  *     number of worker threads. At least one worker is started.
+  */
+ThreadPool::ThreadPool(int nWorkers) : running(0), stopping(false)
+{
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&jobAvailable, NULL);
+    pthread_cond_init(&jobDone, NULL);
+
+    if (nWorkers < 1) nWorkers = 1;
+    for (int i = 0; i < nWorkers; i++) {
+        pthread_t thread;
+        int r = pthread_create(&thread, NULL, workerLoop, this);
+        if (r != 0) {
+            LOG_ERROR("Cannot create worker thread: (%d) %s", r, strerror(r));
+            if (threads.empty()) exit(1);
+            break;
+        }
+        threads.push_back(thread);
+    }
+}
+
+/** Wait for the completion of all the jobs and stop the workers
+  */
+ThreadPool::~ThreadPool()
+{
+    waitAll();
+
+    pthread_mutex_lock(&mutex);
+    stopping = true;
+    pthread_cond_broadcast(&jobAvailable);
+    pthread_mutex_unlock(&mutex);
+
+    std::vector<pthread_t>::iterator thread;
+    for (thread = threads.begin(); thread != threads.end(); thread++) {
+        pthread_join(*thread, NULL);
+    }
+
+    pthread_cond_destroy(&jobDone);
+    pthread_cond_destroy(&jobAvailable);
+    pthread_mutex_destroy(&mutex);
+}
+
+/** Submit a job
+  *
+  * @param group
+  *     group of the job, to be passed to wait() (optional)
+  */
+void ThreadPool::submit(JobFunction function, void *arg, JobGroup *group)
+{
+    Job job;
+    job.function = function;
+    job.arg = arg;
+    job.group = group;
+
+    pthread_mutex_lock(&mutex);
+    if (group) group->pending++;
+    jobs.push_back(job);
+    pthread_cond_signal(&jobAvailable);
+    pthread_mutex_unlock(&mutex);
+}
+
+/** Wait until the jobs of a group are completed
+  *
+  * The jobs of the other submitters are not waited for.
+  */
+void ThreadPool::wait(JobGroup &group)
+{
+    pthread_mutex_lock(&mutex);
+    while (group.pending > 0) pthread_cond_wait(&jobDone, &mutex);
+    pthread_mutex_unlock(&mutex);
+}
+
+/** Wait until all the submitted jobs are completed
+  */
+void ThreadPool::waitAll()
+{
+    pthread_mutex_lock(&mutex);
+    while (!jobs.empty() || running > 0) pthread_cond_wait(&jobDone, &mutex);
+    pthread_mutex_unlock(&mutex);
+}
+
+void *ThreadPool::workerLoop(void *arg)
+{
+    ThreadPool *pool = (ThreadPool*)arg;
+
+    pthread_mutex_lock(&pool->mutex);
+    while (1) {
+        while (pool->jobs.empty() && !pool->stopping) pthread_cond_wait(&pool->jobAvailable, &pool->mutex);
+        if (pool->jobs.empty()) break; // stopping
+
+        Job job = pool->jobs.front();
+        pool->jobs.pop_front();
+        pool->running++;
+        pthread_mutex_unlock(&pool->mutex);
+
+        job.function(job.arg);
+
+        pthread_mutex_lock(&pool->mutex);
+        if (job.group) job.group->pending--;
+        pool->running--;
+        pthread_cond_broadcast(&pool->jobDone);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return 0;
+}
+
+/** Get the number of online processors
+  */
+int ThreadPool::getNumCpus()
+{
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    int n = info.dwNumberOfProcessors;
+#else
+    int n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (n < 1) n = 1;
+    return n;
+}
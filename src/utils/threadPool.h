@@ -0,0 +1,51 @@
+#ifndef _threadPool_h
+#define _threadPool_h
+
+#include <list>
+#include <vector>
+#include <pthread.h>
+
+/** Bounded pool of worker threads
+  *
+  * Jobs are executed in the order of submission, by at most
+  * the given number of threads.
+  *
+  * A pool may be shared by several submitters: each of them waits for
+  * the completion of its own jobs through a JobGroup.
+  */
+class ThreadPool {
+public:
+    typedef void (*JobFunction)(void *arg);
+
+    /** Jobs of a submitter, that it waits for (see wait)
+      */
+    struct JobGroup {
+        JobGroup() : pending(0) {}
+        int pending; // jobs submitted and not completed
+    };
+
+    ThreadPool(int nWorkers);
+    ~ThreadPool();
+    void submit(JobFunction function, void *arg, JobGroup *group = 0);
+    void wait(JobGroup &group);
+    void waitAll();
+    inline int getNumWorkers() const { return threads.size(); }
+    static int getNumCpus();
+
+private:
+    struct Job {
+        JobFunction function;
+        void *arg;
+        JobGroup *group;
+    };
+    static void *workerLoop(void *pool);
+    std::list<Job> jobs; // jobs waiting for a worker
+    int running; // jobs being executed
+    bool stopping;
+    pthread_mutex_t mutex;
+    pthread_cond_t jobAvailable;
+    pthread_cond_t jobDone;
+    std::vector<pthread_t> threads;
+};
+
+#endif
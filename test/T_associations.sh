@@ -0,0 +1,58 @@
+#!/bin/sh
+
+# test the summaries of the associated issues, in both directions
+
+. $srcdir/functions
+
+initTest
+rm -f $TEST_NAME.out
+
+cleanRepo
+initRepo
+
+SMITC=$srcdir/../bin/smitc
+
+$SMIT project $REPO/$PROJECT1 addProperty "blocks association -reverseLabel blocked_by"
+
+# print the associations shown on the page of an issue: label, id, summary
+associations() {
+    echo "issue $1:" >> $TEST_NAME.out
+    $SMITC get "http://127.0.0.1:$PORT/$PROJECT1/issues/$1?format=html" | tr -d "\r\n" | \
+        sed -e 's;<td class="sm_issue_plabel">;\n;g' -e 's;<span class="sm_issue_asso_id">;\n    ;g' | \
+        grep -e 'class="sm_issue_asso"' -e "^    " | \
+        sed -e 's;</span> <span class="sm_issue_asso_summary">; ;' -e 's; *<.*;;' -e '/^$/d' >> $TEST_NAME.out
+}
+
+startServer
+$SMITC signin http://127.0.0.1:$PORT $USER1 $PASSWD1 > /dev/null
+
+echo ">>> new issue referencing 1, 2 and 5 (not existing yet)" >> $TEST_NAME.out
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/new" "summary=issue3" "blocks=1,2,5" > /dev/null
+associations 3
+associations 1
+associations 2
+
+echo ">>> summary of 1 modified" >> $TEST_NAME.out
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/1" "summary=first_issue_modified" > /dev/null
+associations 3
+
+echo ">>> issue 5 created" >> $TEST_NAME.out
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/new" "summary=issue4" > /dev/null
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/new" "summary=issue5" > /dev/null
+associations 3
+associations 5
+
+echo ">>> association of 3 modified" >> $TEST_NAME.out
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/3" "blocks=2" > /dev/null
+associations 3
+associations 1
+associations 2
+
+echo ">>> full contents of the list" >> $TEST_NAME.out
+$SMITC get "http://127.0.0.1:$PORT/$PROJECT1/issues/?full=1&format=html" | \
+    grep -o 'class="sm_issue_asso_id">[^<]*</span> <span class="sm_issue_asso_summary">[^<]*' | \
+    sed -e 's;class="sm_issue_asso_id">;;' -e 's;</span> <span class="sm_issue_asso_summary">; ;' >> $TEST_NAME.out
+
+stopServer > /dev/null
+
+diff $srcdir/$TEST_NAME.ref $TEST_NAME.out
@@ -0,0 +1,57 @@
+#!/bin/sh
+
+# test the cache of the projects (stored by the server when stopping)
+
+. $srcdir/functions
+
+initTest
+rm -f $TEST_NAME.out
+
+cleanRepo
+initRepo
+
+SMITC=$srcdir/../bin/smitc
+CACHE=$REPO/$PROJECT1/.smip/cache
+
+restartServer() {
+    startServer
+    stopServer
+    # keep only the relevant logs, without timestamps and durations
+    grep "Project \|Invalid cache" server.log | \
+        sed -e "s/.*\(INFO\|ERROR\) *[^ ]* //" -e "s/ ([0-9.]*s)$//" -e "s/ (.* bytes.*)$//" >> $TEST_NAME.out
+}
+
+echo ">>> no cache, tag an entry" >> $TEST_NAME.out
+startServer
+$SMITC signin http://127.0.0.1:$PORT $USER1 $PASSWD1 >> $TEST_NAME.out
+entry=`$SMIT issue -h $REPO/$PROJECT1 1 | grep -o -m 1 "([0-9a-f]\{40\})" | tr -d "()"`
+curl -s -b .smitcCookie -X POST "http://127.0.0.1:$PORT/$PROJECT1/tags/$entry/tag1" > /dev/null
+stopServer
+[ -f $CACHE ] && echo "cache stored" >> $TEST_NAME.out
+
+echo ">>> restart" >> $TEST_NAME.out
+restartServer
+
+echo ">>> restart after modification of issue 1" >> $TEST_NAME.out
+$SMIT issue $REPO/$PROJECT1 -a 1 status=closed
+restartServer
+$SMIT issue -h $REPO/$PROJECT1 1 > $TEST_NAME.issue1.cached
+rm $CACHE
+$SMIT issue -h $REPO/$PROJECT1 1 > $TEST_NAME.issue1.uncached
+if diff $TEST_NAME.issue1.cached $TEST_NAME.issue1.uncached; then
+    echo "issue 1 identical with and without cache" >> $TEST_NAME.out
+fi
+
+echo ">>> restart without cache" >> $TEST_NAME.out
+restartServer
+
+echo ">>> restart with corrupted cache" >> $TEST_NAME.out
+chmod u+w $CACHE
+head -c 100 $CACHE > $CACHE.tmp
+mv $CACHE.tmp $CACHE
+restartServer
+$SMIT issue $REPO/$PROJECT1 >> $TEST_NAME.out
+
+rm -f $TEST_NAME.issue1.*
+
+diff $srcdir/$TEST_NAME.ref $TEST_NAME.out
@@ -0,0 +1,73 @@
+#!/bin/sh
+
+# test the compression of the objects (objectCompression in the config of the repository)
+
+. $srcdir/functions
+
+initTest
+rm -f $TEST_NAME.out
+
+cleanRepo
+initRepo
+
+SMITC=$srcdir/../bin/smitc
+OBJECTS=$REPO/$PROJECT1/.smip/objects
+echo "objectCompression gzip" >> $REPO/.smit/config
+
+getEntry() {
+    $SMIT issue -h $REPO/$PROJECT1 1 | grep -o "([0-9a-f]\{40\})" | tr -d "()" | tail -n 1
+}
+countMessage() {
+    echo "message found: `$SMIT issue -m $REPO/$PROJECT1 1 | grep -c $message`"
+}
+getObject() {
+    curl -s -b .smitcCookie "$@" "http://127.0.0.1:$PORT/$PROJECT1/files/$entry/x"
+}
+
+startServer
+$SMITC signin http://127.0.0.1:$PORT $USER1 $PASSWD1 >> $TEST_NAME.out
+message=`printf "%0600d" 0`
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/1" "+message=$message" > /dev/null
+entry=`getEntry`
+
+echo ">>> loose compressed object" >> $TEST_NAME.out
+subpath=`echo $entry | sed -e "s;^..;&/;"`
+head -c 4 $OBJECTS/$subpath | tail -c 3 >> $TEST_NAME.out
+echo "" >> $TEST_NAME.out
+echo "stored size < 600: `[ \`wc -c < $OBJECTS/$subpath\` -lt 600 ] && echo yes`" >> $TEST_NAME.out
+echo "uncompressed sha1: `getObject | sha1sum | cut -c1-40 | sed -e s/$entry/ok/`" >> $TEST_NAME.out
+echo "gzip sha1: `getObject -H 'Accept-Encoding: deflate, gzip' | gunzip | sha1sum | cut -c1-40 | sed -e s/$entry/ok/`" >> $TEST_NAME.out
+getObject -H 'Accept-Encoding: gzip' -D - -o /dev/null | grep -i "^Content-Encoding" | tr -d "\r" >> $TEST_NAME.out
+getObject -H 'Accept-Encoding: gzip;q=0' -D - -o /dev/null | grep -i -c "^Content-Encoding" >> $TEST_NAME.out
+
+# pushed files are stored through the same layer
+pushFile() {
+    id=`sha1sum < $1 | cut -c1-40`
+    curl -s -b .smitcCookie --data-binary @$1 "http://127.0.0.1:$PORT/$PROJECT1/files/$id" > /dev/null
+    subpath=`echo $id | sed -e "s;^..;&/;"`
+    echo "stored header: `head -c 4 $OBJECTS/$subpath | tail -c 3`" >> $TEST_NAME.out
+    echo "uncompressed sha1: `curl -s -b .smitcCookie "http://127.0.0.1:$PORT/$PROJECT1/files/$id/x" | sha1sum | cut -c1-40 | sed -e s/$id/ok/`" >> $TEST_NAME.out
+}
+echo ">>> pushed file" >> $TEST_NAME.out
+printf "%01000d" 0 > pushed.tmp
+pushFile pushed.tmp
+echo ">>> pushed file that looks like a compressed object" >> $TEST_NAME.out
+printf "\000SMZ\001not-compressed" > pushed.tmp
+pushFile pushed.tmp
+rm -f pushed.tmp
+stopServer
+
+countMessage >> $TEST_NAME.out
+$SMIT fsck $REPO | sed -e "s;^$REPO/;;" >> $TEST_NAME.out
+
+echo ">>> packed compressed object" >> $TEST_NAME.out
+$SMIT repack $REPO | sed -e "s;^$REPO/;;" >> $TEST_NAME.out
+countMessage >> $TEST_NAME.out
+$SMIT fsck $REPO | sed -e "s;^$REPO/;;" >> $TEST_NAME.out
+startServer
+$SMITC signin http://127.0.0.1:$PORT $USER1 $PASSWD1 > /dev/null
+echo "uncompressed sha1: `getObject | sha1sum | cut -c1-40 | sed -e s/$entry/ok/`" >> $TEST_NAME.out
+echo "gzip sha1: `getObject -H 'Accept-Encoding: gzip' | gunzip | sha1sum | cut -c1-40 | sed -e s/$entry/ok/`" >> $TEST_NAME.out
+stopServer
+
+diff $srcdir/$TEST_NAME.ref $TEST_NAME.out
@@ -0,0 +1,60 @@
+#!/bin/sh
+
+# test the lists of issues across several projects (sorted, paged, filtered)
+
+. $srcdir/functions
+
+initTest
+rm -f $TEST_NAME.out
+
+cleanRepo
+initEmptyRepo
+
+SMITC=$srcdir/../bin/smitc
+
+for project in pa pb pc; do
+    $SMIT project -c $REPO/$project
+    $SMIT project $REPO/$project addProperty "priority select low normal high"
+done
+$SMIT user $USER1 --project pa:rw --project pb:rw --project pc:ro -d $REPO
+
+$SMIT issue $REPO/pa -a - summary=apple status=open priority=high owner=$USER1
+$SMIT issue $REPO/pa -a - summary=kiwi status=closed priority=low
+$SMIT issue $REPO/pa -a - summary=mango status=open priority=normal
+$SMIT issue $REPO/pb -a - summary=banana status=open priority=normal owner=$USER1
+$SMIT issue $REPO/pb -a - summary=kiwi status=open priority=high
+$SMIT issue $REPO/pc -a - summary=cherry status=closed priority=high
+$SMIT issue $REPO/pc -a - summary=apple status=open priority=low owner=$USER1
+$SMIT issue $REPO/pc -a - summary=lemon status=open priority=normal
+$SMIT issue $REPO/pc -a - "summary=fig and kiwi" status=open priority=low
+
+# print the number of issues found, and the rows of the table of issues
+issues() {
+    echo ">>> $1" >> $TEST_NAME.out
+    $SMITC get "http://127.0.0.1:$PORT/p*/issues/?format=html&colspec=p+id+summary+status+priority&$1" > issues.html
+    grep -o 'span class="sm_issues_count">[0-9]*' issues.html | sed -e 's/.*>/found: /' >> $TEST_NAME.out
+    tr -d "\r\n" < issues.html | sed -e 's;<tr class="sm_issues">;\n;g' -e 's;</table>;\n;g' | \
+        grep '^<td class="sm_issues">' | sed -e 's;<[^>]*>; ;g' -e 's/  */ /g' -e 's/^ //' >> $TEST_NAME.out
+}
+
+startServer
+$SMITC signin http://127.0.0.1:$PORT $USER1 $PASSWD1 > /dev/null
+
+issues "sort=summary"
+issues "sort=-summary"
+issues "sort=priority-summary"
+issues "sort=summary&limit=4"
+issues "sort=summary&limit=4&offset=4"
+issues "sort=summary&limit=4&offset=8"
+issues "sort=summary&offset=3"
+issues "sort=-p&limit=3&offset=1"
+issues "filterin=status:open&sort=-priority&limit=5"
+issues "filterin=owner:me&sort=-summary"
+issues "search=kiwi&sort=summary"
+issues "limit=2&offset=3"
+issues "sort=summary&limit=100&offset=2147483600"
+
+stopServer > /dev/null
+rm -f issues.html
+
+diff $srcdir/$TEST_NAME.ref $TEST_NAME.out
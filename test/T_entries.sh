@@ -0,0 +1,83 @@
+#!/bin/sh
+
+# test the list of entries sorted by ctime, and the paging with a cursor
+
+. $srcdir/functions
+
+initTest
+rm -f $TEST_NAME.out
+
+cleanRepo
+initEmptyRepo
+
+SMITC=$srcdir/../bin/smitc
+REFS=$REPO/$PROJECT1/.smip/refs/issues
+
+e=`storeEntry null 1000 "summary a"`
+e=`storeEntry $e 3000 "status a3000"`
+printf $e > $REFS/1
+
+e=`storeEntry null 2000 "summary b"`
+e=`storeEntry $e 2000 "status b2000"`
+e=`storeEntry $e 5000 "status b5000"`
+printf $e > $REFS/2
+
+# an entry older than its parent
+e=`storeEntry null 4000 "summary c"`
+e=`storeEntry $e 1500 "status c1500"`
+printf $e > $REFS/3
+
+# print the ctime and the properties of the entries, and keep the id of the last one
+entries() {
+    echo ">>> $1" | sed -e 's/cursor=[0-9a-f]*/cursor=<last>/' >> $TEST_NAME.out
+    $SMITC get "http://127.0.0.1:$PORT/$PROJECT1/entries?format=json&$1" > entries.json
+    lastId=`grep -o '"id":"[0-9a-f]*"' entries.json | tail -1 | cut -c7-46`
+    (tr -d "\r\n" < entries.json; echo) | \
+        sed -e 's;{"entry_header":{"id":"[0-9a-f]*","author":"[^"]*","ctime":\([0-9]*\),"parent":[^}]*},"properties":{\("smv":"[^"]*",\)\{0,1\}\([^}]*\)}};\n\1 \3;g' | \
+        sed -e 's/,$//' -e 's/\]$//' -e '/^\[$/d' >> $TEST_NAME.out
+}
+
+startServer
+$SMITC signin http://127.0.0.1:$PORT $USER1 $PASSWD1 > /dev/null
+
+entries "sort=-ctime"
+entries "sort=ctime"
+entries "sort=-ctime&limit=3"
+
+echo ">>> pages of the latest entries" >> $TEST_NAME.out
+entries "sort=-ctime&limit=3"
+entries "sort=-ctime&limit=3&cursor=$lastId"
+entries "sort=-ctime&limit=3&cursor=$lastId"
+entries "sort=-ctime&limit=3&cursor=$lastId"
+
+echo ">>> pages of the oldest entries" >> $TEST_NAME.out
+entries "sort=ctime&limit=4"
+entries "sort=ctime&cursor=$lastId"
+
+echo ">>> pages of the entries sorted by another property" >> $TEST_NAME.out
+entries "sort=status-ctime&limit=4"
+entries "sort=status-ctime&limit=4&cursor=$lastId"
+
+echo ">>> unknown cursor" >> $TEST_NAME.out
+$SMITC get "http://127.0.0.1:$PORT/$PROJECT1/entries?format=json&sort=-ctime&cursor=0123" 2>&1 | head -1 >> $TEST_NAME.out
+
+COOKIES=$TEST_NAME.cookies
+curl -s -c $COOKIES -X POST -d "username=$USER_SUPER&password=$PASSWD_SUPER" "http://127.0.0.1:$PORT/signin?format=text" > /dev/null
+
+echo ">>> new entry" >> $TEST_NAME.out
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/3" "status=new" > /dev/null
+entries "sort=-ctime&limit=2"
+entries "sort=-ctime&cursor=$lastId"
+
+echo ">>> after a reload" >> $TEST_NAME.out
+curl -s -b $COOKIES -X POST "http://127.0.0.1:$PORT/$PROJECT1/reload" > /dev/null
+entries "sort=-ctime&limit=2"
+entries "sort=-ctime&limit=2&cursor=$lastId"
+
+stopServer > /dev/null
+rm -f $COOKIES entries.json
+
+# the ctime of the posted entry is the current time
+sed -i -e 's/^1[0-9]\{9\} /<now> /' $TEST_NAME.out
+
+diff $srcdir/$TEST_NAME.ref $TEST_NAME.out
@@ -0,0 +1,52 @@
+#!/bin/sh
+
+# test the numbers of issues per value of some properties (facets)
+
+. $srcdir/functions
+
+initTest
+rm -f $TEST_NAME.out
+
+cleanRepo
+initRepo
+
+SMITC=$srcdir/../bin/smitc
+
+facets() {
+    echo ">>> $1" >> $TEST_NAME.out
+    $SMITC get "http://127.0.0.1:$PORT/$PROJECT1/issues/?format=json&$1" >> $TEST_NAME.out
+}
+
+$SMIT project $REPO/$PROJECT1 addProperty "labels multiselect red green blue"
+$SMIT issue $REPO/$PROJECT1 -a - "summary=third issue" status=closed labels=red labels=green freeText=abc
+$SMIT issue $REPO/$PROJECT1 -a - "summary=fourth issue" status=deleted labels=green owner=$USER1
+
+startServer
+$SMITC signin http://127.0.0.1:$PORT $USER1 $PASSWD1 > /dev/null
+
+echo ">>> counted with the filter index" >> $TEST_NAME.out
+facets "facets=status"
+facets "facets=status+labels+owner"
+facets "facets=labels&filterin=status:open&filterin=status:closed"
+facets "facets=status&filterout=labels:green"
+facets "facets=status&filterin=owner:me"
+facets "facets=status&filterin=status:none"
+
+echo ">>> counted over the matching issues" >> $TEST_NAME.out
+facets "facets=status+labels+owner&search=issue"
+facets "facets=labels&search=third"
+facets "facets=status+freeText"
+facets "facets=labels&filterin=freeText:abc"
+facets "facets=unknown"
+
+echo ">>> modified issues" >> $TEST_NAME.out
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/1" "status=closed" "labels=blue" > /dev/null
+facets "facets=status+labels"
+facets "facets=status+labels&search=issue"
+
+echo ">>> sidebar of the html list" >> $TEST_NAME.out
+$SMITC get "http://127.0.0.1:$PORT/$PROJECT1/issues/?format=html&facets=status&filterout=status:deleted&limit=1" | \
+    grep "sm_issues_facet" >> $TEST_NAME.out
+stopServer > /dev/null
+
+diff $srcdir/$TEST_NAME.ref $TEST_NAME.out
@@ -0,0 +1,55 @@
+#!/bin/sh
+
+# test the filters evaluated through the bitmap index of the select properties
+
+. $srcdir/functions
+
+initTest
+rm -f $TEST_NAME.out
+
+cleanRepo
+initRepo
+
+SMITC=$srcdir/../bin/smitc
+
+filter() {
+    echo "$1: `listIssueIds "sort=id&$1"`" >> $TEST_NAME.out
+}
+
+$SMIT project $REPO/$PROJECT1 addProperty "labels multiselect red green blue"
+$SMIT issue $REPO/$PROJECT1 -a - "summary=third issue" status=closed labels=red labels=green freeText=abc
+$SMIT issue $REPO/$PROJECT1 -a - "summary=fourth issue" status=deleted labels=green owner=$USER1
+
+startServer
+$SMITC signin http://127.0.0.1:$PORT $USER1 $PASSWD1 > /dev/null
+
+echo ">>> index built by the first filter" >> $TEST_NAME.out
+filter "filterin=status:open"
+filter "filterin=status:OPEN&filterin=status:closed"
+filter "filterin=status:*ed"
+filter "filterout=status:open"
+filter "filterin=labels:green"
+filter "filterin=labels:green&filterout=labels:red"
+filter "filterin=labels:"
+filter "filterin=owner:$USER1"
+filter "filterin=status:closed&filterin=freeText:abc"
+filter "filterin=labels:green&filterout=freeText:abc"
+filter "filterin=labels:green&search=fourth"
+filter "filterin=freeText:"
+
+echo ">>> modified issues" >> $TEST_NAME.out
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/1" "status=closed" "labels=blue" > /dev/null
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/new" "summary=fifth issue" "status=open" > /dev/null
+filter "filterin=status:open"
+filter "filterin=status:closed"
+filter "filterin=labels:blue"
+filter "filterin=labels:"
+
+echo ">>> property added out-of-band" >> $TEST_NAME.out
+$SMIT project $REPO/$PROJECT1 addProperty "priority select low high"
+sleep 0.5
+filter "filterin=priority:"
+filter "filterin=priority:low"
+stopServer > /dev/null
+
+diff $srcdir/$TEST_NAME.ref $TEST_NAME.out
@@ -0,0 +1,43 @@
+#!/bin/sh
+
+# test the verification of the objects (smit fsck, and scrubber of the server)
+
+. $srcdir/functions
+
+initTest
+rm -f $TEST_NAME.out
+
+cleanRepo
+initRepo
+
+OBJECTS=$REPO/$PROJECT1/.smip/objects
+
+echo ">>> fsck" >> $TEST_NAME.out
+$SMIT fsck $REPO >> $TEST_NAME.out
+echo "exit code: $?" >> $TEST_NAME.out
+
+# corrupt an entry, without changing its contents once parsed
+entry=`$SMIT issue -h $REPO/$PROJECT1 1 | grep -o "([0-9a-f]\{40\})" | tr -d "()" | tail -n 1`
+subpath=`echo $entry | sed -e "s;^..;&/;"`
+echo "" >> $OBJECTS/$subpath
+
+echo ">>> fsck corrupted loose object" >> $TEST_NAME.out
+$SMIT fsck $REPO -j 2 > $TEST_NAME.fsck 2>/dev/null
+echo "exit code: $?" >> $TEST_NAME.out
+sed -e "s;^$REPO/;;" -e "s;$entry;<entry>;" $TEST_NAME.fsck >> $TEST_NAME.out
+
+echo ">>> fsck corrupted packed object" >> $TEST_NAME.out
+$SMIT repack $REPO > /dev/null
+$SMIT fsck $REPO 2>/dev/null | sed -e "s;^$REPO/;;" -e "s;$entry;<entry>;" >> $TEST_NAME.out
+
+# the server does not verify the objects when loading, but in the background
+echo ">>> scrubber" >> $TEST_NAME.out
+startServer
+sleep 1
+curl -s "http://127.0.0.1:$PORT/sm/stat" | grep -A 10 "^Integrity" | grep -v "last pass" | sed -e "s;$entry;<entry>;" >> $TEST_NAME.out
+$SMIT issue $REPO/$PROJECT1 1 >> $TEST_NAME.out
+stopServer
+
+rm -f $TEST_NAME.fsck
+
+diff $srcdir/$TEST_NAME.ref $TEST_NAME.out
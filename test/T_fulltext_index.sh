@@ -0,0 +1,45 @@
+#!/bin/sh
+
+# test the full-text search through the trigram index, kept up to date by the modifications
+
+. $srcdir/functions
+
+initTest
+rm -f $TEST_NAME.out
+
+cleanRepo
+initRepo
+
+SMITC=$srcdir/../bin/smitc
+
+search() {
+    echo "search=$1: `listIssueIds "sort=id&search=$1"`" >> $TEST_NAME.out
+}
+
+startServer
+$SMITC signin http://127.0.0.1:$PORT $USER1 $PASSWD1 > /dev/null
+
+echo ">>> index built by the first search" >> $TEST_NAME.out
+search ISSUE
+search second
+search t
+search $USER1
+search nothing_here
+
+echo ">>> new entries" >> $TEST_NAME.out
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/2" "+message=Posted_Word" > /dev/null
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/new" "summary=brand new" > /dev/null
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/1" "status=closed" > /dev/null
+search posted_word
+search Brand
+search closed
+search open
+
+echo ">>> amended message" >> $TEST_NAME.out
+entry=`$SMIT issue -h $REPO/$PROJECT1 2 | grep -o "([0-9a-f]\{40\})" | tr -d "()" | tail -n 1`
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/2" "+message=amended_word" "+amend=$entry" > /dev/null
+search amended
+search posted_word
+stopServer > /dev/null
+
+diff $srcdir/$TEST_NAME.ref $TEST_NAME.out
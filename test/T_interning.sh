@@ -0,0 +1,58 @@
+#!/bin/sh
+
+# test the properties whose values are interned (select properties) or not (texts)
+
+. $srcdir/functions
+
+initTest
+rm -f $TEST_NAME.out
+
+cleanRepo
+initRepo
+
+SMITC=$srcdir/../bin/smitc
+
+LONG=0123456789012345678901234567890123456789xyz
+
+getIssues() {
+    $SMITC get "http://127.0.0.1:$PORT/$PROJECT1/issues/?colspec=id+status+labels+freeText&sort=freeText&format=text" >> $TEST_NAME.out
+}
+
+$SMIT project $REPO/$PROJECT1 addProperty "labels multiselect red green blue"
+$SMIT issue $REPO/$PROJECT1 -a - "summary=third issue" status=open labels=red labels=green "freeText=some text"
+
+startServer
+$SMITC signin http://127.0.0.1:$PORT $USER1 $PASSWD1 > /dev/null
+
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/new" "summary=fourth issue" "status=open" "labels=green" "freeText=$LONG" > /dev/null
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/new" "summary=fifth issue" "status=closed" "freeText=abc" > /dev/null
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/3" "status=closed" "labels=blue" > /dev/null
+
+echo ">>> posted issues" >> $TEST_NAME.out
+getIssues
+echo ">>> filters on interned and owned values" >> $TEST_NAME.out
+$SMITC get "http://127.0.0.1:$PORT/$PROJECT1/issues/?colspec=id&sort=id&format=text&filterin=freeText:$LONG" | grep -v "^id" >> $TEST_NAME.out
+$SMITC get "http://127.0.0.1:$PORT/$PROJECT1/issues/?colspec=id&sort=id&format=text&filterin=freeText:some%20*" | grep -v "^id" >> $TEST_NAME.out
+$SMITC get "http://127.0.0.1:$PORT/$PROJECT1/issues/?colspec=id&sort=id&format=text&filterin=labels:green" | grep -v "^id" >> $TEST_NAME.out
+curl -s "http://127.0.0.1:$PORT/sm/stat" | grep -c "^Interned strings: [1-9][0-9]* strings" >> $TEST_NAME.out
+echo ">>> short text values are not interned" >> $TEST_NAME.out
+internedStrings() {
+    curl -s "http://127.0.0.1:$PORT/sm/stat" | grep "^Interned strings:" | tr -d "\r"
+}
+before=`internedStrings`
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/5" "freeText=token_abc" > /dev/null
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/5" "freeText=token_def" > /dev/null
+after=`internedStrings`
+[ "$before" = "$after" ] && echo "interned strings unchanged" >> $TEST_NAME.out
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/5" "freeText=abc" > /dev/null
+stopServer > /dev/null
+
+echo ">>> after reloading the project" >> $TEST_NAME.out
+startServer
+$SMITC signin http://127.0.0.1:$PORT $USER1 $PASSWD1 > /dev/null
+getIssues
+stopServer > /dev/null
+
+$SMIT fsck $REPO/$PROJECT1 | grep -i "error" >> $TEST_NAME.out
+
+diff $srcdir/$TEST_NAME.ref $TEST_NAME.out
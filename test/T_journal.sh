@@ -0,0 +1,112 @@
+#!/bin/sh
+
+# test the journal of the entries: replay after a crash, concurrent posts,
+# records that cannot be materialized
+
+. $srcdir/functions
+
+initTest
+rm -f $TEST_NAME.out
+
+cleanRepo
+initRepo
+
+SMITC=$srcdir/../bin/smitc
+SMIP=$REPO/$PROJECT1/.smip
+JOURNAL=$SMIP/journal
+
+journalPresent() {
+    echo "journal present: `[ -f $JOURNAL ] && echo yes || echo no`"
+}
+countMessages() {
+    echo "$1: `$SMIT issue -m $REPO/$PROJECT1 1 | grep -c $1`"
+}
+# wait until the ref of issue 1 is materialized in the background (no longer $1)
+waitRef() {
+    n=0
+    while [ "`cat $SMIP/refs/issues/1 2> /dev/null`" = "$1" ] && [ $n -lt 50 ]; do
+        sleep 0.1
+        n=`expr $n + 1`
+    done
+}
+
+echo ">>> crash before the materialized files are synced" >> $TEST_NAME.out
+startServer
+$SMITC signin http://127.0.0.1:$PORT $USER1 $PASSWD1 > /dev/null
+refInit=`cat $SMIP/refs/issues/1 2> /dev/null`
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/1" "+message=first_message" > /dev/null
+waitRef "$refInit"
+ref0=`cat $SMIP/refs/issues/1`
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/1" "+message=second_message" > /dev/null
+waitRef "$ref0"
+entry=`cat $SMIP/refs/issues/1`
+kill -9 $smitServerPid
+wait $smitServerPid 2> /dev/null
+journalPresent >> $TEST_NAME.out
+
+# lose the latest entry and ref, and leave an incomplete record
+subpath=`echo $entry | sed -e "s;^..;&/;"`
+rm $SMIP/objects/$subpath
+printf "$ref0" > $SMIP/refs/issues/1
+printf "1 $entry $entry 1000\nincomplete" >> $JOURNAL
+
+countMessages second_message >> $TEST_NAME.out
+echo "ref replayed: `sed -e s/$entry/ok/ $SMIP/refs/issues/1`" >> $TEST_NAME.out
+journalPresent >> $TEST_NAME.out
+$SMIT fsck $REPO | sed -e "s;^$REPO/;;" >> $TEST_NAME.out
+
+echo ">>> concurrent posts" >> $TEST_NAME.out
+startServer
+$SMITC signin http://127.0.0.1:$PORT $USER1 $PASSWD1 > /dev/null
+(
+    for n in 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20; do
+        $SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/1" "+message=burst_message_$n" > /dev/null &
+    done
+    wait
+)
+# all the entries have been published, possibly after a retry
+curl -s "http://127.0.0.1:$PORT/sm/stat" | grep -A1 "^Write lock" | tr -d "\r" | sed -e "s/, held.*//" >> $TEST_NAME.out
+stopServer > /dev/null
+countMessages burst_message >> $TEST_NAME.out
+$SMIT fsck $REPO | sed -e "s;^$REPO/;;" >> $TEST_NAME.out
+
+echo ">>> journal that cannot be written" >> $TEST_NAME.out
+startServer
+$SMITC signin http://127.0.0.1:$PORT $USER1 $PASSWD1 > /dev/null
+mkdir $JOURNAL # the journal cannot be opened
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/1" "+message=unjournaled_message" > /dev/null && echo "post: ok" >> $TEST_NAME.out
+rmdir $JOURNAL
+stopServer > /dev/null
+countMessages unjournaled_message >> $TEST_NAME.out
+$SMIT fsck $REPO | sed -e "s;^$REPO/;;" >> $TEST_NAME.out
+
+echo ">>> record neither journaled nor materialized" >> $TEST_NAME.out
+startServer
+$SMITC signin http://127.0.0.1:$PORT $USER1 $PASSWD1 > /dev/null
+mkdir $JOURNAL # the journal cannot be opened
+mkdir $SMIP/refs/issues/.1.tmp # the ref cannot be written
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/1" "+message=lost_message" | tr -d "\r" >> $TEST_NAME.out
+echo "lost_message visible: `$SMITC get "http://127.0.0.1:$PORT/$PROJECT1/issues/1" | grep -c lost_message`" >> $TEST_NAME.out
+rmdir $SMIP/refs/issues/.1.tmp $JOURNAL
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/1" "+message=next_message" > /dev/null && echo "post: ok" >> $TEST_NAME.out
+stopServer > /dev/null
+countMessages lost_message >> $TEST_NAME.out
+countMessages next_message >> $TEST_NAME.out
+$SMIT fsck $REPO | sed -e "s;^$REPO/;;" >> $TEST_NAME.out
+
+echo ">>> ref that cannot be materialized" >> $TEST_NAME.out
+startServer
+$SMITC signin http://127.0.0.1:$PORT $USER1 $PASSWD1 > /dev/null
+mkdir $SMIP/refs/issues/.1.tmp # the ref cannot be written in the background
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/1" "+message=unmaterialized_message" > /dev/null && echo "post: ok" >> $TEST_NAME.out
+stopServer > /dev/null
+journalPresent >> $TEST_NAME.out
+# the ref cannot be written by the replay either
+countMessages unmaterialized_message >> $TEST_NAME.out
+journalPresent >> $TEST_NAME.out
+rmdir $SMIP/refs/issues/.1.tmp
+countMessages unmaterialized_message >> $TEST_NAME.out
+journalPresent >> $TEST_NAME.out
+$SMIT fsck $REPO | sed -e "s;^$REPO/;;" >> $TEST_NAME.out
+
+diff $srcdir/$TEST_NAME.ref $TEST_NAME.out
@@ -0,0 +1,52 @@
+#!/bin/sh
+
+# test the server with messages not resident in memory (--message-cache)
+
+. $srcdir/functions
+
+initTest
+rm -f $TEST_NAME.out
+
+cleanRepo
+initRepo
+
+SMITC=$srcdir/../bin/smitc
+
+getAll() {
+    $SMITC signin http://127.0.0.1:$PORT $USER1 $PASSWD1 > /dev/null
+    $SMITC get "http://127.0.0.1:$PORT/$PROJECT1/issues/1?format=json"
+    $SMITC get "http://127.0.0.1:$PORT/$PROJECT1/issues/1?format=text"
+    $SMITC get "http://127.0.0.1:$PORT/$PROJECT1/issues/?format=csv&search=some+message"
+}
+
+echo ">>> messages resident" >> $TEST_NAME.out
+startServer
+$SMITC signin http://127.0.0.1:$PORT $USER1 $PASSWD1 >> $TEST_NAME.out
+# post a message and amend it
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/1" "+message=posted_message" > /dev/null
+entry=`$SMIT issue -h $REPO/$PROJECT1 1 | grep -o "([0-9a-f]\{40\})" | tr -d "()" | tail -n 1`
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/1" "+message=amended_message" "+amend=$entry" > /dev/null
+getAll > $TEST_NAME.resident
+curl -s "http://127.0.0.1:$PORT/sm/stat" | grep "^  $PROJECT1: [0-9]* issues" | sed -e "s/, [0-9]* kB//g" >> $TEST_NAME.out
+stopServer
+
+echo ">>> messages not resident" >> $TEST_NAME.out
+rm -f server.log
+$SMIT serve $REPO --listen-port $PORT --message-cache 1 > server.log 2>&1 &
+smitServerPid=$!
+sleep 0.5
+getAll > $TEST_NAME.lazy
+# the amended message is displayed instead of the original one
+curl -s -b .smitcCookie "http://127.0.0.1:$PORT/$PROJECT1/issues/1" > $TEST_NAME.html
+echo "html: posted: `grep -c posted_message $TEST_NAME.html`, amended: `grep -c amended_message $TEST_NAME.html`" >> $TEST_NAME.out
+curl -s "http://127.0.0.1:$PORT/sm/stat" | grep "^  $PROJECT1: [0-9]* issues\|^Message cache" | sed -e "s/, [0-9]* kB//g" -e "s;[0-9]*/1024 kB;1024 kB;" >> $TEST_NAME.out
+stopServer
+
+if diff $TEST_NAME.resident $TEST_NAME.lazy; then
+    echo "same messages, resident or not" >> $TEST_NAME.out
+fi
+grep -o "\"message\":\"amended[^\"]*\"" $TEST_NAME.lazy >> $TEST_NAME.out
+
+rm -f $TEST_NAME.resident $TEST_NAME.lazy $TEST_NAME.html
+
+diff $srcdir/$TEST_NAME.ref $TEST_NAME.out
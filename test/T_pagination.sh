@@ -0,0 +1,58 @@
+#!/bin/sh
+
+# test the pages of the lists of issues (offset and limit)
+
+. $srcdir/functions
+
+initTest
+rm -f $TEST_NAME.out
+
+cleanRepo
+initRepo
+
+SMITC=$srcdir/../bin/smitc
+
+page() {
+    echo "$1: `listIssueIds "$1"`" >> $TEST_NAME.out
+}
+
+headers() {
+    echo "$1:" >> $TEST_NAME.out
+    curl -s -b .smitcCookie -D - -o /dev/null "http://127.0.0.1:$PORT/$PROJECT1/issues/?colspec=id&format=text&$1" | \
+        grep "^X-Total-Count\|^Link" | tr -d "\r" >> $TEST_NAME.out
+}
+
+for n in 3 4 5 6 7; do
+    $SMIT issue $REPO/$PROJECT1 -a - "summary=issue $n" status=open > /dev/null
+done
+$SMIT issue $REPO/$PROJECT1 -a - "summary=issue 8" status=closed > /dev/null
+
+startServer
+$SMITC signin http://127.0.0.1:$PORT $USER1 $PASSWD1 > /dev/null
+
+echo ">>> pages" >> $TEST_NAME.out
+page "sort=id"
+page "sort=id&limit=3"
+page "sort=id&limit=3&offset=3"
+page "sort=id&limit=3&offset=6"
+page "sort=id&limit=3&offset=9"
+page "sort=-id&limit=3&offset=2"
+page "sort=status-id&limit=4"
+page "limit=2&offset=1"
+page "sort=id&limit=0"
+page "sort=id&limit=2&filterin=status:closed"
+page "sort=id&limit=2&filterin=status:open&offset=4"
+
+echo ">>> headers" >> $TEST_NAME.out
+headers "sort=id"
+headers "sort=id&limit=3"
+headers "sort=id&limit=3&offset=3"
+headers "sort=id&limit=3&offset=6"
+
+echo ">>> html" >> $TEST_NAME.out
+curl -s -b .smitcCookie "http://127.0.0.1:$PORT/$PROJECT1/issues/?sort=id&limit=3&offset=3" | \
+    grep -o "sm_issues_count\">[0-9][0-9]*\|sm_issues_page_[a-z]*\">[^<]*\|href=\"[^\"]*\" class=\"sm_issues_page_[a-z]*" >> $TEST_NAME.out
+
+stopServer > /dev/null
+
+diff $srcdir/$TEST_NAME.ref $TEST_NAME.out
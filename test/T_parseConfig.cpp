@@ -18,6 +18,36 @@
 // 3] 
 //
 
+/** Check that TokenViews gives the same result as parseConfigTokens
+  */
+bool sameTokens(const char *buf, size_t len)
+{
+    std::list<std::list<std::string> > tokens = parseConfigTokens(buf, len);
+    TokenViews views;
+    views.parse(buf, len);
+
+    if (views.getNumLines() != tokens.size()) return false;
+
+    size_t lineIndex = 0;
+    std::list<std::list<std::string> >::iterator line;
+    for (line=tokens.begin(); line!=tokens.end(); line++, lineIndex++) {
+        size_t begin = views.lineBegin(lineIndex);
+        size_t end = views.lineEnd(lineIndex);
+        if (end - begin != line->size()) return false;
+        std::list<std::string>::iterator tok;
+        for (tok=line->begin(); tok!=line->end(); tok++, begin++) {
+            if (views.str(views.tokens[begin]) != *tok) return false;
+            if (!views.equals(views.tokens[begin], tok->c_str())) return false;
+        }
+    }
+    return true;
+}
+
+bool sameTokens(const std::string &text)
+{
+    return sameTokens(text.data(), text.size());
+}
+
 int main()
 {
     // step 1: parse "parseConfig1.txt"
@@ -76,6 +106,8 @@ int main()
     ASSERT(line->front() == "one-void-value");
     ASSERT(line->back() == "");
 
+    ASSERT(sameTokens(buffer, n));
+
     // step 2: parse "parseConfig2.txt"
     f = fopen("parseConfig2.txt", "r");
     ASSERT(f!=0);
@@ -117,6 +149,22 @@ int main()
     line++;
     ASSERT(line->size() == 2);
 
+    ASSERT(sameTokens(buffer, n));
+
+    // step 3: same tokens with both parsers on corner cases
+    ASSERT(sameTokens(""));
+    ASSERT(sameTokens("key value"));
+    ASSERT(sameTokens("key \"a b\" c\"d\"e \"\"\n"));
+    ASSERT(sameTokens("key a\\ b \\n\\t\\r \\\nnext line\n"));
+    ASSERT(sameTokens("\\ escaped-start \\\n continued\n"));
+    ASSERT(sameTokens("percent 100%% 50%x \"%%\" end%"));
+    ASSERT(sameTokens("a b # comment \" ignored\n# full comment\nc\r\nd \\"));
+    ASSERT(sameTokens("message < boundary:01\nline 1\nline 2\nboundary:01\nnext value\n"));
+    ASSERT(sameTokens("message <boundary:01\n\nboundary:01\n"));
+    ASSERT(sameTokens("message < b\ntext not terminated\nb"));
+    ASSERT(sameTokens("message < b\nunterminated"));
+    ASSERT(sameTokens("mixed plain\"quoted\"plain \"multi\nline\" last"));
+
     std::string s = doubleQuote("a b\nc d\\");
     ASSERT(s == "\"a b\\nc d\\\\\"");
 
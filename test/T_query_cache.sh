@@ -0,0 +1,60 @@
+#!/bin/sh
+
+# test the cache of the results of the lists of issues
+
+. $srcdir/functions
+
+initTest
+rm -f $TEST_NAME.out
+
+cleanRepo
+initRepo
+
+SMITC=$srcdir/../bin/smitc
+
+list() {
+    echo "$1: `listIssueIds "$1"`" >> $TEST_NAME.out
+}
+
+stats() {
+    curl -s "http://127.0.0.1:$PORT/sm/stat" | grep "^  $PROJECT1: .* hits" | tr -d "\r" >> $TEST_NAME.out
+}
+
+for n in 3 4 5 6; do
+    $SMIT issue $REPO/$PROJECT1 -a - "summary=issue $n" status=open > /dev/null
+done
+
+startServer
+$SMITC signin http://127.0.0.1:$PORT $USER1 $PASSWD1 > /dev/null
+
+echo ">>> same queries" >> $TEST_NAME.out
+list "sort=-id&filterin=status:open"
+list "sort=-id&filterin=status:open"
+list "sort=-id&filterin=status:open&colspec=id+status"
+stats
+
+echo ">>> deeper pages" >> $TEST_NAME.out
+list "sort=status-id&limit=2"
+list "sort=status-id&limit=2&offset=2"
+list "sort=status-id&limit=2&offset=4"
+stats
+
+echo ">>> after a new entry" >> $TEST_NAME.out
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/4" "status=closed" > /dev/null
+list "sort=-id&filterin=status:open"
+list "sort=status-id&limit=2"
+stats
+
+echo ">>> after a new issue" >> $TEST_NAME.out
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/new" "summary=issue7" "status=open" > /dev/null
+list "sort=-id&filterin=status:open"
+stats
+
+echo ">>> values containing separators" >> $TEST_NAME.out
+list "sort=-id&filterin=status:closed%1Fopen"
+list "sort=-id&filterin=status:closed&filterin=status:open"
+stats
+
+stopServer > /dev/null
+
+diff $srcdir/$TEST_NAME.ref $TEST_NAME.out
@@ -0,0 +1,58 @@
+#!/bin/sh
+
+# test the refs modified out-of-band while the server is running (sync of the repository)
+
+. $srcdir/functions
+
+initTest
+rm -f $TEST_NAME.out
+
+cleanRepo
+initRepo
+
+SMITC=$srcdir/../bin/smitc
+SYNC=trepo_sync
+SMIP=$REPO/$PROJECT1/.smip
+
+getIssues() {
+    $SMITC get "http://127.0.0.1:$PORT/$PROJECT1/issues/?colspec=id+summary+status&sort=id&format=text"
+}
+
+# prepare the modifications in a copy of the repository
+rm -rf $SYNC
+cp -r $REPO $SYNC
+$SMIT issue $SYNC/$PROJECT1 -a 1 +message=synced_message status=closed
+$SMIT issue $SYNC/$PROJECT1 -a - "summary=synced issue"
+$SMIT project $SYNC/$PROJECT1 addProperty "syncedText text"
+
+startServer
+$SMITC signin http://127.0.0.1:$PORT $USER1 $PASSWD1 > /dev/null
+echo ">>> before sync" >> $TEST_NAME.out
+getIssues >> $TEST_NAME.out
+
+# copy the objects, then the refs
+cp -r $SYNC/$PROJECT1/.smip/objects/* $SMIP/objects/
+cp $SYNC/$PROJECT1/.smip/refs/issues/1 $SYNC/$PROJECT1/.smip/refs/issues/3 $SMIP/refs/issues/
+cp $SYNC/$PROJECT1/.smip/refs/project $SMIP/refs/project
+rm $SMIP/refs/issues/2
+sleep 0.5
+
+echo ">>> after sync" >> $TEST_NAME.out
+getIssues >> $TEST_NAME.out
+$SMITC get "http://127.0.0.1:$PORT/$PROJECT1/issues/1?format=json" | grep -o "\"message\":\"synced_message\"" >> $TEST_NAME.out
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/3" "syncedText=posted" > /dev/null
+$SMITC get "http://127.0.0.1:$PORT/$PROJECT1/issues/3?format=json" | grep -o "^{\"properties\":{[^}]*}" >> $TEST_NAME.out
+sleep 0.5
+# the ref written by the server is already applied
+curl -s "http://127.0.0.1:$PORT/sm/stat" | grep "^Refs watcher" | tr -d "\r" >> $TEST_NAME.out
+
+echo ">>> history rewritten" >> $TEST_NAME.out
+first=`$SMIT issue -h $REPO/$PROJECT1 1 | grep -o "([0-9a-f]\{40\})" | tr -d "()" | head -n 1`
+e=`storeEntry $first 5000 "status rewritten"`
+printf $e > $SMIP/refs/issues/1
+sleep 0.5
+getIssues >> $TEST_NAME.out
+stopServer > /dev/null
+
+rm -rf $SYNC
+diff $srcdir/$TEST_NAME.ref $TEST_NAME.out
@@ -0,0 +1,51 @@
+#!/bin/sh
+
+# test the reload of a project, concurrently with posts and reads
+
+. $srcdir/functions
+
+initTest
+rm -f $TEST_NAME.out
+
+cleanRepo
+initRepo
+
+SMITC=$srcdir/../bin/smitc
+COOKIES=$TEST_NAME.cookies
+
+getIssues() {
+    $SMITC get "http://127.0.0.1:$PORT/$PROJECT1/issues/?colspec=id+summary+status&sort=id&format=text"
+}
+reload() {
+    curl -s -b $COOKIES -X POST "http://127.0.0.1:$PORT/$PROJECT1/reload" > /dev/null
+}
+countMessages() {
+    echo "$1: `$SMIT issue -m $REPO/$PROJECT1 1 | grep -c $1`"
+}
+
+startServer
+$SMITC signin http://127.0.0.1:$PORT $USER1 $PASSWD1 > /dev/null
+curl -s -c $COOKIES -X POST -d "username=$USER_SUPER&password=$PASSWD_SUPER" "http://127.0.0.1:$PORT/signin?format=text" > /dev/null
+
+echo ">>> reload after an offline modification" >> $TEST_NAME.out
+$SMIT project $REPO/$PROJECT1 addProperty "reloadedText text"
+reload
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/2" "reloadedText=posted" > /dev/null
+$SMITC get "http://127.0.0.1:$PORT/$PROJECT1/issues/2?format=json" | grep -o "^{\"properties\":{[^}]*}" >> $TEST_NAME.out
+
+echo ">>> concurrent posts, reads and reloads" >> $TEST_NAME.out
+(
+    for n in 1 2 3 4 5 6 7 8 9 10; do
+        $SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/1" "+message=reload_message_$n" > /dev/null &
+        getIssues > /dev/null &
+        reload &
+    done
+    wait
+)
+getIssues >> $TEST_NAME.out
+stopServer > /dev/null
+countMessages reload_message >> $TEST_NAME.out
+$SMIT fsck $REPO | sed -e "s;^$REPO/;;" >> $TEST_NAME.out
+
+rm -f $COOKIES
+diff $srcdir/$TEST_NAME.ref $TEST_NAME.out
@@ -0,0 +1,64 @@
+#!/bin/sh
+
+# test the packing of objects (smit repack)
+
+. $srcdir/functions
+
+initTest
+rm -f $TEST_NAME.out
+
+cleanRepo
+initRepo
+
+SMITC=$srcdir/../bin/smitc
+OBJECTS=$REPO/$PROJECT1/.smip/objects
+
+countLooseObjects() {
+    find $OBJECTS -type f ! -path "$OBJECTS/pack/*" | wc -l
+}
+countPacks() {
+    ls $OBJECTS/pack/*.idx | wc -l
+}
+
+$SMIT issue -h $REPO/$PROJECT1 1 > $TEST_NAME.issue1.before
+
+echo ">>> repack" >> $TEST_NAME.out
+$SMIT repack $REPO | sed -e "s;^$REPO/;;" >> $TEST_NAME.out
+echo "loose objects: `countLooseObjects`" >> $TEST_NAME.out
+echo "packs: `countPacks`" >> $TEST_NAME.out
+
+# the issue must be loaded from the pack
+$SMIT issue -h $REPO/$PROJECT1 1 > $TEST_NAME.issue1.after
+if diff $TEST_NAME.issue1.before $TEST_NAME.issue1.after; then
+    echo "issue 1 unchanged after repack" >> $TEST_NAME.out
+fi
+
+# new entries are written as loose objects
+echo ">>> add entry" >> $TEST_NAME.out
+$SMIT issue $REPO/$PROJECT1 -a 1 status=closed
+echo "loose objects: `countLooseObjects`" >> $TEST_NAME.out
+
+echo ">>> repack again" >> $TEST_NAME.out
+$SMIT repack $REPO | sed -e "s;^$REPO/;;" >> $TEST_NAME.out
+echo "loose objects: `countLooseObjects`" >> $TEST_NAME.out
+echo "packs: `countPacks`" >> $TEST_NAME.out
+$SMIT issue $REPO/$PROJECT1 >> $TEST_NAME.out
+
+# packed objects are served by the server
+startServer
+$SMITC signin http://127.0.0.1:$PORT $USER1 $PASSWD1 >> $TEST_NAME.out
+echo ">>> get files" >> $TEST_NAME.out
+curl -s -b .smitcCookie "http://127.0.0.1:$PORT/$PROJECT1/files" | sort > $TEST_NAME.objects
+wc -l < $TEST_NAME.objects >> $TEST_NAME.out
+entry=`$SMIT issue -h $REPO/$PROJECT1 1 | grep -m 1 "^[0-9a-f]\{40\}" | cut -c1-40`
+[ -n "$entry" ] || entry=`head -n 1 $TEST_NAME.objects`
+curl -s -b .smitcCookie "http://127.0.0.1:$PORT/$PROJECT1/files/$entry" > $TEST_NAME.object
+sha1=`sha1sum < $TEST_NAME.object | cut -c1-40`
+if [ "$sha1" = "$entry" ]; then
+    echo "packed object served with valid contents" >> $TEST_NAME.out
+fi
+stopServer
+
+rm -f $TEST_NAME.issue1.before $TEST_NAME.issue1.after $TEST_NAME.objects $TEST_NAME.object
+
+diff $srcdir/$TEST_NAME.ref $TEST_NAME.out
@@ -0,0 +1,77 @@
+#!/bin/sh
+
+# test the snapshots of the list of issues (states of the issues in the past)
+
+. $srcdir/functions
+
+initTest
+rm -f $TEST_NAME.out
+
+cleanRepo
+initEmptyRepo
+
+SMITC=$srcdir/../bin/smitc
+REFS=$REPO/$PROJECT1/.smip/refs/issues
+
+e=`storeEntry null 1000 "summary a
+status open
+owner tuser1"`
+e=`storeEntry $e 2000 "status closed"`
+printf $e > $REFS/1
+
+e=`storeEntry null 1500 "summary b
+status open"`
+e=`storeEntry $e 2500 "summary b2
+owner tuser1"`
+printf $e > $REFS/2
+
+e=`storeEntry null 3000 "summary c
+status closed"`
+printf $e > $REFS/3
+
+# an entry older than the previous one is taken into account only after it
+e=`storeEntry null 1200 "summary d
+status open"`
+e=`storeEntry $e 3500 "status closed"`
+e=`storeEntry $e 3200 "status open
+owner tuser1"`
+printf $e > $REFS/4
+
+snapshot() {
+    echo ">>> $1" >> $TEST_NAME.out
+    $SMITC get "http://127.0.0.1:$PORT/$PROJECT1/issues/?format=csv&colspec=id+summary+status+owner&$1" >> $TEST_NAME.out
+}
+
+startServer
+$SMITC signin http://127.0.0.1:$PORT $USER1 $PASSWD1 > /dev/null
+
+snapshot "snapshot=999"
+snapshot "snapshot=1000"
+snapshot "snapshot=1600"
+snapshot "snapshot=2200"
+snapshot "snapshot=3300"
+snapshot "snapshot=3400"
+snapshot "snapshot=3500"
+snapshot "snapshot=2200&filterin=status:open"
+snapshot "snapshot=2200&filterout=status:open"
+snapshot "snapshot=2600&filterin=owner:me"
+snapshot "snapshot=3300&filterin=status:closed&filterin=summary:a"
+snapshot "snapshot=2600&sort=-summary"
+snapshot "snapshot=3300&sort=status-mtime"
+snapshot "snapshot=3500&sort=-id&offset=1&limit=2"
+snapshot "snapshot=3500&offset=10"
+
+echo ">>> counts" >> $TEST_NAME.out
+$SMITC get "http://127.0.0.1:$PORT/$PROJECT1/issues/?snapshot=999,1000,1600,2200,3300,3500" >> $TEST_NAME.out
+$SMITC get "http://127.0.0.1:$PORT/$PROJECT1/issues/?snapshot=1600,2200,3300,3500&filterin=status:open" >> $TEST_NAME.out
+
+echo ">>> issue 3 reopened, issue 5 created" >> $TEST_NAME.out
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/3" "status=open" > /dev/null
+$SMITC post "http://127.0.0.1:$PORT/$PROJECT1/issues/new" "summary=e" "status=open" > /dev/null
+snapshot "snapshot=3500&filterin=status:open"
+snapshot "snapshot=9999999999&filterin=status:open"
+$SMITC get "http://127.0.0.1:$PORT/$PROJECT1/issues/?snapshot=3500,9999999999&filterin=status:open" >> $TEST_NAME.out
+
+stopServer > /dev/null
+
+diff $srcdir/$TEST_NAME.ref $TEST_NAME.out
@@ -0,0 +1,116 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <fnmatch.h>
+#include <string>
+#include <vector>
+
+#include "utest.h"
+#include "stringSearch.h"
+
+// reference: mg_strcasestr of mongoose
+static const char *refStrcasestr(const char *big_str, const char *small_str)
+{
+    int i, big_len = strlen(big_str), small_len = strlen(small_str);
+
+    for (i = 0; i <= big_len - small_len; i++) {
+        int j;
+        for (j = 0; j < small_len; j++) {
+            if (tolower((unsigned char)big_str[i+j]) != tolower((unsigned char)small_str[j])) break;
+        }
+        if (j == small_len) return big_str + i;
+    }
+    return NULL;
+}
+
+// characters around the boundaries of the folding, and UTF-8 bytes
+static const char Alphabet[] = "aAbBzZ@[`{09 \xc3\xa9\xc3\x89\x80\xff";
+
+static std::string randomString(size_t len)
+{
+    std::string s;
+    for (size_t i = 0; i < len; i++) s += Alphabet[rand() % (sizeof(Alphabet) - 1)];
+    return s;
+}
+
+static std::string flipCase(const std::string &s)
+{
+    std::string result = s;
+    for (size_t i = 0; i < result.size(); i++) {
+        if (rand() % 2) result[i] = isupper((unsigned char)result[i]) ? tolower((unsigned char)result[i]) :
+                                                                          toupper((unsigned char)result[i]);
+    }
+    return result;
+}
+
+static void checkAllKernels(const std::vector<std::pair<std::string, FindNoCaseFunction> > &kernels,
+                            const std::string &text, const std::string &pattern)
+{
+    const char *expected = refStrcasestr(text.c_str(), pattern.c_str());
+    for (size_t k = 0; k < kernels.size(); k++) {
+        const char *found = kernels[k].second(text.c_str(), text.size(), pattern.c_str(), pattern.size());
+        ASSERT(found == expected);
+        if (found != expected) {
+            fprintf(stderr, " kernel %s, text='%s', pattern='%s'\n", kernels[k].first.c_str(),
+                    text.c_str(), pattern.c_str());
+        }
+    }
+    ASSERT(findNoCase(text.c_str(), pattern.c_str()) == expected);
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<std::pair<std::string, FindNoCaseFunction> > kernels;
+    getFindNoCaseKernels(kernels);
+    fprintf(stderr, "kernels:");
+    for (size_t k = 0; k < kernels.size(); k++) fprintf(stderr, " %s", kernels[k].first.c_str());
+    fprintf(stderr, "\n");
+
+    // simple cases
+    checkAllKernels(kernels, "", "");
+    checkAllKernels(kernels, "abc", "");
+    checkAllKernels(kernels, "", "a");
+    checkAllKernels(kernels, "Hello World", "WORLD");
+    checkAllKernels(kernels, "Hello World", "world!");
+    checkAllKernels(kernels, "[@`{", "{");
+    checkAllKernels(kernels, "Caf\xc3\xa9 au lait", "CAF\xc3\xa9");
+    checkAllKernels(kernels, "Caf\xc3\xa9 au lait", "caf\xc3\x89"); // no folding of non-ASCII
+    ASSERT(findNoCase("xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxABCxxxxxxxxxxxxxxxxxxxxxxxxx", "abc") != 0);
+
+    // random texts and patterns, of lengths around the sizes of the vectors
+    srand(12345);
+    for (int i = 0; i < 20000; i++) {
+        std::string text = randomString(rand() % 100);
+        std::string pattern;
+        if (!text.empty() && rand() % 2) {
+            // a substring of the text, with the case modified
+            size_t start = rand() % text.size();
+            size_t len = rand() % (text.size() - start + 1);
+            pattern = flipCase(text.substr(start, len));
+        } else {
+            pattern = randomString(rand() % 4);
+        }
+        checkAllKernels(kernels, text, pattern);
+    }
+
+    // the text is taken up to the null character
+    ASSERT(findNoCase("abc\0def", "def") == 0);
+
+    // equalNoCase and fnmatch on patterns without special characters
+    const char *values[] = { "open", "Open", "OPEN", "opened", "ope", "", "caf\xc3\xa9", "CAF\xc3\xa9",
+                             "CAF\xc3\x89", "a b", "A B", "@`{", 0 };
+    for (int i = 0; values[i]; i++) {
+        ASSERT(!isGlobPattern(values[i]));
+        for (int j = 0; values[j]; j++) {
+            bool expected = (0 == fnmatch(values[i], values[j], FNM_CASEFOLD));
+            ASSERT(equalNoCase(values[i], values[j]) == expected);
+        }
+    }
+    ASSERT(isGlobPattern("op*"));
+    ASSERT(isGlobPattern("op?n"));
+    ASSERT(isGlobPattern("[oc]pen"));
+    ASSERT(isGlobPattern("\\*"));
+
+    utestEnd();
+}
@@ -0,0 +1,84 @@
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <vector>
+
+#include "utest.h"
+#include "threadPool.h"
+
+pthread_mutex_t Mutex = PTHREAD_MUTEX_INITIALIZER;
+int Counter = 0;
+std::vector<int> Order;
+
+void increment(void *arg)
+{
+    int *x = (int*)arg;
+    pthread_mutex_lock(&Mutex);
+    Counter += *x;
+    Order.push_back(*x);
+    pthread_mutex_unlock(&Mutex);
+}
+
+int main(int argc, char **argv)
+{
+    // several workers: all jobs executed
+    const int N = 1000;
+    std::vector<int> values(N);
+    for (int i = 0; i < N; i++) values[i] = i+1;
+
+    {
+        ThreadPool pool(8);
+        ASSERT(pool.getNumWorkers() == 8);
+        for (int i = 0; i < N; i++) pool.submit(increment, &values[i]);
+        pool.waitAll();
+        ASSERT(Counter == N*(N+1)/2);
+        ASSERT((int)Order.size() == N);
+
+        // the pool may be reused after waitAll
+        pool.submit(increment, &values[0]);
+        pool.waitAll();
+        ASSERT(Counter == N*(N+1)/2 + 1);
+    }
+
+    // a shared pool: each submitter waits for its own jobs
+    Counter = 0;
+    {
+        ThreadPool pool(4);
+        ThreadPool::JobGroup group1, group2;
+        for (int i = 0; i < N; i++) pool.submit(increment, &values[i], (i % 2) ? &group1 : &group2);
+        pool.wait(group1);
+        ASSERT(group1.pending == 0);
+        pool.wait(group2);
+        ASSERT(group2.pending == 0);
+        ASSERT(Counter == N*(N+1)/2);
+
+        // a group with no job
+        ThreadPool::JobGroup group3;
+        pool.wait(group3);
+    }
+
+    // a single worker executes the jobs in order of submission
+    Counter = 0;
+    Order.clear();
+    {
+        ThreadPool pool(1);
+        for (int i = 0; i < N; i++) pool.submit(increment, &values[i]);
+        // no waitAll: the destructor waits for the completion
+    }
+    ASSERT(Counter == N*(N+1)/2);
+    bool inOrder = true;
+    for (int i = 0; i < N; i++) if (Order[i] != i+1) inOrder = false;
+    ASSERT(inOrder);
+
+    // invalid number of workers
+    {
+        ThreadPool pool(0);
+        ASSERT(pool.getNumWorkers() == 1);
+    }
+
+    ASSERT(ThreadPool::getNumCpus() >= 1);
+
+    utestEnd();
+}
@@ -0,0 +1,138 @@
+/** Count the allocations done when copying issues for the requests
+  *
+  * Usage: bench_issueCopy [-n <issues>] [-r <requests>] [-p <page-size>]
+  *
+  * The readers of a project copy the issues under the read lock (see
+  * Project::get and Project::search). This program builds issues with
+  * typical properties, and reports the allocations (count and bytes)
+  * and the time per request:
+  * - get: copy of one issue (page of an issue)
+  * - page: copy of a page of issues (list with a limit)
+  * - list: copy of all the issues (list without limit)
+  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <sys/time.h>
+#include <string>
+#include <vector>
+
+#include "project/Issue.h"
+
+static size_t Allocations = 0;
+static size_t AllocatedBytes = 0;
+
+void *operator new(size_t size)
+{
+    Allocations++;
+    AllocatedBytes += size;
+    void *p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) throw()
+{
+    free(p);
+}
+
+static double now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static const char *Statuses[] = { "open", "closed", "deferred" };
+static const char *Owners[] = { "alice", "bob", "carol", "dave" };
+static const char *Components[] = { "core", "gui", "doc", "build", "network" };
+
+static Issue *createIssue(int n)
+{
+    Issue *issue = new Issue();
+    char id[16];
+    snprintf(id, sizeof(id), "%d", n);
+    issue->id = id;
+    issue->project = "bench";
+    issue->ctime = 1500000000 + n;
+    issue->mtime = issue->ctime + 3600;
+
+    PropertiesMap properties;
+    char summary[128];
+    snprintf(summary, sizeof(summary), "The summary of issue %d, long enough not to be interned", n);
+    properties["summary"].push_back(summary);
+    properties["status"].push_back(Statuses[n % 3]);
+    properties["owner"].push_back(Owners[n % 4]);
+    properties["component"].push_back(Components[n % 5]);
+    properties["priority"].push_back(n % 2 ? "high" : "low");
+    properties["labels"].push_back("bug");
+    properties["labels"].push_back(Components[(n + 1) % 5]);
+    issue->properties = properties;
+    return issue;
+}
+
+struct Measure {
+    size_t allocations;
+    size_t bytes;
+    double t0;
+    void start() { allocations = Allocations; bytes = AllocatedBytes; t0 = now(); }
+    void stop(const char *name, int requests) {
+        double t = now() - t0;
+        printf("%-5s %12.1f allocs/req %12.1f bytes/req %10.2f us/req\n", name,
+               (double)(Allocations - allocations) / requests, (double)(AllocatedBytes - bytes) / requests,
+               t * 1000000 / requests);
+    }
+};
+
+int main(int argc, char **argv)
+{
+    int nIssues = 10000;
+    int nRequests = 1000;
+    int pageSize = 50;
+    for (int i = 1; i < argc; i++) {
+        if (0 == strcmp(argv[i], "-n") && i+1 < argc) nIssues = atoi(argv[++i]);
+        else if (0 == strcmp(argv[i], "-r") && i+1 < argc) nRequests = atoi(argv[++i]);
+        else if (0 == strcmp(argv[i], "-p") && i+1 < argc) pageSize = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: bench_issueCopy [-n <issues>] [-r <requests>] [-p <page-size>]\n");
+            return 1;
+        }
+    }
+    if (nIssues < pageSize || nRequests <= 0) {
+        fprintf(stderr, "Invalid parameters\n");
+        return 1;
+    }
+
+    std::vector<Issue*> issues;
+    for (int i = 0; i < nIssues; i++) issues.push_back(createIssue(i));
+    printf("%d issues, %d requests, pages of %d issues\n", nIssues, nRequests, pageSize);
+
+    Measure m;
+    m.start();
+    for (int r = 0; r < nRequests; r++) {
+        Issue copy(*issues[r % nIssues]);
+    }
+    m.stop("get", nRequests);
+
+    m.start();
+    for (int r = 0; r < nRequests; r++) {
+        std::vector<Issue> page;
+        page.reserve(pageSize);
+        int offset = (r * pageSize) % (nIssues - pageSize + 1);
+        for (int i = offset; i < offset + pageSize; i++) page.push_back(*issues[i]);
+    }
+    m.stop("page", nRequests);
+
+    int nLists = nRequests / 100 + 1;
+    m.start();
+    for (int r = 0; r < nLists; r++) {
+        std::vector<Issue> list;
+        list.reserve(nIssues);
+        std::vector<Issue*>::const_iterator i;
+        for (i = issues.begin(); i != issues.end(); i++) list.push_back(**i);
+    }
+    m.stop("list", nLists);
+
+    return 0;
+}
@@ -0,0 +1,111 @@
+/** Compare the speed of parseConfigTokens and TokenViews
+  *
+  * Usage: bench_parseConfig [-n <iterations>] <file-or-directory> ...
+  *
+  * Directories are scanned recursively, so that the loose objects of
+  * a project may be given (eg: repo/project/.smip/objects).
+  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <string>
+#include <vector>
+
+#include "parseConfig.h"
+
+static double now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void loadFiles(const std::string &path, std::vector<std::string> &files)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        fprintf(stderr, "Cannot stat '%s'\n", path.c_str());
+        return;
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+        DIR *d = opendir(path.c_str());
+        if (!d) return;
+        struct dirent *de;
+        while ((de = readdir(d))) {
+            if (de->d_name[0] == '.') continue;
+            loadFiles(path + "/" + de->d_name, files);
+        }
+        closedir(d);
+        return;
+    }
+
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) return;
+    std::string data;
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) data.append(buffer, n);
+    fclose(f);
+    files.push_back(data);
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = 100;
+    std::vector<std::string> files;
+    int i;
+    for (i=1; i<argc; i++) {
+        if (0 == strcmp(argv[i], "-n") && i+1 < argc) iterations = atoi(argv[++i]);
+        else loadFiles(argv[i], files);
+    }
+    if (files.empty()) {
+        fprintf(stderr, "Usage: bench_parseConfig [-n <iterations>] <file-or-directory> ...\n");
+        return 1;
+    }
+
+    size_t totalSize = 0;
+    std::vector<std::string>::const_iterator f;
+    for (f=files.begin(); f!=files.end(); f++) totalSize += f->size();
+
+    // parseConfigTokens
+    size_t nTokens1 = 0;
+    double t0 = now();
+    for (i=0; i<iterations; i++) {
+        for (f=files.begin(); f!=files.end(); f++) {
+            std::list<std::list<std::string> > lines = parseConfigTokens(f->data(), f->size());
+            std::list<std::list<std::string> >::const_iterator line;
+            for (line=lines.begin(); line!=lines.end(); line++) nTokens1 += line->size();
+        }
+    }
+    double t1 = now();
+
+    // TokenViews
+    size_t nTokens2 = 0;
+    TokenViews views;
+    for (i=0; i<iterations; i++) {
+        for (f=files.begin(); f!=files.end(); f++) {
+            views.parse(f->data(), f->size());
+            nTokens2 += views.tokens.size();
+        }
+    }
+    double t2 = now();
+
+    printf("files: %lu, bytes: %lu, iterations: %d\n", (unsigned long)files.size(),
+           (unsigned long)totalSize, iterations);
+    printf("parseConfigTokens: %.3fs (%.1f MB/s)\n", t1 - t0,
+           totalSize * iterations / (t1 - t0) / 1000000);
+    printf("TokenViews:        %.3fs (%.1f MB/s)\n", t2 - t1,
+           totalSize * iterations / (t2 - t1) / 1000000);
+
+    if (nTokens1 != nTokens2) {
+        fprintf(stderr, "Error: different number of tokens: %lu / %lu\n",
+                (unsigned long)nTokens1, (unsigned long)nTokens2);
+        return 1;
+    }
+    return 0;
+}
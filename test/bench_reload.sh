@@ -0,0 +1,104 @@
+#!/bin/sh
+
+# Benchmark of the read stalls caused by the reloads of a project
+#
+# usage: bench_reload.sh [<issues> [<entries per issue> [<readers> [<reloads>]]]]
+#
+# A project is populated through the server. Then several clients read
+# the list of issues continuously, first without reload, then while the
+# project is reloaded. The latencies of the reads of both phases are
+# printed, with the durations of the reloads.
+#
+# Run it from the test directory, once smit and the tests are built.
+
+srcdir=${srcdir:-.}
+. $srcdir/functions
+
+NISSUES=${1:-5000}
+NENTRIES=${2:-4}
+NREADERS=${3:-4}
+NRELOADS=${4:-5}
+
+SMITC=$srcdir/../bin/smitc
+URL=http://127.0.0.1:$PORT/$PROJECT1
+COOKIES=bench_reload.cookies
+STOP=bench_reload.stop
+TIMES=bench_reload.times
+
+# create the issues <first>, <first> + <step>, ... and their entries
+# usage: populate <first> <step>
+populate() {
+    i=$1
+    while [ $i -le $NISSUES ]; do
+        r=`$SMITC post "$URL/issues/new" "summary=issue $i" status=open "+message=message 1 of issue $i"`
+        id=`echo $r | sed -e "s;/.*;;"`
+        j=2
+        while [ $j -le $NENTRIES ]; do
+            $SMITC post "$URL/issues/$id" "+message=message $j of issue $i" > /dev/null
+            j=`expr $j + 1`
+        done
+        i=`expr $i + $2`
+    done
+}
+
+# read the list of issues until the stop file exists, and log the durations
+# usage: readIssues <log>
+readIssues() {
+    while [ ! -f $STOP ]; do
+        curl -s -b .smitcCookie -o /dev/null -w "%{time_total}\n" \
+             "$URL/issues/?colspec=id+summary+status&sort=id&format=text&limit=100" >> $1
+    done
+}
+
+# run the readers while a command runs
+# usage: withReaders <label> <command...>
+withReaders() {
+    label=$1
+    shift
+    rm -f $STOP $TIMES.*
+    n=1
+    while [ $n -le $NREADERS ]; do
+        readIssues $TIMES.$n &
+        n=`expr $n + 1`
+    done
+    "$@"
+    touch $STOP
+    wait
+    cat $TIMES.* | sort -n | awk -v label="$label" '
+        { t[NR] = $1 * 1000; if ($1 > 0.05) slow++ }
+        END { printf "%s: %d reads, median %.1f ms, max %.1f ms, %d reads above 50 ms\n",
+                     label, NR, t[int((NR + 1) / 2)], t[NR], slow }'
+    rm -f $STOP $TIMES.*
+}
+
+reloads() {
+    k=1
+    while [ $k -le $NRELOADS ]; do
+        sleep 1
+        curl -s -b $COOKIES -o /dev/null -w "reload $k: %{time_total} s\n" -X POST "$URL/reload"
+        k=`expr $k + 1`
+    done
+    sleep 1
+}
+
+idle() {
+    sleep `expr $NRELOADS + 1`
+}
+
+cleanRepo > /dev/null
+initEmptyRepo > /dev/null
+
+startServer
+$SMITC signin http://127.0.0.1:$PORT $USER1 $PASSWD1 > /dev/null
+curl -s -c $COOKIES -X POST -d "username=$USER_SUPER&password=$PASSWD_SUPER" "http://127.0.0.1:$PORT/signin?format=text" > /dev/null
+
+echo "populating $NISSUES issues of $NENTRIES entries..."
+populate 1 4 & populate 2 4 & populate 3 4 & populate 4 4 &
+wait
+
+echo "$NREADERS readers, $NRELOADS reloads"
+withReaders "without reload" idle
+withReaders "with reloads" reloads
+
+stopServer > /dev/null
+rm -f $COOKIES
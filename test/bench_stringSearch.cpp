@@ -0,0 +1,134 @@
+/** Compare the speed of the case-insensitive search kernels and mg_strcasestr
+  *
+  * Usage: bench_stringSearch [-n <iterations>] [<pattern> ...]
+  *
+  * The texts look like the properties and messages of issues: 80% of
+  * short values, 20% of messages of a few hundred bytes.
+  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/time.h>
+#include <string>
+#include <vector>
+
+#include "stringSearch.h"
+
+static double now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+// same as mg_strcasestr of mongoose
+static int lowercase(const char *s)
+{
+    return tolower(* (const unsigned char *) s);
+}
+
+static int mg_strncasecmp(const char *s1, const char *s2, size_t len)
+{
+    int diff = 0;
+
+    if (len > 0)
+        do {
+            diff = lowercase(s1++) - lowercase(s2++);
+        } while (diff == 0 && s1[-1] != '\0' && --len > 0);
+
+    return diff;
+}
+
+static const char *mg_strcasestr(const char *big_str, const char *small_str)
+{
+    int i, big_len = strlen(big_str), small_len = strlen(small_str);
+
+    for (i = 0; i <= big_len - small_len; i++) {
+        if (mg_strncasecmp(big_str + i, small_str, small_len) == 0) {
+            return big_str + i;
+        }
+    }
+
+    return NULL;
+}
+
+static const char *Words[] = { "the", "issue", "Server", "crash", "when", "loading", "project", "with",
+                               "Unicode", "caf\xc3\xa9", "timeout", "in", "HTTP", "request", "fixed",
+                               "by", "commit", "Please", "check", "again", "memory", "leak", 0 };
+
+static std::string randomText(size_t nWords)
+{
+    int nw = 0;
+    while (Words[nw]) nw++;
+    std::string text;
+    for (size_t i = 0; i < nWords; i++) {
+        if (i) text += ' ';
+        text += Words[rand() % nw];
+    }
+    return text;
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = 20;
+    std::vector<std::string> patterns;
+    for (int i = 1; i < argc; i++) {
+        if (0 == strcmp(argv[i], "-n") && i+1 < argc) iterations = atoi(argv[++i]);
+        else patterns.push_back(argv[i]);
+    }
+    if (patterns.empty()) {
+        patterns.push_back("zorglub"); // not found: the whole texts are scanned
+        patterns.push_back("MEMORY LEAK");
+        patterns.push_back("x");
+    }
+
+    srand(1);
+    std::vector<std::string> texts;
+    size_t totalSize = 0;
+    for (int i = 0; i < 100000; i++) {
+        if (i % 5) texts.push_back(randomText(1 + rand() % 6));
+        else texts.push_back(randomText(30 + rand() % 100));
+        totalSize += texts.back().size();
+    }
+    printf("texts: %lu, bytes: %lu, iterations: %d\n", (unsigned long)texts.size(),
+           (unsigned long)totalSize, iterations);
+
+    std::vector<std::pair<std::string, FindNoCaseFunction> > kernels;
+    getFindNoCaseKernels(kernels);
+
+    std::vector<std::string>::const_iterator pattern;
+    for (pattern = patterns.begin(); pattern != patterns.end(); pattern++) {
+        size_t nFound = 0;
+        double t0 = now();
+        for (int i = 0; i < iterations; i++) {
+            std::vector<std::string>::const_iterator t;
+            for (t = texts.begin(); t != texts.end(); t++) {
+                if (mg_strcasestr(t->c_str(), pattern->c_str())) nFound++;
+            }
+        }
+        double t = now() - t0;
+        printf("'%s': found in %lu texts\n", pattern->c_str(), (unsigned long)nFound / iterations);
+        printf("  mg_strcasestr %8.3fs (%7.1f MB/s)\n", t, totalSize * iterations / t / 1000000);
+
+        for (size_t k = 0; k < kernels.size(); k++) {
+            size_t nFoundKernel = 0;
+            t0 = now();
+            for (int i = 0; i < iterations; i++) {
+                std::vector<std::string>::const_iterator t;
+                for (t = texts.begin(); t != texts.end(); t++) {
+                    if (kernels[k].second(t->c_str(), t->size(), pattern->c_str(), pattern->size())) nFoundKernel++;
+                }
+            }
+            t = now() - t0;
+            printf("  %-13s %8.3fs (%7.1f MB/s)\n", kernels[k].first.c_str(), t,
+                   totalSize * iterations / t / 1000000);
+            if (nFoundKernel != nFound) {
+                fprintf(stderr, "Error: kernel %s found %lu texts instead of %lu\n", kernels[k].first.c_str(),
+                        (unsigned long)nFoundKernel / iterations, (unsigned long)nFound / iterations);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}